@@ -18,6 +18,8 @@ struct FunctionHeader {
   uint32_t size;
   uint32_t paramCount;
   uint32_t functionNameID;
+  uint32_t frameSize;
+  uint32_t inlineCacheCount;
 };
 
 // This class represents the in-memory representation of the bytecode function.
@@ -25,14 +27,42 @@ class BytecodeFunction {
   
   std::vector<opcode_t> opcodesAndJumpTables_;
   
+  /// The number of declared parameters, not including 'this'.
+  uint32_t paramCount_;
+  
+  /// The number of registers used by the function's frame.
+  uint32_t frameSize_;
+  
+  /// The number of inline cache slots used by the function's instructions.
+  uint32_t inlineCacheCount_;
+  
 public:
-  explicit BytecodeFunction(std::vector<opcode_t> &&opcodesAndJumpTables)
-      : opcodesAndJumpTables_(std::move(opcodesAndJumpTables)) {}
+  explicit BytecodeFunction(
+      std::vector<opcode_t> &&opcodesAndJumpTables,
+      uint32_t paramCount,
+      uint32_t frameSize,
+      uint32_t inlineCacheCount)
+      : opcodesAndJumpTables_(std::move(opcodesAndJumpTables)),
+        paramCount_(paramCount),
+        frameSize_(frameSize),
+        inlineCacheCount_(inlineCacheCount) {}
   
   std::vector<opcode_t> &getOpcodes() {
     return opcodesAndJumpTables_;
   }
   
+  uint32_t getParamCount() const {
+    return paramCount_;
+  }
+  
+  uint32_t getFrameSize() const {
+    return frameSize_;
+  }
+  
+  uint32_t getInlineCacheCount() const {
+    return inlineCacheCount_;
+  }
+  
 };
 
 class BytecodeModule {
@@ -26,6 +26,9 @@ struct Relocation {
     JumpType = 0,
     // A long jump instruction
     LongJumpType,
+    // A jump instruction with wide register operands, which has no short
+    // variant and keeps its 4 bytes target
+    WideJumpType,
     // A basic block
     BasicBlockType,
     // A catch instruction
@@ -37,7 +40,7 @@ struct Relocation {
   /// Type of the relocation.
   RelocationType type;
   /// We multiplex pointer for different things under different types:
-  /// If the type is jump or long jump, pointer is the target basic block;
+  /// If the type is a jump, pointer is the target basic block;
   /// if the type is basic block, pointer is the pointer to it.
   /// if the type is catch instruction, pointer is the pointer to it.
   Value *pointer;
@@ -59,9 +62,19 @@ class BytecodeFunctionGenerator : public BytecodeInstructionGenerator {
   /// The list of all jump instructions and jump targets that require
   /// relocation and address resolution.
   std::vector<Relocation> relocations_{};
+  
+  /// The number of inline cache slots used by the GetField and SetField
+  /// instructions of this function.
+  uint32_t inlineCacheCount_{0};
       
   void emitMovIfNeeded(param_t dest, param_t src);
   
+  /// \return true if the register \p reg does not fit in a Reg8 operand, so
+  /// the instruction using it must be encoded with its wide variant.
+  static bool isWideRegister(param_t reg) {
+    return reg > UINT8_MAX;
+  }
+  
 public:
   explicit BytecodeFunctionGenerator(
       BytecodeGenerator &BCGen,
@@ -77,7 +90,7 @@ public:
         new BytecodeFunctionGenerator(BCGen, F, RA));
   }
   
-  /// Add long jump instruction to the relocation list.
+  /// Add long or wide jump instruction to the relocation list.
   void addJumpToRelocations(offset_t loc, BasicBlock *target);
   
   void generateJumpTable();
@@ -86,6 +99,11 @@ public:
   
   unsigned encodeValue(Value *value);
   
+  /// \return a new inline cache index for a GetField or SetField instruction.
+  /// The cache index operand is 16 bits wide, once all of them are taken the
+  /// remaining instructions get kNoInlineCacheIndex and have no slot.
+  uint16_t allocateInlineCacheIndex();
+  
 #define INCLUDE_HBC_INSTRS
 #define DEF_VALUE(CLASS, PARENT) \
   void generate##CLASS(CLASS *Inst, BasicBlock *next);
@@ -119,6 +137,18 @@ public:
     }
   }
   
+  /// \return true if \p op is the wide variant of a jump instruction.
+  static bool isWideJump(opcode_t op) {
+    switch (op) {
+#define DEFINE_JUMP_WIDE_VARIANT(name, nameWide) \
+  case nameWide##Op:                             \
+    return true;
+#include "cobra/BCGen/BytecodeList.def"
+      default:
+        return false;
+    }
+  }
+  
 };
 
 class BytecodeGenerator : public BytecodeInstructionGenerator {
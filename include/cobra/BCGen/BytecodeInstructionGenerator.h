@@ -154,6 +154,10 @@ public:
   offset_t emitLoadConstDoubleDirect(param_t dst, double value) {
     return emitLoadConstDouble(dst, DoubleToBits(value));
   }
+  
+  offset_t emitLoadConstDoubleWideDirect(param_t dst, double value) {
+    return emitLoadConstDoubleWide(dst, DoubleToBits(value));
+  }
 };
 
 }
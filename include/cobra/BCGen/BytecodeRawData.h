@@ -30,6 +30,14 @@ public:
     return byteCodeModule_->getFunction(functionID).getOpcodes().data();
   }
   
+  uint32_t getNumFunctions() const {
+    return byteCodeModule_->getNumFunctions();
+  }
+  
+  BytecodeFunction &getFunction(uint32_t functionID) const {
+    return byteCodeModule_->getFunction(functionID);
+  }
+  
 };
 
 }
@@ -8,8 +8,27 @@
 #ifndef Lowering_h
 #define Lowering_h
 
+#include "cobra/IR/IR.h"
+#include "cobra/IR/Instrs.h"
+#include "cobra/Optimizer/Pass.h"
+
 namespace cobra {
 
+/// Fuse a comparison whose only user is a conditional branch with that
+/// branch, into a CompareBranchInst that is emitted as a single jump
+/// instruction.
+class LowerCondBranch : public FunctionPass {
+ public:
+  explicit LowerCondBranch() : FunctionPass("LowerCondBranch") {}
+  ~LowerCondBranch() override = default;
+
+  bool runOnFunction(Function *F) override;
+  
+ private:
+  /// \return true if the comparison \p op can be fused with a branch.
+  static bool isOperatorSupported(BinaryOperatorInst::OpKind op);
+};
+
 }
 
 #endif
@@ -53,6 +53,11 @@ public:
   VirtualRegister allocateRegister();
   
   void killRegister(VirtualRegister reg);
+  
+  /// \returns the number of registers that were allocated at some point.
+  unsigned getMaxRegisterUsage() const {
+    return registers.size();
+  }
 };
 
 struct LiveRange {
@@ -253,6 +258,11 @@ public:
   
   bool isAllocated(Value *I);
   
+  /// \returns the number of registers needed by the frame of the function.
+  unsigned getMaxRegisterUsage() const {
+    return registerManager.getMaxRegisterUsage();
+  }
+  
   
 };
 
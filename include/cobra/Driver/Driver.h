@@ -18,6 +18,12 @@ namespace driver {
 
 bool compile(std::string source);
 
+#ifdef COBRA_ENABLE_LLVM_BACKEND
+/// Compile \p source ahead of time with the LLVM backend, and write the
+/// native object file to \p path instead of running it.
+bool compileToObject(std::string source, const std::string &path);
+#endif
+
 
 } // namespace driver
 } // namespace cobra
@@ -304,7 +304,9 @@ class Type {
   friend std::ostream& operator<<(std::ostream &OS, const Type &T);
 
   constexpr bool operator==(Type RHS) const {
-    return bitmask_ == RHS.bitmask_;
+    return bitmask_ == RHS.bitmask_ &&
+        (!(bitmask_ & (1 << TypeKind::Number)) ||
+         numBitmask_ == RHS.numBitmask_);
   }
   constexpr bool operator!=(Type RHS) const {
     return !(*this == RHS);
@@ -83,6 +83,13 @@ public:
   CondBranchInst *
   createCondBranchInst(Value *Cond, BasicBlock *T, BasicBlock *F);
   
+  CompareBranchInst *createCompareBranchInst(
+      Value *left,
+      Value *right,
+      BinaryOperatorInst::OpKind opKind,
+      BasicBlock *T,
+      BasicBlock *F);
+  
   ReturnInst *createReturnInst(Value *Val);
   
   AllocStackInst *createAllocStackInst(Identifier varName);
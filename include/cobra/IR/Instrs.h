@@ -442,6 +442,82 @@ class BinaryOperatorInst : public Instruction {
   getBinarySideEffect(Type leftTy, Type rightTy, OpKind op);
 };
 
+/// A comparison fused with the conditional branch on its result. It is only
+/// created by the LowerCondBranch pass of the bytecode generator.
+class CompareBranchInst : public TerminatorInst {
+  CompareBranchInst(const CompareBranchInst &) = delete;
+  void operator=(const CompareBranchInst &) = delete;
+  
+  BinaryOperatorInst::OpKind op_;
+
+ public:
+  enum { LeftHandSideIdx, RightHandSideIdx, TrueBlockIdx, FalseBlockIdx };
+
+  BinaryOperatorInst::OpKind getOperatorKind() const {
+    return op_;
+  }
+
+  StringRef getOperatorStr() {
+    return BinaryOperatorInst::opStringRepr[static_cast<int>(op_)];
+  }
+
+  Value *getLeftHandSide() const {
+    return getOperand(LeftHandSideIdx);
+  }
+  Value *getRightHandSide() const {
+    return getOperand(RightHandSideIdx);
+  }
+  BasicBlock *getTrueDest() const {
+    return dynamic_cast<BasicBlock *>(getOperand(TrueBlockIdx));
+  }
+  BasicBlock *getFalseDest() const {
+    return dynamic_cast<BasicBlock *>(getOperand(FalseBlockIdx));
+  }
+
+  explicit CompareBranchInst(
+      Value *left,
+      Value *right,
+      BinaryOperatorInst::OpKind opKind,
+      BasicBlock *trueBlock,
+      BasicBlock *falseBlock)
+      : TerminatorInst(ValueKind::CompareBranchInstKind), op_(opKind) {
+    pushOperand(left);
+    pushOperand(right);
+    pushOperand(trueBlock);
+    pushOperand(falseBlock);
+  }
+  explicit CompareBranchInst(
+      const CompareBranchInst *src,
+      std::vector<Value *> &operands)
+      : TerminatorInst(src, operands), op_(src->op_) {}
+
+  SideEffectKind getSideEffect() {
+    return BinaryOperatorInst::getBinarySideEffect(
+        getLeftHandSide()->getType(),
+        getRightHandSide()->getType(),
+        getOperatorKind());
+  }
+
+  static bool classof(const Value *V) {
+    return kindIsA(V->getKind(), ValueKind::CompareBranchInstKind);
+  }
+
+  unsigned getNumSuccessors() {
+    return 2;
+  }
+  BasicBlock *getSuccessor(unsigned idx) const {
+    if (idx == 0)
+      return getTrueDest();
+    if (idx == 1)
+      return getFalseDest();
+    COBRA_UNREACHABLE();
+  }
+  void setSuccessor(unsigned idx, BasicBlock *B) {
+    assert(idx <= 1 && "CompareBranchInst only have 2 successors!");
+    setOperand(B, idx + TrueBlockIdx);
+  }
+};
+
 class PhiInst : public Instruction {
   PhiInst(const PhiInst &) = delete;
   void operator=(const PhiInst &) = delete;
@@ -17,6 +17,7 @@ namespace inst {
 enum class OpCode : uint8_t {
 #define DEFINE_OPCODE(name) name,
 #include "cobra/BCGen/BytecodeList.def"
+  _last
 };
 
 // Define all instructions.
@@ -78,6 +79,10 @@ enum class OpCode : uint8_t {
 
 #include "cobra/BCGen/BytecodeList.def"
 
+/// The cache index operand of the GetField and SetField instructions that
+/// have no inline cache slot, once a method used every other index.
+constexpr uint16_t kNoInlineCacheIndex = UINT16_MAX;
+
 /// A union of all instructions.
 LLVM_PACKED_START
 struct Inst {
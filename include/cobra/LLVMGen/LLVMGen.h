@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef LLVMGen_h
+#define LLVMGen_h
+
+#ifdef COBRA_ENABLE_LLVM_BACKEND
+
+#include "cobra/IR/IR.h"
+
+#include <string>
+
+namespace cobra {
+
+/// Lower the optimized IR of \p M to LLVM IR and write a native object file
+/// for the host to \p path.
+///
+/// Every function F becomes an external symbol with the C signature
+///   uint64_t cobra_F(const uint64_t *params, uint32_t argCount);
+/// where values are raw CBValue encodings, params[0] is 'this' and missing
+/// parameters read as undefined, like in the interpreter. Operations that are
+/// not inlined call the cobra_aot_* entry points of the VM runtime (see
+/// cobra/VM/AOTRuntime.h), so the object links against cobraRuntime.
+///
+/// \return false and set \p error if the module uses IR the backend does not
+/// support yet, or if the object file cannot be written.
+bool generateObjectFile(Module *M, const std::string &path, std::string &error);
+
+}
+
+#endif // COBRA_ENABLE_LLVM_BACKEND
+
+#endif /* LLVMGen_h */
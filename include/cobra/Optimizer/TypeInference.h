@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef TypeInference_h
+#define TypeInference_h
+
+#include "cobra/IR/IR.h"
+#include "cobra/Optimizer/Pass.h"
+
+namespace cobra {
+
+/// Infer the result types of the operators, phis and moves of a function from
+/// the types of their operands, iterating to a fixed point so that values
+/// flowing around loops get a type too.
+///
+/// Number types are sound: a value typed as a number is always a number. The
+/// Int32 kind is speculative for +, - and *, whose int32 operands are assumed
+/// not to overflow. The I32 instructions selected from it check for overflow
+/// and fall back to doubles, so a wrong guess only costs a slow path.
+class TypeInference : public FunctionPass {
+ public:
+  explicit TypeInference() : FunctionPass("TypeInference") {}
+  ~TypeInference() override = default;
+
+  bool runOnFunction(Function *F) override;
+};
+
+} // namespace cobra
+
+#endif
@@ -37,6 +37,14 @@
 #define COBRA_NODISCARD
 #endif
 
+/// Guarantee that a return statement calling a function with the same
+/// signature is compiled to a jump. Only defined when the compiler supports it.
+#if defined(__has_cpp_attribute) && defined(__clang__)
+#if __has_cpp_attribute(clang::musttail)
+#define COBRA_MUSTTAIL [[clang::musttail]]
+#endif
+#endif
+
 #ifdef __GNUC__
 #define LLVM_ATTRIBUTE_NORETURN __attribute__((noreturn))
 #elif defined(_MSC_VER)
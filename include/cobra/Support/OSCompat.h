@@ -32,6 +32,9 @@ namespace oscompat {
 /// Returns the current page size.
 size_t page_size();
 
+/// The size of a transparent huge page, on the platforms that have them.
+static constexpr size_t kHugePageSize = 2 * 1024 * 1024;
+
 // Allocates a virtual memory region of the given size (required to be
 // a multiple of page_size()), and returns a pointer to the start.
 // Optionally specify a page-aligned hint for where to place the mapping.
@@ -80,7 +83,15 @@ void vm_uncommit(void *p, size_t sz);
 /// Mark the \p sz byte region of memory starting at \p p as being a good
 /// candidate for huge pages.
 /// \pre sz must be a multiple of oscompat::page_size().
-void vm_hugepage(void *p, size_t sz);
+/// \return true if the OS took the advice, false if it has no huge pages.
+bool vm_hugepage(void *p, size_t sz);
+
+/// \return the number of bytes of the mappings overlapping the \p sz byte
+/// region of memory starting at \p p that are backed by transparent huge
+/// pages, 0 on platforms that do not report it. This reads the AnonHugePages
+/// of /proc/self/smaps on Linux, which takes time proportional to the number
+/// of mappings of the process.
+size_t vm_hugepage_backed_bytes(const void *p, size_t sz);
 
 /// Mark the \p sz byte region of memory starting at \p p as not currently in
 /// use, so that the OS may free it. \p p must be page-aligned.
@@ -96,7 +107,9 @@ void vm_prefetch(void *p, size_t sz);
 /// for a process (e.g. by /proc/<pid>/maps).
 void vm_name(void *p, size_t sz, const char *name);
 
-enum class ProtectMode { ReadWrite, None };
+/// Page protections. There is deliberately no mode that is both writable and
+/// executable: JIT code is written while ReadWrite and then made ReadExecute.
+enum class ProtectMode { ReadWrite, ReadExecute, None };
 
 bool vm_protect(void *p, size_t sz, ProtectMode mode);
 
@@ -7,8 +7,8 @@
 //
 //===----------------------------------------------------------------------===//
 
-#ifndef String_h
-#define String_h
+#ifndef StringRef_h
+#define StringRef_h
 
 #include <string>
 
@@ -140,4 +140,4 @@ inline std::string &operator+=(std::string &buffer, StringRef string) {
 
 }
 
-#endif /* String_h */
+#endif /* StringRef_h */
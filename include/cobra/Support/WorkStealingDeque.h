@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef WorkStealingDeque_h
+#define WorkStealingDeque_h
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace cobra {
+
+/// Ref to Chase and Lev, Dynamic Circular Work-Stealing Deque
+/// and Le et al., Correct and Efficient Work-Stealing for Weak Memory Models
+///
+/// A deque owned by one thread, which pushes and pops at its bottom, while
+/// the other threads steal from its top. The buffer grows when it is full;
+/// the buffers it outgrew are kept until the deque is destroyed, since a
+/// thief may still be reading them.
+template <typename T>
+class WorkStealingDeque {
+  static_assert(
+      std::is_trivially_copyable<T>::value,
+      "The items are copied with atomic loads and stores");
+
+  class Buffer {
+  public:
+    explicit Buffer(int64_t capacity)
+        : capacity_(capacity), items_(new std::atomic<T>[capacity]) {}
+
+    int64_t capacity() const {
+      return capacity_;
+    }
+
+    T get(int64_t i) const {
+      return items_[i & (capacity_ - 1)].load(std::memory_order_relaxed);
+    }
+
+    void put(int64_t i, T item) {
+      items_[i & (capacity_ - 1)].store(item, std::memory_order_relaxed);
+    }
+
+    /// \return a buffer twice as large holding the items in [top, bottom).
+    Buffer *grow(int64_t bottom, int64_t top) const {
+      auto *buffer = new Buffer(capacity_ * 2);
+      for (int64_t i = top; i < bottom; ++i)
+        buffer->put(i, get(i));
+      return buffer;
+    }
+
+  private:
+    int64_t capacity_;
+    std::unique_ptr<std::atomic<T>[]> items_;
+  };
+
+public:
+  /// Create a deque holding up to \p capacity items, a power of two, before
+  /// it grows.
+  explicit WorkStealingDeque(int64_t capacity = 1024)
+      : buffer_(new Buffer(capacity)) {
+    buffers_.emplace_back(buffer_.load(std::memory_order_relaxed));
+  }
+
+  WorkStealingDeque(const WorkStealingDeque &) = delete;
+  WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+  /// Push \p item at the bottom. Only called by the owner.
+  void push(T item) {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    int64_t top = top_.load(std::memory_order_acquire);
+    Buffer *buffer = buffer_.load(std::memory_order_relaxed);
+    if (bottom - top > buffer->capacity() - 1) {
+      buffer = buffer->grow(bottom, top);
+      buffers_.emplace_back(buffer);
+      buffer_.store(buffer, std::memory_order_release);
+    }
+    buffer->put(bottom, item);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+  }
+
+  /// Pop the item at the bottom into \p item. Only called by the owner.
+  /// \return false if the deque is empty.
+  bool pop(T &item) {
+    int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+    Buffer *buffer = buffer_.load(std::memory_order_relaxed);
+    bottom_.store(bottom, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t top = top_.load(std::memory_order_relaxed);
+    if (top > bottom) {
+      bottom_.store(bottom + 1, std::memory_order_relaxed);
+      return false;
+    }
+    item = buffer->get(bottom);
+    if (top < bottom)
+      return true;
+    // The last item, which a thief may be taking at the same time.
+    bool won = top_.compare_exchange_strong(
+        top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    bottom_.store(bottom + 1, std::memory_order_relaxed);
+    return won;
+  }
+
+  /// Steal the item at the top into \p item. Called by any thread.
+  /// \return false if the deque is empty or another thread took the item.
+  bool steal(T &item) {
+    int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t bottom = bottom_.load(std::memory_order_acquire);
+    if (top >= bottom)
+      return false;
+    Buffer *buffer = buffer_.load(std::memory_order_acquire);
+    item = buffer->get(top);
+    return top_.compare_exchange_strong(
+        top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+  }
+
+  /// \return true if the deque looks empty. Another thread may change it
+  /// right after.
+  bool isEmpty() const {
+    return bottom_.load(std::memory_order_relaxed) <=
+        top_.load(std::memory_order_relaxed);
+  }
+
+private:
+  std::atomic<int64_t> top_{0};
+  std::atomic<int64_t> bottom_{0};
+  std::atomic<Buffer *> buffer_;
+
+  /// Every buffer of the deque, the current one last.
+  std::vector<std::unique_ptr<Buffer>> buffers_;
+};
+
+} // namespace cobra
+
+#endif /* WorkStealingDeque_h */
@@ -7,8 +7,8 @@
 //
 //===----------------------------------------------------------------------===//
 
-#ifndef LLVM_ADT_ITERATOR_H
-#define LLVM_ADT_ITERATOR_H
+#ifndef iterator_h
+#define iterator_h
 
 #include "cobra/Support/iterator_range.h"
 #include <algorithm>
@@ -369,4 +369,4 @@ public:
 
 } // end namespace llvh
 
-#endif // LLVM_ADT_ITERATOR_H
+#endif // iterator_h
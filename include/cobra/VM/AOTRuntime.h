@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef AOTRuntime_h
+#define AOTRuntime_h
+
+#include <cstdint>
+
+/// Runtime entry points called by the native code of the LLVM AOT backend.
+/// Compiled code passes and returns CBValues as their raw 64-bit encoding, and
+/// only calls out to the runtime for the operations it does not inline.
+extern "C" {
+
+uint64_t cobra_aot_add(uint64_t x, uint64_t y);
+uint64_t cobra_aot_sub(uint64_t x, uint64_t y);
+uint64_t cobra_aot_mul(uint64_t x, uint64_t y);
+uint64_t cobra_aot_div(uint64_t x, uint64_t y);
+uint64_t cobra_aot_mod(uint64_t x, uint64_t y);
+
+bool cobra_aot_strict_equal(uint64_t x, uint64_t y);
+bool cobra_aot_less(uint64_t x, uint64_t y);
+bool cobra_aot_less_equal(uint64_t x, uint64_t y);
+bool cobra_aot_greater(uint64_t x, uint64_t y);
+bool cobra_aot_greater_equal(uint64_t x, uint64_t y);
+
+bool cobra_aot_to_boolean(uint64_t value);
+double cobra_aot_to_number(uint64_t value);
+
+}
+
+#endif /* AOTRuntime_h */
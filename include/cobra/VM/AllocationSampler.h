@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef AllocationSampler_h
+#define AllocationSampler_h
+
+#ifdef COBRA_ALLOCATION_SAMPLER
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace cobra {
+namespace vm {
+
+class GCCell;
+class Method;
+class Runtime;
+
+/// Ref V8 SamplingHeapProfiler
+///
+/// An allocation profiler, available when the VM is built with
+/// COBRA_ALLOCATION_SAMPLER. The heap reports every allocation to it, and it
+/// samples one allocation every interval bytes on average, at exponentially
+/// distributed distances, so that the allocations of every size and every
+/// period are sampled alike. A sample is attributed to the site the
+/// interpreter set for the instruction allocating, the method and the
+/// bytecode offset of the instruction, or to the runtime itself if the
+/// interpreter did not set one.
+///
+/// A sample of an object of size s stands for 1 / (1 - exp(-s / interval))
+/// allocations of its size, the inverse of the probability of sampling it,
+/// which gives an unbiased estimate of the bytes allocated at every site.
+///
+/// The sampler follows the sampled objects through the collections, and
+/// drops the sample of an object once a collection frees it: the sites
+/// report the estimates of their allocations that are still alive.
+class AllocationSampler {
+public:
+  /// The offset of the site of the allocations done by the runtime itself.
+  static constexpr uint32_t kUnknownOffset = UINT32_MAX;
+
+  struct Site {
+    /// Null for the allocations done by the runtime itself.
+    Method *method;
+    uint32_t offset;
+
+    bool operator<(const Site &other) const {
+      return std::make_pair(method, offset) <
+          std::make_pair(other.method, other.offset);
+    }
+  };
+
+  struct SiteStats {
+    uint64_t samples{0};
+    /// The bytes of the sampled allocations.
+    uint64_t sampledBytes{0};
+    /// The estimates of the allocations and bytes of the site.
+    double estimatedCount{0};
+    double estimatedBytes{0};
+  };
+
+  AllocationSampler() = default;
+  ~AllocationSampler();
+
+  AllocationSampler(const AllocationSampler &) = delete;
+  AllocationSampler &operator=(const AllocationSampler &) = delete;
+
+  /// Start sampling the allocations of the heap of \p runtime, one every
+  /// \p interval bytes on average, or every one if \p interval is 0.
+  /// \return false if the sampler is already running.
+  bool start(Runtime *runtime, uint64_t interval = 512 * 1024);
+
+  /// Stop sampling. The stats of the sites are kept as they are until
+  /// reset(), the objects of their samples are not followed anymore.
+  void stop();
+
+  bool isRunning() const {
+    return runtime_ != nullptr;
+  }
+
+  /// Attribute the next allocation to the instruction at \p offset in the
+  /// bytecode of \p method.
+  void setSite(Method *method, uint32_t offset) {
+    site_ = {method, offset};
+  }
+
+  /// Count the allocation of the \p size bytes at \p mem, called by the
+  /// heap.
+  void onAllocation(void *mem, size_t size) {
+    if (size < bytesUntilSample_)
+      bytesUntilSample_ -= size;
+    else
+      takeSample(static_cast<GCCell *>(mem), size);
+    site_ = {nullptr, kUnknownOffset};
+  }
+
+  /// Update the sampled objects after a collection, called by the heap.
+  /// \p update returns the address of a sampled object after the
+  /// collection, or null if the collection freed it.
+  template <typename Fn>
+  void updateObjects(Fn update) {
+    size_t live = 0;
+    for (Sample &sample : samples_) {
+      sample.cell = update(sample.cell);
+      if (sample.cell != nullptr)
+        samples_[live++] = sample;
+      else
+        dropSample(sample);
+    }
+    samples_.resize(live);
+  }
+
+  /// Forget the samples.
+  void reset() {
+    samples_.clear();
+    sites_.clear();
+  }
+
+  const std::map<Site, SiteStats> &getSites() const {
+    return sites_;
+  }
+
+  /// Write the sites to \p os as JSON, the ones that allocated the most
+  /// bytes first.
+  void dumpJSON(std::ostream &os) const;
+
+private:
+  struct Sample {
+    GCCell *cell;
+    Site site;
+    uint32_t size;
+    /// The allocations the sample stands for.
+    double count;
+  };
+
+  /// Record a sample of the allocation of the \p size bytes of \p cell,
+  /// and draw the distance to the next one.
+  void takeSample(GCCell *cell, size_t size);
+
+  /// Remove \p sample, whose object was freed, from the stats of its site.
+  void dropSample(const Sample &sample);
+
+  /// \return a distance to the next sample.
+  uint64_t nextDistance();
+
+  Runtime *runtime_{nullptr};
+
+  uint64_t interval_{0};
+
+  /// Bytes to allocate before the next sample.
+  uint64_t bytesUntilSample_{0};
+
+  std::mt19937_64 random_{};
+
+  /// The site of the next allocation.
+  Site site_{nullptr, kUnknownOffset};
+
+  /// The samples whose object is alive.
+  std::vector<Sample> samples_{};
+
+  /// The stats of the samples of every site.
+  std::map<Site, SiteStats> sites_{};
+};
+
+}
+}
+
+#endif // COBRA_ALLOCATION_SAMPLER
+
+#endif /* AllocationSampler_h */
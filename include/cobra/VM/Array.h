@@ -9,14 +9,18 @@
 #define Array_h
 
 #include "cobra/VM/Object.h"
+#include "cobra/VM/GC.h"
 #include "cobra/Support/Common.h"
 
 namespace cobra {
 namespace vm {
 
-class Array : Object {
+class Array : public Object {
 public:
-  static Array *create(Class arrayClass, uint32_t length);
+  /// Allocate an array of \p length values in \p heap, which are all
+  /// undefined.
+  /// \return null if the heap is exhausted.
+  static inline Array *create(GC &heap, uint32_t length);
   
   static size_t computeSize(size_t elementSize, uint32_t length) {
       assert(elementSize != 0);
@@ -77,6 +81,8 @@ public:
   
   
 private:
+  explicit Array(uint32_t size) : Object(ArrayKind, size) {}
+  
   void setLength(uint32_t length) {
     // Atomic with relaxed order reason: data race with length_ with no synchronization or ordering constraints
     // imposed on other reads or writes
@@ -84,9 +90,26 @@ private:
   }
   
   std::atomic<uint32_t> length_;
-  uint32_t data_[0];
+  /// The elements are CBValues, aligned whatever the size of the header.
+  alignas(HeapAlign) uint32_t data_[0];
 };
 
+Array *Array::create(GC &heap, uint32_t length) {
+  size_t size = computeSize(sizeof(CBValue), length);
+  if (COBRA_UNLIKELY(size == 0 || size > GC::kMaxObjectSize))
+    return nullptr;
+  size = heapAlignSize(size);
+  void *mem = heap.alloc(size);
+  if (COBRA_UNLIKELY(mem == nullptr))
+    return nullptr;
+  auto *array = new (mem) Array(size);
+  array->setLength(length);
+  auto *values = reinterpret_cast<CBValue *>(array->getData());
+  for (uint32_t i = 0; i < length; ++i)
+    values[i] = CBValue::encodeUndefinedValue();
+  return array;
+}
+
 }
 }
 
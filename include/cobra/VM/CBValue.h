@@ -145,12 +145,23 @@ public:
     return raw_;
   }
 
+  /// \return the value whose encoding is \p raw, as produced by getRaw().
+  constexpr inline static CBValue fromRaw(RawType raw) {
+    return CBValue(raw);
+  }
+
   inline void *getPointer() const {
     assert(isPointer());
     // Mask out the tag.
     return reinterpret_cast<void *>(raw_ & kDataMask);
   }
 
+  /// \return a pointer value with the tag of this one, pointing to \p ptr.
+  inline CBValue updatePointer(const void *ptr) const {
+    assert(isPointer());
+    return CBValue((raw_ & ~kDataMask) | reinterpret_cast<uintptr_t>(ptr));
+  }
+
   inline double getDouble() const {
     assert(isDouble());
     return BitsToDouble(raw_);
@@ -201,6 +212,14 @@ public:
   inline static constexpr CBValue encodeEmptyValue() {
     return CBValue(0, ETag::Empty);
   }
+
+  inline static CBValue encodeObjectValue(const void *val) {
+    return CBValue(reinterpret_cast<uintptr_t>(val), Tag::Object);
+  }
+
+  inline static CBValue encodeStringValue(const void *val) {
+    return CBValue(reinterpret_cast<uintptr_t>(val), Tag::Str);
+  }
   
   /// Encode a numeric value into the best possible representation based on the
   /// static type of the parameter. Right now we only have one representation
@@ -250,6 +269,8 @@ typedef enum {
   MethodKind,
   ClosureKind,
   ClassKind,
+  /// A free chunk of the old generation, or a gap too small to hold one.
+  FreeKind,
 } CBValueKind;
 
 
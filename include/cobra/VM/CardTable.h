@@ -9,6 +9,10 @@
 #define CardTable_h
 
 #include <cassert>
+#include <cstdint>
+#include <cstring>
+
+#include "cobra/VM/RuntimeGlobals.h"
 
 namespace cobra {
 namespace vm {
@@ -18,13 +22,22 @@ namespace vm {
 // Maintain a card table from the the write barrier. All writes of
 // non-null values to heap addresses should go through an entry in
 // WriteBarrier, and from there to here.
+//
+// A card table lives in the metadata of the HeapRegion it covers, so the
+// address of a card is found by masking the address it covers. Besides the
+// cards, the table records for every card the object that covers its first
+// byte, so that the objects of a dirty card can be walked without parsing the
+// region from its start.
 class CardTable {
 public:
   static constexpr size_t kLogCardSize = 9;
   static constexpr size_t kCardSize = 1 << kLogCardSize;
   static constexpr uint8_t kCardClean = 0x0;
   static constexpr uint8_t kCardDirty = 0x70;
-  
+
+  /// Number of cards covering a region.
+  static constexpr size_t kNumCards = DEFAULT_HEAP_REGION_SIZE >> kLogCardSize;
+
   CardTable() = default;
   /// CardTable is not copyable or movable: It must be constructed in-place.
   CardTable(const CardTable &) = delete;
@@ -32,34 +45,103 @@ public:
   CardTable &operator=(const CardTable &) = delete;
   CardTable &operator=(CardTable &&) = delete;
 
-  inline const uint8_t *base() const;
-  
+  /// \return the start of the region covered by the table.
+  inline char *base() const {
+    return reinterpret_cast<char *>(
+        reinterpret_cast<uintptr_t>(this) & ~(DEFAULT_HEAP_REGION_SIZE - 1));
+  }
+
+  /// \return the index of the card covering \p addr.
+  static size_t addressToIndex(const void *addr) {
+    return (reinterpret_cast<uintptr_t>(addr) & (DEFAULT_HEAP_REGION_SIZE - 1)) >>
+        kLogCardSize;
+  }
+
+  /// \return the first address covered by the card \p index.
+  char *indexToAddress(size_t index) const {
+    return base() + (index << kLogCardSize);
+  }
+
   uint8_t getCard(const void *addr) const {
     return *addressToCard(addr);
   }
-  
+
   /// Returns the address corresponding to the given card address
-  inline void *cardToAddress(const uint8_t *cardAddr) const;
-  
+  inline void *cardToAddress(const uint8_t *cardAddr) const {
+    return indexToAddress(cardAddr - cards_);
+  }
+
   /// Returns the card address corresponding to the given address
-  inline uint8_t *addressToCard(const void *addr) const;
-  
+  inline uint8_t *addressToCard(const void *addr) const {
+    return const_cast<uint8_t *>(&cards_[addressToIndex(addr)]);
+  }
+
+  /// Clean every card, and forget the objects of the cards.
   void clear();
-  
+
+  /// Clean every card.
+  void clearCards() {
+    memset(cards_, kCardClean, sizeof(cards_));
+  }
+
   inline void markCard(const void *addr) {
     *addressToCard(addr) = kCardDirty;
   }
-  
+
   bool isClean(const void *addr) {
     return getCard(addr) == kCardClean;
   }
-  
+
   bool isDirty(const void *addr) {
     return getCard(addr) == kCardDirty;
   }
-  
-  
-  
+
+  bool isCardDirty(size_t index) const {
+    return cards_[index] == kCardDirty;
+  }
+
+  void cleanCard(size_t index) {
+    cards_[index] = kCardClean;
+  }
+
+  /// \return the index of the first dirty card in [\p from, \p to), or \p to
+  /// if there is none.
+  size_t findNextDirtyCard(size_t from, size_t to) const;
+
+  /// Record that an object, or a free chunk, occupies the \p size bytes at
+  /// \p start.
+  inline void updateBoundaries(const void *start, size_t size) {
+    size_t first = addressToIndex(start);
+    // The card of the object is only covered from its start if the object
+    // starts exactly at the card boundary.
+    if (indexToAddress(first) != start)
+      ++first;
+    size_t last = addressToIndex(static_cast<const char *>(start) + size - 1);
+    uint32_t offset = (uint32_t)(reinterpret_cast<uintptr_t>(start) &
+        (DEFAULT_HEAP_REGION_SIZE - 1)) >> LogHeapAlign;
+    for (size_t index = first; index <= last; ++index)
+      boundaries_[index] = offset;
+  }
+
+  /// \return the object covering the first byte of the card \p index, null if
+  /// no object does.
+  void *getFirstObject(size_t index) const {
+    uint32_t offset = boundaries_[index];
+    if (offset == kNoObject)
+      return nullptr;
+    return base() + ((size_t)offset << LogHeapAlign);
+  }
+
+private:
+  /// The boundary of a card not covered by an object. Offset 0 is the
+  /// metadata of the region, where no object lives.
+  static constexpr uint32_t kNoObject = 0;
+
+  uint8_t cards_[kNumCards];
+
+  /// For every card, the offset in heap aligned units from the start of the
+  /// region of the object covering the first byte of the card.
+  uint32_t boundaries_[kNumCards];
 };
 
 } // namespace vm
@@ -18,7 +18,7 @@ namespace vm {
 class Class : public Object {
   
   /// The superclass, or null if this is cobra.Object or a primitive type.
-  GCPointer<Class> super{nullptr};
+  Class *super{nullptr};
   
   /// The lower 16 bits contains a Primitive::Type value. The upper 16
   /// bits contains the size shift of the primitive type.
@@ -66,7 +66,7 @@ class Class : public Object {
   
 public:
   Class *getSuperClass() const {
-    return super.get<Class>();
+    return super;
   }
   
   bool isPublic() const {
@@ -148,6 +148,10 @@ public:
     return &getStaticFields()[idx];
   }
   
+  /// Find the instance field named \p name in this class or its superclasses.
+  /// \return the field, or nullptr if there is no such field.
+  Field *findInstanceField(const char *name);
+  
   ArraySlice<Method> getMethods() const {
     return {methods_, methodCount_};
   }
@@ -11,6 +11,7 @@
 #include "cobra/VM/Class.h"
 #include "cobra/VM/CexFile.h"
 #include "cobra/VM/ClassDataAccessor.h"
+#include "cobra/VM/Method.h"
 
 namespace cobra {
 namespace vm {
@@ -30,6 +31,18 @@ public:
   
   bool loadMethods(Class *klass);
   
+  /// Link \p method, whose instructions are the \p codeSize bytes at
+  /// \p insts, so that it can run. The method gets its own copy of the
+  /// instructions, which is verified once here, and a table of
+  /// \p inlineCacheCount inline caches.
+  /// \return false with the reason in \p error if the bytecode is invalid.
+  bool linkMethod(
+      Method *method,
+      const uint8_t *insts,
+      uint32_t codeSize,
+      uint32_t inlineCacheCount,
+      std::string &error);
+  
 private:
   
 };
@@ -57,6 +57,10 @@ public:
     return accessFlags_;
   }
   
+  const char *getName() const {
+    return name;
+  }
+  
   void setClass(ObjPtr<Class> cls);
   
   uint32_t getOffset() const {
@@ -8,12 +8,94 @@
 #ifndef FreeList_h
 #define FreeList_h
 
+#include <cstddef>
+#include <cstdint>
+
+#include "cobra/VM/GCCell.h"
+#include "cobra/VM/RuntimeGlobals.h"
+
 namespace cobra {
 namespace vm {
 
+/// A free chunk of a region, linked in a FreeList. The chunk keeps a cell
+/// header, so that the regions can still be walked object by object.
+class FreeCell : public GCCell {
+public:
+  explicit FreeCell(uint32_t size) : GCCell(FreeKind, size) {}
+  
+  FreeCell *next_{nullptr};
+};
+
+/// Ref hermes HadesGC::OldGen::FreelistBucket
+/// and JSC MarkedBlock::Handle::sweep
+///
+/// The free chunks of the old generation, segregated by size. The small
+/// sizes each have their own class; the larger ones share a class per power
+/// of two. A chunk larger than requested is split, and its remainder goes
+/// back to the list.
 class FreeList {
+public:
+  /// Number of classes of a single size, for the sizes up to
+  /// kMaxSmallSize.
+  static constexpr size_t kNumSmallClasses = 32;
+  static constexpr size_t kMaxSmallSize = kNumSmallClasses << LogHeapAlign;
+  static constexpr size_t kNumLargeClasses = 32;
+  static constexpr size_t kNumClasses = kNumSmallClasses + kNumLargeClasses;
+  
+  FreeList() = default;
+  
+  FreeList(const FreeList &) = delete;
+  FreeList &operator=(const FreeList &) = delete;
+  
+  /// Take a chunk of \p size bytes, which must be heap aligned.
+  /// \return the uninitialized memory, null if no chunk is large enough.
+  void *alloc(size_t size);
+  
+  /// Make the \p size bytes at \p start a free chunk, and add it to the
+  /// list if it can hold a FreeCell.
+  void addChunk(void *start, size_t size);
+  
+  /// Forget every chunk.
+  void clear();
+  
+  /// Forget the chunks for which \p pred returns true.
+  template <typename Pred>
+  void removeIf(Pred pred) {
+    for (size_t cls = 0; cls < kNumClasses; ++cls) {
+      for (FreeCell **link = &heads_[cls]; *link != nullptr;) {
+        if (pred(*link)) {
+          freeBytes_ -= (*link)->getSize();
+          *link = (*link)->next_;
+        } else {
+          link = &(*link)->next_;
+        }
+      }
+      if (heads_[cls] == nullptr)
+        nonEmptyClasses_ &= ~(uint64_t(1) << cls);
+    }
+  }
+  
+  /// \return the number of bytes of the chunks in the list.
+  size_t getFreeBytes() const {
+    return freeBytes_;
+  }
+  
+private:
+  static size_t getClass(size_t size);
+  
+  /// Make the \p size bytes at \p start a free chunk, and add it to its
+  /// class if it can hold a FreeCell.
+  void link(void *start, size_t size);
+  
+  /// Take the first chunk of \p cls that holds \p size bytes.
+  FreeCell *take(size_t cls, size_t size);
+  
+  FreeCell *heads_[kNumClasses]{};
   
+  /// A bit per class, set if its list is not empty.
+  uint64_t nonEmptyClasses_{0};
   
+  size_t freeBytes_{0};
 };
 
 }
@@ -8,15 +8,25 @@
 #ifndef GC_h
 #define GC_h
 
+#include <limits>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "cobra/VM/AllocationSampler.h"
 #include "cobra/VM/HeapRegion.h"
+#include "cobra/VM/HeapRegionSpace.h"
 #include "cobra/VM/CardTable.h"
-#include "cobra/VM/GCRoot.h"
+#include "cobra/VM/FreeList.h"
+#include "cobra/VM/GCStats.h"
+#include "cobra/VM/MemMapAllocator.h"
 
 namespace cobra {
 namespace vm {
 
+class Runtime;
+
 // The CellState of a cell is a kind of hint about what the state of the cell is.
 enum class CellState : uint8_t {
   // The object is either currently being scanned, or it has finished being scanned, or this
@@ -33,6 +43,55 @@ enum class CellState : uint8_t {
   Grey = 2
 };
 
+/// The heap of a runtime, split in two generations.
+///
+/// Objects are allocated in the young generation, a few regions that are
+/// collected on their own by copying the live objects out of them. Every
+/// object that survives a young collection is promoted to the old
+/// generation, so the young generation is empty after a collection and its
+/// regions are reused as they are.
+///
+/// The roots of a young collection are the registers of the interpreter, and
+/// the old objects that may reference young ones. Those are found through
+/// the cards of the old regions, which the write barrier marks on every store
+/// of a pointer into the heap.
+///
+/// The objects larger than half a region are not allocated in the young
+/// generation but in the large object space, on a mapping of their own that
+/// is never copied, and unmapped as soon as a collection finds the object
+/// dead. Such a mapping spans several regions, only the first of which has
+/// metadata: the stores past it mark the card of the object header, and the
+/// whole object is then scanned.
+///
+/// The old generation is not moving: its objects are allocated from a
+/// FreeList of the chunks left between live objects, or else by bumping the
+/// top of its last region.
+///
+/// The old generation is collected when it outgrows a limit. Its marking is
+/// incremental: it starts from the registers once a young collection finds
+/// the old generation over the limit, and every following young collection
+/// marks a bounded number of bytes, until a last short pause completes the
+/// marking and sweeps. A snapshot-at-the-beginning barrier keeps the objects
+/// reachable at the start from being lost meanwhile: a reference overwritten
+/// during the marking is marked first, and every object promoted during the
+/// marking is allocated marked. The limit is then set from the size of the
+/// old generation after the collection. The regions are then swept lazily:
+/// the allocations sweep them one by one until the free list can serve them,
+/// and every young collection sweeps a bounded number of bytes, so that no
+/// sweeping is left when the next marking starts.
+///
+/// The regions whose live bytes, as found by the last sweep, fall under
+/// kEvacuationThreshold are evacuated by the next marking. Nothing is
+/// allocated in them during the marking, which records the slots that
+/// reference them in their remembered sets, as does the barrier for the
+/// stores. The final pause copies their marked objects out, updates the
+/// remembered slots and the registers, and frees the regions.
+///
+/// collectOld() does the same work in a single pause, with the marking
+/// spread over several threads.
+///
+/// Every pause is recorded in the GCStats of the heap, with the time spent in
+/// each of its phases and the bytes it found.
 class GC {
   
   enum class Phase : uint8_t {
@@ -43,13 +102,346 @@ class GC {
   };
   
 public:
-  GC() = default;
+  /// Number of regions of the young generation.
+  static constexpr uint32_t kYoungRegionCount = 2;
+  
+  /// Number of regions the old generation grows to before its first
+  /// collection.
+  static constexpr uint32_t kMinOldRegionCount = 8;
+  
+  /// The objects larger than this go to the large object space.
+  static constexpr size_t kLargeObjectThreshold = HeapRegion::maxSize() / 2;
+  
+  /// The size of a cell is 32 bits.
+  static constexpr size_t kMaxObjectSize =
+      std::numeric_limits<uint32_t>::max() & ~(size_t)(HeapAlign - 1);
+  
+  /// The old regions with fewer live bytes than this are evacuated.
+  static constexpr size_t kEvacuationThreshold = HeapRegion::maxSize() / 4;
+  
+  /// Number of bytes of old objects scanned by each marking increment, twice
+  /// the bytes a young collection may promote.
+  static constexpr size_t kMarkStepBytes =
+      2 * kYoungRegionCount * HeapRegion::maxSize();
+  
+  explicit GC(Runtime &runtime);
+  
+  ~GC();
+  
+  GC(const GC &) = delete;
+  GC &operator=(const GC &) = delete;
+  
+  /// Allocate \p size bytes, which must be heap aligned, in the young
+  /// generation, or in the large object space if \p size is over
+  /// kLargeObjectThreshold. The young generation is collected first if it is
+  /// full.
+  /// \return the uninitialized memory, null if the heap is exhausted.
+  inline void *alloc(size_t size) {
+    void *mem;
+    if (COBRA_UNLIKELY(size > kLargeObjectThreshold))
+      mem = allocLarge(size);
+    else if (COBRA_UNLIKELY((mem = young_->alloc(size)) == nullptr))
+      mem = allocSlow(size);
+#ifdef COBRA_ALLOCATION_SAMPLER
+    if (COBRA_UNLIKELY(allocationSampler_ != nullptr))
+      allocationSampler_->onAllocation(mem, size);
+#endif
+    return mem;
+  }
+  
+  /// Record that \p value is about to be stored at \p loc, in the heap
+  /// object \p obj. Must be called before the store.
+  inline void writeBarrier(const void *obj, const void *loc, CBValue value) {
+    if (COBRA_UNLIKELY(phase_ == Phase::Mark))
+      markingBarrier(obj, loc, value);
+    cardBarrier(obj, loc, value);
+  }
+  
+  /// Record that \p oldValue is about to be overwritten. While marking, the
+  /// object it references is marked, as it was reachable when the marking
+  /// started.
+  inline void snapshotBarrier(CBValue oldValue) {
+    if (COBRA_UNLIKELY(phase_ == Phase::Mark) && oldValue.isPointer())
+      markGrey(static_cast<GCCell *>(oldValue.getPointer()));
+  }
+  
+  /// Record that \p value is stored at \p loc, in the heap object \p obj,
+  /// so that the young objects referenced by old ones are found.
+  inline void cardBarrier(const void *obj, const void *loc, CBValue value) {
+    if (value.isPointer()) {
+      // Past the first region of a large object, the card of its header
+      // stands for the whole object.
+      const void *card =
+          HeapRegion::start(loc) == HeapRegion::start(obj) ? loc : obj;
+      HeapRegion::getCardTable(obj)->markCard(card);
+    }
+  }
+  
+  /// Promote every live object of the young generation to the old one, in a
+  /// pause of its own.
+  void collectYoung();
+  
+  /// Collect the young generation, then free the old objects that are not
+  /// reachable anymore, in a single pause. An incremental marking in
+  /// progress is abandoned.
+  void collectOld();
+  
+  /// \return true while the old generation is being marked incrementally.
+  bool isMarking() const {
+    return phase_ == Phase::Mark;
+  }
+  
+  /// Allocate \p size bytes, which must be heap aligned, in the old
+  /// generation, where objects never move. Marks the memory as a live
+  /// object if a marking or a sweep is in progress. The pointers to young
+  /// objects the object is initialized with must go through the write
+  /// barrier.
+  /// \return the uninitialized memory, null if the heap is exhausted.
+  void *allocOld(size_t size);
+  
+  /// Set the number of threads marking the old generation, the calling one
+  /// included.
+  void setMarkerThreadCount(uint32_t count) {
+    markerThreadCount_ = count > 0 ? count : 1;
+  }
+  
+  uint32_t getMarkerThreadCount() const {
+    return markerThreadCount_;
+  }
+  
+  HeapRegionSpace &getYoungSpace() {
+    return *young_;
+  }
   
-  void writeBarrier(const Object *obj, const Object *value);
+  HeapRegionSpace &getOldSpace() {
+    return *old_;
+  }
+  
+  HeapRegionSpace &getLargeObjectSpace() {
+    return *large_;
+  }
+  
+  MemMapAllocator &getRegionPool() {
+    return regionPool_;
+  }
+  
+  uint64_t getYoungCollectionCount() const {
+    return youngCollectionCount_;
+  }
+  
+  uint64_t getOldCollectionCount() const {
+    return oldCollectionCount_;
+  }
+  
+  /// \return the number of bytes of the old objects moved out of sparse
+  /// regions so far.
+  uint64_t getEvacuatedBytes() const {
+    return evacuatedBytes_;
+  }
+  
+  GCStats &getStats() {
+    return stats_;
+  }
+  
+  /// Record in the stats how many bytes of the heap cage and the register
+  /// stack the OS backs with huge pages. This asks the OS, which is too slow
+  /// to do at every pause.
+  void measureHugePages();
+  
+#ifdef COBRA_ALLOCATION_SAMPLER
+  /// Report every allocation to \p sampler, or to none if it is null.
+  void setAllocationSampler(AllocationSampler *sampler) {
+    allocationSampler_ = sampler;
+  }
+#endif
+  
+  /// \return in [\p begin, \p end) the values \p cell references.
+  static void getSlots(GCCell *cell, CBValue *&begin, CBValue *&end);
   
 private:
+  /// Collect the young generation, and allocate \p size bytes in it.
+  void *allocSlow(size_t size);
+  
+  /// Allocate a mapping for an object of \p size bytes in the large object
+  /// space.
+  void *allocLarge(size_t size);
+  
+  /// Collect the young generation, and advance the collection of the old
+  /// one, or start it if the old generation outgrew its limit, in a pause
+  /// caused by \p trigger.
+  void collect(GCTrigger trigger);
+  
+  /// Open the record of a pause of kind \p kind caused by \p trigger.
+  void beginCollection(GCKind kind, GCTrigger trigger);
+  
+  /// Close the record of the current pause, with the sizes of the spaces.
+  void endCollection();
+  
+  /// Promote every live object of the young generation to the old one.
+  void promoteYoung();
+  
+  /// \return the size of the old generation and the large object space, in
+  /// regions.
+  size_t getOldRegionCount() const {
+    return (old_->getStorageBytes() + large_->getStorageBytes()) /
+        HeapRegion::kSize;
+  }
+  
+  /// \return true if \p ptr points into the old generation or the large
+  /// object space.
+  bool isOld(const void *ptr) const {
+    return old_->contains(ptr) || large_->contains(ptr);
+  }
+  
+  /// Free the large objects left unmarked.
+  void sweepLargeObjects();
+  
+  /// Copy the young objects referenced by the dirty cards of the old
+  /// regions and of the large objects.
+  void scanDirtyCards();
+  
+  /// Call \p fn with every range [begin, end) of registers of the
+  /// interpreter.
+  template <typename Fn>
+  void forEachRegisterRange(Fn fn);
+  
+  /// Copy the young objects referenced by the registers of the interpreter.
+  void scanRoots();
+  
+  /// Copy the young objects referenced by the promoted objects, until there
+  /// are no more of them.
+  void scanPromoted();
+  
+  /// Copy the young objects referenced by the values in [\p begin, \p end).
+  void evacuateRange(CBValue *begin, CBValue *end);
+  
+  /// If \p slot references a young object, copy it to the old generation,
+  /// unless it was already, and update \p slot to the copy.
+  inline void evacuate(CBValue *slot);
+  
+  /// Copy \p cell to the old generation.
+  GCCell *promote(GCCell *cell);
+  
+  /// Add to \p roots the old objects referenced by the registers of the
+  /// interpreter.
+  void collectRoots(std::vector<GCCell *> &roots);
+  
+  /// Sweep the regions left to sweep for about \p budget bytes.
+  void sweepIncrement(size_t budget);
+  
+  /// Add the unmarked objects of \p region to the free list, or free the
+  /// region if none is marked.
+  void sweepRegion(HeapRegion *region);
+  
+  /// Start marking the old generation from the registers, and scan from them
+  /// for one increment.
+  void startMarking();
+  
+  /// Scan grey objects for about \p budget bytes, and complete the marking
+  /// if none is left.
+  void markIncrement(size_t budget);
+  
+  /// The final pause of the marking: scan the objects greyed by the barrier
+  /// since the last increment, then sweep.
+  void completeMarking();
+  
+#ifdef COBRA_ALLOCATION_SAMPLER
+  /// Drop the allocation samples of the objects the collection freed, and
+  /// follow the objects it moved. \p marked is true once the mark bits of
+  /// the old generation tell its live objects.
+  void updateSampledObjects(bool marked);
+#endif
+  
+  /// Scan the grey objects of the mark stack with a ParallelMarker for about
+  /// \p budget bytes, and push the ones left grey back on the mark stack.
+  void markInParallel(size_t budget);
+  
+  /// Mark \p cell, if it is an unmarked old object, and push it on the mark
+  /// stack.
+  void markGrey(GCCell *cell);
+  
+  /// Mark the objects referenced by \p cell.
+  void scanGrey(GCCell *cell);
+  
+  /// The write barrier while marking: mark the object referenced by \p loc,
+  /// and remember \p loc if \p value references an evacuation candidate.
+  void markingBarrier(const void *obj, const void *loc, CBValue value);
+  
+  /// If \p slot references an evacuation candidate, add it to the
+  /// remembered set of the candidate.
+  inline void rememberSlot(CBValue *slot);
+  
+  /// \return true if \p ptr points into an evacuation candidate.
+  inline bool isInEvacuationCandidate(const void *ptr) const;
+  
+  /// Choose the sparse old regions to evacuate at the end of the marking
+  /// about to start, and stop allocating in them.
+  void selectEvacuationCandidates();
+  
+  /// Copy the marked objects of the evacuation candidates, update the
+  /// references to them, and free the candidates.
+  void evacuateCandidates();
+  
+  /// Update \p slot to the copy of the object it references, if that
+  /// object was in an evacuation candidate.
+  inline void updateEvacuatedSlot(CBValue *slot);
+  
+  /// Finish a marking of the old generation, queue its regions to sweep,
+  /// and set the limit of the next collection.
+  void finishOldCollection();
+  
+  Runtime &runtime_;
+  
+  /// The storage of the regions of every space, which outlives them.
+  MemMapAllocator regionPool_;
+  
+  std::unique_ptr<HeapRegionSpace> young_;
+  
+  std::unique_ptr<HeapRegionSpace> old_;
+  
+  std::unique_ptr<HeapRegionSpace> large_;
+  
+  uint64_t youngCollectionCount_{0};
+  
+  uint64_t oldCollectionCount_{0};
+  
+  uint64_t evacuatedBytes_{0};
+  
+  GCStats stats_;
+  
+#ifdef COBRA_ALLOCATION_SAMPLER
+  /// The sampler allocations are reported to, null if none is running.
+  AllocationSampler *allocationSampler_{nullptr};
+#endif
+  
+  /// Number of regions of the old generation that triggers its collection.
+  uint32_t oldRegionLimit_{kMinOldRegionCount};
+  
+  uint32_t markerThreadCount_;
+  
+  Phase phase_{Phase::Idle};
+  
+  /// The old objects marked but not scanned yet by the incremental marking.
+  std::vector<GCCell *> markStack_;
+  
+  /// Number of bytes of the objects found live by the current or the last
+  /// marking.
+  size_t markedBytes_{0};
+  
+  /// The objects promoted by the current young collection and not scanned
+  /// yet.
+  std::vector<GCCell *> promoted_;
+  
+  FreeList freeList_;
+  
+  /// The regions evacuated at the end of the current marking.
+  std::vector<HeapRegion *> evacuationCandidates_;
   
+  /// The regions whose free chunks are not in the free list yet.
+  std::vector<HeapRegion *> sweepQueue_;
   
+  /// The free runs of the region being swept.
+  std::vector<std::pair<char *, size_t>> sweepRuns_;
 };
 
 }
@@ -8,22 +8,58 @@
 #ifndef GCCell_h
 #define GCCell_h
 
+#include <cassert>
+
 #include "cobra/VM/CBValue.h"
 
 namespace cobra {
 namespace vm {
 
+/// The base of every object allocated in the heap. Its header holds the kind
+/// and the size of the cell, so that the collector can walk the heap and find
+/// the values the cell references. Once the collector has moved the cell, the
+/// header holds the address of the copy instead.
 class GCCell {
+  /// Set in the header of a cell that was moved, the rest of the header is
+  /// then the address of the copy.
+  static constexpr uint64_t kForwardedBit = 1;
+  static constexpr unsigned kKindShift = 8;
+  static constexpr unsigned kSizeShift = 32;
+  
+  uint64_t header_;
   
 public:
   GCCell() = default;
   
+  GCCell(CBValueKind kind, uint32_t size)
+      : header_(((uint64_t)size << kSizeShift) | ((uint64_t)kind << kKindShift)) {}
+  
   // GCCell-s are not copyable (in the C++ sense).
   GCCell(const GCCell &) = delete;
   void operator=(const GCCell &) = delete;
   
   CBValueKind getKind() const {
-    return CBValueKind::NullKind;
+    return (CBValueKind)((header_ >> kKindShift) & 0xff);
+  }
+  
+  /// \return the size of the cell in bytes, which is heap aligned.
+  uint32_t getSize() const {
+    return (uint32_t)(header_ >> kSizeShift);
+  }
+  
+  bool isForwarded() const {
+    return (header_ & kForwardedBit) != 0;
+  }
+  
+  GCCell *getForwardingAddress() const {
+    assert(isForwarded() && "cell was not moved");
+    return reinterpret_cast<GCCell *>(header_ & ~kForwardedBit);
+  }
+  
+  /// Record that the cell was moved to \p copy, which overwrites its kind and
+  /// size.
+  void setForwardingAddress(GCCell *copy) {
+    header_ = reinterpret_cast<uintptr_t>(copy) | kForwardedBit;
   }
   
 };
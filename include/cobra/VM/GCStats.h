@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef GCStats_h
+#define GCStats_h
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace cobra {
+namespace vm {
+
+/// The work a collection pause did.
+enum class GCKind : uint8_t {
+  /// Only the young generation was collected.
+  Young,
+  /// The young generation was collected, and the incremental collection of
+  /// the old generation was started or advanced.
+  Incremental,
+  /// Both generations were collected in a single pause.
+  Full,
+};
+
+/// What caused a collection.
+enum class GCTrigger : uint8_t {
+  /// The young generation was full.
+  YoungFull,
+  /// A large object was allocated while the old generation was over its
+  /// limit.
+  LargeObject,
+  /// The collection was requested through the API.
+  Explicit,
+};
+
+/// The phases a pause is split into. The time of a pause not spent in one of
+/// them, e.g. cleaning the cards, only counts in its total.
+enum class GCPhase : uint8_t {
+  /// Copying the young objects referenced by the registers and the cards.
+  RootScan,
+  /// Copying the young objects referenced by the promoted ones.
+  Promote,
+  /// Marking the old generation.
+  Mark,
+  /// Sweeping the old generation and the large object space.
+  Sweep,
+  /// Moving the objects of the sparse old regions.
+  Evacuate,
+};
+
+static constexpr unsigned kNumGCPhases = unsigned(GCPhase::Evacuate) + 1;
+
+/// The record of one collection pause.
+struct GCCollectionStats {
+  GCKind kind{GCKind::Young};
+  GCTrigger trigger{GCTrigger::Explicit};
+
+  /// Whether the pause finished a collection of the old generation.
+  bool finishedOldCollection{false};
+
+  /// Start of the pause, in microseconds since the heap was created.
+  uint64_t startMicros{0};
+
+  uint64_t pauseMicros{0};
+
+  uint64_t phaseMicros[kNumGCPhases]{};
+
+  /// Bytes allocated in the young generation and the large object space
+  /// since the previous pause.
+  uint64_t allocatedBytes{0};
+
+  /// Bytes of the young generation when the pause started.
+  uint64_t youngBytes{0};
+
+  /// Bytes of the young objects promoted to the old generation.
+  uint64_t promotedBytes{0};
+
+  /// Bytes of the old objects moved out of sparse regions.
+  uint64_t evacuatedBytes{0};
+
+  /// The number of regions and the bytes of storage of every space when the
+  /// pause ended.
+  uint32_t youngRegions{0};
+  uint32_t oldRegions{0};
+  uint32_t largeRegions{0};
+  uint64_t oldBytes{0};
+  uint64_t largeBytes{0};
+
+  /// \return the fraction of the young bytes that survived the pause.
+  double getSurvivalRate() const {
+    return youngBytes ? double(promotedBytes) / double(youngBytes) : 0;
+  }
+};
+
+/// The statistics of the collections of a heap. The heap opens a record when
+/// a pause starts, fills it while collecting, and closes it when the pause
+/// ends. The totals and the histogram of the pause times cover every pause,
+/// while only the first kMaxRecordedCollections records are kept.
+class GCStats {
+  using Clock = std::chrono::steady_clock;
+
+public:
+  /// Number of collection records kept. The later ones are only counted.
+  static constexpr size_t kMaxRecordedCollections = 4096;
+
+  /// Number of buckets of the pause histogram: bucket i counts the pauses
+  /// shorter than 2^i microseconds and not shorter than the previous bucket,
+  /// the last one counts every longer pause.
+  static constexpr unsigned kNumPauseBuckets = 24;
+
+  /// Time the phase \p phase of the current pause, from construction to
+  /// destruction.
+  class PhaseTimer {
+  public:
+    PhaseTimer(GCStats &stats, GCPhase phase)
+        : stats_(stats), phase_(phase), start_(Clock::now()) {}
+
+    ~PhaseTimer() {
+      stats_.current_.phaseMicros[unsigned(phase_)] += toMicros(
+          Clock::now() - start_);
+    }
+
+    PhaseTimer(const PhaseTimer &) = delete;
+    PhaseTimer &operator=(const PhaseTimer &) = delete;
+
+  private:
+    GCStats &stats_;
+    GCPhase phase_;
+    Clock::time_point start_;
+  };
+
+  GCStats() : created_(Clock::now()) {}
+
+  GCStats(const GCStats &) = delete;
+  GCStats &operator=(const GCStats &) = delete;
+
+  /// Open the record of a pause of kind \p kind caused by \p trigger. The
+  /// heap held \p youngBytes bytes in its young generation.
+  void beginCollection(GCKind kind, GCTrigger trigger, size_t youngBytes);
+
+  /// Close the record of the current pause, whose region counts and sizes
+  /// the heap filled in.
+  void endCollection();
+
+  /// \return the record of the pause in progress.
+  GCCollectionStats &current() {
+    return current_;
+  }
+
+  /// Count \p size bytes allocated outside of the young generation, which
+  /// the next pause reports.
+  void addLargeAllocation(size_t size) {
+    pendingLargeBytes_ += size;
+  }
+
+  /// Record that the OS was asked huge pages for \p requestedBytes of the
+  /// heap, and took the advice for \p advisedBytes of them.
+  void setHugePageBytes(size_t requestedBytes, size_t advisedBytes) {
+    hugePageRequestedBytes_ = requestedBytes;
+    hugePageAdvisedBytes_ = advisedBytes;
+  }
+
+  /// Record that \p backedBytes of the heap and the register stack are
+  /// actually backed by huge pages, as the OS last reported.
+  void setHugePageBackedBytes(size_t backedBytes) {
+    hugePageBackedBytes_ = backedBytes;
+  }
+
+  /// \return the records of the first kMaxRecordedCollections pauses.
+  const std::vector<GCCollectionStats> &getCollections() const {
+    return collections_;
+  }
+
+  uint64_t getCollectionCount() const {
+    return collectionCount_;
+  }
+
+  uint64_t getTotalPauseMicros() const {
+    return totalPauseMicros_;
+  }
+
+  uint64_t getMaxPauseMicros() const {
+    return maxPauseMicros_;
+  }
+
+  uint64_t getTotalAllocatedBytes() const {
+    return totalAllocatedBytes_;
+  }
+
+  uint64_t getTotalPromotedBytes() const {
+    return totalPromotedBytes_;
+  }
+
+  /// \return the number of pauses that fall in the bucket \p bucket of the
+  /// histogram.
+  uint64_t getPauseBucketCount(unsigned bucket) const {
+    return pauseBuckets_[bucket];
+  }
+
+  /// \return the time under which \p ratio of the pauses fall, in
+  /// microseconds, rounded up to the bound of its bucket in the histogram.
+  uint64_t getPausePercentile(double ratio) const;
+
+  /// \return the bytes allocated per second since the heap was created.
+  double getAllocationRate() const;
+
+  /// Write the totals and the records of the pauses as JSON to \p os.
+  void dumpJSON(std::ostream &os) const;
+
+private:
+  static uint64_t toMicros(Clock::duration duration) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(duration)
+        .count();
+  }
+
+  Clock::time_point created_;
+
+  /// Start of the pause in progress.
+  Clock::time_point pauseStart_;
+
+  GCCollectionStats current_;
+
+  std::vector<GCCollectionStats> collections_;
+
+  uint64_t collectionCount_{0};
+  uint64_t kindCounts_[unsigned(GCKind::Full) + 1]{};
+  uint64_t totalPauseMicros_{0};
+  uint64_t maxPauseMicros_{0};
+  uint64_t totalPhaseMicros_[kNumGCPhases]{};
+  uint64_t pauseBuckets_[kNumPauseBuckets]{};
+  uint64_t totalAllocatedBytes_{0};
+  uint64_t totalYoungBytes_{0};
+  uint64_t totalPromotedBytes_{0};
+  uint64_t totalEvacuatedBytes_{0};
+
+  /// Bytes of large objects allocated since the last pause.
+  uint64_t pendingLargeBytes_{0};
+
+  size_t hugePageRequestedBytes_{0};
+  size_t hugePageAdvisedBytes_{0};
+  size_t hugePageBackedBytes_{0};
+};
+
+}
+}
+
+#endif /* GCStats_h */
@@ -92,9 +92,9 @@ private:
     return capacityOffset(pointer_size) + sizeof(capacity_) + sizeof(size_);
   }
   
-  ObjectReference<Object> *getReferences() const {
+  Object **getReferences() const {
     uintptr_t address = reinterpret_cast<uintptr_t>(this) + referencesOffset(kRuntimePointerSize);
-    return reinterpret_cast<ObjectReference<Object>*>(address);
+    return reinterpret_cast<Object **>(address);
   }
   
 public:
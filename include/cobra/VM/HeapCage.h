@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef HeapCage_h
+#define HeapCage_h
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+#include "cobra/VM/RuntimeGlobals.h"
+
+namespace cobra {
+namespace vm {
+
+/// The range of virtual memory every heap region of the process lives in.
+/// It is reserved once, and shared by the heaps of every runtime, so that the
+/// heaps never map memory outside of it.
+///
+/// The cage hands out uncommitted ranges of region aligned memory, and takes
+/// back the single regions a heap does not need anymore. The regions given
+/// back are kept in address order: a range of several regions is claimed
+/// from adjacent ones when there are enough, and the ones adjacent to the
+/// unclaimed end of the cage join it, so that the cage does not fragment.
+class HeapCage {
+public:
+  /// The size of the cage, which bounds the heaps of all the runtimes
+  /// together.
+  static constexpr size_t kSize = sizeof(void *) == 8
+      ? size_t(uint64_t(1) << (32 + LogHeapAlign))
+      : size_t(1) << 30;
+
+  /// Reserve the cage, unless it already is.
+  /// \return false if the cage cannot be reserved.
+  static bool init();
+
+  /// \return the first address of the cage, null if it is not reserved.
+  static char *getBase() {
+    return base_;
+  }
+
+  /// \return true if \p ptr points into the cage.
+  static bool contains(const void *ptr) {
+    return base_ != nullptr && base_ <= ptr && ptr < base_ + kSize;
+  }
+
+  /// Take \p size bytes of the cage, a multiple of the region size.
+  /// \return the region aligned uncommitted range, null if the cage is not
+  /// reserved or has no such range left.
+  static void *claim(size_t size);
+
+  /// Give back the uncommitted region at \p storage, taken by claim().
+  static void giveBack(void *storage);
+
+private:
+  static char *base_;
+};
+
+}
+}
+
+#endif /* HeapCage_h */
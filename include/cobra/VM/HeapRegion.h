@@ -9,6 +9,7 @@
 #define HeapRegion_h
 
 #include <stdint.h>
+#include <vector>
 
 #include "cobra/VM/GCCell.h"
 #include "cobra/VM/MarkBitSet.h"
@@ -21,7 +22,6 @@ namespace cobra {
 namespace vm {
 
 static constexpr size_t KB = 1024;
-static constexpr size_t DEFAULT_HEAP_REGION_SIZE = 4096 * KB;
 
 template <size_t N>
 struct ConstantLog2
@@ -82,18 +82,27 @@ public:
   /// is the first address not in the bounds.
   inline static const void *end(const void *ptr);
   
-  HeapRegion(void *allocateBase);
+  /// Create the region whose storage of \p storageSize bytes, a multiple
+  /// of kSize, starts at \p allocateBase. Only a region holding a single
+  /// large object spans more than kSize bytes; its metadata only covers the
+  /// first kSize bytes.
+  HeapRegion(void *allocateBase, size_t storageSize = kSize);
 
+  /// The storage is not freed, it belongs to the space of the region. Its
+  /// guard page is unprotected so that the storage can be reused.
   ~HeapRegion();
   
   class Contents {
     friend class HeapRegion;
     
+    /// The region whose storage this is, to find it from its objects.
+    HeapRegion *region_{nullptr};
+    
     CardTable cardTable_;
     MarkBitSet markBitSet_;
     
     static constexpr size_t kMetadataSize =
-        sizeof(cardTable_) + sizeof(markBitSet_);
+        sizeof(region_) + sizeof(cardTable_) + sizeof(markBitSet_);
     /// Padding to ensure that the guard page is aligned to a page boundary.
     static constexpr size_t kGuardPagePadding =
         alignTo<kExpectedPageSize>(kMetadataSize) - kMetadataSize;
@@ -120,6 +129,9 @@ public:
   /// sufficent space, cast the space as a Object, and returns an uninitialized
   /// pointer to that object.  If there is not sufficient
   /// space, returns nullptr.
+  ///
+  /// This is the fast path of every allocation, it is inlined into the
+  /// interpreter and only bumps top_.
   inline void *alloc(size_t size);
   
   /// Given the \p allocateBase_ of some valid memory region, returns
@@ -131,6 +143,12 @@ public:
   /// be.
   inline static constexpr size_t maxSize();
   
+  /// \return the start of the storage of the region, where its metadata
+  /// lives.
+  char *getStorage() const {
+    return allocateBase_;
+  }
+  
   char *start() const {
     return contents()->start_;
   }
@@ -144,7 +162,11 @@ public:
   }
   
   char *end() const {
-    return start() + maxSize();
+    return allocateBase_ + storageSize_;
+  }
+  
+  size_t getStorageSize() const {
+    return storageSize_;
   }
   
   size_t size() const {
@@ -155,6 +177,57 @@ public:
     return allocateBase_ <= reinterpret_cast<char *>(obj) && reinterpret_cast<char *>(obj) < end();
   }
   
+  /// Free every object of the region, and clean its cards.
+  void reset() {
+    top_ = start();
+    cardTable().clear();
+  }
+  
+  /// Number of bytes allocated in the region since it was created.
+  uint64_t getAllocatedBytes() const {
+    return allocatedBytes_;
+  }
+  
+  /// Number of objects allocated in the region since it was created.
+  uint64_t getAllocatedObjects() const {
+    return allocatedObjects_;
+  }
+  
+  /// Number of bytes of the objects found live by the last marking.
+  size_t getLiveBytes() const {
+    return liveBytes_;
+  }
+  
+  void setLiveBytes(size_t liveBytes) {
+    liveBytes_ = liveBytes;
+  }
+  
+  /// Whether the region was marked but not swept yet. Its unmarked objects
+  /// are then dead.
+  bool needsSweep() const {
+    return needsSweep_;
+  }
+  
+  void setNeedsSweep(bool needsSweep) {
+    needsSweep_ = needsSweep;
+  }
+  
+  /// Whether the live objects of the region are moved out of it at the end
+  /// of the current marking.
+  bool isEvacuationCandidate() const {
+    return evacuationCandidate_;
+  }
+  
+  void setEvacuationCandidate(bool evacuationCandidate) {
+    evacuationCandidate_ = evacuationCandidate;
+  }
+  
+  /// The slots outside of the region that may reference its objects,
+  /// recorded while the region is an evacuation candidate.
+  std::vector<CBValue *> &getRememberedSet() {
+    return rememberedSet_;
+  }
+  
   inline CardTable &cardTable() const;
 
   inline MarkBitSet &markBitSet() const;
@@ -164,9 +237,13 @@ public:
     
   inline static MarkBitSet *getMarkBitSet(const void *ptr);
   
-  inline static void setCellMarkBit(const Object *cell);
+  inline static void setCellMarkBit(const GCCell *cell);
+  
+  inline static bool getCellMarkBit(const GCCell *cell);
   
-  inline static bool getCellMarkBit(const Object *cell);
+  /// Set the mark bit of \p cell, atomically.
+  /// \return true if this call set it, false if the cell was already marked.
+  inline static bool testAndSetCellMarkBit(const GCCell *cell);
   
   inline static CardTable *getCardTable(const void *ptr);
   
@@ -177,19 +254,48 @@ private:
   /// The begin address of the region.
   char *allocateBase_;
   
+  size_t storageSize_;
+  
   /// Note that `top_` can be higher than `end_` in the case of a
   /// large region, where an allocated object spans multiple regions
   /// (large region + one or more large tail regions).
   /// The current position of the allocation.
   char *top_;
+  
+  /// Allocation counters, which keep counting when top_ is moved back.
+  uint64_t allocatedBytes_{0};
+  uint64_t allocatedObjects_{0};
+  
+  size_t liveBytes_{0};
+  
+  bool needsSweep_{false};
+  
+  bool evacuationCandidate_{false};
+  
+  std::vector<CBValue *> rememberedSet_;
 };
 
+/// Ref arkcompiler BumpPointerAllocator::Allocate
+/// and art RegionSpace::Region::Alloc
+/// and hermes AlignedHeapSegment::alloc
+void *HeapRegion::alloc(size_t size) {
+  assert(isSizeHeapAligned(size) && "size must be heap aligned");
+  char *oldTop = top_;
+  if (COBRA_UNLIKELY(size > (size_t)(end() - oldTop))) {
+    return nullptr;
+  }
+  top_ = oldTop + size;
+  allocatedBytes_ += size;
+  ++allocatedObjects_;
+  return oldTop;
+}
+
 HeapRegion::Contents *HeapRegion::contents(void *lowLim) {
   return reinterpret_cast<Contents *>(lowLim);
 }
 
 HeapRegion *HeapRegion::getHeapRegion(const void *ptr) {
-  return reinterpret_cast<HeapRegion *>(reinterpret_cast<uintptr_t>(ptr) & kHighMask);
+  return contents(start(ptr))->region_;
 }
 
 void *HeapRegion::start(const void *ptr) {
@@ -204,18 +310,23 @@ MarkBitSet *HeapRegion::getMarkBitSet(const void *ptr) {
   return &contents(HeapRegion::start(ptr))->markBitSet_;
 }
 
-void HeapRegion::setCellMarkBit(const Object *object) {
+void HeapRegion::setCellMarkBit(const GCCell *object) {
   MarkBitSet *markBits = getMarkBitSet(object);
   size_t ind = markBits->index(object);
   markBits->mark(ind);
 }
 
-bool HeapRegion::getCellMarkBit(const Object *object) {
+bool HeapRegion::getCellMarkBit(const GCCell *object) {
   MarkBitSet *markBits = getMarkBitSet(object);
   size_t ind = markBits->index(object);
   return markBits->at(ind);
 }
 
+bool HeapRegion::testAndSetCellMarkBit(const GCCell *object) {
+  MarkBitSet *markBits = getMarkBitSet(object);
+  return markBits->testAndMark(markBits->index(object));
+}
+
 CardTable *HeapRegion::getCardTable(const void *ptr) {
   return &contents(HeapRegion::start(ptr))->cardTable_;
 }
@@ -10,7 +10,10 @@
 
 #include <stdint.h>
 #include <list>
+#include <string>
+#include <unordered_set>
 #include "cobra/VM/HeapRegion.h"
+#include "cobra/VM/MemMapAllocator.h"
 
 namespace cobra {
 namespace vm {
@@ -24,15 +27,59 @@ enum HeapRegionSpaceType {
 class HeapRegionSpace {
   
 public:
-  static HeapRegionSpace *create(const std::string& name);
+  /// Create an empty space of \p type, whose regions are allocated by
+  /// \p allocator and named \p name on platforms that support naming
+  /// memory. The space grows up to \p maxRegionCount regions, or without
+  /// limit if it is 0.
+  static HeapRegionSpace *create(
+      const std::string &name,
+      HeapRegionSpaceType type,
+      MemMapAllocator &allocator,
+      uint32_t maxRegionCount = 0);
+  
+  /// Free every region of the space.
+  ~HeapRegionSpace();
   
   /// Ref arkcompiler HeapRegionAllocator::AllocateAlignedRegion
   /// and art RegionSpace::AllocateRegion
   /// and hermes HadesGC::createSegment
-  HeapRegion *allocRegion();
+  ///
+  /// \return the new region of \p storageSize bytes, a multiple of
+  /// HeapRegion::kSize, which becomes the current one, null if the memory
+  /// cannot be allocated.
+  HeapRegion *allocRegion(size_t storageSize = HeapRegion::kSize);
+  
+  /// Free \p region and every object in it.
+  void freeRegion(HeapRegion *region);
+  
+  /// Allocate \p size bytes, which must be heap aligned. Only the top of the
+  /// current region is bumped, unless it is full.
+  /// \return the uninitialized memory, null if the heap is exhausted.
+  inline void *alloc(size_t size) {
+    if (COBRA_LIKELY(currentRegion_ != nullptr)) {
+      if (void *mem = currentRegion_->alloc(size))
+        return mem;
+    }
+    return allocSlow(size);
+  }
+  
+  /// Free every object of the space. The regions are kept, and allocation
+  /// starts over from the first one.
+  void reset();
   
+  /// \return true if \p ptr points into a region of the space.
+  bool contains(const void *ptr) const {
+    return storages_.count(HeapRegion::start(ptr)) != 0;
+  }
+  
+  HeapRegionSpaceType getType() const {
+    return type_;
+  }
+  
+  /// \return the region allocations are made in, null if the space has no
+  /// region yet.
   HeapRegion *getCurrentRegion() const {
-      return regions_.back();
+      return currentRegion_;
   }
 
   HeapRegion *getFirstRegion() const {
@@ -43,6 +90,15 @@ public:
     return regions_.size();
   }
   
+  /// \return the number of bytes below the tops of the regions, including
+  /// the ones of the objects freed since they were allocated.
+  size_t getUsedBytes() const;
+  
+  /// \return the number of bytes of the storages of the regions.
+  size_t getStorageBytes() const {
+    return storageBytes_;
+  }
+  
   std::list<HeapRegion *> &getRegions() {
     return regions_;
   }
@@ -52,7 +108,39 @@ public:
   }
   
 private:
+  HeapRegionSpace(
+      const std::string &name,
+      HeapRegionSpaceType type,
+      MemMapAllocator &allocator,
+      uint32_t maxRegionCount)
+      : name_(name),
+        type_(type),
+        allocator_(allocator),
+        maxRegionCount_(maxRegionCount) {}
+  
+  /// Delete \p region and free its storage.
+  void destroyRegion(HeapRegion *region);
+  
+  /// Allocate \p size bytes in the next region, when the current one is
+  /// full.
+  void *allocSlow(size_t size);
+  
+  std::string name_;
+  
+  HeapRegionSpaceType type_;
+  
+  MemMapAllocator &allocator_;
+  
+  uint32_t maxRegionCount_;
+  
+  HeapRegion *currentRegion_{nullptr};
+  
   std::list<HeapRegion *> regions_;
+  
+  /// The storage of every region, to find whether a pointer is in the space.
+  std::unordered_set<const void *> storages_;
+  
+  size_t storageBytes_{0};
 };
 
 }
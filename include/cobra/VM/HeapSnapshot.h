@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef HeapSnapshot_h
+#define HeapSnapshot_h
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cobra/VM/GCCell.h"
+
+namespace cobra {
+namespace vm {
+
+class HeapRegionSpace;
+class Runtime;
+
+/// Ref V8 HeapSnapshotGenerator and hermes HeapSnapshot
+///
+/// The graph of the objects of the heap of a runtime, with the size each
+/// object retains: the bytes that would be freed if it were not referenced
+/// anymore, found from the dominator tree of the graph.
+///
+/// The snapshot is written in the .heapsnapshot format of V8, which the
+/// Chrome DevTools and other heap viewers load. The first node is the root
+/// of the graph, which references a node standing for the registers, which
+/// references the objects they hold, and a node standing for the objects
+/// that are not reached from the registers, found by walking every region
+/// of the heap: garbage not collected yet, and objects only referenced
+/// through raw pointers (e.g. stored with ObjectAccessor::setObject), which
+/// the collector does not trace either.
+class HeapSnapshot {
+public:
+  enum class NodeType : uint8_t {
+    Hidden,
+    Array,
+    String,
+    Object,
+    Code,
+    Closure,
+    RegExp,
+    Number,
+    Native,
+    Synthetic,
+  };
+
+  enum class EdgeType : uint8_t {
+    Context,
+    Element,
+    Property,
+    Internal,
+    Hidden,
+    Shortcut,
+    Weak,
+  };
+
+  struct Node {
+    NodeType type;
+    /// Index of the name in the string table.
+    uint32_t name;
+    /// The object of the node, null for the synthetic nodes.
+    GCCell *cell;
+    uint32_t selfSize;
+    uint64_t retainedSize;
+    /// The edges of the node are [firstEdge, firstEdge + edgeCount).
+    uint32_t firstEdge;
+    uint32_t edgeCount;
+  };
+
+  struct Edge {
+    EdgeType type;
+    /// The index of an Element edge, else the index of its name in the
+    /// string table.
+    uint32_t nameOrIndex;
+    /// Index of the referenced node.
+    uint32_t to;
+  };
+
+  /// Index of the root node.
+  static constexpr uint32_t kRootNode = 0;
+
+  /// Take a snapshot of the heap of \p runtime. Nothing may be allocated
+  /// while it is taken.
+  explicit HeapSnapshot(Runtime &runtime);
+
+  HeapSnapshot(const HeapSnapshot &) = delete;
+  HeapSnapshot &operator=(const HeapSnapshot &) = delete;
+
+  const std::vector<Node> &getNodes() const {
+    return nodes_;
+  }
+
+  const std::vector<Edge> &getEdges() const {
+    return edges_;
+  }
+
+  const std::string &getString(uint32_t index) const {
+    return strings_[index];
+  }
+
+  /// \return the total size of the objects of the snapshot.
+  uint64_t getTotalSize() const {
+    return nodes_[kRootNode].retainedSize;
+  }
+
+  /// Write the snapshot in the .heapsnapshot format to \p os.
+  void dumpJSON(std::ostream &os) const;
+
+private:
+  /// \return the index of the node of \p cell, adding the node if it is new.
+  uint32_t getNode(GCCell *cell);
+
+  /// \return the index of the node of \p name, adding the node.
+  uint32_t addSyntheticNode(const char *name);
+
+  /// \return the index of \p str in the string table.
+  uint32_t intern(const std::string &str);
+
+  /// Add the edges of the node \p index, after the ones of the nodes before
+  /// it.
+  void addEdges(uint32_t index);
+
+  /// Add an edge from the current node to every object of \p space that
+  /// has no node yet.
+  void addUnreachedEdges(HeapRegionSpace &space, uint32_t &index);
+
+  /// Reorder the edges so that the ones of every node follow the ones of
+  /// the node before it, as the .heapsnapshot format lays them out.
+  void sortEdges();
+
+  void addEdge(EdgeType type, uint32_t nameOrIndex, GCCell *cell);
+
+  /// Set the retained size of every node from the dominator tree.
+  void computeRetainedSizes();
+
+  std::vector<Node> nodes_;
+  std::vector<Edge> edges_;
+  std::vector<std::string> strings_;
+  std::unordered_map<std::string, uint32_t> stringIndices_;
+  std::unordered_map<GCCell *, uint32_t> nodeIndices_;
+};
+
+}
+}
+
+#endif /* HeapSnapshot_h */
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef InlineCache_h
+#define InlineCache_h
+
+#include <cstdint>
+
+#include "cobra/Support/Common.h"
+
+namespace cobra {
+namespace vm {
+
+class Class;
+
+/// A receiver class and the offset of the field that was resolved for it.
+struct InlineCacheEntry {
+  Class *clazz;
+  uint32_t offset;
+};
+
+/// Per-instruction property cache used by GetField and SetField.
+/// Ref to https://github.com/facebook/hermes/blob/main/include/hermes/VM/PropertyCache.h
+///
+/// A cache starts out empty, becomes monomorphic after the first lookup and
+/// polymorphic as more receiver classes are seen. Once more than
+/// \c kMaxEntries classes have been seen at the same site the cache is
+/// marked megamorphic and lookups go through the runtime's
+/// MegamorphicCache instead.
+class InlineCache {
+public:
+  /// Maximum number of receiver classes recorded before going megamorphic.
+  static constexpr uint32_t kMaxEntries = 4;
+  
+  InlineCache() = default;
+  
+  bool isEmpty() const {
+    return size_ == 0;
+  }
+  
+  bool isMonomorphic() const {
+    return size_ == 1;
+  }
+  
+  bool isPolymorphic() const {
+    return size_ > 1;
+  }
+  
+  bool isMegamorphic() const {
+    return megamorphic_;
+  }
+  
+  /// Look up the field offset recorded for \p clazz.
+  /// \return true and set \p offset if the class is in the cache.
+  inline bool lookup(Class *clazz, uint32_t &offset) const {
+    // The first entry is checked separately since most sites stay
+    // monomorphic.
+    if (COBRA_LIKELY(entries_[0].clazz == clazz && size_ != 0)) {
+      offset = entries_[0].offset;
+      return true;
+    }
+    for (uint32_t i = 1; i < size_; ++i) {
+      if (entries_[i].clazz == clazz) {
+        offset = entries_[i].offset;
+        return true;
+      }
+    }
+    return false;
+  }
+  
+  /// Record that the field is at \p offset for receivers of \p clazz.
+  /// When the cache is full it is marked megamorphic instead.
+  void update(Class *clazz, uint32_t offset) {
+    if (megamorphic_)
+      return;
+    if (size_ == kMaxEntries) {
+      megamorphic_ = true;
+      return;
+    }
+    entries_[size_++] = {clazz, offset};
+  }
+  
+  /// Forget all the recorded classes, e.g. when classes have been moved or
+  /// unloaded.
+  void clear() {
+    size_ = 0;
+    megamorphic_ = false;
+  }
+  
+private:
+  InlineCacheEntry entries_[kMaxEntries]{};
+  
+  /// The number of valid entries in \c entries_.
+  uint8_t size_{0};
+  
+  bool megamorphic_{false};
+};
+
+/// A direct-mapped cache from (class, string id) to field offset, shared by
+/// all megamorphic GetField and SetField instructions of a runtime.
+class MegamorphicCache {
+public:
+  static constexpr uint32_t kNumEntries = 1024;
+  
+  MegamorphicCache() = default;
+  
+  /// \return true and set \p offset if (\p clazz, \p nameID) is cached.
+  inline bool lookup(Class *clazz, uint32_t nameID, uint32_t &offset) const {
+    const Entry &entry = entries_[hash(clazz, nameID)];
+    if (entry.clazz == clazz && entry.nameID == nameID) {
+      offset = entry.offset;
+      return true;
+    }
+    return false;
+  }
+  
+  /// Record the offset of \p nameID in \p clazz, evicting the previous entry
+  /// of the same bucket.
+  void update(Class *clazz, uint32_t nameID, uint32_t offset) {
+    entries_[hash(clazz, nameID)] = {clazz, nameID, offset};
+  }
+  
+  void clear() {
+    for (auto &entry : entries_) {
+      entry = {};
+    }
+  }
+  
+private:
+  struct Entry {
+    Class *clazz;
+    uint32_t nameID;
+    uint32_t offset;
+  };
+  
+  static uint32_t hash(Class *clazz, uint32_t nameID) {
+    // Classes are at least 8 bytes aligned, the low bits carry no
+    // information.
+    auto bits = reinterpret_cast<uintptr_t>(clazz) >> 3;
+    return (uint32_t)(bits ^ (nameID * 0x9E3779B1u)) & (kNumEntries - 1);
+  }
+  
+  Entry entries_[kNumEntries]{};
+};
+
+}
+}
+
+#endif /* InlineCache_h */
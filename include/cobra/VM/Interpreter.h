@@ -13,6 +13,7 @@
 #include "cobra/VM/Method.h"
 #include "cobra/VM/StackFrame.h"
 #include "cobra/VM/Runtime.h"
+#include "cobra/Support/Common.h"
 
 namespace cobra {
 namespace vm {
@@ -26,10 +27,34 @@ struct InterpSaveState {
 class Interpreter {
   
 public:
+  /// The ways the interpreter can pass control from the handler of an
+  /// instruction to the handler of the next one.
+  enum class Dispatch {
+    /// A loop that jumps through a table of label addresses (computed goto).
+    ComputedGoto,
+#ifdef COBRA_MUSTTAIL
+    /// One function per handler, each of which tail calls the next one, so
+    /// the interpreter state stays in argument registers.
+    TailCall,
+#endif
+  };
+  
+  /// The dispatch strategy used to execute methods.
+#ifdef COBRA_TAIL_CALL_INTERPRETER
+  static constexpr Dispatch kDefaultDispatch = Dispatch::TailCall;
+#else
+  static constexpr Dispatch kDefaultDispatch = Dispatch::ComputedGoto;
+#endif
+  
   static bool execute(Method *method, uint32_t *args, uint32_t argCount);
   
   static bool execute(StackFrame *frame);
   
+  /// Interpret the instructions set in \p frame, without compiling its
+  /// method, with the dispatch strategy \p dispatch.
+  /// \return false if an error was raised, the runtime holds its message.
+  static bool run(StackFrame *frame, Dispatch dispatch = kDefaultDispatch);
+  
 };
 
 }
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef InterpreterProfiler_h
+#define InterpreterProfiler_h
+
+#ifdef COBRA_INTERPRETER_PROFILER
+
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+#include "cobra/Inst/Inst.h"
+
+namespace cobra {
+namespace vm {
+
+class Method;
+
+/// Execution counters collected by the interpreter when it is built with
+/// COBRA_INTERPRETER_PROFILER: how often each opcode and each pair of
+/// consecutive opcodes executes, and how often each method is entered and
+/// takes a backward branch.
+class InterpreterProfiler {
+public:
+  static constexpr unsigned kNumOpCodes = (unsigned)inst::OpCode::_last;
+  
+  struct MethodCounters {
+    uint64_t entries{0};
+    uint64_t backEdges{0};
+  };
+  
+  InterpreterProfiler() : pairCounts_(kNumOpCodes * kNumOpCodes) {}
+  
+  /// Record the execution of an instruction with opcode \p opCode.
+  inline void onInstruction(inst::OpCode opCode) {
+    auto op = (unsigned)opCode;
+    ++opCodeCounts_[op];
+    if (prevOpCode_ < kNumOpCodes)
+      ++pairCounts_[prevOpCode_ * kNumOpCodes + op];
+    prevOpCode_ = op;
+  }
+  
+  /// \return the number of executions of the instructions with opcode
+  /// \p opCode.
+  uint64_t getOpCodeCount(inst::OpCode opCode) const {
+    return opCodeCounts_[(unsigned)opCode];
+  }
+  
+  /// \return the number of executions of an instruction with opcode
+  /// \p second right after one with opcode \p first.
+  uint64_t getPairCount(inst::OpCode first, inst::OpCode second) const {
+    return pairCounts_[(unsigned)first * kNumOpCodes + (unsigned)second];
+  }
+  
+  /// Record an invocation of \p method.
+  void onMethodEntry(Method *method) {
+    ++methodCounters_[method].entries;
+  }
+  
+  /// Record a backward branch taken in \p method.
+  void onBackEdge(Method *method) {
+    ++methodCounters_[method].backEdges;
+  }
+  
+  /// Clear all the counters.
+  void reset();
+  
+  /// Write the counters to \p os as JSON, sorted by decreasing count:
+  /// { "opcodes": {name: count},
+  ///   "pairs": [{"first": name, "second": name, "count": count}],
+  ///   "methods": [{"index": index, "entries": count, "backEdges": count}] }
+  void dumpJSON(std::ostream &os) const;
+  
+private:
+  uint64_t opCodeCounts_[kNumOpCodes]{};
+  
+  /// Count of the opcode pairs, indexed by first * kNumOpCodes + second.
+  std::vector<uint64_t> pairCounts_;
+  
+  /// The opcode of the last executed instruction, kNumOpCodes if none.
+  unsigned prevOpCode_{kNumOpCodes};
+  
+  std::unordered_map<Method *, MethodCounters> methodCounters_{};
+};
+
+}
+}
+
+#endif // COBRA_INTERPRETER_PROFILER
+
+#endif /* InterpreterProfiler_h */
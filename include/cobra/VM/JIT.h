@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef JIT_h
+#define JIT_h
+
+#ifdef COBRA_ENABLE_JIT
+
+#include "cobra/VM/Method.h"
+
+namespace cobra {
+namespace vm {
+
+/// Baseline template JIT for x86-64.
+/// Each instruction of a hot method is translated to a fixed machine code
+/// template: simple instructions (moves, constants, numeric arithmetic and
+/// comparisons, jumps) are inlined, the others call out-of-line helpers.
+/// Virtual registers stay in the interpreter frame, so compiled code and the
+/// interpreter share frames and can call each other freely.
+class JIT {
+public:
+  /// Number of interpreter entries after which a method is compiled.
+  static constexpr uint32_t kHotnessThreshold = 1000;
+
+  /// Compile \p method and install its code.
+  /// \return false if the method uses instructions the JIT does not support,
+  /// it then keeps running in the interpreter.
+  static bool compile(Method *method);
+
+  /// Count an entry into \p method, and compile it when it becomes hot.
+  /// \return true if \p method has compiled code.
+  static bool compileIfHot(Method *method) {
+    if (method->getCompiledCode())
+      return true;
+    if (COBRA_LIKELY(!method->incrementHotness(kHotnessThreshold)))
+      return false;
+    return compile(method);
+  }
+};
+
+}
+}
+
+#endif // COBRA_ENABLE_JIT
+
+#endif /* JIT_h */
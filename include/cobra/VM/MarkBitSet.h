@@ -8,12 +8,18 @@
 #ifndef MarkBitSet_h
 #define MarkBitSet_h
 
-#include "cobra/Support/BitSet.h"
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+
 #include "cobra/VM/RuntimeGlobals.h"
 
 namespace cobra {
 namespace vm {
 
+/// The mark bits of a HeapRegion, one bit per heap aligned address of the
+/// region. The bit set lives in the metadata of the region it covers, and is
+/// shared by the marking threads, which set its bits atomically.
 class MarkBitSet {
 public:
   MarkBitSet() = default;
@@ -24,46 +30,67 @@ public:
   MarkBitSet(MarkBitSet &&) = delete;
   MarkBitSet &operator=(const MarkBitSet &) = delete;
   MarkBitSet &operator=(MarkBitSet &&) = delete;
-  
+
 private:
-  static constexpr size_t kNumBits = 1;
-  BitSet<kNumBits> bitSet;
-  
+  static constexpr size_t kNumBits = DEFAULT_HEAP_REGION_SIZE >> LogHeapAlign;
+  static constexpr size_t kBitsPerWord = 64;
+  static constexpr size_t kNumWords = kNumBits / kBitsPerWord;
+
+  std::atomic<uint64_t> words_[kNumWords];
+
+  static uint64_t bit(size_t idx) {
+    return uint64_t(1) << (idx % kBitsPerWord);
+  }
+
 public:
   static constexpr size_t size() {
     return kNumBits;
   }
-  
+
   /// Refto JSC candidateAtomNumber
   /// And hermes MarkBitArrayNC::addressToIndex
-  inline size_t index(const void *ptr) const {
-    return (reinterpret_cast<uintptr_t>(ptr) - reinterpret_cast<uintptr_t>(this)) >> LogHeapAlign;
+  static inline size_t index(const void *ptr) {
+    return (reinterpret_cast<uintptr_t>(ptr) & (DEFAULT_HEAP_REGION_SIZE - 1)) >>
+        LogHeapAlign;
   }
-  
+
   inline bool at(size_t idx) const {
     assert(idx < kNumBits && "precondition: ind must be within the index range");
-    return true;
-    return bitSet.at(idx);
+    return (words_[idx / kBitsPerWord].load(std::memory_order_relaxed) &
+            bit(idx)) != 0;
   }
-  
+
   inline void mark(size_t idx) {
     assert(idx < kNumBits && "precondition: ind must be within the index range");
-    bitSet.set(idx, true);
+    words_[idx / kBitsPerWord].fetch_or(bit(idx), std::memory_order_relaxed);
   }
-  
+
   inline void mark(const void *ptr) {
-    size_t idx = index(ptr);
-    mark(idx);
+    mark(index(ptr));
   }
-  
+
+  /// Set the bit \p idx.
+  /// \return true if this call set it, false if it was already set.
+  inline bool testAndMark(size_t idx) {
+    assert(idx < kNumBits && "precondition: ind must be within the index range");
+    std::atomic<uint64_t> &word = words_[idx / kBitsPerWord];
+    // Most objects are only reached once, a plain load avoids the locked
+    // instruction for the others.
+    if (word.load(std::memory_order_relaxed) & bit(idx))
+      return false;
+    return (word.fetch_or(bit(idx), std::memory_order_relaxed) & bit(idx)) == 0;
+  }
+
   inline void clear() {
-    bitSet.reset();
+    for (auto &word : words_)
+      word.store(0, std::memory_order_relaxed);
   }
 
   inline void markAll() {
-    bitSet.set();
+    for (auto &word : words_)
+      word.store(~uint64_t(0), std::memory_order_relaxed);
   }
-  
+
 };
 
 
@@ -9,23 +9,108 @@
 #define MemMapAllocator_h
 
 #include <stdio.h>
+#include <chrono>
 #include <cstddef>
+#include <vector>
 
 namespace cobra {
 namespace vm {
 
+/// Ref hermes AlignedStorage and HadesGC::segmentIndices_
+/// and arkcompiler PoolManager
+///
+/// The source of the storage of the heap regions of a runtime. The storages
+/// are claimed from the HeapCage, and committed when first used. The freed regions are kept in
+/// a free list and reused first, so that getting a region takes constant
+/// time; a freed storage spanning several regions is split into them. The
+/// regions idle for longer than the release delay are returned to the OS,
+/// but stay in the free list. The storage of a large object is returned to
+/// the OS as soon as it is freed, since another one of its size is unlikely
+/// to come soon. The regions are given back to the cage when
+/// the allocator is destroyed.
+///
+/// When asked to, the allocator advises the OS to back the storages with
+/// transparent huge pages. The regions are aligned to a multiple of the huge
+/// page size, so every huge page of a storage can be backed, but for the one
+/// holding the guard page of the region.
 class MemMapAllocator {
 public:
-  MemMapAllocator() = default;
-  ~MemMapAllocator() = default;
+  /// Create an allocator, reserving the HeapCage if it is not yet. If
+  /// \p hugePages is true, the storages are backed by huge pages where the
+  /// OS has them.
+  explicit MemMapAllocator(bool hugePages = false);
+  
+  /// Give the free regions back to the cage. Every storage must have been
+  /// freed.
+  ~MemMapAllocator();
   
   MemMapAllocator(const MemMapAllocator &) = delete;
   MemMapAllocator(MemMapAllocator &&) = delete;
   MemMapAllocator &operator=(const MemMapAllocator &) = delete;
   MemMapAllocator &operator=(MemMapAllocator &&) = delete;
   
+  /// Allocate a storage of \p size bytes, a multiple of the region size,
+  /// aligned to the region size. Its memory is named \p name on platforms
+  /// that support naming memory.
+  /// \return the storage, which is zero-filled unless it reuses freed
+  /// regions, null if the cage is exhausted.
+  void *alloc(size_t size, const char *name);
+  
+  /// Free the storage of \p size bytes at \p storage, allocated by alloc().
+  /// If \p release is true, its memory is returned to the OS right away
+  /// instead of after the release delay.
+  void free(void *storage, size_t size, bool release = false);
+  
+  /// Return to the OS the memory of the free regions that were idle for
+  /// longer than the release delay.
+  void releaseIdleRegions();
+  
+  /// Set how long a free region stays idle before its memory is returned
+  /// to the OS.
+  void setReleaseDelay(std::chrono::milliseconds delay) {
+    releaseDelay_ = delay;
+  }
+  
+  /// \return the number of bytes of the free regions whose memory was not
+  /// returned to the OS yet.
+  size_t getRetainedBytes() const;
+  
+  /// \return the number of bytes for which huge pages were asked.
+  size_t getHugePageRequestedBytes() const {
+    return hugePageRequestedBytes_;
+  }
+  
+  /// \return the number of bytes for which the OS took the huge page advice.
+  size_t getHugePageAdvisedBytes() const {
+    return hugePageAdvisedBytes_;
+  }
+  
+private:
+  using Clock = std::chrono::steady_clock;
+  
+  struct FreeRegion {
+    void *storage;
+    Clock::time_point freedAt;
+  };
+  
+  /// Ask for huge pages for the \p size bytes at \p mem, which were just
+  /// mapped, if the allocator was asked to.
+  void adviseHugePages(void *mem, size_t size);
+  
+  /// Take \p count regions of contiguous memory out of the free list.
+  /// \return the first of them, null if the free list holds no such run.
+  void *takeFreeRun(size_t count);
+  
+  /// The free regions, from the longest idle. The first releasedCount_ of
+  /// them had their memory returned to the OS.
+  std::vector<FreeRegion> freeRegions_;
+  size_t releasedCount_{0};
   
+  std::chrono::milliseconds releaseDelay_{1000};
   
+  bool hugePages_;
+  size_t hugePageRequestedBytes_{0};
+  size_t hugePageAdvisedBytes_{0};
 };
 
 }
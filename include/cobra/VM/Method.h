@@ -10,11 +10,21 @@
 
 #include "cobra/VM/Object.h"
 #include "cobra/VM/CodeDataAccessor.h"
+#include "cobra/VM/InlineCache.h"
+
+#include <memory>
 
 namespace cobra {
 namespace vm {
 
 class Class;
+class StackFrame;
+class CBValue;
+
+/// Entry point of the machine code the JIT generated for a method. Runs the
+/// method on \p frame, whose registers start at \p frameRegs.
+/// \return false when the stack or the heap is exhausted.
+using JITCompiledCode = bool (*)(StackFrame *frame, CBValue *frameRegs);
 
 class Method : public Object {
     
@@ -24,8 +34,12 @@ class Method : public Object {
   /// verifier flags and single-implementation flag.
   std::atomic<uint32_t> accessFlags_ {0};
   
+  /// Number of declared parameters, not including 'this'.
   uint32_t argsCount_ {0};
   
+  /// Number of registers used by the method's frame.
+  uint32_t frameSize_ {0};
+  
   uint16_t methodIndex_;
   
   const CexFile *file_;
@@ -33,9 +47,36 @@ class Method : public Object {
   /// Method prototype descriptor string (return and argument types).
   const char *shorty_;
   
+  /// The bytecode this method runs, a private copy of the one in its file,
+  /// which the verifier and the adaptive interpreter rewrite in place.
+  std::unique_ptr<uint8_t[]> instructions_;
+  
+  uint32_t codeSize_ {0};
+  
+  /// Side table of the inline caches used by the GetField and SetField
+  /// instructions of this method, indexed by their cache index operand.
+  InlineCache *inlineCaches_ {nullptr};
+  
+  uint32_t inlineCacheCount_ {0};
+  
+  /// Number of times this method was entered by the interpreter, the JIT
+  /// compiles it once the count reaches its threshold.
+  uint32_t hotnessCounter_ {0};
+  
+  /// Machine code of this method, null if it was not compiled.
+  JITCompiledCode compiledCode_ {nullptr};
+  
+  /// Size of the pages holding the machine code, freed with the method.
+  size_t compiledCodeSize_ {0};
+  
 public:
   
-  ~Method() = default;
+  /// Create the method \p methodIndex of \p file, whose prototype is
+  /// \p shorty. Methods are not allocated in the heap, they live as long as
+  /// the module that loaded them.
+  Method(const CexFile *file, uint16_t methodIndex, const char *shorty);
+  
+  ~Method();
   
   Method() = delete;
   Method(const Method &) = delete;
@@ -87,6 +128,10 @@ public:
     return (getAccessFlags() & kAccObsoleteMethod) != 0;
   }
   
+  bool isVerified() const {
+    return (getAccessFlags() & kAccVerified) != 0;
+  }
+  
   uint32_t getAccessFlags() const {
     return accessFlags_.load(std::memory_order_relaxed);
   }
@@ -106,14 +151,59 @@ public:
     methodIndex_ = idx;
   }
   
+  /// \return the bytecode of this method, null until it is set by
+  /// setInstructions().
   const uint8_t *getInstructions() const {
-    return CodeDataAccessor::getInstructions(*file_);
+    return instructions_.get();
+  }
+  
+  uint32_t getCodeSize() const {
+    return codeSize_;
   }
   
+  /// Make the \p codeSize bytes at \p insts the bytecode of this method.
+  /// They are copied, so that quickening never writes to the file the
+  /// bytecode was loaded from, which may be mapped read-only or shared.
+  void setInstructions(const uint8_t *insts, uint32_t codeSize);
+  
   const char *getShorty() {
     return shorty_;
   }
   
+  uint32_t getArgCount() const {
+    return argsCount_;
+  }
+  
+  void setArgCount(uint32_t argCount) {
+    argsCount_ = argCount;
+  }
+  
+  uint32_t getFrameSize() const {
+    return frameSize_;
+  }
+  
+  void setFrameSize(uint32_t frameSize) {
+    frameSize_ = frameSize;
+  }
+  
+  const CexFile *getCexFile() const {
+    return file_;
+  }
+  
+  /// Allocate the inline cache table of this method, \p count is the number
+  /// of cache indices used by its instructions. Called by the class linker
+  /// with the count the bytecode generator recorded for the method.
+  void initInlineCaches(uint32_t count);
+  
+  uint32_t getInlineCacheCount() const {
+    return inlineCacheCount_;
+  }
+  
+  InlineCache *getInlineCache(uint32_t idx) {
+    assert(idx < inlineCacheCount_ && "Inline cache index out of range");
+    return &inlineCaches_[idx];
+  }
+  
   static constexpr uint32_t getArgCountOffset() {
     return MEMBER_OFFSET(Method, argsCount_);
   }
@@ -122,9 +212,40 @@ public:
     return MEMBER_OFFSET(Method, methodIndex_);
   }
   
-  void invoke(uint32_t *args, uint32_t argCount);
+  /// Bump the hotness counter of this method.
+  /// \return true exactly once, when the counter reaches \p threshold.
+  bool incrementHotness(uint32_t threshold) {
+    return hotnessCounter_ != threshold && ++hotnessCounter_ == threshold;
+  }
+  
+  JITCompiledCode getCompiledCode() const {
+    return compiledCode_;
+  }
+  
+  /// Install the machine code \p code, which takes \p size bytes of pages
+  /// from oscompat::vm_allocate. The method owns them from now on.
+  void setCompiledCode(JITCompiledCode code, size_t size) {
+    assert(compiledCode_ == nullptr && "Method is already compiled");
+    compiledCode_ = code;
+    compiledCodeSize_ = size;
+  }
+  
+  /// Run this method with the \p argCount 32-bit words at \p args as its
+  /// parameters, decoded as its shorty describes.
+  /// \return false if an error was raised.
+  bool invoke(uint32_t *args, uint32_t argCount);
+  
+  /// Run the compiled code of this method with the parameters \p args, as
+  /// in invoke(). Native methods have no code to run, and raise an error.
+  /// \return false if an error was raised.
+  bool invokeCompiledCode(uint32_t *args, uint32_t argCount);
   
-  void invokeCompiledCode(uint32_t *args, uint32_t argCount);
+  /// Run the compiled code of this method on \p frame, which must be the top
+  /// frame of the register stack, then pop it. Raises a stack overflow if
+  /// Runtime::kMaxNativeCallDepth invocations of compiled code are already
+  /// running.
+  /// \return false if an error was raised.
+  bool invokeCompiledCode(StackFrame *frame);
   
 };
 
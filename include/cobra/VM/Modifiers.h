@@ -39,6 +39,9 @@ static constexpr uint32_t kAccConstructor =           0x00010000;  // method <(c
 // This flag may only be applied to methods.
 static constexpr uint32_t kAccObsoleteMethod =        0x00040000;  // method (runtime)
 
+// Set by the verifier once the bytecode of the method was checked.
+static constexpr uint32_t kAccVerified =              0x00080000;  // method (runtime)
+
 }
 }
 
@@ -24,13 +24,20 @@ namespace vm {
 
 class Class;
 
+/// The instance fields of an object are CBValues, laid out after the
+/// Object header up to the size of the cell.
 class Object : public GCCell {
-  /// The Class representing the type of the object.
-  GCPointer<Class> clazz{nullptr};
+  /// The Class representing the type of the object. Classes are created by
+  /// the class linker outside of the heap, so the collector does not trace
+  /// this pointer.
+  Class *clazz{nullptr};
+  
+protected:
+  Object(CBValueKind kind, uint32_t size) : GCCell(kind, size) {}
   
 public:
   
-  Object() = default;
+  Object() : GCCell(ObjectKind, heapAlignSize(instanceSize())) {}
   
   static constexpr uint32_t instanceSize() {
     return sizeof(Object);
@@ -41,7 +48,7 @@ public:
   }
   
   inline Class *getClass() {
-    return clazz.get<Class>();
+    return clazz;
   }
   
   /// Ref to https://android.googlesource.com/platform/art/+/refs/heads/main/runtime/mirror/object.h#373
@@ -17,6 +17,30 @@ namespace vm {
 
 bool strictEqualityTest(CBValue x, CBValue y);
 
+/// Convert a primitive value to a number, following ES5.1 9.3 ToNumber.
+/// Strings and objects are not converted yet and produce NaN.
+double toNumber(CBValue value);
+
+/// Convert a value to a signed 32-bit integer, following ES5.1 9.5 ToInt32.
+int32_t toInt32(CBValue value);
+
+/// Convert a value to an unsigned 32-bit integer, following ES5.1 9.6
+/// ToUint32.
+uint32_t toUInt32(CBValue value);
+
+/// Convert a value to a boolean, following ES5.1 9.2 ToBoolean.
+bool toBoolean(CBValue value);
+
+/// Append the string of a value to \p out, following ES5.1 9.8 ToString.
+/// Objects are not converted yet and produce "[object Object]".
+void appendToString(CBValue value, std::u16string &out);
+
+/// Add \p x and \p y into \p result, following ES5.1 11.6.1: the strings
+/// of the operands are concatenated if either of them is a string, else
+/// their numbers are added.
+/// \return false if the heap is exhausted by the concatenated string.
+bool addValues(GC &heap, CBValue x, CBValue y, CBValue &result);
+
 }
 }
 
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef ParallelMarker_h
+#define ParallelMarker_h
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "cobra/Support/WorkStealingDeque.h"
+#include "cobra/VM/GCCell.h"
+#include "cobra/VM/HeapRegionSpace.h"
+
+namespace cobra {
+namespace vm {
+
+/// Marks the objects of some spaces that are reachable from a set of roots, on
+/// several threads. Every thread pushes the grey objects it finds, marked but
+/// not scanned yet, on its own deque, and steals from the deques of the other
+/// threads once its own is empty. Marking ends when every thread is out of
+/// work.
+class ParallelMarker {
+public:
+  /// Create a marker of the objects of \p spaces running on \p numThreads
+  /// threads, the calling one included.
+  ParallelMarker(std::vector<HeapRegionSpace *> spaces, uint32_t numThreads);
+
+  ~ParallelMarker();
+
+  ParallelMarker(const ParallelMarker &) = delete;
+  ParallelMarker &operator=(const ParallelMarker &) = delete;
+
+  /// Mark every object of the spaces reachable from \p roots, which may hold
+  /// pointers out of the spaces. The mark bits of the spaces must be clear.
+  void mark(const std::vector<GCCell *> &roots);
+
+  /// Scan the grey objects \p grey, which are marked already, and mark the
+  /// objects of the spaces reachable from them, until about \p budget bytes
+  /// were scanned. This continues a marking that was started elsewhere.
+  /// \return true if no grey object is left, else takeGrey() returns them.
+  bool markFrom(const std::vector<GCCell *> &grey, uint64_t budget);
+
+  /// Append the objects left grey when markFrom() ran out of budget to
+  /// \p grey.
+  void takeGrey(std::vector<GCCell *> &grey);
+
+  /// \return the number of bytes of the objects marked by mark().
+  uint64_t getMarkedBytes() const;
+  
+  /// Add the slots found by mark() that reference an evacuation candidate
+  /// to the remembered set of the candidate.
+  void rememberCandidateSlots();
+
+private:
+  struct Worker;
+
+  /// Bytes a worker scans between two checks of the budget.
+  static constexpr uint64_t kBudgetCheckBytes = 64 * 1024;
+
+  /// Run the workers until there is no work left or the budget is spent.
+  void runWorkers(uint64_t budget);
+
+  /// Mark from the deque of worker \p id until there is no work left.
+  void run(uint32_t id);
+
+  /// Count the \p size bytes scanned by \p worker against the budget.
+  /// \return false once the budget is spent.
+  inline bool chargeBudget(Worker &worker, uint64_t size);
+
+  /// Steal a grey object from the deque of another worker than \p id.
+  bool steal(uint32_t id, GCCell *&cell);
+
+  /// \return true if some worker has grey objects.
+  bool hasWork() const;
+
+  /// \return true if \p cell is in one of the spaces.
+  inline bool contains(const GCCell *cell) const;
+  
+  /// Mark \p cell, which must be in one of the spaces, and push it on the
+  /// deque of \p worker if it was white.
+  inline void markCell(Worker &worker, GCCell *cell);
+
+  /// Mark the objects \p cell references.
+  void scan(Worker &worker, GCCell *cell);
+
+  std::vector<HeapRegionSpace *> spaces_;
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+
+  /// Number of workers that ran out of work.
+  std::atomic<uint32_t> idleCount_{0};
+
+  /// The bytes the workers may scan, and the ones they scanned.
+  uint64_t budget_{UINT64_MAX};
+  std::atomic<uint64_t> scannedBytes_{0};
+
+  /// Set once the budget is spent, the workers then stop.
+  std::atomic<bool> outOfBudget_{false};
+};
+
+}
+}
+
+#endif /* ParallelMarker_h */
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef RegisterStack_h
+#define RegisterStack_h
+
+#include <memory>
+
+#include "cobra/VM/CBValue.h"
+
+namespace cobra {
+namespace vm {
+
+/// A contiguous stack of registers from which the interpreter carves its
+/// frames. The whole stack is reserved up front, and committed in chunks of
+/// \c kCommitSize bytes as it grows, so a deep call chain only costs a pointer
+/// bump per call.
+class RegisterStack {
+public:
+  /// Default number of registers of a runtime's register stack (16MB).
+  static constexpr uint32_t kDefaultNumRegisters = 2 * 1024 * 1024;
+  
+  /// Granularity at which the reserved memory is committed.
+  static constexpr size_t kCommitSize = 64 * 1024;
+  
+  /// Reserve a register stack of \p numRegisters registers. If \p hugePages
+  /// is true, the stack is committed in huge pages where the OS has them.
+  /// \return nullptr if the address space could not be reserved.
+  static std::unique_ptr<RegisterStack> create(
+      uint32_t numRegisters = kDefaultNumRegisters,
+      bool hugePages = false);
+  
+  ~RegisterStack();
+  
+  RegisterStack(const RegisterStack &) = delete;
+  RegisterStack &operator=(const RegisterStack &) = delete;
+  
+  /// \return the first register of the stack.
+  CBValue *getBottom() const {
+    return start_;
+  }
+  
+  /// \return the first free register.
+  CBValue *getTop() const {
+    return top_;
+  }
+  
+  /// \return the size in bytes of the reservation of the stack.
+  size_t getReservedSize() const {
+    return (end_ - start_) * sizeof(CBValue);
+  }
+  
+  /// Allocate \p count registers at the top of the stack.
+  /// \return the first allocated register, or nullptr on stack overflow.
+  inline CBValue *allocate(uint32_t count) {
+    CBValue *regs = top_;
+    CBValue *newTop = regs + count;
+    if (COBRA_UNLIKELY(newTop > committedEnd_) && !commit(newTop)) {
+      return nullptr;
+    }
+    top_ = newTop;
+    return regs;
+  }
+  
+  /// Pop every register above \p top.
+  void release(CBValue *top) {
+    assert(top >= start_ && top <= top_ && "Invalid register stack top");
+    top_ = top;
+  }
+  
+  /// Uncommit the unused memory above the top of the stack.
+  void trim();
+  
+private:
+  RegisterStack(CBValue *start, uint32_t numRegisters, bool hugePages)
+      : start_(start),
+        top_(start),
+        committedEnd_(start),
+        end_(start + numRegisters),
+        hugePages_(hugePages) {}
+  
+  /// Commit enough memory so that the registers below \p newTop are usable.
+  /// \return false if that would overflow the reservation.
+  bool commit(CBValue *newTop);
+  
+  /// Start of the reservation.
+  CBValue *const start_;
+  
+  /// First free register.
+  CBValue *top_;
+  
+  /// End of the committed part of the stack.
+  CBValue *committedEnd_;
+  
+  /// End of the reservation.
+  CBValue *const end_;
+  
+  /// Whether the stack is committed in huge pages, rather than in chunks of
+  /// kCommitSize bytes.
+  const bool hugePages_;
+  
+  /// \return the granularity at which this stack is committed.
+  size_t getCommitSize() const;
+};
+
+}
+}
+
+#endif /* RegisterStack_h */
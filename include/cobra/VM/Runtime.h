@@ -8,25 +8,44 @@
 #ifndef Runtime_h
 #define Runtime_h
 
+#include <atomic>
+#include <cassert>
 #include <string>
 
 #include "cobra/VM/Interpreter.h"
 #include "cobra/BCGen/BytecodeRawData.h"
 #include "cobra/VM/Handle.h"
 #include "cobra/VM/ClassLinker.h"
+#include "cobra/VM/GC.h"
 #include "cobra/VM/RuntimeOptions.h"
 #include "cobra/VM/CexFile.h"
 #include "cobra/VM/StackFrame.h"
+#include "cobra/VM/InlineCache.h"
+#include "cobra/VM/RegisterStack.h"
+#include "cobra/VM/InterpreterProfiler.h"
+#include "cobra/VM/SamplingProfiler.h"
+#include "cobra/VM/AllocationSampler.h"
 
 namespace cobra {
 namespace vm {
 
+class RuntimeModule;
+
+/// An isolated instance of the VM. A process can run several runtimes, each
+/// with its own heap, class linker and register stack, which share no mutable
+/// state. A runtime is current on at most one thread at a time, and the
+/// objects of one runtime must never be reachable from another.
 class Runtime {
   
-  static Runtime* instance_;
-  static RuntimeOptions options_;
+  /// The runtime of the calling thread.
+  static thread_local Runtime *current_;
+  
+  RuntimeOptions options_;
   
-  ClassLinker *classLinker_{};
+  /// The objects allocated by this runtime.
+  std::unique_ptr<GC> heap_{};
+  
+  std::unique_ptr<ClassLinker> classLinker_{};
   HandleScope *topScope_{};
   
   /// The package of the app running in this process.
@@ -40,25 +59,169 @@ class Runtime {
   
   StackFrame *currentFrame_{nullptr};
   
+  /// The registers of the interpreter frames.
+  std::unique_ptr<RegisterStack> registerStack_{};
+  
+  /// Field offsets of the property accesses whose inline cache went
+  /// megamorphic.
+  MegamorphicCache megamorphicCache_{};
+  
+  /// The error the interpreter unwound with, empty if none.
+  std::string pendingError_{};
+  
+  /// The number of invocations of compiled code on the native stack.
+  uint32_t nativeCallDepth_{0};
+  
+  /// The bytecode modules loaded by runBytecode.
+  std::vector<std::unique_ptr<RuntimeModule>> modules_{};
+  
+#ifdef COBRA_INTERPRETER_PROFILER
+  /// Execution counters collected by the interpreter.
+  InterpreterProfiler interpreterProfiler_{};
+#endif
+  
+#ifdef COBRA_SAMPLING_PROFILER
+  /// Samples the frame chain from a timer signal.
+  SamplingProfiler samplingProfiler_{};
+#endif
+  
+#ifdef COBRA_ALLOCATION_SAMPLER
+  /// Samples the allocations of the heap, with the instruction allocating.
+  AllocationSampler allocationSampler_{};
+#endif
+  
 public:
   
+  /// Compiled code calls methods with native calls. This is the deepest
+  /// nesting of compiled code invocations, past it methods run in the
+  /// interpreter so that deep recursion cannot exhaust the native stack.
+  static constexpr uint32_t kMaxNativeCallDepth = 1024;
+  
   Runtime();
   
-  static bool create(const RuntimeOptions &options);
+  /// Create a runtime and make it the current runtime of the calling thread.
+  /// \return null if the calling thread already has a current runtime, or if
+  /// the runtime cannot be initialized.
+  static Runtime *create(const RuntimeOptions &options);
   
   ~Runtime();
   
+  /// Destroy the current runtime of the calling thread.
+  /// \return false if the calling thread has no current runtime.
   static bool destroy();
   
-  static Runtime *getCurrent();
+  /// \return the current runtime of the calling thread, null if none.
+  static Runtime *getCurrent() {
+    return current_;
+  }
+  
+  /// Make \p runtime the current runtime of the calling thread, or detach the
+  /// thread from its runtime if \p runtime is null. This lets a pool of
+  /// threads take turns running a runtime, one at a time.
+  static void setCurrent(Runtime *runtime) {
+    current_ = runtime;
+  }
   
   HandleScope *getTopScope();
   
+  const RuntimeOptions &getOptions() const {
+    return options_;
+  }
+  
+  GC &getHeap() {
+    return *heap_;
+  }
+  
+  /// \return the statistics of the collections of the heap.
+  GCStats &getGCStats() {
+    return heap_->getStats();
+  }
+  
+  ClassLinker &getClassLinker() {
+    return *classLinker_;
+  }
+  
   StackFrame *getCurrentFrame() {
     return currentFrame_;
   }
   
-  bool runBytecode(std::shared_ptr<BytecodeRawData> &&bytecode);
+  void setCurrentFrame(StackFrame *frame) {
+#ifdef COBRA_SAMPLING_PROFILER
+    // The sampling profiler walks the frames from a signal handler on this
+    // thread, the frame must be complete before it becomes visible.
+    std::atomic_signal_fence(std::memory_order_release);
+#endif
+    currentFrame_ = frame;
+  }
+  
+  RegisterStack &getRegisterStack() {
+    return *registerStack_;
+  }
+  
+  MegamorphicCache &getMegamorphicCache() {
+    return megamorphicCache_;
+  }
+  
+  /// Record \p message as the error the interpreter unwinds with. The
+  /// invocation of the interpreter then returns false.
+  void raiseError(const char *message) {
+    pendingError_ = message;
+  }
+  
+  bool hasPendingError() const {
+    return !pendingError_.empty();
+  }
+  
+  const std::string &getPendingError() const {
+    return pendingError_;
+  }
+  
+  void clearPendingError() {
+    pendingError_.clear();
+  }
+  
+  /// \return true if compiled code can be invoked without going deeper than
+  /// kMaxNativeCallDepth. Otherwise callers run the method in the
+  /// interpreter, whose calls do not nest on the native stack.
+  bool canEnterNativeCall() const {
+    return nativeCallDepth_ < kMaxNativeCallDepth;
+  }
+  
+  /// Count an invocation of compiled code.
+  void enterNativeCall() {
+    assert(canEnterNativeCall() && "Native stack too deep");
+    ++nativeCallDepth_;
+  }
+  
+  /// Count the return of an invocation of compiled code.
+  void leaveNativeCall() {
+    assert(nativeCallDepth_ != 0 && "Unbalanced native calls");
+    --nativeCallDepth_;
+  }
+  
+#ifdef COBRA_INTERPRETER_PROFILER
+  InterpreterProfiler &getInterpreterProfiler() {
+    return interpreterProfiler_;
+  }
+#endif
+  
+#ifdef COBRA_SAMPLING_PROFILER
+  SamplingProfiler &getSamplingProfiler() {
+    return samplingProfiler_;
+  }
+#endif
+  
+#ifdef COBRA_ALLOCATION_SAMPLER
+  AllocationSampler &getAllocationSampler() {
+    return allocationSampler_;
+  }
+#endif
+  
+  /// Load the functions of \p bytecode, linking and verifying each of them.
+  /// \return false with the reason in \p error if a function does not link.
+  bool runBytecode(
+      std::shared_ptr<BytecodeRawData> &&bytecode,
+      std::string &error);
   
 private:
   
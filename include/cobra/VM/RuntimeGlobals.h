@@ -24,6 +24,9 @@ namespace cobra {
 /// it 32-bit).
 using gcheapsize_t = uint32_t;
 
+/// The size and the alignment of a HeapRegion.
+static constexpr size_t DEFAULT_HEAP_REGION_SIZE = 4 * 1024 * 1024;
+
 static const uint32_t LogHeapAlign = 3;
 static const uint32_t HeapAlign = 1 << LogHeapAlign;
 
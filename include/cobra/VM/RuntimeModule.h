@@ -8,7 +8,9 @@
 #ifndef RuntimeModule_h
 #define RuntimeModule_h
 
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "cobra/VM/Interpreter.h"
 #include "cobra/BCGen/BytecodeRawData.h"
@@ -19,17 +21,40 @@ namespace vm {
 class CodeBlock;
 class Runtime;
 
+/// The methods of the functions of a bytecode module, loaded into a runtime.
 class RuntimeModule {
   
   Runtime &runtime_;
   
-  std::shared_ptr<BytecodeRawData> bytecode{};
+  std::shared_ptr<BytecodeRawData> bytecode_{};
+  
+  /// The method of every function, by function ID.
+  std::vector<std::unique_ptr<Method>> methods_{};
+  
+  /// The prototypes of the methods, which take and return values.
+  std::vector<std::string> shorties_{};
   
 public:
   explicit RuntimeModule(Runtime &runtime) : runtime_(runtime) {}
                          
   ~RuntimeModule();
-                         
+  
+  /// Load every function of \p bytecode as a method of \p runtime, and
+  /// link it.
+  /// \return null with the reason in \p error if a function does not link.
+  static std::unique_ptr<RuntimeModule> create(
+      Runtime &runtime,
+      std::shared_ptr<BytecodeRawData> bytecode,
+      std::string &error);
+  
+  uint32_t getNumMethods() const {
+    return methods_.size();
+  }
+  
+  Method *getMethod(uint32_t functionID) const {
+    return methods_[functionID].get();
+  }
+  
 };
 
 }
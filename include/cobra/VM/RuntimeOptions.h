@@ -20,8 +20,19 @@ public:
 
   static bool create(const RuntimeRawOptions& rawOptions);
   
-
+  /// Whether the heap regions and the register stack are backed by
+  /// transparent huge pages, where the OS has them. Off by default, since a
+  /// small heap would waste most of its huge pages.
+  bool getHugePages() const {
+    return hugePages_;
+  }
+  
+  void setHugePages(bool hugePages) {
+    hugePages_ = hugePages;
+  }
   
+private:
+  bool hugePages_{false};
 };
 
 }
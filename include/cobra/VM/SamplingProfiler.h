@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef SamplingProfiler_h
+#define SamplingProfiler_h
+
+#ifdef COBRA_SAMPLING_PROFILER
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <time.h>
+
+namespace cobra {
+namespace vm {
+
+class Method;
+class Runtime;
+
+/// A sampling profiler for the interpreter, available when the VM is built
+/// with COBRA_SAMPLING_PROFILER. A SIGPROF timer on the CPU clock of the
+/// profiled thread interrupts that thread, whose signal handler walks the StackFrame chain of the runtime and
+/// records the method and bytecode offset of every frame into a ring buffer.
+/// The handler neither allocates nor locks: samples that do not fit in the
+/// buffer are dropped and counted. While the profiler runs, a drainer thread
+/// moves the buffered samples out of it every kDrainInterval, so the buffer
+/// only needs to hold the samples of one interval.
+class SamplingProfiler {
+public:
+  /// Frames deeper than this are cut from the sampled stacks.
+  static constexpr uint32_t kMaxDepth = 32;
+
+  /// The offset of a frame whose current instruction is not known, e.g. a
+  /// frame running compiled code.
+  static constexpr uint32_t kUnknownOffset = UINT32_MAX;
+
+  /// How often the drainer thread empties the ring buffer. At the default
+  /// 1 kHz a buffer of 4096 samples lasts for about 4 seconds.
+  static constexpr std::chrono::milliseconds kDrainInterval{100};
+
+  struct Frame {
+    Method *method;
+    /// Offset of the current instruction in the bytecode of the method.
+    uint32_t offset;
+  };
+
+  struct Sample {
+    /// Time of the sample in nanoseconds, from a monotonic clock.
+    uint64_t timestamp;
+    /// Number of valid entries in frames, the innermost frame first.
+    uint32_t depth;
+    Frame frames[kMaxDepth];
+  };
+
+  SamplingProfiler() = default;
+  ~SamplingProfiler();
+
+  SamplingProfiler(const SamplingProfiler &) = delete;
+  SamplingProfiler &operator=(const SamplingProfiler &) = delete;
+
+  /// Start sampling the stack of \p runtime on the calling thread
+  /// \p frequency times per second of CPU time, into a buffer of
+  /// \p capacity samples, which is rounded up to a power of two.
+  /// \return false if a sampling profiler is already running or the timer
+  /// cannot be installed.
+  bool start(
+      Runtime *runtime,
+      uint32_t frequency = 1000,
+      uint32_t capacity = 4096);
+
+  /// Stop sampling, join the drainer thread and drain the remaining samples.
+  void stop();
+
+  bool isRunning() const {
+    return running_;
+  }
+
+  /// Forget the drained samples. The profiler must be stopped.
+  void reset();
+
+  /// \return the number of samples that were dropped because the buffer was
+  /// full, or because the timer signal was delivered to another thread,
+  /// which can only happen on systems without per-thread CPU timers.
+  uint64_t getDroppedSamples() const {
+    return dropped_.load(std::memory_order_relaxed);
+  }
+
+  /// \return the drained samples. The profiler must be stopped.
+  const std::vector<Sample> &getSamples() const {
+    return samples_;
+  }
+
+  /// Write the drained samples to \p os as folded stacks, one line per
+  /// distinct stack, outermost frame first, followed by its sample count:
+  ///   method#0;method#3;method#7 12
+  void dumpFoldedStacks(std::ostream &os) const;
+
+  /// Write the drained samples to \p os in the Chrome trace event format,
+  /// with a "stackFrames" table and one entry of "samples" per sample.
+  void dumpChromeTrace(std::ostream &os) const;
+
+private:
+  static void handleSignal(int sig);
+
+  /// Arm the timer that sends SIGPROF \p frequency times per second of CPU
+  /// time of the profiled thread.
+  /// \return false if the timer cannot be created.
+  bool startTimer(uint32_t frequency);
+
+  /// Disarm and delete the timer armed by startTimer().
+  void stopTimer();
+
+  /// Record a sample of the current stack, called from the signal handler.
+  void takeSample();
+
+  /// Move the buffered samples out of the ring buffer, called by the drainer
+  /// thread while the profiler runs and by stop() once it is joined.
+  void drain();
+
+  /// The body of the drainer thread, drain every kDrainInterval until stop().
+  void runDrainer();
+
+  /// The profiler receiving the samples, null if none is running.
+  static std::atomic<SamplingProfiler *> active_;
+
+  Runtime *runtime_{nullptr};
+
+  /// The profiled thread, samples taken on other threads are ignored.
+  pthread_t thread_{};
+
+#ifdef __linux__
+  /// The CPU timer of the profiled thread.
+  timer_t timer_{};
+#endif
+
+  bool running_{false};
+
+  /// Ring buffer of capacity_ samples, filled by the signal handler at head_
+  /// and drained at tail_. Both indices only grow, and are masked with
+  /// capacity_ - 1 to index the buffer.
+  std::unique_ptr<Sample[]> buffer_{};
+  uint32_t capacity_{0};
+  std::atomic<uint64_t> head_{0};
+  std::atomic<uint64_t> tail_{0};
+
+  std::atomic<uint64_t> dropped_{0};
+
+  /// The samples moved out of the ring buffer by drain().
+  std::vector<Sample> samples_{};
+
+  /// The drainer thread, which never receives SIGPROF.
+  std::thread drainer_{};
+  std::mutex drainerMutex_{};
+  std::condition_variable drainerCond_{};
+  /// Set by stop() to end the drainer thread, guarded by drainerMutex_.
+  bool stopDrainer_{false};
+
+  static_assert(
+      std::atomic<uint64_t>::is_always_lock_free,
+      "The ring buffer indices are updated from a signal handler");
+};
+
+}
+}
+
+#endif // COBRA_SAMPLING_PROFILER
+
+#endif /* SamplingProfiler_h */
@@ -8,17 +8,113 @@
 #ifndef StackFrame_h
 #define StackFrame_h
 
+#include <algorithm>
+#include <new>
 #include <string>
 
+#include "cobra/VM/CBValue.h"
+#include "cobra/VM/Method.h"
+#include "cobra/VM/RegisterStack.h"
+
 namespace cobra {
 namespace vm {
 
-class Method;
-
+/// An interpreter frame. Frames are not heap allocated, they are carved out of
+/// the runtime's RegisterStack, with the frame registers right above the
+/// frame header and the parameters right below it:
+///
+///   | ... | argN ... arg1 this | StackFrame | reg0 ... regK | ...
+///                                ^ frame      ^ getRegisters()
+///
+/// The parameters are the outgoing registers at the end of the caller's frame,
+/// so the callee reads its arguments in place and the caller does not need to
+/// copy them into a separate argument area.
 class StackFrame {
 public:
-  static StackFrame *create(StackFrame *prev, Method *method, uint32_t argCount) {
-    return new StackFrame(prev, method, argCount);
+#ifdef COBRA_SAMPLING_PROFILER
+  static constexpr uint32_t kNumHeaderPointers = 7;
+#else
+  static constexpr uint32_t kNumHeaderPointers = 6;
+#endif
+  
+  /// Number of registers taken by a frame header.
+  static constexpr uint32_t kNumHeaderRegisters =
+      alignTo<sizeof(CBValue)>(
+          sizeof(void *) * kNumHeaderPointers + sizeof(uint32_t)) /
+      sizeof(CBValue);
+  
+  /// Create a frame for \p method at the top of \p stack.
+  /// The \p argCount + 1 parameters (including 'this') must be the registers
+  /// immediately below the top of \p stack, in reverse order.
+  /// \param prevTop is the top of the stack to restore when the frame is
+  ///   popped.
+  /// \param result is the register in which the return value is stored, may be
+  ///   null.
+  /// \return nullptr on stack overflow.
+  static StackFrame *create(
+      RegisterStack &stack,
+      StackFrame *prev,
+      Method *method,
+      uint32_t argCount,
+      CBValue *prevTop,
+      CBValue *result = nullptr) {
+    if (COBRA_UNLIKELY(argCount < method->getArgCount()))
+      return createWithMissingArgs(
+          stack, prev, method, argCount, prevTop, result);
+    return createWithFrameSize(
+        stack, prev, method, method->getFrameSize(), argCount, prevTop, result);
+  }
+  
+  /// Create a frame with \p frameSize registers at the top of \p stack, for
+  /// instructions that do not come from \p method, which may be null.
+  /// The other parameters are the same as in create().
+  static StackFrame *createWithFrameSize(
+      RegisterStack &stack,
+      StackFrame *prev,
+      Method *method,
+      uint32_t frameSize,
+      uint32_t argCount,
+      CBValue *prevTop,
+      CBValue *result = nullptr) {
+    CBValue *mem = stack.allocate(kNumHeaderRegisters + frameSize);
+    if (COBRA_UNLIKELY(mem == nullptr))
+      return nullptr;
+    auto *frame = new (mem) StackFrame(prev, method, argCount, prevTop, result);
+    // The collector scans every register, which must not hold the stale
+    // values of a popped frame.
+    std::fill_n(frame->getRegisters(), frameSize, CBValue::encodeUndefinedValue());
+    return frame;
+  }
+  
+  /// Create a frame for \p method, which is passed fewer parameters than it
+  /// declares. The parameters are copied above the top of \p stack and
+  /// completed with undefined, so that the frame of a method always holds at
+  /// least its declared parameters. The parameters are the same as in
+  /// create().
+  static StackFrame *createWithMissingArgs(
+      RegisterStack &stack,
+      StackFrame *prev,
+      Method *method,
+      uint32_t argCount,
+      CBValue *prevTop,
+      CBValue *result);
+  
+  /// Create a frame for \p method at the top of \p stack, and push its
+  /// parameters from the \p argCount 32-bit words at \p args, in the native
+  /// calling convention: the parameters are decoded as the shorty of
+  /// \p method describes, longs, doubles and references take two words, low
+  /// word first.
+  /// \return nullptr on stack overflow.
+  static StackFrame *createWithArgs(
+      RegisterStack &stack,
+      StackFrame *prev,
+      Method *method,
+      uint32_t *args,
+      uint32_t argCount);
+  
+  /// Pop \p frame and every register above it from \p stack.
+  static void destroy(RegisterStack &stack, StackFrame *frame) {
+    stack.release(frame->prevTop_);
   }
   
   StackFrame *getPrevFrame() const {
@@ -49,15 +145,61 @@ public:
     return insts_;
   }
   
+  /// \return the first register of the frame.
+  CBValue *getRegisters() {
+    return reinterpret_cast<CBValue *>(this) + kNumHeaderRegisters;
+  }
+  
+  /// \return the parameter \p idx, 0 being 'this'.
+  CBValue &getParam(uint32_t idx) {
+    assert(idx <= argCount_ && "Parameter index out of range");
+    return reinterpret_cast<CBValue *>(this)[-1 - (int32_t)idx];
+  }
+  
+  /// The instruction at which the caller resumes when this frame returns.
+  void setReturnIP(const uint8_t *ip) {
+    returnIP_ = ip;
+  }
+  
+  const uint8_t *getReturnIP() const {
+    return returnIP_;
+  }
+  
+  /// \return the register in which the return value is stored, null if the
+  /// value is discarded.
+  CBValue *getResult() const {
+    return result_;
+  }
+  
+#ifdef COBRA_SAMPLING_PROFILER
+  /// The last instruction of this frame the interpreter told the sampling
+  /// profiler about, null if none.
+  void setSampledIP(const uint8_t *ip) {
+    sampledIP_ = ip;
+  }
+  
+  const uint8_t *getSampledIP() const {
+    return sampledIP_;
+  }
+#endif
+  
 private:
   StackFrame(
     StackFrame *prev,
     Method *method,
-    uint32_t argCount)
+    uint32_t argCount,
+    CBValue *prevTop,
+    CBValue *result)
     : prev_(prev),
       method_(method),
-      argCount_(argCount),
-      insts_(nullptr){}
+      insts_(nullptr),
+      returnIP_(nullptr),
+      result_(result),
+      prevTop_(prevTop),
+#ifdef COBRA_SAMPLING_PROFILER
+      sampledIP_(nullptr),
+#endif
+      argCount_(argCount) {}
   
   ~StackFrame() = default;
   
@@ -69,11 +211,26 @@ private:
   
   StackFrame *prev_;
   Method *method_;
-  uint32_t argCount_;
   const uint8_t *insts_;
+  const uint8_t *returnIP_;
+  CBValue *result_;
+  
+  /// Top of the register stack before the parameters of this frame were
+  /// pushed.
+  CBValue *prevTop_;
+  
+#ifdef COBRA_SAMPLING_PROFILER
+  const uint8_t *sampledIP_;
+#endif
+  
+  uint32_t argCount_;
   
 };
 
+static_assert(
+    sizeof(StackFrame) <= StackFrame::kNumHeaderRegisters * sizeof(CBValue),
+    "StackFrame header does not fit in its registers");
+
 }
 }
 
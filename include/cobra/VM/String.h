@@ -9,6 +9,7 @@
 #define String_h
 
 #include "cobra/VM/Object.h"
+#include "cobra/VM/GC.h"
 
 namespace cobra {
 namespace vm {
@@ -23,7 +24,17 @@ enum class StringCompressionFlag : uint32_t {
 class String : public Object {
   
 public:
-  String() = default;
+  
+  /// Allocate a string of the \p length characters at \p chars, one
+  /// character per byte, in \p heap. The string is compressed if every
+  /// character is ASCII.
+  /// \return null if the heap is exhausted.
+  static String *create(GC &heap, const char *chars, uint32_t length);
+  
+  /// Allocate a string of the \p length UTF-16 code units at \p chars in
+  /// \p heap. The string is compressed if every code unit is ASCII.
+  /// \return null if the heap is exhausted.
+  static String *create(GC &heap, const uint16_t *chars, uint32_t length);
   
   static constexpr uint32_t getLengthOffset() {
     return MEMBER_OFFSET(String, length_);
@@ -63,7 +74,7 @@ public:
   uint32_t computeHashCode();
   
   bool isCompressed() {
-    return kUseStringCompression && isCompressed(getLength());
+    return kUseStringCompression && isCompressed(length_);
   }
   
    static bool isCompressed(int32_t length) {
@@ -79,6 +90,12 @@ public:
   bool equals(String* that);
   
 private:
+  explicit String(uint32_t size) : Object(StringKind, size) {}
+  
+  /// Allocate a string of \p length characters in \p heap, leaving the
+  /// characters uninitialized.
+  static String *allocate(GC &heap, uint32_t length, bool compressed);
+  
   uint32_t length_;
   uint32_t hashCode_;
   
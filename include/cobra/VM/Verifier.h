@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef Verifier_h
+#define Verifier_h
+
+#include <string>
+
+#include "cobra/VM/Method.h"
+
+namespace cobra {
+namespace vm {
+
+/// Checks the bytecode of a method once, when it is linked, so that the
+/// interpreter does not have to check it on every instruction. Bytecode comes
+/// from downloaded bundles and must not be trusted.
+///
+/// A method is valid if:
+///   - every instruction has a known opcode and fits in the code;
+///   - every register operand is below the frame size of the method;
+///   - every jump targets the start of an instruction;
+///   - every string and function ID is in range of the tables of its file;
+///   - LoadParam only reads declared parameters, calls pass at least 'this'
+///     and at most the registers of the frame, and inline cache indices are in
+///     range of the inline cache table or kNoInlineCacheIndex;
+///   - the last instruction does not fall through the end of the code.
+class Verifier {
+public:
+  /// Verify the \p codeSize bytes of instructions of \p method. On success,
+  /// mark the method verified and rewrite its checked instructions into their
+  /// unchecked variants (e.g. LoadParam into LoadParamUnchecked).
+  /// \return false with a description of the first error in \p error if the
+  /// bytecode is invalid, the method is then left untouched.
+  static bool verify(Method *method, uint32_t codeSize, std::string &error);
+
+  /// Verify \p codeSize bytes of instructions at \p insts, which belong to
+  /// \p method. This is verify() for instructions that do not come from the
+  /// file of the method.
+  static bool verify(
+      Method *method,
+      const uint8_t *insts,
+      uint32_t codeSize,
+      std::string &error);
+};
+
+}
+}
+
+#endif /* Verifier_h */
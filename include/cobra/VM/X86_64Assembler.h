@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef X86_64Assembler_h
+#define X86_64Assembler_h
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace cobra {
+namespace vm {
+
+/// A minimal x86-64 assembler, with just the instructions used by the
+/// templates of the baseline JIT. Code is emitted into a growable buffer and
+/// copied to executable memory once complete, so every branch is encoded with
+/// a 32-bit displacement that is patched when its target is known.
+class X86_64Assembler {
+public:
+  enum Reg : uint8_t {
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15,
+  };
+
+  enum XMMReg : uint8_t { XMM0, XMM1 };
+
+  /// Condition codes, encoded as the low nibble of Jcc.
+  enum Cond : uint8_t {
+    Below = 0x2,
+    AboveEqual = 0x3,
+    Equal = 0x4,
+    NotEqual = 0x5,
+    BelowEqual = 0x6,
+    Above = 0x7,
+    Parity = 0xa,
+  };
+
+  /// Scalar double arithmetic, encoded as the opcode byte after F2 0F.
+  enum SSEOp : uint8_t {
+    AddSD = 0x58,
+    MulSD = 0x59,
+    SubSD = 0x5c,
+    DivSD = 0x5e,
+  };
+
+  size_t size() const {
+    return code_.size();
+  }
+
+  const uint8_t *data() const {
+    return code_.data();
+  }
+
+  void push(Reg reg) {
+    if (reg >= R8)
+      emit8(0x41);
+    emit8(0x50 + (reg & 7));
+  }
+
+  void pop(Reg reg) {
+    if (reg >= R8)
+      emit8(0x41);
+    emit8(0x58 + (reg & 7));
+  }
+
+  void ret() {
+    emit8(0xc3);
+  }
+
+  /// mov dst, src
+  void mov(Reg dst, Reg src) {
+    emitREXW(src, dst);
+    emit8(0x89);
+    emitModRMReg(src, dst);
+  }
+
+  /// mov dst, imm64
+  void movImm(Reg dst, uint64_t imm) {
+    emit8(0x48 | (dst >> 3));
+    emit8(0xb8 + (dst & 7));
+    emit64(imm);
+  }
+
+  /// mov dst, [base + disp]
+  void load(Reg dst, Reg base, int32_t disp) {
+    emitREXW(dst, base);
+    emit8(0x8b);
+    emitModRMMem(dst, base, disp);
+  }
+
+  /// mov [base + disp], src
+  void store(Reg base, int32_t disp, Reg src) {
+    emitREXW(src, base);
+    emit8(0x89);
+    emitModRMMem(src, base, disp);
+  }
+
+  /// cmp lhs, rhs
+  void cmp(Reg lhs, Reg rhs) {
+    emitREXW(rhs, lhs);
+    emit8(0x39);
+    emitModRMReg(rhs, lhs);
+  }
+
+  /// test al, al
+  void testAL() {
+    emit8(0x84);
+    emit8(0xc0);
+  }
+
+  /// movq dst, src
+  void movq(XMMReg dst, Reg src) {
+    emit8(0x66);
+    emitREXW(Reg(dst), src);
+    emit8(0x0f);
+    emit8(0x6e);
+    emitModRMReg(Reg(dst), src);
+  }
+
+  /// movq dst, src
+  void movq(Reg dst, XMMReg src) {
+    emit8(0x66);
+    emitREXW(Reg(src), dst);
+    emit8(0x0f);
+    emit8(0x7e);
+    emitModRMReg(Reg(src), dst);
+  }
+
+  /// movsd dst, [base + disp]
+  void movsd(XMMReg dst, Reg base, int32_t disp) {
+    emit8(0xf2);
+    emitREX(Reg(dst), base);
+    emit8(0x0f);
+    emit8(0x10);
+    emitModRMMem(Reg(dst), base, disp);
+  }
+
+  /// addsd/subsd/mulsd/divsd dst, src
+  void sse(SSEOp op, XMMReg dst, XMMReg src) {
+    emit8(0xf2);
+    emit8(0x0f);
+    emit8(op);
+    emitModRMReg(Reg(dst), Reg(src));
+  }
+
+  /// ucomisd lhs, [base + disp]
+  void ucomisd(XMMReg lhs, Reg base, int32_t disp) {
+    emit8(0x66);
+    emitREX(Reg(lhs), base);
+    emit8(0x0f);
+    emit8(0x2e);
+    emitModRMMem(Reg(lhs), base, disp);
+  }
+
+  /// call reg
+  void call(Reg reg) {
+    if (reg >= R8)
+      emit8(0x41);
+    emit8(0xff);
+    emitModRMReg(Reg(2), reg);
+  }
+
+  /// jmp rel32, with a displacement to be patched.
+  /// \return the position of the displacement.
+  size_t jmp() {
+    emit8(0xe9);
+    emit32(0);
+    return size() - 4;
+  }
+
+  /// jcc rel32, with a displacement to be patched.
+  /// \return the position of the displacement.
+  size_t jcc(Cond cond) {
+    emit8(0x0f);
+    emit8(0x80 | cond);
+    emit32(0);
+    return size() - 4;
+  }
+
+  /// Point the branch displacement at \p pos to \p target.
+  void patch(size_t pos, size_t target) {
+    int32_t rel = (int32_t)(target - (pos + 4));
+    memcpy(&code_[pos], &rel, sizeof(rel));
+  }
+
+  /// Point the branch displacement at \p pos to the current position.
+  void bind(size_t pos) {
+    patch(pos, size());
+  }
+
+private:
+  std::vector<uint8_t> code_;
+
+  void emit8(uint8_t byte) {
+    code_.push_back(byte);
+  }
+
+  void emit32(uint32_t value) {
+    size_t pos = code_.size();
+    code_.resize(pos + sizeof(value));
+    memcpy(&code_[pos], &value, sizeof(value));
+  }
+
+  void emit64(uint64_t value) {
+    size_t pos = code_.size();
+    code_.resize(pos + sizeof(value));
+    memcpy(&code_[pos], &value, sizeof(value));
+  }
+
+  /// REX.W prefix with \p reg in ModRM.reg and \p rm in ModRM.rm.
+  void emitREXW(Reg reg, Reg rm) {
+    emit8(0x48 | ((reg >> 3) << 2) | (rm >> 3));
+  }
+
+  /// Optional REX prefix, only emitted for the extended registers.
+  void emitREX(Reg reg, Reg rm) {
+    if (reg >= R8 || rm >= R8)
+      emit8(0x40 | ((reg >> 3) << 2) | (rm >> 3));
+  }
+
+  void emitModRMReg(Reg reg, Reg rm) {
+    emit8(0xc0 | ((reg & 7) << 3) | (rm & 7));
+  }
+
+  /// [base + disp32] operand. RSP and R12 as a base need a SIB byte.
+  void emitModRMMem(Reg reg, Reg base, int32_t disp) {
+    emit8(0x80 | ((reg & 7) << 3) | (base & 7));
+    if ((base & 7) == RSP)
+      emit8(0x24);
+    emit32((uint32_t)disp);
+  }
+};
+
+}
+}
+
+#endif /* X86_64Assembler_h */
@@ -14,6 +14,7 @@
 #include "cobra/IR/Analysis.h"
 #include "cobra/BCGen/BCPasses.h"
 #include "cobra/BCGen/MovElimination.h"
+#include "cobra/BCGen/Lowering.h"
 
 #include <algorithm>
 #include <queue>
@@ -23,6 +24,7 @@ using namespace cobra;
 void lowerIR(Module *M) {
   PassManager PM;
   
+  PM.addPass<LowerCondBranch>();
   PM.addPass<LoadConstants>();
   PM.addPass<LoadParameters>();
   
@@ -6,6 +6,7 @@
  */
 
 #include "cobra/BCGen/BytecodeGenerator.h"
+#include "cobra/Inst/Inst.h"
 #include "cobra/Support/Common.h"
 #include "cobra/IR/Analysis.h"
 
@@ -14,7 +15,9 @@ using namespace cobra;
 static constexpr param_t JumpTempValue = 0;
 
 void BytecodeFunctionGenerator::addJumpToRelocations(offset_t loc, BasicBlock *target) {
-  relocations_.push_back({loc, Relocation::RelocationType::LongJumpType, target});
+  auto type = isWideJump(opcodes_[loc]) ? Relocation::RelocationType::WideJumpType
+                                        : Relocation::RelocationType::LongJumpType;
+  relocations_.push_back({loc, type, target});
 }
 
 void BytecodeFunctionGenerator::generateJumpTable() {
@@ -48,6 +51,12 @@ void BytecodeFunctionGenerator::resolveRelocations() {
           }
           break;
         }
+        case Relocation::WideJumpType: {
+          int targetLoc = basicBlockMap_[dynamic_cast<BasicBlock *>(pointer)].first;
+          int jumpOffset = targetLoc - loc;
+          this->updateJumpTarget(loc + 1, jumpOffset, 4);
+          break;
+        }
         case Relocation::BasicBlockType:
           basicBlockMap_[dynamic_cast<BasicBlock *>(pointer)].first = loc;
           break;
@@ -78,7 +87,10 @@ void BytecodeFunctionGenerator::emitMovIfNeeded(param_t dest, param_t src) {
   if (dest == src)
     return;
   
-  this->emitMov(dest, src);
+  if (isWideRegister(dest) || isWideRegister(src))
+    this->emitMovLong(dest, src);
+  else
+    this->emitMov(dest, src);
 }
 
 void BytecodeFunctionGenerator::generateSingleOperandInst(SingleOperandInst *Inst, BasicBlock *next) {
@@ -110,22 +122,76 @@ void BytecodeFunctionGenerator::generateBinaryOperatorInst(BinaryOperatorInst *I
   auto left = encodeValue(Inst->getLeftHandSide());
   auto right = encodeValue(Inst->getRightHandSide());
   auto res = encodeValue(Inst);
+  // Int32 operands select the integer variants, which check for overflow.
+  bool isInt32 = Inst->getLeftHandSide()->getType().isInt32Type() &&
+      Inst->getRightHandSide()->getType().isInt32Type();
+  
+  // Registers that do not fit in 8 bits select the wide variants.
+  bool wide = isWideRegister(res) || isWideRegister(left) ||
+      isWideRegister(right);
+  
+#define EMIT_BINOP(name)                          \
+  if (wide)                                       \
+    this->emit##name##Wide(res, left, right);     \
+  else                                            \
+    this->emit##name(res, left, right);
   
   using OpKind = BinaryOperatorInst::OpKind;
   
   switch (Inst->getOperatorKind()) {
     case OpKind::EqualKind: // ==
-      this->emitEq(res, left, right);
+      EMIT_BINOP(Eq);
       break;
     case OpKind::ModuloKind: // %   (%=)
-      this->emitMod(res, left, right);
+      EMIT_BINOP(Mod);
       break;
     case OpKind::AddKind: // +   (+=)
-      this->emitAdd(res, left, right);
+      if (isInt32) {
+        EMIT_BINOP(AddI32);
+      } else {
+        EMIT_BINOP(Add);
+      }
+      break;
+    case OpKind::SubtractKind: // -   (-=)
+      if (isInt32) {
+        EMIT_BINOP(SubI32);
+      } else {
+        EMIT_BINOP(Sub);
+      }
+      break;
+    case OpKind::MultiplyKind: // *   (*=)
+      if (isInt32) {
+        EMIT_BINOP(MulI32);
+      } else {
+        EMIT_BINOP(Mul);
+      }
+      break;
+    case OpKind::DivideKind: // /   (/=)
+      EMIT_BINOP(Div);
+      break;
+    case OpKind::AndKind: // &   (^=)
+      EMIT_BINOP(BitAnd);
+      break;
+    case OpKind::OrKind: // |   (|=)
+      EMIT_BINOP(BitOr);
+      break;
+    case OpKind::XorKind: // ^   (^=)
+      EMIT_BINOP(BitXor);
+      break;
+    case OpKind::LeftShiftKind: // <<  (<<=)
+      EMIT_BINOP(LShift);
+      break;
+    case OpKind::RightShiftKind: // >>  (>>=)
+      EMIT_BINOP(RShift);
+      break;
+    case OpKind::UnsignedRightShiftKind: // >>> (>>>=)
+      EMIT_BINOP(URshift);
       break;
     default:
       break;
   }
+  
+#undef EMIT_BINOP
 }
 
 void BytecodeFunctionGenerator::generateStoreStackInst(StoreStackInst *Inst, BasicBlock *next) {
@@ -151,46 +217,135 @@ void BytecodeFunctionGenerator::generateBranchInst(BranchInst *Inst, BasicBlock
 
 void BytecodeFunctionGenerator::generateReturnInst(ReturnInst *Inst, BasicBlock *next) {
   auto value = encodeValue(Inst->getValue());
-  this->emitRet(value);
+  if (isWideRegister(value))
+    this->emitRetWide(value);
+  else
+    this->emitRet(value);
 }
 
 void BytecodeFunctionGenerator::generateCondBranchInst(CondBranchInst *Inst, BasicBlock *next) {
   auto condReg = encodeValue(Inst->getCondition());
+  bool wide = isWideRegister(condReg);
 
   BasicBlock *trueBlock = Inst->getTrueDest();
   BasicBlock *falseBlock = Inst->getFalseDest();
   
   if (next == trueBlock) {
-    auto loc = this->emitJmpFalseLong(JumpTempValue, condReg);
+    auto loc = wide ? this->emitJmpFalseWide(JumpTempValue, condReg)
+                    : this->emitJmpFalseLong(JumpTempValue, condReg);
     addJumpToRelocations(loc, falseBlock);
     return;
   }
   
-  auto loc = this->emitJmpTrueLong(JumpTempValue, condReg);
+  auto loc = wide ? this->emitJmpTrueWide(JumpTempValue, condReg)
+                  : this->emitJmpTrueLong(JumpTempValue, condReg);
   addJumpToRelocations(loc, trueBlock);
   
   if (next == falseBlock) {
     return;
   }
   
-  loc = this->emitJmpFalseLong(JumpTempValue, condReg);
+  loc = wide ? this->emitJmpFalseWide(JumpTempValue, condReg)
+             : this->emitJmpFalseLong(JumpTempValue, condReg);
+  addJumpToRelocations(loc, falseBlock);
+}
+
+void BytecodeFunctionGenerator::generateCompareBranchInst(CompareBranchInst *Inst, BasicBlock *next) {
+  auto left = encodeValue(Inst->getLeftHandSide());
+  auto right = encodeValue(Inst->getRightHandSide());
+  bool isNumber = Inst->getLeftHandSide()->getType().isNumberType() &&
+      Inst->getRightHandSide()->getType().isNumberType();
+  bool wide = isWideRegister(left) || isWideRegister(right);
+  
+  BasicBlock *trueBlock = Inst->getTrueDest();
+  BasicBlock *falseBlock = Inst->getFalseDest();
+  
+  // If the true block is the next block, jump to the false block when the
+  // comparison does not hold instead.
+  bool invert = next == trueBlock;
+  if (invert)
+    std::swap(trueBlock, falseBlock);
+  
+  offset_t loc;
+  using OpKind = BinaryOperatorInst::OpKind;
+  
+#define EMIT_COMPARE_BRANCH_VARIANT(name, notName, suffix)                   \
+  if (isNumber) {                                                           \
+    loc = invert                                                            \
+        ? this->emit##notName##N##suffix(JumpTempValue, left, right)        \
+        : this->emit##name##N##suffix(JumpTempValue, left, right);          \
+  } else {                                                                  \
+    loc = invert ? this->emit##notName##suffix(JumpTempValue, left, right)  \
+                 : this->emit##name##suffix(JumpTempValue, left, right);    \
+  }
+#define EMIT_COMPARE_BRANCH(name, notName)               \
+  if (wide) {                                            \
+    EMIT_COMPARE_BRANCH_VARIANT(name, notName, Wide)     \
+  } else {                                               \
+    EMIT_COMPARE_BRANCH_VARIANT(name, notName, Long)     \
+  }
+  
+  switch (Inst->getOperatorKind()) {
+    case OpKind::EqualKind: // ==
+    case OpKind::StrictlyEqualKind: // ===
+      EMIT_COMPARE_BRANCH(JEq, JNotEq);
+      break;
+    case OpKind::NotEqualKind: // !=
+    case OpKind::StrictlyNotEqualKind: // !==
+      EMIT_COMPARE_BRANCH(JNotEq, JEq);
+      break;
+    case OpKind::LessThanKind: // <
+      EMIT_COMPARE_BRANCH(JLess, JNotLess);
+      break;
+    case OpKind::LessThanOrEqualKind: // <=
+      EMIT_COMPARE_BRANCH(JLessEqual, JNotLessEqual);
+      break;
+    case OpKind::GreaterThanKind: // >
+      EMIT_COMPARE_BRANCH(JGreater, JNotGreater);
+      break;
+    case OpKind::GreaterThanOrEqualKind: // >=
+      EMIT_COMPARE_BRANCH(JGreaterEqual, JNotGreaterEqual);
+      break;
+    default:
+      COBRA_UNREACHABLE();
+  }
+  
+#undef EMIT_COMPARE_BRANCH
+#undef EMIT_COMPARE_BRANCH_VARIANT
+  
+  addJumpToRelocations(loc, trueBlock);
+  
+  if (next == falseBlock)
+    return;
+  
+  loc = this->emitJmpLong(JumpTempValue);
   addJumpToRelocations(loc, falseBlock);
 }
 
 void BytecodeFunctionGenerator::generateLoadConstInst(LoadConstInst *Inst, BasicBlock *next) {
   auto output = encodeValue(Inst);
+  bool wide = isWideRegister(output);
   Literal *literal = Inst->getConst();
   switch (literal->getKind()) {
     case ValueKind::LiteralNumberKind: {
       auto *litNum = dynamic_cast<LiteralNumber *>(literal);
       if (litNum->isPositiveZero()) {
-        this->emitLoadConstZero(output);
+        if (wide)
+          this->emitLoadConstZeroWide(output);
+        else
+          this->emitLoadConstZero(output);
       } else if (litNum->isUInt8Representible()) {
-        this->emitLoadConstUInt8(output, litNum->asUInt8());
+        if (wide)
+          this->emitLoadConstUInt8Wide(output, litNum->asUInt8());
+        else
+          this->emitLoadConstUInt8(output, litNum->asUInt8());
       } else {
         // param_t is int64_t, we cannot directly convert a double into that.
         // Instead we are going to copy it as if it is binary.
-        this->emitLoadConstDoubleDirect(output, litNum->getValue());
+        if (wide)
+          this->emitLoadConstDoubleWideDirect(output, litNum->getValue());
+        else
+          this->emitLoadConstDoubleDirect(output, litNum->getValue());
       }
       break;
     }
@@ -203,7 +358,10 @@ void BytecodeFunctionGenerator::generateLoadParamInst(LoadParamInst *Inst, Basic
   auto output = encodeValue(Inst);
   LiteralNumber *number = Inst->getIndex();
   auto value = number->asUInt32();
-  this->emitLoadParam(output, value);
+  if (isWideRegister(output))
+    this->emitLoadParamWide(output, value);
+  else
+    this->emitLoadParam(output, value);
 }
 
 void BytecodeFunctionGenerator::generateBody() {
@@ -256,7 +414,17 @@ void BytecodeFunctionGenerator::generateInst(Instruction *ii, BasicBlock *next)
 
 std::unique_ptr<BytecodeFunction>
 BytecodeFunctionGenerator::generateBytecodeFunction() {
-  return std::make_unique<BytecodeFunction>(std::move(opcodes_));
+  return std::make_unique<BytecodeFunction>(
+      std::move(opcodes_),
+      F_->getParameters().size(),
+      RA_.getMaxRegisterUsage(),
+      inlineCacheCount_);
+}
+
+uint16_t BytecodeFunctionGenerator::allocateInlineCacheIndex() {
+  if (inlineCacheCount_ < inst::kNoInlineCacheIndex)
+    return inlineCacheCount_++;
+  return inst::kNoInlineCacheIndex;
 }
 
 unsigned BytecodeGenerator::addFunction(Function *F) {
@@ -11,3 +11,53 @@
 #include "cobra/IR/Instrs.h"
 
 
+using namespace cobra;
+
+bool LowerCondBranch::isOperatorSupported(BinaryOperatorInst::OpKind op) {
+  using OpKind = BinaryOperatorInst::OpKind;
+  switch (op) {
+    case OpKind::EqualKind: // ==
+    case OpKind::NotEqualKind: // !=
+    case OpKind::StrictlyEqualKind: // ===
+    case OpKind::StrictlyNotEqualKind: // !==
+    case OpKind::LessThanKind: // <
+    case OpKind::LessThanOrEqualKind: // <=
+    case OpKind::GreaterThanKind: // >
+    case OpKind::GreaterThanOrEqualKind: // >=
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool LowerCondBranch::runOnFunction(Function *F) {
+  IRBuilder builder(F);
+  bool changed = false;
+  
+  for (auto *BB : *F) {
+    auto *cbr = dynamic_cast<CondBranchInst *>(BB->getTerminator());
+    if (!cbr)
+      continue;
+    
+    auto *cond = dynamic_cast<BinaryOperatorInst *>(cbr->getCondition());
+    // The result of the comparison must not be needed in a register.
+    if (!cond || !cond->hasOneUser())
+      continue;
+    if (!isOperatorSupported(cond->getOperatorKind()))
+      continue;
+    
+    builder.setInsertionPoint(cbr);
+    builder.createCompareBranchInst(
+        cond->getLeftHandSide(),
+        cond->getRightHandSide(),
+        cond->getOperatorKind(),
+        cbr->getTrueDest(),
+        cbr->getFalseDest());
+    
+    cbr->eraseFromParent();
+    cond->eraseFromParent();
+    changed = true;
+  }
+  
+  return changed;
+}
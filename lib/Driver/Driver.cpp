@@ -10,6 +10,9 @@
 #include "cobra/VM/Runtime.h"
 #include "cobra/BCGen/BCGen.h"
 #include "cobra/BCGen/BytecodeRawData.h"
+#include "cobra/LLVMGen/LLVMGen.h"
+
+#include <iostream>
 
 using namespace cobra;
 using namespace driver;
@@ -34,8 +37,37 @@ bool driver::compile(std::string source) {
   
   auto result = Runtime::create(RuntimeOptions());
   auto BR = cobra::BytecodeRawData::create(std::move(BM));
-  Runtime::getCurrent()->runBytecode(std::move(BR));
+  std::string error;
+  if (!Runtime::getCurrent()->runBytecode(std::move(BR), error)) {
+    std::cerr << "error: " << error << "\n";
+    return false;
+  }
   
   return true;
 }
 
+
+#ifdef COBRA_ENABLE_LLVM_BACKEND
+bool driver::compileToObject(std::string source, const std::string &path) {
+  auto context = std::make_shared<Context>();
+  Module M(context);
+  
+  parser::Parser cbParser(*context, source.c_str(), source.size());
+  auto parsedCb = cbParser.parse();
+  
+  NodePtr ast = parsedCb.value();
+  
+  TreeIRGen irGen(ast, &M);
+  irGen.visitChildren();
+  
+  runFullOptimizationPasses(M);
+  
+  std::string error;
+  if (!generateObjectFile(&M, path, error)) {
+    std::cerr << "error: " << error << "\n";
+    return false;
+  }
+  
+  return true;
+}
+#endif
@@ -97,6 +97,17 @@ IRBuilder::createCondBranchInst(Value *Cond, BasicBlock *T, BasicBlock *F) {
   return CBI;
 }
 
+CompareBranchInst *IRBuilder::createCompareBranchInst(
+    Value *left,
+    Value *right,
+    BinaryOperatorInst::OpKind opKind,
+    BasicBlock *T,
+    BasicBlock *F) {
+  auto *CBI = new CompareBranchInst(left, right, opKind, T, F);
+  insert(CBI);
+  return CBI;
+}
+
 ReturnInst *IRBuilder::createReturnInst(Value *Val) {
   auto *RI = new ReturnInst(Val);
   insert(RI);
@@ -32,7 +32,7 @@ BasicBlock *TerminatorInst::getSuccessor(unsigned idx) {
 void TerminatorInst::setSuccessor(unsigned idx, BasicBlock *B) {
 #undef TERMINATOR
 #define TERMINATOR(CLASS, PARENT)           \
-  if (auto I = static_cast<CLASS *>(this)) \
+  if (auto I = dynamic_cast<CLASS *>(this)) \
     return I->setSuccessor(idx, B);
 #include "cobra/IR/Instrs.def"
   COBRA_UNREACHABLE();
@@ -0,0 +1,554 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "cobra/LLVMGen/LLVMGen.h"
+#include "cobra/IR/Analysis.h"
+#include "cobra/IR/Instrs.h"
+#include "cobra/VM/CBValue.h"
+
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/MC/TargetRegistry.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
+
+#include <map>
+#include <vector>
+
+using namespace cobra;
+
+using vm::CBValue;
+
+namespace {
+
+/// Raw encodings of the constant values used by the generated code.
+const uint64_t kUndefined = CBValue::encodeUndefinedValue().getRaw();
+const uint64_t kFalse = CBValue::encodeBoolValue(false).getRaw();
+
+/// Lowers the IR of one function to an LLVM function. Every IR value is an
+/// i64 holding a raw CBValue. Values statically typed as numbers are unboxed
+/// with a bitcast, the others go through the cobra_aot_* runtime entry points.
+class LLVMFunctionGenerator {
+  Function *F_;
+  llvm::Module &module_;
+  llvm::LLVMContext &ctx_;
+  llvm::IRBuilder<> builder_;
+  llvm::Function *fn_{};
+  std::string &error_;
+
+  llvm::Type *int64Ty_;
+  llvm::Type *doubleTy_;
+
+  std::map<Value *, llvm::Value *> values_{};
+  std::map<BasicBlock *, llvm::BasicBlock *> blocks_{};
+  std::vector<PhiInst *> phis_{};
+
+  /// Record the first error, and keep generating so the function stays well
+  /// formed for LLVM.
+  void fail(const std::string &message) {
+    if (error_.empty())
+      error_ = F_->getName().str().str() + ": " + message;
+  }
+
+  void unsupported(Instruction *Inst) {
+    fail("unsupported instruction " + Inst->getKindStr().str());
+  }
+
+  llvm::Constant *constant(uint64_t raw) {
+    return llvm::ConstantInt::get(int64Ty_, raw);
+  }
+
+  /// \return the LLVM value computing \p V, which must already be generated.
+  llvm::Value *getValue(Value *V);
+
+  llvm::FunctionCallee getRuntimeFunction(
+      const char *name,
+      llvm::Type *result,
+      unsigned numArgs) {
+    std::vector<llvm::Type *> params(numArgs, int64Ty_);
+    return module_.getOrInsertFunction(
+        name, llvm::FunctionType::get(result, params, false));
+  }
+
+  /// Call a runtime entry point returning a bool, as an i1.
+  llvm::Value *callPredicate(const char *name, std::vector<llvm::Value *> args) {
+    auto *result = builder_.CreateCall(
+        getRuntimeFunction(name, builder_.getInt8Ty(), args.size()), args);
+    return builder_.CreateICmpNE(result, builder_.getInt8(0));
+  }
+
+  llvm::Value *unboxNumber(llvm::Value *V) {
+    return builder_.CreateBitCast(V, doubleTy_);
+  }
+
+  /// Box a double, replacing any NaN by the canonical one like
+  /// CBValue::encodeUntrustedNumberValue().
+  llvm::Value *boxNumber(llvm::Value *V) {
+    auto *isNaN = builder_.CreateFCmpUNO(V, V);
+    return builder_.CreateSelect(
+        isNaN,
+        constant(CBValue::encodeNaNValue().getRaw()),
+        builder_.CreateBitCast(V, int64Ty_));
+  }
+
+  llvm::Value *boxBool(llvm::Value *V) {
+    return builder_.CreateOr(builder_.CreateZExt(V, int64Ty_), constant(kFalse));
+  }
+
+  /// Convert \p V to a double with ToNumber.
+  llvm::Value *toNumber(Value *V) {
+    if (V->getType().isNumberType())
+      return unboxNumber(getValue(V));
+    return builder_.CreateCall(
+        getRuntimeFunction("cobra_aot_to_number", doubleTy_, 1), {getValue(V)});
+  }
+
+  /// Convert \p V to an i1 with ToBoolean.
+  llvm::Value *toBoolean(Value *V) {
+    if (V->getType().isBooleanType())
+      return builder_.CreateTrunc(getValue(V), builder_.getInt1Ty());
+    return callPredicate("cobra_aot_to_boolean", {getValue(V)});
+  }
+
+  /// \return the i1 result of the comparison \p op, or nullptr if \p op is not
+  /// a comparison.
+  llvm::Value *
+  emitComparison(BinaryOperatorInst::OpKind op, Value *lhs, Value *rhs);
+
+  /// \return the boxed result of the arithmetic operation \p op, or nullptr if
+  /// \p op is not supported.
+  llvm::Value *
+  emitArithmetic(BinaryOperatorInst::OpKind op, Value *lhs, Value *rhs);
+
+  /// Create the entry block, with the stack slots and the parameters.
+  void generateEntry();
+
+  void generateBlock(BasicBlock *BB);
+
+  void generateInst(Instruction *Inst);
+
+#define DEF_VALUE(CLASS, PARENT) void generate##CLASS(CLASS *Inst);
+#include "cobra/IR/Instrs.def"
+
+ public:
+  LLVMFunctionGenerator(Function *F, llvm::Module &module, std::string &error)
+      : F_(F),
+        module_(module),
+        ctx_(module.getContext()),
+        builder_(module.getContext()),
+        error_(error),
+        int64Ty_(llvm::Type::getInt64Ty(module.getContext())),
+        doubleTy_(llvm::Type::getDoubleTy(module.getContext())) {}
+
+  void generate();
+};
+
+llvm::Value *LLVMFunctionGenerator::getValue(Value *V) {
+  if (auto *L = dynamic_cast<LiteralNumber *>(V))
+    return constant(CBValue::encodeUntrustedNumberValue(L->getValue()).getRaw());
+  if (auto *L = dynamic_cast<LiteralBool *>(V))
+    return constant(CBValue::encodeBoolValue(L->getValue()).getRaw());
+  if (dynamic_cast<LiteralNull *>(V))
+    return constant(CBValue::encodeNullValue().getRaw());
+  if (dynamic_cast<LiteralUndefined *>(V))
+    return constant(kUndefined);
+  if (dynamic_cast<LiteralEmpty *>(V))
+    return constant(CBValue::encodeEmptyValue().getRaw());
+
+  auto it = values_.find(V);
+  if (it != values_.end()) {
+    // Like in the bytecode, where a stack slot is a register, a stack slot
+    // used as an operand stands for the current value of the variable.
+    if (dynamic_cast<AllocStackInst *>(V))
+      return builder_.CreateLoad(int64Ty_, it->second);
+    return it->second;
+  }
+
+  fail("unsupported operand " + V->getKindStr().str());
+  return constant(kUndefined);
+}
+
+void LLVMFunctionGenerator::generate() {
+  std::vector<llvm::Type *> params{
+      llvm::PointerType::getUnqual(int64Ty_), builder_.getInt32Ty()};
+  fn_ = llvm::Function::Create(
+      llvm::FunctionType::get(int64Ty_, params, false),
+      llvm::Function::ExternalLinkage,
+      "cobra_" + F_->getName().str().str(),
+      module_);
+  fn_->getArg(0)->setName("params");
+  fn_->getArg(1)->setName("argCount");
+
+  // Blocks in reverse post order, so that every value is generated before its
+  // uses except for the incoming values of phis. Unreachable blocks are
+  // dropped.
+  PostOrderAnalysis PO(F_);
+  std::vector<BasicBlock *> order(PO.rbegin(), PO.rend());
+
+  generateEntry();
+  for (auto *BB : order)
+    blocks_[BB] = llvm::BasicBlock::Create(ctx_, "", fn_);
+  builder_.CreateBr(blocks_[F_->front()]);
+
+  for (auto *BB : order)
+    generateBlock(BB);
+
+  for (auto *Inst : phis_) {
+    auto *phi = llvm::cast<llvm::PHINode>(values_[Inst]);
+    for (unsigned i = 0, e = Inst->getNumEntries(); i != e; ++i) {
+      auto entry = Inst->getEntry(i);
+      auto it = blocks_.find(entry.second);
+      if (it == blocks_.end())
+        continue;
+      builder_.SetInsertPoint(it->second->getTerminator());
+      phi->addIncoming(getValue(entry.first), it->second);
+    }
+  }
+}
+
+void LLVMFunctionGenerator::generateEntry() {
+  builder_.SetInsertPoint(llvm::BasicBlock::Create(ctx_, "entry", fn_));
+
+  // Parameter i reads params[i], or undefined when fewer arguments were
+  // passed. The load always stays in bounds by reading 'this' instead.
+  llvm::Value *params = fn_->getArg(0);
+  llvm::Value *argCount = fn_->getArg(1);
+  uint32_t index = 1;
+  for (auto *P : F_->getParameters()) {
+    auto *present = builder_.CreateICmpUGE(argCount, builder_.getInt32(index));
+    auto *slot = builder_.CreateSelect(
+        present, builder_.getInt32(index), builder_.getInt32(0));
+    auto *param = builder_.CreateLoad(
+        int64Ty_, builder_.CreateGEP(int64Ty_, params, slot));
+    values_[P] = builder_.CreateSelect(present, param, constant(kUndefined));
+    ++index;
+  }
+
+  for (auto *BB : *F_) {
+    for (auto *Inst : BB->getInstList()) {
+      if (auto *alloc = dynamic_cast<AllocStackInst *>(Inst)) {
+        auto *slot = builder_.CreateAlloca(int64Ty_);
+        builder_.CreateStore(constant(kUndefined), slot);
+        values_[alloc] = slot;
+      }
+    }
+  }
+}
+
+void LLVMFunctionGenerator::generateBlock(BasicBlock *BB) {
+  builder_.SetInsertPoint(blocks_[BB]);
+  for (auto *Inst : BB->getInstList())
+    generateInst(Inst);
+}
+
+void LLVMFunctionGenerator::generateInst(Instruction *Inst) {
+  switch (Inst->getKind()) {
+#define DEF_VALUE(CLASS, PARENT) \
+  case ValueKind::CLASS##Kind:   \
+    return generate##CLASS(dynamic_cast<CLASS *>(Inst));
+#include "cobra/IR/Instrs.def"
+
+    default:
+      COBRA_UNREACHABLE();
+  }
+}
+
+void LLVMFunctionGenerator::generateSingleOperandInst(SingleOperandInst *Inst) {
+  unsupported(Inst);
+}
+
+void LLVMFunctionGenerator::generateTerminatorInst(TerminatorInst *Inst) {
+  unsupported(Inst);
+}
+
+void LLVMFunctionGenerator::generateAllocStackInst(AllocStackInst *Inst) {
+  // The slot was allocated in the entry block.
+}
+
+void LLVMFunctionGenerator::generateLoadStackInst(LoadStackInst *Inst) {
+  values_[Inst] = builder_.CreateLoad(int64Ty_, values_[Inst->getPtr()]);
+}
+
+void LLVMFunctionGenerator::generateStoreStackInst(StoreStackInst *Inst) {
+  builder_.CreateStore(getValue(Inst->getSrc()), values_[Inst->getDest()]);
+}
+
+void LLVMFunctionGenerator::generateMovInst(MovInst *Inst) {
+  values_[Inst] = getValue(Inst->getSingleOperand());
+}
+
+void LLVMFunctionGenerator::generateLoadConstInst(LoadConstInst *Inst) {
+  values_[Inst] = getValue(Inst->getConst());
+}
+
+void LLVMFunctionGenerator::generateLoadParamInst(LoadParamInst *Inst) {
+  // Only created by lowering, which does not run before this backend.
+  unsupported(Inst);
+}
+
+void LLVMFunctionGenerator::generatePhiInst(PhiInst *Inst) {
+  values_[Inst] = builder_.CreatePHI(int64Ty_, Inst->getNumEntries());
+  phis_.push_back(Inst);
+}
+
+void LLVMFunctionGenerator::generateUnaryOperatorInst(UnaryOperatorInst *Inst) {
+  using OpKind = UnaryOperatorInst::OpKind;
+
+  Value *operand = Inst->getSingleOperand();
+  llvm::Value *result;
+  switch (Inst->getOperatorKind()) {
+    case OpKind::VoidKind:
+      result = constant(kUndefined);
+      break;
+    case OpKind::PlusKind:
+      result = operand->getType().isNumberType()
+          ? getValue(operand)
+          : boxNumber(toNumber(operand));
+      break;
+    case OpKind::MinusKind:
+      result = boxNumber(builder_.CreateFNeg(toNumber(operand)));
+      break;
+    case OpKind::IncKind:
+      result = boxNumber(builder_.CreateFAdd(
+          toNumber(operand), llvm::ConstantFP::get(doubleTy_, 1)));
+      break;
+    case OpKind::DecKind:
+      result = boxNumber(builder_.CreateFSub(
+          toNumber(operand), llvm::ConstantFP::get(doubleTy_, 1)));
+      break;
+    case OpKind::BangKind:
+      result = boxBool(builder_.CreateNot(toBoolean(operand)));
+      break;
+    default:
+      unsupported(Inst);
+      result = constant(kUndefined);
+      break;
+  }
+  values_[Inst] = result;
+}
+
+llvm::Value *LLVMFunctionGenerator::emitComparison(
+    BinaryOperatorInst::OpKind op,
+    Value *lhs,
+    Value *rhs) {
+  using OpKind = BinaryOperatorInst::OpKind;
+
+  if (lhs->getType().isNumberType() && rhs->getType().isNumberType()) {
+    auto *x = unboxNumber(getValue(lhs));
+    auto *y = unboxNumber(getValue(rhs));
+    switch (op) {
+      case OpKind::EqualKind: // ==
+      case OpKind::StrictlyEqualKind: // ===
+        return builder_.CreateFCmpOEQ(x, y);
+      case OpKind::NotEqualKind: // !=
+      case OpKind::StrictlyNotEqualKind: // !==
+        return builder_.CreateFCmpUNE(x, y);
+      case OpKind::LessThanKind: // <
+        return builder_.CreateFCmpOLT(x, y);
+      case OpKind::LessThanOrEqualKind: // <=
+        return builder_.CreateFCmpOLE(x, y);
+      case OpKind::GreaterThanKind: // >
+        return builder_.CreateFCmpOGT(x, y);
+      case OpKind::GreaterThanOrEqualKind: // >=
+        return builder_.CreateFCmpOGE(x, y);
+      default:
+        return nullptr;
+    }
+  }
+
+  std::vector<llvm::Value *> args{getValue(lhs), getValue(rhs)};
+  switch (op) {
+    case OpKind::EqualKind: // ==
+    case OpKind::StrictlyEqualKind: // ===
+      return callPredicate("cobra_aot_strict_equal", args);
+    case OpKind::NotEqualKind: // !=
+    case OpKind::StrictlyNotEqualKind: // !==
+      return builder_.CreateNot(callPredicate("cobra_aot_strict_equal", args));
+    case OpKind::LessThanKind: // <
+      return callPredicate("cobra_aot_less", args);
+    case OpKind::LessThanOrEqualKind: // <=
+      return callPredicate("cobra_aot_less_equal", args);
+    case OpKind::GreaterThanKind: // >
+      return callPredicate("cobra_aot_greater", args);
+    case OpKind::GreaterThanOrEqualKind: // >=
+      return callPredicate("cobra_aot_greater_equal", args);
+    default:
+      return nullptr;
+  }
+}
+
+llvm::Value *LLVMFunctionGenerator::emitArithmetic(
+    BinaryOperatorInst::OpKind op,
+    Value *lhs,
+    Value *rhs) {
+  using OpKind = BinaryOperatorInst::OpKind;
+
+  if (lhs->getType().isNumberType() && rhs->getType().isNumberType()) {
+    auto *x = unboxNumber(getValue(lhs));
+    auto *y = unboxNumber(getValue(rhs));
+    switch (op) {
+      case OpKind::AddKind: // +   (+=)
+        return boxNumber(builder_.CreateFAdd(x, y));
+      case OpKind::SubtractKind: // -   (-=)
+        return boxNumber(builder_.CreateFSub(x, y));
+      case OpKind::MultiplyKind: // *   (*=)
+        return boxNumber(builder_.CreateFMul(x, y));
+      case OpKind::DivideKind: // /   (/=)
+        return boxNumber(builder_.CreateFDiv(x, y));
+      case OpKind::ModuloKind: // %   (%=)
+        return boxNumber(builder_.CreateFRem(x, y));
+      default:
+        return nullptr;
+    }
+  }
+
+  const char *name;
+  switch (op) {
+    case OpKind::AddKind: // +   (+=)
+      name = "cobra_aot_add";
+      break;
+    case OpKind::SubtractKind: // -   (-=)
+      name = "cobra_aot_sub";
+      break;
+    case OpKind::MultiplyKind: // *   (*=)
+      name = "cobra_aot_mul";
+      break;
+    case OpKind::DivideKind: // /   (/=)
+      name = "cobra_aot_div";
+      break;
+    case OpKind::ModuloKind: // %   (%=)
+      name = "cobra_aot_mod";
+      break;
+    default:
+      return nullptr;
+  }
+  return builder_.CreateCall(
+      getRuntimeFunction(name, int64Ty_, 2), {getValue(lhs), getValue(rhs)});
+}
+
+void LLVMFunctionGenerator::generateBinaryOperatorInst(BinaryOperatorInst *Inst) {
+  auto op = Inst->getOperatorKind();
+  auto *lhs = Inst->getLeftHandSide();
+  auto *rhs = Inst->getRightHandSide();
+
+  llvm::Value *result = emitArithmetic(op, lhs, rhs);
+  if (!result) {
+    if (auto *cond = emitComparison(op, lhs, rhs))
+      result = boxBool(cond);
+  }
+  if (!result) {
+    fail("unsupported operator " + Inst->getOperatorStr().str());
+    result = constant(kUndefined);
+  }
+  values_[Inst] = result;
+}
+
+void LLVMFunctionGenerator::generateBranchInst(BranchInst *Inst) {
+  builder_.CreateBr(blocks_[Inst->getBranchDest()]);
+}
+
+void LLVMFunctionGenerator::generateCondBranchInst(CondBranchInst *Inst) {
+  builder_.CreateCondBr(
+      toBoolean(Inst->getCondition()),
+      blocks_[Inst->getTrueDest()],
+      blocks_[Inst->getFalseDest()]);
+}
+
+void LLVMFunctionGenerator::generateCompareBranchInst(CompareBranchInst *Inst) {
+  auto *cond = emitComparison(
+      Inst->getOperatorKind(),
+      Inst->getLeftHandSide(),
+      Inst->getRightHandSide());
+  if (!cond) {
+    fail("unsupported operator " + Inst->getOperatorStr().str());
+    cond = builder_.getFalse();
+  }
+  builder_.CreateCondBr(
+      cond, blocks_[Inst->getTrueDest()], blocks_[Inst->getFalseDest()]);
+}
+
+void LLVMFunctionGenerator::generateReturnInst(ReturnInst *Inst) {
+  builder_.CreateRet(getValue(Inst->getValue()));
+}
+
+/// Run the default O2 pipeline on \p module.
+void optimizeModule(llvm::Module &module, llvm::TargetMachine *TM) {
+  llvm::LoopAnalysisManager LAM;
+  llvm::FunctionAnalysisManager FAM;
+  llvm::CGSCCAnalysisManager CGAM;
+  llvm::ModuleAnalysisManager MAM;
+
+  llvm::PassBuilder PB(TM);
+  PB.registerModuleAnalyses(MAM);
+  PB.registerCGSCCAnalyses(CGAM);
+  PB.registerFunctionAnalyses(FAM);
+  PB.registerLoopAnalyses(LAM);
+  PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+  PB.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O2)
+      .run(module, MAM);
+}
+
+}
+
+bool cobra::generateObjectFile(
+    Module *M,
+    const std::string &path,
+    std::string &error) {
+  llvm::InitializeNativeTarget();
+  llvm::InitializeNativeTargetAsmPrinter();
+
+  auto triple = llvm::sys::getDefaultTargetTriple();
+  const llvm::Target *target = llvm::TargetRegistry::lookupTarget(triple, error);
+  if (!target)
+    return false;
+  std::unique_ptr<llvm::TargetMachine> TM(target->createTargetMachine(
+      triple, "generic", "", llvm::TargetOptions(), llvm::Reloc::PIC_));
+
+  llvm::LLVMContext ctx;
+  llvm::Module module("cobra", ctx);
+  module.setTargetTriple(triple);
+  module.setDataLayout(TM->createDataLayout());
+
+  for (auto *F : *M) {
+    LLVMFunctionGenerator(F, module, error).generate();
+    if (!error.empty())
+      return false;
+  }
+
+  llvm::raw_string_ostream verifyErrors(error);
+  if (llvm::verifyModule(module, &verifyErrors)) {
+    verifyErrors.flush();
+    return false;
+  }
+
+  optimizeModule(module, TM.get());
+
+  std::error_code EC;
+  llvm::raw_fd_ostream out(path, EC, llvm::sys::fs::OF_None);
+  if (EC) {
+    error = path + ": " + EC.message();
+    return false;
+  }
+
+  llvm::legacy::PassManager PM;
+  if (TM->addPassesToEmitFile(PM, out, nullptr, llvm::CGFT_ObjectFile)) {
+    error = "the target cannot emit object files";
+    return false;
+  }
+  PM.run(module);
+  out.flush();
+  return true;
+}
@@ -18,6 +18,7 @@ void cobra::runFullOptimizationPasses(Module &M) {
   PM.addSimplifyCFG();
   PM.addMem2Reg();
   PM.addDCE();
+  PM.addTypeInference();
 //  PM.addSSADestruction();
 
   PM.run(&M);
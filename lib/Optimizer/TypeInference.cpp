@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#define DEBUG_TYPE "typeinference"
+
+#include "cobra/Optimizer/TypeInference.h"
+#include "cobra/IR/Instrs.h"
+#include "cobra/IR/Analysis.h"
+
+#include <optional>
+#include <vector>
+
+using namespace cobra;
+
+/// Union of two types, where the type of a value that was not inferred yet
+/// does not contribute anything.
+static Type unionTypes(Type A, Type B) {
+  if (A.isNoType())
+    return B;
+  if (B.isNoType())
+    return A;
+  return Type::unionTy(A, B);
+}
+
+/// Optimistic type predicates: a type that was not inferred yet may still
+/// become anything.
+static bool mayBeInt32(Type T) {
+  return T.isNoType() || T.isInt32Type();
+}
+
+static bool mayBeNumber(Type T) {
+  return T.isNoType() || T.isNumberType();
+}
+
+static Type inferBinaryOperatorType(BinaryOperatorInst *Inst) {
+  using OpKind = BinaryOperatorInst::OpKind;
+  
+  Type left = Inst->getLeftHandSide()->getType();
+  Type right = Inst->getRightHandSide()->getType();
+  bool isInt32 = mayBeInt32(left) && mayBeInt32(right);
+  
+  switch (Inst->getOperatorKind()) {
+    case OpKind::EqualKind: // ==
+    case OpKind::NotEqualKind: // !=
+    case OpKind::StrictlyEqualKind: // ===
+    case OpKind::StrictlyNotEqualKind: // !==
+    case OpKind::LessThanKind: // <
+    case OpKind::LessThanOrEqualKind: // <=
+    case OpKind::GreaterThanKind: // >
+    case OpKind::GreaterThanOrEqualKind: // >=
+    case OpKind::InKind: // "in"
+    case OpKind::InstanceOfKind: // instanceof
+      return Type::createBoolean();
+    case OpKind::LeftShiftKind: // <<  (<<=)
+    case OpKind::RightShiftKind: // >>  (>>=)
+    case OpKind::OrKind: // |   (|=)
+    case OpKind::XorKind: // ^   (^=)
+    case OpKind::AndKind: // &   (^=)
+      return Type::createInt32();
+    case OpKind::UnsignedRightShiftKind: // >>> (>>>=)
+      return Type::createUint32();
+    case OpKind::AddKind: // +   (+=)
+      // Anything else may be a string concatenation.
+      if (!mayBeNumber(left) || !mayBeNumber(right))
+        return Type::createAnyType();
+      return isInt32 ? Type::createInt32() : Type::createNumber();
+    case OpKind::SubtractKind: // -   (-=)
+    case OpKind::MultiplyKind: // *   (*=)
+      return isInt32 ? Type::createInt32() : Type::createNumber();
+    case OpKind::DivideKind: // /   (/=)
+    case OpKind::ModuloKind: // %   (%=)
+    case OpKind::ExponentiationKind: // ** (**=)
+      return Type::createNumber();
+    default:
+      return Type::createAnyType();
+  }
+}
+
+static Type inferUnaryOperatorType(UnaryOperatorInst *Inst) {
+  using OpKind = UnaryOperatorInst::OpKind;
+  
+  switch (Inst->getOperatorKind()) {
+    case OpKind::DeleteKind: // delete
+    case OpKind::BangKind: // !
+      return Type::createBoolean();
+    case OpKind::VoidKind: // void
+      return Type::createUndefined();
+    case OpKind::TypeofKind: // typeof
+      return Type::createString();
+    case OpKind::TildeKind: // ~
+      return Type::createInt32();
+    case OpKind::PlusKind: // +
+    case OpKind::MinusKind: // -
+    case OpKind::IncKind: // + 1
+    case OpKind::DecKind: // - 1
+      return Type::createNumber();
+    default:
+      return Type::createAnyType();
+  }
+}
+
+static Type inferPhiType(PhiInst *Inst) {
+  Type type = Type::createNoType();
+  for (unsigned i = 0, e = Inst->getNumEntries(); i != e; ++i)
+    type = unionTypes(type, Inst->getEntry(i).first->getType());
+  return type;
+}
+
+/// \return the type of \p I computed from its operands, or None if \p I is
+/// not an instruction whose type is inferred.
+static std::optional<Type> inferType(Instruction *I) {
+  if (auto *BO = dynamic_cast<BinaryOperatorInst *>(I))
+    return inferBinaryOperatorType(BO);
+  if (auto *UO = dynamic_cast<UnaryOperatorInst *>(I))
+    return inferUnaryOperatorType(UO);
+  if (auto *Phi = dynamic_cast<PhiInst *>(I))
+    return inferPhiType(Phi);
+  if (auto *Mov = dynamic_cast<MovInst *>(I))
+    return Mov->getSingleOperand()->getType();
+  return std::nullopt;
+}
+
+bool TypeInference::runOnFunction(Function *F) {
+  PostOrderAnalysis PO(F);
+  std::vector<Instruction *> worklist;
+  std::vector<Type> originalTypes;
+  
+  // Start from no type at all and only widen, so that a loop-carried value
+  // keeps the type of its initial value if the loop body does not widen it.
+  for (auto it = PO.rbegin(), e = PO.rend(); it != e; ++it) {
+    for (auto *I : (*it)->getInstList()) {
+      if (!inferType(I))
+        continue;
+      worklist.push_back(I);
+      originalTypes.push_back(I->getType());
+      I->setType(Type::createNoType());
+    }
+  }
+  
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (auto *I : worklist) {
+      Type type = unionTypes(I->getType(), *inferType(I));
+      if (type != I->getType()) {
+        I->setType(type);
+        changed = true;
+      }
+    }
+  }
+  
+  for (size_t i = 0, e = worklist.size(); i != e; ++i) {
+    if (worklist[i]->getType() != originalTypes[i])
+      return true;
+  }
+  return false;
+}
+
+std::unique_ptr<Pass> cobra::createTypeInference() {
+  return std::make_unique<TypeInference>();
+}
+
+#undef DEBUG_TYPE
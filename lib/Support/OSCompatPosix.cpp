@@ -9,7 +9,10 @@
 #include "cobra/Support/MathExtras.h"
 
 #include <cassert>
+#include <cinttypes>
+#include <cstdio>
 #include <fstream>
+#include <string>
 #include <vector>
 
 #include <signal.h>
@@ -147,14 +150,42 @@ void vm_uncommit(void *p, size_t sz) {
   assert(res && "uncommit failed");
 }
 
-void vm_hugepage(void *p, size_t sz) {
+bool vm_hugepage(void *p, size_t sz) {
   assert(
          reinterpret_cast<uintptr_t>(p) % page_size() == 0 &&
          "Precondition: pointer is page-aligned.");
   
 #if defined(__linux__) || defined(__ANDROID__)
   // Since the alloc is aligned, it may benefit from huge pages.
-  madvise(p, sz, MADV_HUGEPAGE);
+  return madvise(p, sz, MADV_HUGEPAGE) == 0;
+#else
+  return false;
+#endif
+}
+
+size_t vm_hugepage_backed_bytes(const void *p, size_t sz) {
+#if defined(__linux__) || defined(__ANDROID__)
+  std::ifstream smaps("/proc/self/smaps");
+  uintptr_t begin = reinterpret_cast<uintptr_t>(p);
+  uintptr_t end = begin + sz;
+  size_t bytes = 0;
+  bool overlaps = false;
+  std::string line;
+  while (std::getline(smaps, line)) {
+    // Every mapping starts with a line of its address range, followed by its
+    // fields.
+    uintptr_t start, stop;
+    if (sscanf(line.c_str(), "%" SCNxPTR "-%" SCNxPTR, &start, &stop) == 2) {
+      overlaps = start < end && begin < stop;
+      continue;
+    }
+    size_t kb;
+    if (overlaps && sscanf(line.c_str(), "AnonHugePages: %zu kB", &kb) == 1)
+      bytes += kb * 1024;
+  }
+  return bytes;
+#else
+  return 0;
 #endif
 }
 
@@ -210,6 +241,8 @@ bool vm_protect(void *p, size_t sz, ProtectMode mode) {
   auto prot = PROT_NONE;
   if (mode == ProtectMode::ReadWrite) {
     prot = PROT_WRITE | PROT_READ;
+  } else if (mode == ProtectMode::ReadExecute) {
+    prot = PROT_READ | PROT_EXEC;
   }
   int err = mprotect(p, sz, prot);
   return err != -1;
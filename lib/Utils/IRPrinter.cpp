@@ -181,6 +181,9 @@ void IRPrinter::printInstruction(Instruction *I) {
   } else if (auto *unop = dynamic_cast<UnaryOperatorInst *>(I)) {
     os << " '" << unop->getOperatorStr().str()  << "'";
     first = false;
+  } else if (auto *cmpBr = dynamic_cast<CompareBranchInst *>(I)) {
+    os << " '" << cmpBr->getOperatorStr().str() << "'";
+    first = false;
   }
 
   for (int i = 0, e = I->getNumOperands(); i < e; i++) {
@@ -0,0 +1,50 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "cobra/VM/AOTRuntime.h"
+#include "cobra/VM/Operations.h"
+
+#include "Interpreter-inl.h"
+
+using namespace cobra;
+using namespace vm;
+
+#define AOT_BINOP(name, oper)                                        \
+  uint64_t cobra_aot_##name(uint64_t x, uint64_t y) {                \
+    double result =                                                  \
+        oper(toNumber(CBValue::fromRaw(x)), toNumber(CBValue::fromRaw(y))); \
+    return CBValue::encodeUntrustedNumberValue(result).getRaw();     \
+  }
+
+#define AOT_COMPARE(name, oper)                              \
+  bool cobra_aot_##name(uint64_t x, uint64_t y) {            \
+    return oper(CBValue::fromRaw(x), CBValue::fromRaw(y));   \
+  }
+
+extern "C" {
+
+AOT_BINOP(add, doAdd)
+AOT_BINOP(sub, doSub)
+AOT_BINOP(mul, doMul)
+AOT_BINOP(div, doDiv)
+AOT_BINOP(mod, doMod)
+
+AOT_COMPARE(strict_equal, strictEqualityTest)
+AOT_COMPARE(less, doLess)
+AOT_COMPARE(less_equal, doLessEqual)
+AOT_COMPARE(greater, doGreater)
+AOT_COMPARE(greater_equal, doGreaterEqual)
+
+bool cobra_aot_to_boolean(uint64_t value) {
+  return toBoolean(CBValue::fromRaw(value));
+}
+
+double cobra_aot_to_number(uint64_t value) {
+  return toNumber(CBValue::fromRaw(value));
+}
+
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifdef COBRA_ALLOCATION_SAMPLER
+
+#include "cobra/VM/AllocationSampler.h"
+#include "cobra/VM/Method.h"
+#include "cobra/VM/Runtime.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+using namespace cobra;
+using namespace vm;
+
+AllocationSampler::~AllocationSampler() {
+  stop();
+}
+
+bool AllocationSampler::start(Runtime *runtime, uint64_t interval) {
+  if (isRunning())
+    return false;
+  runtime_ = runtime;
+  interval_ = interval;
+  random_.seed(std::random_device()());
+  bytesUntilSample_ = nextDistance();
+  site_ = {nullptr, kUnknownOffset};
+  runtime->getHeap().setAllocationSampler(this);
+  return true;
+}
+
+void AllocationSampler::stop() {
+  if (!isRunning())
+    return;
+  runtime_->getHeap().setAllocationSampler(nullptr);
+  runtime_ = nullptr;
+  // The objects are not followed anymore, the stats stay as they are.
+  samples_.clear();
+}
+
+uint64_t AllocationSampler::nextDistance() {
+  if (interval_ == 0)
+    return 0;
+  std::exponential_distribution<double> distribution(1.0 / interval_);
+  return (uint64_t)distribution(random_);
+}
+
+void AllocationSampler::takeSample(GCCell *cell, size_t size) {
+  // The sampled allocation took the rest of the distance, the next one is
+  // drawn from the end of it.
+  bytesUntilSample_ = nextDistance();
+  // The heap was exhausted, nothing was allocated.
+  if (cell == nullptr)
+    return;
+
+  double count = 1;
+  if (interval_ != 0)
+    count = 1 / (1 - std::exp(-double(size) / double(interval_)));
+  samples_.push_back({cell, site_, uint32_t(size), count});
+  SiteStats &stats = sites_[site_];
+  ++stats.samples;
+  stats.sampledBytes += size;
+  stats.estimatedCount += count;
+  stats.estimatedBytes += count * size;
+}
+
+void AllocationSampler::dropSample(const Sample &sample) {
+  auto it = sites_.find(sample.site);
+  assert(it != sites_.end() && "The site of a sample has stats");
+  SiteStats &stats = it->second;
+  if (--stats.samples == 0) {
+    sites_.erase(it);
+    return;
+  }
+  stats.sampledBytes -= sample.size;
+  stats.estimatedCount -= sample.count;
+  stats.estimatedBytes -= sample.count * sample.size;
+}
+
+void AllocationSampler::dumpJSON(std::ostream &os) const {
+  std::vector<std::pair<Site, SiteStats>> sites(sites_.begin(), sites_.end());
+  std::sort(sites.begin(), sites.end(), [](const auto &a, const auto &b) {
+    return a.second.estimatedBytes > b.second.estimatedBytes;
+  });
+
+  uint64_t samples = 0;
+  double estimatedBytes = 0;
+  for (const auto &[site, stats] : sites) {
+    samples += stats.samples;
+    estimatedBytes += stats.estimatedBytes;
+  }
+
+  os << "{\n  \"intervalBytes\": " << interval_
+     << ",\n  \"samples\": " << samples
+     << ",\n  \"estimatedBytes\": " << uint64_t(estimatedBytes)
+     << ",\n  \"sites\": [";
+  const char *sep = "\n";
+  for (const auto &[site, stats] : sites) {
+    os << sep << "    {";
+    if (site.method == nullptr)
+      os << "\"method\": \"(native)\"";
+    else
+      os << "\"method\": \"method#" << site.method->getMethodIndex() << "\"";
+    if (site.offset != kUnknownOffset)
+      os << ", \"offset\": " << site.offset;
+    os << ", \"samples\": " << stats.samples
+       << ", \"sampledBytes\": " << stats.sampledBytes
+       << ", \"estimatedCount\": " << uint64_t(stats.estimatedCount)
+       << ", \"estimatedBytes\": " << uint64_t(stats.estimatedBytes) << "}";
+    sep = ",\n";
+  }
+  os << "\n  ]\n}\n";
+}
+
+#endif // COBRA_ALLOCATION_SAMPLER
@@ -10,17 +10,14 @@
 using namespace cobra;
 using namespace vm;
 
-inline const uint8_t *CardTable::base() const {
-  return reinterpret_cast<const uint8_t *>(this);
+void CardTable::clear() {
+  clearCards();
+  memset(boundaries_, 0, sizeof(boundaries_));
 }
 
-inline void *CardTable::cardToAddress(const uint8_t *cardAddr) const {
-  uintptr_t offset = cardAddr - base();
-  return reinterpret_cast<void*>(offset << kLogCardSize);
+size_t CardTable::findNextDirtyCard(size_t from, size_t to) const {
+  const void *found = memchr(cards_ + from, kCardDirty, to - from);
+  if (found == nullptr)
+    return to;
+  return static_cast<const uint8_t *>(found) - cards_;
 }
-
-inline uint8_t *CardTable::addressToCard(const void *addr) const {
-  const uint8_t *cardAddr = base()+ (reinterpret_cast<uintptr_t>(addr) >> kLogCardSize);
-  return const_cast<uint8_t *>(cardAddr);
-}
-
@@ -18,7 +18,7 @@ uint32_t CexFile::Header::getVersion() const {
   return atoi(version);
 }
 
-inline const char *CexFile::getStringData(EntityId id) const {
+const char *CexFile::getStringData(EntityId id) const {
   auto array = getArrayFromId(id);
   return reinterpret_cast<const char*>(array.data());
 }
@@ -7,5 +7,17 @@
 
 #include "cobra/VM/Class.h"
 
+#include <cstring>
+
 using namespace cobra;
 using namespace vm;
+
+Field *Class::findInstanceField(const char *name) {
+  for (Class *klass = this; klass != nullptr; klass = klass->getSuperClass()) {
+    for (Field &field : klass->getInstanceFields()) {
+      if (strcmp(field.getName(), name) == 0)
+        return &field;
+    }
+  }
+  return nullptr;
+}
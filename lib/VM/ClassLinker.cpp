@@ -6,12 +6,30 @@
  */
 
 #include "cobra/VM/ClassLinker.h"
+#include "cobra/VM/Verifier.h"
 
 using namespace cobra;
 using namespace vm;
 
+ClassLinker::~ClassLinker() {
+  
+}
+
 Class *ClassLinker::loadClass(const CexFile *file, uint32_t classID) {
   ClassDataAccessor accessor(*file, classID);
   
   
 }
+
+bool ClassLinker::linkMethod(
+    Method *method,
+    const uint8_t *insts,
+    uint32_t codeSize,
+    uint32_t inlineCacheCount,
+    std::string &error) {
+  if (method->isNative() || method->isAbstract())
+    return true;
+  method->setInstructions(insts, codeSize);
+  method->initInlineCaches(inlineCacheCount);
+  return Verifier::verify(method, codeSize, error);
+}
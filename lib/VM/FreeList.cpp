@@ -6,7 +6,86 @@
  */
 
 #include "cobra/VM/FreeList.h"
+#include "cobra/VM/HeapRegion.h"
+
+#include <new>
 
 using namespace cobra;
 using namespace vm;
 
+static_assert(
+    FreeList::kNumClasses <= 64, "Every class needs a bit of a uint64_t");
+
+size_t FreeList::getClass(size_t size) {
+  if (size < kMaxSmallSize)
+    return size >> LogHeapAlign;
+  size_t log = 63 - __builtin_clzll(size);
+  size_t cls = kNumSmallClasses + log - ConstantLog2<kMaxSmallSize>::value;
+  return cls < kNumClasses ? cls : kNumClasses - 1;
+}
+
+void *FreeList::alloc(size_t size) {
+  assert(isSizeHeapAligned(size) && "size must be heap aligned");
+  size_t cls = getClass(size);
+  FreeCell *cell = nullptr;
+  // The chunks of a small class all have its size; the chunks of a large
+  // class may be smaller than requested.
+  if (nonEmptyClasses_ & (uint64_t(1) << cls))
+    cell = take(cls, size);
+  if (cell == nullptr) {
+    uint64_t larger = nonEmptyClasses_ & ~((uint64_t(2) << cls) - 1);
+    if (larger == 0)
+      return nullptr;
+    cell = take(__builtin_ctzll(larger), size);
+  }
+  
+  size_t chunkSize = cell->getSize();
+  freeBytes_ -= chunkSize;
+  if (chunkSize == size)
+    return cell;
+  // The memory is taken from the end of the chunk: the remainder keeps its
+  // start, so the cards it covers still record it as their first object.
+  size_t remainder = chunkSize - size;
+  link(cell, remainder);
+  return reinterpret_cast<char *>(cell) + remainder;
+}
+
+FreeCell *FreeList::take(size_t cls, size_t size) {
+  FreeCell **link = &heads_[cls];
+  while (*link != nullptr && (*link)->getSize() < size)
+    link = &(*link)->next_;
+  FreeCell *cell = *link;
+  if (cell == nullptr)
+    return nullptr;
+  *link = cell->next_;
+  if (heads_[cls] == nullptr)
+    nonEmptyClasses_ &= ~(uint64_t(1) << cls);
+  return cell;
+}
+
+void FreeList::addChunk(void *start, size_t size) {
+  assert(isSizeHeapAligned(size) && size > 0 && "invalid chunk size");
+  HeapRegion::getCardTable(start)->updateBoundaries(start, size);
+  link(start, size);
+}
+
+void FreeList::link(void *start, size_t size) {
+  // A chunk of a single word only keeps the region walkable.
+  if (size < sizeof(FreeCell)) {
+    new (start) GCCell(FreeKind, size);
+    return;
+  }
+  auto *cell = new (start) FreeCell(size);
+  size_t cls = getClass(size);
+  cell->next_ = heads_[cls];
+  heads_[cls] = cell;
+  nonEmptyClasses_ |= uint64_t(1) << cls;
+  freeBytes_ += size;
+}
+
+void FreeList::clear() {
+  for (auto &head : heads_)
+    head = nullptr;
+  nonEmptyClasses_ = 0;
+  freeBytes_ = 0;
+}
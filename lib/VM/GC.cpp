@@ -6,10 +6,618 @@
  */
 
 #include "cobra/VM/GC.h"
+#include "cobra/VM/Array.h"
+#include "cobra/VM/HeapCage.h"
+#include "cobra/VM/ParallelMarker.h"
+#include "cobra/VM/Runtime.h"
+
+#include <algorithm>
+#include <thread>
 
 using namespace cobra;
 using namespace vm;
 
-void GC::writeBarrier(const Object *obj, const Object *value) {
-  HeapRegion::getCardTable(obj)->markCard(obj);
+GC::GC(Runtime &runtime)
+    : runtime_(runtime),
+      regionPool_(runtime.getOptions().getHugePages()),
+      young_(HeapRegionSpace::create(
+          "cobra-young",
+          HeapRegionSpaceType::Young,
+          regionPool_,
+          kYoungRegionCount)),
+      old_(HeapRegionSpace::create(
+          "cobra-old", HeapRegionSpaceType::Old, regionPool_)),
+      large_(HeapRegionSpace::create(
+          "cobra-large-object", HeapRegionSpaceType::LargeObject, regionPool_)) {
+  setMarkerThreadCount(std::thread::hardware_concurrency());
+}
+
+GC::~GC() = default;
+
+template <typename Fn>
+void GC::forEachRegisterRange(Fn fn) {
+  RegisterStack &stack = runtime_.getRegisterStack();
+  // The registers of a frame extend up to the header of the next frame.
+  CBValue *end = stack.getTop();
+  for (StackFrame *frame = runtime_.getCurrentFrame(); frame != nullptr;
+       frame = frame->getPrevFrame()) {
+    fn(frame->getRegisters(), end);
+    end = reinterpret_cast<CBValue *>(frame);
+  }
+  fn(stack.getBottom(), end);
+}
+
+bool GC::isInEvacuationCandidate(const void *ptr) const {
+  return old_->contains(ptr) &&
+      HeapRegion::getHeapRegion(ptr)->isEvacuationCandidate();
+}
+
+void GC::rememberSlot(CBValue *slot) {
+  CBValue value = *slot;
+  if (value.isPointer() && isInEvacuationCandidate(value.getPointer())) {
+    HeapRegion::getHeapRegion(value.getPointer())
+        ->getRememberedSet()
+        .push_back(slot);
+  }
+}
+
+void GC::updateEvacuatedSlot(CBValue *slot) {
+  CBValue value = *slot;
+  if (!value.isPointer() || !isInEvacuationCandidate(value.getPointer()))
+    return;
+  auto *cell = static_cast<GCCell *>(value.getPointer());
+  assert(cell->isForwarded() && "a live object was not evacuated");
+  *slot = value.updatePointer(cell->getForwardingAddress());
+}
+
+void GC::getSlots(GCCell *cell, CBValue *&begin, CBValue *&end) {
+  char *base = reinterpret_cast<char *>(cell);
+  switch (cell->getKind()) {
+    case ObjectKind:
+      begin = reinterpret_cast<CBValue *>(
+          base + heapAlignSize(Object::instanceSize()));
+      end = reinterpret_cast<CBValue *>(base + cell->getSize());
+      return;
+    case ArrayKind:
+      begin = reinterpret_cast<CBValue *>(base + Array::getDataOffset());
+      end = begin + static_cast<Array *>(cell)->getLength();
+      return;
+    default:
+      begin = end = nullptr;
+      return;
+  }
+}
+
+void *GC::allocSlow(size_t size) {
+  collect(GCTrigger::YoungFull);
+  return young_->alloc(size);
+}
+
+void *GC::allocLarge(size_t size) {
+  if (size > kMaxObjectSize)
+    return nullptr;
+  // The large objects never fill the young generation, their allocation
+  // drives the collection of the old one by itself.
+  if (getOldRegionCount() >= oldRegionLimit_)
+    collect(GCTrigger::LargeObject);
+  
+  size_t metadataSize = HeapRegion::kSize - HeapRegion::maxSize();
+  size_t storageSize = alignTo(metadataSize + size, HeapRegion::kSize);
+  HeapRegion *region = large_->allocRegion(storageSize);
+  if (region == nullptr)
+    return nullptr;
+  void *mem = region->alloc(size);
+  stats_.addLargeAllocation(size);
+  if (phase_ == Phase::Mark) {
+    HeapRegion::setCellMarkBit(static_cast<GCCell *>(mem));
+    markedBytes_ += size;
+  }
+  return mem;
+}
+
+void GC::collect(GCTrigger trigger) {
+  beginCollection(GCKind::Young, trigger);
+  promoteYoung();
+  // The regions left to sweep are swept at least as fast as the young
+  // collections promote, even if the free list is not short of memory.
+  if (phase_ == Phase::Sweep)
+    sweepIncrement(kMarkStepBytes);
+  if (phase_ == Phase::Mark) {
+    stats_.current().kind = GCKind::Incremental;
+    // The marking must complete before the old generation outgrows twice
+    // its limit.
+    if (getOldRegionCount() >= 2 * oldRegionLimit_)
+      markIncrement(std::numeric_limits<size_t>::max());
+    else
+      markIncrement(kMarkStepBytes);
+  } else if (phase_ == Phase::Idle &&
+             getOldRegionCount() >= oldRegionLimit_) {
+    stats_.current().kind = GCKind::Incremental;
+    startMarking();
+  }
+  endCollection();
+}
+
+void GC::measureHugePages() {
+  RegisterStack &stack = runtime_.getRegisterStack();
+  stats_.setHugePageBackedBytes(
+      oscompat::vm_hugepage_backed_bytes(HeapCage::getBase(), HeapCage::kSize) +
+      oscompat::vm_hugepage_backed_bytes(
+          stack.getBottom(), stack.getReservedSize()));
+}
+
+void GC::beginCollection(GCKind kind, GCTrigger trigger) {
+  stats_.beginCollection(kind, trigger, young_->getUsedBytes());
+}
+
+void GC::endCollection() {
+  GCCollectionStats &stats = stats_.current();
+  stats.youngRegions = young_->getRegionCount();
+  stats.oldRegions = old_->getRegionCount();
+  stats.largeRegions = large_->getRegionCount();
+  stats.oldBytes = old_->getStorageBytes();
+  stats.largeBytes = large_->getStorageBytes();
+  stats_.setHugePageBytes(
+      regionPool_.getHugePageRequestedBytes(),
+      regionPool_.getHugePageAdvisedBytes());
+  stats_.endCollection();
+}
+
+void *GC::allocOld(size_t size) {
+  void *mem = freeList_.alloc(size);
+  // Sweep on demand until a region frees a large enough chunk.
+  while (mem == nullptr && !sweepQueue_.empty()) {
+    sweepRegion(sweepQueue_.back());
+    sweepQueue_.pop_back();
+    mem = freeList_.alloc(size);
+  }
+  if (sweepQueue_.empty() && phase_ == Phase::Sweep)
+    phase_ = Phase::Idle;
+  if (mem == nullptr) {
+    mem = old_->alloc(size);
+    if (mem == nullptr)
+      return nullptr;
+  }
+  
+  HeapRegion::getCardTable(mem)->updateBoundaries(mem, size);
+  // The objects allocated during the marking are live until the next one,
+  // and so are the ones allocated in a region still to sweep.
+  if (phase_ == Phase::Mark ||
+      HeapRegion::getHeapRegion(mem)->needsSweep()) {
+    HeapRegion::setCellMarkBit(static_cast<GCCell *>(mem));
+    markedBytes_ += size;
+  }
+  return mem;
+}
+
+void GC::collectYoung() {
+  beginCollection(GCKind::Young, GCTrigger::Explicit);
+  promoteYoung();
+  endCollection();
+}
+
+void GC::promoteYoung() {
+  {
+    GCStats::PhaseTimer timer(stats_, GCPhase::RootScan);
+    scanDirtyCards();
+    scanRoots();
+  }
+  {
+    GCStats::PhaseTimer timer(stats_, GCPhase::Promote);
+    scanPromoted();
+  }
+  
+#ifdef COBRA_ALLOCATION_SAMPLER
+  updateSampledObjects(false);
+#endif
+  // No old object references the young generation anymore.
+  young_->reset();
+  for (HeapRegion *region : old_->getRegions())
+    region->cardTable().clearCards();
+  for (HeapRegion *region : large_->getRegions())
+    region->cardTable().clearCards();
+  ++youngCollectionCount_;
+  regionPool_.releaseIdleRegions();
+}
+
+void GC::collectOld() {
+  // Every live object is old after a young collection, and the registers
+  // are the only roots left.
+  beginCollection(GCKind::Full, GCTrigger::Explicit);
+  promoteYoung();
+  markStack_.clear();
+  sweepIncrement(std::numeric_limits<size_t>::max());
+  {
+    GCStats::PhaseTimer timer(stats_, GCPhase::Mark);
+    selectEvacuationCandidates();
+    for (HeapRegion *region : old_->getRegions())
+      region->markBitSet().clear();
+    for (HeapRegion *region : large_->getRegions())
+      region->markBitSet().clear();
+    phase_ = Phase::Mark;
+    std::vector<GCCell *> roots;
+    collectRoots(roots);
+    ParallelMarker marker({old_.get(), large_.get()}, markerThreadCount_);
+    marker.mark(roots);
+    marker.rememberCandidateSlots();
+    markedBytes_ = marker.getMarkedBytes();
+  }
+  finishOldCollection();
+  endCollection();
+}
+
+void GC::finishOldCollection() {
+  // Every region is swept again from its mark bits, which rebuilds the free
+  // list. Nothing is allocated from it until then. The large objects are
+  // freed right away.
+#ifdef COBRA_ALLOCATION_SAMPLER
+  updateSampledObjects(true);
+#endif
+  sweepLargeObjects();
+  freeList_.clear();
+  evacuateCandidates();
+  sweepQueue_.assign(old_->getRegions().begin(), old_->getRegions().end());
+  for (HeapRegion *region : sweepQueue_)
+    region->setNeedsSweep(true);
+  phase_ = Phase::Sweep;
+  ++oldCollectionCount_;
+  stats_.current().finishedOldCollection = true;
+  size_t liveRegions = markedBytes_ / HeapRegion::maxSize() + 1;
+  oldRegionLimit_ = std::max<uint32_t>(kMinOldRegionCount, 2 * liveRegions);
+  regionPool_.releaseIdleRegions();
+}
+
+void GC::startMarking() {
+  // Called right after a young collection: every object reachable at this
+  // point is old, and is either referenced from the registers now, or found
+  // through the objects they reference. The regions left to sweep hold the
+  // mark bits of the last marking, and are swept first.
+  sweepIncrement(std::numeric_limits<size_t>::max());
+  GCStats::PhaseTimer timer(stats_, GCPhase::Mark);
+  selectEvacuationCandidates();
+  for (HeapRegion *region : old_->getRegions())
+    region->markBitSet().clear();
+  for (HeapRegion *region : large_->getRegions())
+    region->markBitSet().clear();
+  markedBytes_ = 0;
+  phase_ = Phase::Mark;
+  std::vector<GCCell *> roots;
+  collectRoots(roots);
+  for (GCCell *root : roots)
+    markGrey(root);
+  // The first increment scans from the roots in this pause.
+  markInParallel(kMarkStepBytes);
+}
+
+void GC::markIncrement(size_t budget) {
+  {
+    GCStats::PhaseTimer timer(stats_, GCPhase::Mark);
+    if (budget == std::numeric_limits<size_t>::max()) {
+      markInParallel(budget);
+    } else {
+      // A bounded increment is too short to pay for starting the marker
+      // threads.
+      size_t scanned = 0;
+      while (!markStack_.empty() && scanned < budget) {
+        GCCell *cell = markStack_.back();
+        markStack_.pop_back();
+        scanGrey(cell);
+        scanned += cell->getSize();
+      }
+    }
+  }
+  if (markStack_.empty())
+    completeMarking();
+}
+
+void GC::markInParallel(size_t budget) {
+  if (markStack_.empty())
+    return;
+  ParallelMarker marker({old_.get(), large_.get()}, markerThreadCount_);
+  std::vector<GCCell *> grey;
+  grey.swap(markStack_);
+  if (!marker.markFrom(grey, budget))
+    marker.takeGrey(markStack_);
+  marker.rememberCandidateSlots();
+  markedBytes_ += marker.getMarkedBytes();
+}
+
+void GC::completeMarking() {
+  phase_ = Phase::CompleteMarking;
+  // The registers need no rescan: an object they reference now was either
+  // reachable when the marking started, or allocated since, and marked at
+  // its promotion.
+  {
+    GCStats::PhaseTimer timer(stats_, GCPhase::Mark);
+    markInParallel(std::numeric_limits<size_t>::max());
+    markStack_.shrink_to_fit();
+  }
+  finishOldCollection();
+}
+
+void GC::markGrey(GCCell *cell) {
+  if (isOld(cell) && HeapRegion::testAndSetCellMarkBit(cell)) {
+    markedBytes_ += cell->getSize();
+    markStack_.push_back(cell);
+  }
+}
+
+void GC::scanGrey(GCCell *cell) {
+  CBValue *begin, *end;
+  getSlots(cell, begin, end);
+  for (CBValue *slot = begin; slot < end; ++slot) {
+    CBValue value = *slot;
+    if (value.isPointer()) {
+      rememberSlot(slot);
+      markGrey(static_cast<GCCell *>(value.getPointer()));
+    }
+  }
+}
+
+void GC::markingBarrier(const void *obj, const void *loc, CBValue value) {
+  snapshotBarrier(*static_cast<const CBValue *>(loc));
+  // The slots of the young objects are remembered once promoted.
+  if (value.isPointer() && isInEvacuationCandidate(value.getPointer()) &&
+      isOld(obj)) {
+    HeapRegion::getHeapRegion(value.getPointer())
+        ->getRememberedSet()
+        .push_back(const_cast<CBValue *>(static_cast<const CBValue *>(loc)));
+  }
+}
+
+void GC::selectEvacuationCandidates() {
+  for (HeapRegion *region : evacuationCandidates_) {
+    region->setEvacuationCandidate(false);
+    region->getRememberedSet().clear();
+  }
+  evacuationCandidates_.clear();
+  
+  // The live bytes of a region are the ones of its last sweep, 0 if it was
+  // never swept. The bytes copied in the final pause are bounded.
+  size_t budget = kMarkStepBytes;
+  for (HeapRegion *region : old_->getRegions()) {
+    size_t liveBytes = region->getLiveBytes();
+    if (region == old_->getCurrentRegion() || liveBytes == 0 ||
+        liveBytes >= kEvacuationThreshold || liveBytes > budget)
+      continue;
+    region->setEvacuationCandidate(true);
+    evacuationCandidates_.push_back(region);
+    budget -= liveBytes;
+  }
+  if (!evacuationCandidates_.empty()) {
+    freeList_.removeIf([](const FreeCell *cell) {
+      return HeapRegion::getHeapRegion(cell)->isEvacuationCandidate();
+    });
+  }
+}
+
+void GC::evacuateCandidates() {
+  if (evacuationCandidates_.empty())
+    return;
+  GCStats::PhaseTimer timer(stats_, GCPhase::Evacuate);
+  // Nothing was allocated in the candidates during the marking, and the
+  // free list is empty: the copies are appended to the other regions.
+  std::vector<GCCell *> copies;
+  for (HeapRegion *region : evacuationCandidates_) {
+    for (char *obj = region->start(); obj < region->top();) {
+      auto *cell = reinterpret_cast<GCCell *>(obj);
+      uint32_t size = cell->getSize();
+      if (HeapRegion::getCellMarkBit(cell)) {
+        void *mem = allocOld(size);
+        if (mem == nullptr)
+          FATAL_ERROR("Out of memory evacuating the old generation");
+        memcpy(mem, cell, size);
+        auto *copy = static_cast<GCCell *>(mem);
+        HeapRegion::setCellMarkBit(copy);
+        cell->setForwardingAddress(copy);
+        copies.push_back(copy);
+        evacuatedBytes_ += size;
+        stats_.current().evacuatedBytes += size;
+      }
+      obj += size;
+    }
+  }
+  
+  forEachRegisterRange([this](CBValue *begin, CBValue *end) {
+    for (CBValue *slot = begin; slot < end; ++slot)
+      updateEvacuatedSlot(slot);
+  });
+  for (HeapRegion *region : evacuationCandidates_) {
+    // The slots of the evacuated objects are updated in their copies.
+    for (CBValue *slot : region->getRememberedSet()) {
+      if (!isInEvacuationCandidate(slot))
+        updateEvacuatedSlot(slot);
+    }
+  }
+  for (GCCell *copy : copies) {
+    CBValue *begin, *end;
+    getSlots(copy, begin, end);
+    for (CBValue *slot = begin; slot < end; ++slot)
+      updateEvacuatedSlot(slot);
+  }
+  
+#ifdef COBRA_ALLOCATION_SAMPLER
+  updateSampledObjects(true);
+#endif
+  for (HeapRegion *region : evacuationCandidates_)
+    old_->freeRegion(region);
+  evacuationCandidates_.clear();
+}
+
+#ifdef COBRA_ALLOCATION_SAMPLER
+void GC::updateSampledObjects(bool marked) {
+  if (allocationSampler_ == nullptr)
+    return;
+  allocationSampler_->updateObjects([&](GCCell *cell) -> GCCell * {
+    // A young object survived if it was promoted.
+    if (young_->contains(cell))
+      return cell->isForwarded() ? cell->getForwardingAddress() : nullptr;
+    if (!marked || !isOld(cell))
+      return cell;
+    if (!HeapRegion::getCellMarkBit(cell))
+      return nullptr;
+    return cell->isForwarded() ? cell->getForwardingAddress() : cell;
+  });
+}
+#endif
+
+void GC::collectRoots(std::vector<GCCell *> &roots) {
+  forEachRegisterRange([&](CBValue *begin, CBValue *end) {
+    for (CBValue *slot = begin; slot < end; ++slot) {
+      CBValue value = *slot;
+      if (value.isPointer() && isOld(value.getPointer()))
+        roots.push_back(static_cast<GCCell *>(value.getPointer()));
+    }
+  });
+}
+
+void GC::sweepIncrement(size_t budget) {
+  GCStats::PhaseTimer timer(stats_, GCPhase::Sweep);
+  size_t swept = 0;
+  while (!sweepQueue_.empty() && swept < budget) {
+    HeapRegion *region = sweepQueue_.back();
+    sweepQueue_.pop_back();
+    swept += region->top() - region->start();
+    sweepRegion(region);
+  }
+  if (sweepQueue_.empty() && phase_ == Phase::Sweep)
+    phase_ = Phase::Idle;
+}
+
+void GC::sweepLargeObjects() {
+  GCStats::PhaseTimer timer(stats_, GCPhase::Sweep);
+  std::vector<HeapRegion *> deadRegions;
+  for (HeapRegion *region : large_->getRegions()) {
+    if (!HeapRegion::getCellMarkBit(
+            reinterpret_cast<GCCell *>(region->start())))
+      deadRegions.push_back(region);
+  }
+  for (HeapRegion *region : deadRegions)
+    large_->freeRegion(region);
+}
+
+void GC::sweepRegion(HeapRegion *region) {
+  // The runs of unmarked cells become free chunks, once the region is known
+  // to hold a live object at all.
+  sweepRuns_.clear();
+  size_t liveBytes = 0;
+  char *runStart = nullptr;
+  for (char *obj = region->start(); obj < region->top();) {
+    auto *cell = reinterpret_cast<GCCell *>(obj);
+    size_t size = cell->getSize();
+    if (HeapRegion::getCellMarkBit(cell)) {
+      liveBytes += size;
+      if (runStart != nullptr) {
+        sweepRuns_.emplace_back(runStart, obj - runStart);
+        runStart = nullptr;
+      }
+    } else if (runStart == nullptr) {
+      runStart = obj;
+    }
+    obj += size;
+  }
+  if (runStart != nullptr)
+    sweepRuns_.emplace_back(runStart, region->top() - runStart);
+  
+  region->setNeedsSweep(false);
+  region->setLiveBytes(liveBytes);
+  if (liveBytes == 0) {
+    old_->freeRegion(region);
+    return;
+  }
+  for (auto &run : sweepRuns_)
+    freeList_.addChunk(run.first, run.second);
+}
+
+void GC::scanDirtyCards() {
+  for (HeapRegion *region : old_->getRegions()) {
+    if (region->top() == region->start())
+      continue;
+    CardTable &cards = region->cardTable();
+    size_t from = CardTable::addressToIndex(region->start());
+    size_t to = CardTable::addressToIndex(region->top() - 1) + 1;
+    
+    for (size_t index = cards.findNextDirtyCard(from, to); index < to;
+         index = cards.findNextDirtyCard(index + 1, to)) {
+      auto *cardBegin = reinterpret_cast<CBValue *>(cards.indexToAddress(index));
+      auto *cardEnd = reinterpret_cast<CBValue *>(
+          cards.indexToAddress(index + 1));
+      char *obj = static_cast<char *>(cards.getFirstObject(index));
+      if (obj == nullptr)
+        obj = region->start();
+      
+      // Only scan the part of the objects that lies in the card. The
+      // unmarked objects of a region left to sweep are dead, and may
+      // reference freed regions.
+      bool skipUnmarked = region->needsSweep();
+      while (obj < (char *)cardEnd && obj < region->top()) {
+        auto *cell = reinterpret_cast<GCCell *>(obj);
+        if (!skipUnmarked || HeapRegion::getCellMarkBit(cell)) {
+          CBValue *begin, *end;
+          getSlots(cell, begin, end);
+          evacuateRange(std::max(begin, cardBegin), std::min(end, cardEnd));
+        }
+        obj += cell->getSize();
+      }
+    }
+  }
+  
+  // A large object is scanned whole if any of its cards is dirty.
+  for (HeapRegion *region : large_->getRegions()) {
+    CardTable &cards = region->cardTable();
+    if (cards.findNextDirtyCard(0, CardTable::kNumCards) == CardTable::kNumCards)
+      continue;
+    CBValue *begin, *end;
+    getSlots(reinterpret_cast<GCCell *>(region->start()), begin, end);
+    evacuateRange(begin, end);
+  }
+}
+
+void GC::scanRoots() {
+  forEachRegisterRange(
+      [this](CBValue *begin, CBValue *end) { evacuateRange(begin, end); });
+}
+
+void GC::scanPromoted() {
+  // Scanning a promoted object may promote more of them.
+  while (!promoted_.empty()) {
+    GCCell *cell = promoted_.back();
+    promoted_.pop_back();
+    CBValue *begin, *end;
+    getSlots(cell, begin, end);
+    evacuateRange(begin, end);
+    // The promoted objects are not scanned by the marking.
+    if (phase_ == Phase::Mark) {
+      for (CBValue *slot = begin; slot < end; ++slot)
+        rememberSlot(slot);
+    }
+  }
+}
+
+void GC::evacuateRange(CBValue *begin, CBValue *end) {
+  for (CBValue *slot = begin; slot < end; ++slot)
+    evacuate(slot);
+}
+
+void GC::evacuate(CBValue *slot) {
+  CBValue value = *slot;
+  if (!value.isPointer() || !young_->contains(value.getPointer()))
+    return;
+  auto *cell = static_cast<GCCell *>(value.getPointer());
+  GCCell *copy = cell->isForwarded() ? cell->getForwardingAddress()
+                                     : promote(cell);
+  *slot = value.updatePointer(copy);
+}
+
+GCCell *GC::promote(GCCell *cell) {
+  uint32_t size = cell->getSize();
+  void *mem = allocOld(size);
+  if (mem == nullptr)
+    FATAL_ERROR("Out of memory promoting the young generation");
+  memcpy(mem, cell, size);
+  auto *copy = static_cast<GCCell *>(mem);
+  stats_.current().promotedBytes += size;
+  promoted_.push_back(copy);
+  cell->setForwardingAddress(copy);
+  return copy;
 }
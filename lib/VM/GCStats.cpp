@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "cobra/VM/GCStats.h"
+
+#include <algorithm>
+
+using namespace cobra;
+using namespace vm;
+
+static const char *kindNames[] = {"young", "incremental", "full"};
+
+static const char *triggerNames[] = {"young-full", "large-object", "explicit"};
+
+static const char *phaseNames[] = {
+    "rootScan", "promote", "mark", "sweep", "evacuate"};
+
+/// \return the bucket of the pause histogram counting a pause of
+/// \p micros microseconds.
+static unsigned pauseBucket(uint64_t micros) {
+  unsigned bucket = 0;
+  while (micros != 0 && bucket < GCStats::kNumPauseBuckets - 1) {
+    micros >>= 1;
+    ++bucket;
+  }
+  return bucket;
+}
+
+static void dumpPhases(std::ostream &os, const uint64_t *phaseMicros) {
+  os << "{";
+  const char *sep = "";
+  for (unsigned phase = 0; phase < kNumGCPhases; ++phase) {
+    os << sep << "\"" << phaseNames[phase] << "\": " << phaseMicros[phase];
+    sep = ", ";
+  }
+  os << "}";
+}
+
+void GCStats::beginCollection(
+    GCKind kind,
+    GCTrigger trigger,
+    size_t youngBytes) {
+  pauseStart_ = Clock::now();
+  current_ = GCCollectionStats();
+  current_.kind = kind;
+  current_.trigger = trigger;
+  current_.startMicros = toMicros(pauseStart_ - created_);
+  current_.youngBytes = youngBytes;
+  current_.allocatedBytes = youngBytes + pendingLargeBytes_;
+  pendingLargeBytes_ = 0;
+}
+
+void GCStats::endCollection() {
+  current_.pauseMicros = toMicros(Clock::now() - pauseStart_);
+  
+  ++collectionCount_;
+  ++kindCounts_[unsigned(current_.kind)];
+  totalPauseMicros_ += current_.pauseMicros;
+  maxPauseMicros_ = std::max(maxPauseMicros_, current_.pauseMicros);
+  for (unsigned phase = 0; phase < kNumGCPhases; ++phase)
+    totalPhaseMicros_[phase] += current_.phaseMicros[phase];
+  ++pauseBuckets_[pauseBucket(current_.pauseMicros)];
+  totalAllocatedBytes_ += current_.allocatedBytes;
+  totalYoungBytes_ += current_.youngBytes;
+  totalPromotedBytes_ += current_.promotedBytes;
+  totalEvacuatedBytes_ += current_.evacuatedBytes;
+  
+  if (collections_.size() < kMaxRecordedCollections)
+    collections_.push_back(current_);
+}
+
+uint64_t GCStats::getPausePercentile(double ratio) const {
+  uint64_t target = uint64_t(ratio * collectionCount_);
+  uint64_t count = 0;
+  for (unsigned bucket = 0; bucket < kNumPauseBuckets; ++bucket) {
+    count += pauseBuckets_[bucket];
+    if (count > 0 && count >= target)
+      return std::min(uint64_t(1) << bucket, maxPauseMicros_);
+  }
+  return maxPauseMicros_;
+}
+
+double GCStats::getAllocationRate() const {
+  double seconds =
+      std::chrono::duration<double>(Clock::now() - created_).count();
+  return seconds > 0 ? totalAllocatedBytes_ / seconds : 0;
+}
+
+void GCStats::dumpJSON(std::ostream &os) const {
+  os << "{\n  \"collections\": " << collectionCount_
+     << ",\n  \"recordedCollections\": " << collections_.size()
+     << ",\n  \"kinds\": {";
+  const char *sep = "";
+  for (unsigned kind = 0; kind <= unsigned(GCKind::Full); ++kind) {
+    os << sep << "\"" << kindNames[kind] << "\": " << kindCounts_[kind];
+    sep = ", ";
+  }
+  os << "},\n  \"totalPauseMicros\": " << totalPauseMicros_
+     << ",\n  \"maxPauseMicros\": " << maxPauseMicros_
+     << ",\n  \"p50PauseMicros\": " << getPausePercentile(0.5)
+     << ",\n  \"p90PauseMicros\": " << getPausePercentile(0.9)
+     << ",\n  \"p99PauseMicros\": " << getPausePercentile(0.99)
+     << ",\n  \"pauseHistogram\": [";
+  sep = "\n";
+  for (unsigned bucket = 0; bucket < kNumPauseBuckets; ++bucket) {
+    if (!pauseBuckets_[bucket])
+      continue;
+    uint64_t from = bucket ? uint64_t(1) << (bucket - 1) : 0;
+    os << sep << "    {\"fromMicros\": " << from;
+    if (bucket < kNumPauseBuckets - 1)
+      os << ", \"toMicros\": " << (uint64_t(1) << bucket);
+    os << ", \"count\": " << pauseBuckets_[bucket] << "}";
+    sep = ",\n";
+  }
+  os << "\n  ],\n  \"phaseMicros\": ";
+  dumpPhases(os, totalPhaseMicros_);
+  
+  double survivalRate =
+      totalYoungBytes_ ? double(totalPromotedBytes_) / totalYoungBytes_ : 0;
+  // The advice is taken whenever the kernel has transparent huge pages, even
+  // if they are disabled: only the backed bytes tell whether any was used.
+  double adviceAcceptedRate = hugePageRequestedBytes_
+      ? double(hugePageAdvisedBytes_) / hugePageRequestedBytes_
+      : 0;
+  os << ",\n  \"allocatedBytes\": " << totalAllocatedBytes_
+     << ",\n  \"allocationRate\": " << getAllocationRate()
+     << ",\n  \"promotedBytes\": " << totalPromotedBytes_
+     << ",\n  \"survivalRate\": " << survivalRate
+     << ",\n  \"evacuatedBytes\": " << totalEvacuatedBytes_
+     << ",\n  \"hugePages\": {\"requestedBytes\": " << hugePageRequestedBytes_
+     << ", \"advisedBytes\": " << hugePageAdvisedBytes_
+     << ", \"adviceAcceptedRate\": " << adviceAcceptedRate
+     << ", \"backedBytes\": " << hugePageBackedBytes_ << "}"
+     << ",\n  \"pauses\": [";
+  
+  sep = "\n";
+  for (const GCCollectionStats &stats : collections_) {
+    os << sep << "    {\"kind\": \"" << kindNames[unsigned(stats.kind)]
+       << "\", \"trigger\": \"" << triggerNames[unsigned(stats.trigger)]
+       << "\", \"finishedOldCollection\": "
+       << (stats.finishedOldCollection ? "true" : "false")
+       << ", \"startMicros\": " << stats.startMicros
+       << ", \"pauseMicros\": " << stats.pauseMicros << ", \"phaseMicros\": ";
+    dumpPhases(os, stats.phaseMicros);
+    os << ", \"allocatedBytes\": " << stats.allocatedBytes
+       << ", \"youngBytes\": " << stats.youngBytes
+       << ", \"promotedBytes\": " << stats.promotedBytes
+       << ", \"survivalRate\": " << stats.getSurvivalRate()
+       << ", \"evacuatedBytes\": " << stats.evacuatedBytes
+       << ", \"regions\": {\"young\": " << stats.youngRegions
+       << ", \"old\": " << stats.oldRegions
+       << ", \"large\": " << stats.largeRegions << "}"
+       << ", \"storageBytes\": {\"old\": " << stats.oldBytes
+       << ", \"large\": " << stats.largeBytes << "}}";
+    sep = ",\n";
+  }
+  os << "\n  ]\n}\n";
+}
@@ -11,7 +11,7 @@ using namespace cobra;
 using namespace vm;
 
 ObjPtr<Object> HandleScope::getReference(size_t i) const {
-  return getReferences()[i].getPtr();
+  return getReferences()[i];
 }
 
 template<class T>
@@ -25,7 +25,7 @@ MutableHandle<T> HandleScope::getMutableHandle(size_t i) {
 }
 
 void HandleScope::setReference(size_t i, ObjPtr<Object> object) {
-  getReferences()[i].assign(object);
+  getReferences()[i] = object.ptr();
 }
 
 template <class T>
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <iterator>
+#include <mutex>
+#include <random>
+#include <set>
+
+#include "cobra/VM/HeapCage.h"
+#include "cobra/VM/HeapRegion.h"
+#include "cobra/Support/OSCompat.h"
+
+using namespace cobra;
+using namespace vm;
+
+char *HeapCage::base_ = nullptr;
+
+namespace {
+
+/// The state of the cage, shared by the threads of every runtime.
+struct CageState {
+  std::mutex mutex;
+
+  /// The ranges of the cage from this point were never claimed.
+  char *top{nullptr};
+
+  /// The regions given back, in address order, all below top.
+  std::set<char *> freeRegions;
+};
+
+/// Take a run of \p count adjacent regions out of the free regions of
+/// \p state, the lowest one first.
+/// \return the first region of the run, null if there is none.
+char *takeFreeRun(CageState &state, size_t count) {
+  auto runStart = state.freeRegions.begin();
+  size_t runLength = 0;
+  char *prev = nullptr;
+  for (auto it = state.freeRegions.begin(); it != state.freeRegions.end();
+       ++it) {
+    if (runLength == 0 || *it != prev + HeapRegion::kSize) {
+      runStart = it;
+      runLength = 0;
+    }
+    prev = *it;
+    if (++runLength == count) {
+      char *storage = *runStart;
+      state.freeRegions.erase(runStart, std::next(it));
+      return storage;
+    }
+  }
+  return nullptr;
+}
+
+CageState &getState() {
+  static CageState state;
+  return state;
+}
+
+void *getMmapHint() {
+  uintptr_t addr = std::random_device()();
+  if constexpr (sizeof(uintptr_t) >= 8) {
+    // std::random_device() yields an unsigned int, so combine two.
+    addr = (addr << 32) | std::random_device()();
+    // Don't use the entire address space, to prevent too much fragmentation.
+    addr &= std::numeric_limits<uintptr_t>::max() >> 18;
+  }
+  return reinterpret_cast<void *>(alignTo(addr, HeapRegion::kSize));
+}
+
+} // namespace
+
+bool HeapCage::init() {
+  CageState &state = getState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (base_ != nullptr)
+    return true;
+  void *base =
+      oscompat::vm_reserve_aligned(kSize, HeapRegion::kSize, getMmapHint());
+  if (base == nullptr)
+    return false;
+  base_ = state.top = static_cast<char *>(base);
+  return true;
+}
+
+void *HeapCage::claim(size_t size) {
+  assert(size % HeapRegion::kSize == 0 && "size must be aligned");
+  CageState &state = getState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  if (base_ == nullptr)
+    return nullptr;
+  if (char *storage = takeFreeRun(state, size / HeapRegion::kSize))
+    return storage;
+  if (size > size_t(base_ + kSize - state.top))
+    return nullptr;
+  void *storage = state.top;
+  state.top += size;
+  return storage;
+}
+
+void HeapCage::giveBack(void *storage) {
+  assert(contains(storage) && "the region is not in the cage");
+  CageState &state = getState();
+  std::lock_guard<std::mutex> lock(state.mutex);
+  state.freeRegions.insert(static_cast<char *>(storage));
+  // The free regions at the end of the claimed part go back to the unclaimed
+  // end, where ranges of any size are taken.
+  while (!state.freeRegions.empty() &&
+         *state.freeRegions.rbegin() + HeapRegion::kSize == state.top) {
+    state.top -= HeapRegion::kSize;
+    state.freeRegions.erase(std::prev(state.freeRegions.end()));
+  }
+}
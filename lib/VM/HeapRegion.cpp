@@ -21,26 +21,23 @@ void HeapRegion::Contents::protectGuardPage(oscompat::ProtectMode mode) {
   }
 }
 
-HeapRegion::HeapRegion(void *allocateBase) : allocateBase_(static_cast<char *>(allocateBase)) {
+HeapRegion::HeapRegion(void *allocateBase, size_t storageSize)
+    : allocateBase_(static_cast<char *>(allocateBase)),
+      storageSize_(storageSize) {
+  assert(storageSize % kSize == 0 && "storage size must be a multiple of kSize");
   assert(
       reinterpret_cast<uintptr_t>(end()) % oscompat::page_size() == 0 &&
       "storage end must be page-aligned");
   new (contents()) Contents();
+  contents()->region_ = this;
+  // The storage may be a reused one.
+  contents()->cardTable_.clear();
+  contents()->markBitSet_.clear();
   contents()->protectGuardPage(oscompat::ProtectMode::None);
+  top_ = start();
 }
 
-/// Ref arkcompiler BumpPointerAllocator::Allocate
-/// and art RegionSpace::Region::Alloc
-/// and hermes AlignedHeapSegment::alloc
-void *HeapRegion::alloc(size_t size) {
-  assert(isSizeHeapAligned(size) && "size must be heap aligned");
-  char *oldTop;
-  char *newTop = top_ + size;
-  if (COBRA_UNLIKELY(newTop > end())) {
-    return nullptr;
-  }
-  oldTop = top_;
-  top_ = newTop;
-  
-  return reinterpret_cast<void *>(oldTop);
+HeapRegion::~HeapRegion() {
+  // The storage may be handed to another region.
+  contents()->protectGuardPage(oscompat::ProtectMode::ReadWrite);
 }
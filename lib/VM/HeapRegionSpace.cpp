@@ -5,48 +5,84 @@
  * LICENSE file in the root directory of this source tree.
  */
 
-#include <random>
+#include <algorithm>
 
 #include "cobra/VM/HeapRegionSpace.h"
-#include "cobra/Support/OSCompat.h"
 
 using namespace cobra;
 using namespace vm;
 
-bool isAligned(void *p) {
-  return (reinterpret_cast<uintptr_t>(p) & (HeapRegion::kSize - 1)) == 0;
+HeapRegionSpace *HeapRegionSpace::create(
+    const std::string &name,
+    HeapRegionSpaceType type,
+    MemMapAllocator &allocator,
+    uint32_t maxRegionCount) {
+  return new HeapRegionSpace(name, type, allocator, maxRegionCount);
 }
 
-char *alignAlloc(void *p) {
-  return reinterpret_cast<char *>(
-      alignTo(reinterpret_cast<uintptr_t>(p), HeapRegion::kSize));
+HeapRegionSpace::~HeapRegionSpace() {
+  for (HeapRegion *region : regions_)
+    destroyRegion(region);
 }
 
-void *getMmapHint() {
-  uintptr_t addr = std::random_device()();
-  if constexpr (sizeof(uintptr_t) >= 8) {
-    // std::random_device() yields an unsigned int, so combine two.
-    addr = (addr << 32) | std::random_device()();
-    // Don't use the entire address space, to prevent too much fragmentation.
-    addr &= std::numeric_limits<uintptr_t>::max() >> 18;
-  }
-  return alignAlloc(reinterpret_cast<void *>(addr));
+void HeapRegionSpace::destroyRegion(HeapRegion *region) {
+  void *storage = region->getStorage();
+  size_t storageSize = region->getStorageSize();
+  delete region;
+  allocator_.free(
+      storage, storageSize, type_ == HeapRegionSpaceType::LargeObject);
+}
+
+HeapRegion *HeapRegionSpace::allocRegion(size_t storageSize) {
+  auto addr = allocator_.alloc(storageSize, name_.c_str());
+  if (addr == nullptr)
+    return nullptr;
+  auto *region = new HeapRegion(addr, storageSize);
+  regions_.push_back(region);
+  storages_.insert(addr);
+  storageBytes_ += storageSize;
+  currentRegion_ = region;
+  return region;
 }
 
-static void *alloc(const char *name) {
-  auto result = oscompat::vm_allocate_aligned(HeapRegion::kSize, HeapRegion::kSize, getMmapHint());
-  if (!result) {
-    return result;
+void HeapRegionSpace::freeRegion(HeapRegion *region) {
+  regions_.remove(region);
+  storages_.erase(region->getStorage());
+  storageBytes_ -= region->getStorageSize();
+  if (currentRegion_ == region)
+    currentRegion_ = regions_.empty() ? nullptr : regions_.back();
+  destroyRegion(region);
+}
+
+void *HeapRegionSpace::allocSlow(size_t size) {
+  if (size > HeapRegion::maxSize())
+    return nullptr;
+  // Continue in the regions emptied by reset().
+  auto it = std::find(regions_.begin(), regions_.end(), currentRegion_);
+  if (it != regions_.end()) {
+    for (++it; it != regions_.end(); ++it) {
+      currentRegion_ = *it;
+      if (void *mem = currentRegion_->alloc(size))
+        return mem;
+    }
   }
-  void *mem = result;
-  assert(isAligned(mem));
-  
-  // Name the memory region on platforms that support naming.
-  oscompat::vm_name(mem, HeapRegion::kSize, name);
-  return mem;
+  if (maxRegionCount_ != 0 && regions_.size() >= maxRegionCount_)
+    return nullptr;
+  HeapRegion *region = allocRegion();
+  if (region == nullptr)
+    return nullptr;
+  return region->alloc(size);
+}
+
+size_t HeapRegionSpace::getUsedBytes() const {
+  size_t usedBytes = 0;
+  for (HeapRegion *region : regions_)
+    usedBytes += region->top() - region->start();
+  return usedBytes;
 }
 
-HeapRegion *HeapRegionSpace::allocRegion() {
-  auto addr = alloc("cobra-heapregion");
-  return new HeapRegion(addr);
+void HeapRegionSpace::reset() {
+  for (HeapRegion *region : regions_)
+    region->reset();
+  currentRegion_ = regions_.empty() ? nullptr : regions_.front();
 }
@@ -0,0 +1,433 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "cobra/VM/HeapSnapshot.h"
+#include "cobra/VM/Array.h"
+#include "cobra/VM/Class.h"
+#include "cobra/VM/Field.h"
+#include "cobra/VM/GC.h"
+#include "cobra/VM/Object.h"
+#include "cobra/VM/Runtime.h"
+#include "cobra/VM/StackFrame.h"
+#include "cobra/VM/String.h"
+
+using namespace cobra;
+using namespace vm;
+
+static const char *nodeTypeNames[] = {
+    "hidden", "array", "string", "object", "code",
+    "closure", "regexp", "number", "native", "synthetic"};
+
+static const char *edgeTypeNames[] = {
+    "context", "element", "property", "internal", "hidden", "shortcut", "weak"};
+
+/// Number of characters of a string kept in the name of its node.
+static constexpr uint32_t kMaxStringNameLength = 1024;
+
+/// Number of values of a node in the "nodes" array of the snapshot.
+static constexpr uint32_t kNodeFieldCount = 6;
+
+/// \return the contents of \p str as UTF-8, truncated to
+/// kMaxStringNameLength characters.
+static std::string stringName(String *str) {
+  uint32_t length = std::min(str->getLength(), kMaxStringNameLength);
+  std::string name;
+  name.reserve(length);
+  if (str->isCompressed()) {
+    name.append(reinterpret_cast<const char *>(str->getDataCompressed()), length);
+  } else {
+    const uint16_t *data = str->getData();
+    for (uint32_t i = 0; i < length; ++i) {
+      uint16_t c = data[i];
+      if (c < 0x80) {
+        name += char(c);
+      } else if (c < 0x800) {
+        name += char(0xC0 | (c >> 6));
+        name += char(0x80 | (c & 0x3F));
+      } else if (c >= 0xD800 && c < 0xE000) {
+        // A lone half of a surrogate pair has no UTF-8 encoding.
+        name += '?';
+      } else {
+        name += char(0xE0 | (c >> 12));
+        name += char(0x80 | ((c >> 6) & 0x3F));
+        name += char(0x80 | (c & 0x3F));
+      }
+    }
+  }
+  if (length < str->getLength())
+    name += "...";
+  return name;
+}
+
+/// \return the name of the instance field at \p offset of the objects of
+/// \p cls, null if no field of the class or its superclasses is there.
+static const char *fieldName(Class *cls, uint32_t offset) {
+  for (; cls != nullptr; cls = cls->getSuperClass()) {
+    for (const Field &field : cls->getInstanceFields()) {
+      if (field.getOffset() == offset)
+        return field.getName();
+    }
+  }
+  return nullptr;
+}
+
+/// Write \p str to \p os as a JSON string.
+static void writeJSONString(std::ostream &os, const std::string &str) {
+  static const char hexDigits[] = "0123456789abcdef";
+  os << '"';
+  for (char c : str) {
+    switch (c) {
+      case '"':
+        os << "\\\"";
+        break;
+      case '\\':
+        os << "\\\\";
+        break;
+      case '\n':
+        os << "\\n";
+        break;
+      case '\r':
+        os << "\\r";
+        break;
+      case '\t':
+        os << "\\t";
+        break;
+      default:
+        if ((unsigned char)c < 0x20)
+          os << "\\u00" << hexDigits[c >> 4] << hexDigits[c & 0xF];
+        else
+          os << c;
+    }
+  }
+  os << '"';
+}
+
+HeapSnapshot::HeapSnapshot(Runtime &runtime) {
+  intern("");
+  addSyntheticNode("");
+  uint32_t registers = addSyntheticNode("(Registers)");
+  uint32_t unreached = addSyntheticNode("(Unreached)");
+
+  nodes_[kRootNode].firstEdge = 0;
+  edges_.push_back({EdgeType::Element, 1, registers});
+  edges_.push_back({EdgeType::Element, 2, unreached});
+  nodes_[kRootNode].edgeCount = 2;
+
+  // The registers of a frame extend up to the header of the next frame, as
+  // the collector scans them.
+  nodes_[registers].firstEdge = (uint32_t)edges_.size();
+  uint32_t index = 0;
+  auto addRange = [&](CBValue *begin, CBValue *end) {
+    for (CBValue *slot = begin; slot < end; ++slot, ++index) {
+      if (slot->isPointer()) {
+        addEdge(EdgeType::Element, index,
+            static_cast<GCCell *>(slot->getPointer()));
+      }
+    }
+  };
+  RegisterStack &stack = runtime.getRegisterStack();
+  std::vector<std::pair<CBValue *, CBValue *>> ranges;
+  CBValue *end = stack.getTop();
+  for (StackFrame *frame = runtime.getCurrentFrame(); frame != nullptr;
+       frame = frame->getPrevFrame()) {
+    ranges.emplace_back(frame->getRegisters(), end);
+    end = reinterpret_cast<CBValue *>(frame);
+  }
+  ranges.emplace_back(stack.getBottom(), end);
+  // Number the registers from the bottom of the stack.
+  for (auto it = ranges.rbegin(); it != ranges.rend(); ++it)
+    addRange(it->first, it->second);
+  nodes_[registers].edgeCount =
+      (uint32_t)edges_.size() - nodes_[registers].firstEdge;
+
+  // The objects are added as they are first referenced, breadth first.
+  uint32_t node = unreached + 1;
+  for (; node < nodes_.size(); ++node)
+    addEdges(node);
+
+  // Every object left has no path from the registers the walk can see.
+  GC &heap = runtime.getHeap();
+  nodes_[unreached].firstEdge = (uint32_t)edges_.size();
+  index = 0;
+  addUnreachedEdges(heap.getYoungSpace(), index);
+  addUnreachedEdges(heap.getOldSpace(), index);
+  addUnreachedEdges(heap.getLargeObjectSpace(), index);
+  nodes_[unreached].edgeCount =
+      (uint32_t)edges_.size() - nodes_[unreached].firstEdge;
+  for (; node < nodes_.size(); ++node)
+    addEdges(node);
+
+  sortEdges();
+  computeRetainedSizes();
+}
+
+void HeapSnapshot::addUnreachedEdges(HeapRegionSpace &space, uint32_t &index) {
+  for (HeapRegion *region : space.getRegions()) {
+    for (char *obj = region->start(); obj < region->top();) {
+      auto *cell = reinterpret_cast<GCCell *>(obj);
+      obj += cell->getSize();
+      if (cell->getKind() == FreeKind || nodeIndices_.count(cell))
+        continue;
+      addEdge(EdgeType::Element, index++, cell);
+    }
+  }
+}
+
+void HeapSnapshot::sortEdges() {
+  std::vector<Edge> edges;
+  edges.reserve(edges_.size());
+  for (Node &node : nodes_) {
+    uint32_t firstEdge = (uint32_t)edges.size();
+    edges.insert(
+        edges.end(),
+        edges_.begin() + node.firstEdge,
+        edges_.begin() + node.firstEdge + node.edgeCount);
+    node.firstEdge = firstEdge;
+  }
+  edges_.swap(edges);
+}
+
+uint32_t HeapSnapshot::intern(const std::string &str) {
+  auto it = stringIndices_.find(str);
+  if (it != stringIndices_.end())
+    return it->second;
+  uint32_t index = (uint32_t)strings_.size();
+  strings_.push_back(str);
+  stringIndices_.emplace(str, index);
+  return index;
+}
+
+uint32_t HeapSnapshot::addSyntheticNode(const char *name) {
+  uint32_t index = (uint32_t)nodes_.size();
+  nodes_.push_back({NodeType::Synthetic, intern(name), nullptr, 0, 0, 0, 0});
+  return index;
+}
+
+uint32_t HeapSnapshot::getNode(GCCell *cell) {
+  auto it = nodeIndices_.find(cell);
+  if (it != nodeIndices_.end())
+    return it->second;
+
+  NodeType type;
+  std::string name;
+  switch (cell->getKind()) {
+    case StringKind:
+      type = NodeType::String;
+      name = stringName(static_cast<String *>(cell));
+      break;
+    case ObjectKind:
+      type = NodeType::Object;
+      name = "Object";
+      break;
+    case ArrayKind:
+      type = NodeType::Array;
+      name = "Array";
+      break;
+    case MapKind:
+      type = NodeType::Object;
+      name = "Map";
+      break;
+    case ClosureKind:
+      type = NodeType::Closure;
+      name = "Closure";
+      break;
+    case MethodKind:
+      type = NodeType::Code;
+      name = "Method";
+      break;
+    default:
+      type = NodeType::Hidden;
+      name = "(system)";
+      break;
+  }
+
+  uint32_t index = (uint32_t)nodes_.size();
+  nodes_.push_back({type, intern(name), cell, cell->getSize(), 0, 0, 0});
+  nodeIndices_.emplace(cell, index);
+  return index;
+}
+
+void HeapSnapshot::addEdge(EdgeType type, uint32_t nameOrIndex, GCCell *cell) {
+  edges_.push_back({type, nameOrIndex, getNode(cell)});
+}
+
+void HeapSnapshot::addEdges(uint32_t index) {
+  GCCell *cell = nodes_[index].cell;
+  nodes_[index].firstEdge = (uint32_t)edges_.size();
+
+  CBValue *begin, *end;
+  GC::getSlots(cell, begin, end);
+  Class *cls = cell->getKind() == ObjectKind
+      ? static_cast<Object *>(cell)->getClass()
+      : nullptr;
+  for (CBValue *slot = begin; slot < end; ++slot) {
+    if (!slot->isPointer())
+      continue;
+    auto *to = static_cast<GCCell *>(slot->getPointer());
+    uint32_t slotIndex = (uint32_t)(slot - begin);
+    if (cell->getKind() != ObjectKind) {
+      addEdge(EdgeType::Element, slotIndex, to);
+      continue;
+    }
+    uint32_t offset = (uint32_t)(reinterpret_cast<char *>(slot) -
+        reinterpret_cast<char *>(cell));
+    const char *name = fieldName(cls, offset);
+    addEdge(EdgeType::Property,
+        intern(name ? name : "field " + std::to_string(slotIndex)), to);
+  }
+
+  nodes_[index].edgeCount = (uint32_t)edges_.size() - nodes_[index].firstEdge;
+}
+
+void HeapSnapshot::computeRetainedSizes() {
+  // Ref Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm"
+  uint32_t count = (uint32_t)nodes_.size();
+  constexpr uint32_t kUndefined = UINT32_MAX;
+
+  // Number the nodes in postorder of a depth first walk from the root, which
+  // reaches every node.
+  std::vector<uint32_t> postorder;
+  std::vector<uint32_t> postorderIndex(count, kUndefined);
+  postorder.reserve(count);
+  {
+    std::vector<bool> visited(count, false);
+    std::vector<std::pair<uint32_t, uint32_t>> stack;
+    stack.emplace_back(kRootNode, 0);
+    visited[kRootNode] = true;
+    while (!stack.empty()) {
+      auto &[node, next] = stack.back();
+      if (next < nodes_[node].edgeCount) {
+        uint32_t to = edges_[nodes_[node].firstEdge + next++].to;
+        if (!visited[to]) {
+          visited[to] = true;
+          stack.emplace_back(to, 0);
+        }
+        continue;
+      }
+      postorderIndex[node] = (uint32_t)postorder.size();
+      postorder.push_back(node);
+      stack.pop_back();
+    }
+  }
+
+  // The predecessors of every node, in postorder numbers.
+  std::vector<uint32_t> predecessorStart(count + 1, 0);
+  for (const Edge &edge : edges_)
+    ++predecessorStart[postorderIndex[edge.to] + 1];
+  for (uint32_t i = 0; i < count; ++i)
+    predecessorStart[i + 1] += predecessorStart[i];
+  std::vector<uint32_t> predecessors(edges_.size());
+  {
+    std::vector<uint32_t> fill(predecessorStart.begin(), predecessorStart.end() - 1);
+    for (uint32_t node = 0; node < count; ++node) {
+      for (uint32_t i = 0; i < nodes_[node].edgeCount; ++i) {
+        uint32_t to = postorderIndex[edges_[nodes_[node].firstEdge + i].to];
+        predecessors[fill[to]++] = postorderIndex[node];
+      }
+    }
+  }
+
+  // The immediate dominators, in postorder numbers. The root is the last
+  // node of the postorder.
+  uint32_t root = count - 1;
+  std::vector<uint32_t> idom(count, kUndefined);
+  idom[root] = root;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (uint32_t node = root; node-- > 0;) {
+      uint32_t newIdom = kUndefined;
+      for (uint32_t i = predecessorStart[node]; i < predecessorStart[node + 1];
+           ++i) {
+        uint32_t pred = predecessors[i];
+        if (idom[pred] == kUndefined)
+          continue;
+        if (newIdom == kUndefined) {
+          newIdom = pred;
+          continue;
+        }
+        uint32_t finger = pred;
+        while (finger != newIdom) {
+          while (finger < newIdom)
+            finger = idom[finger];
+          while (newIdom < finger)
+            newIdom = idom[newIdom];
+        }
+      }
+      if (idom[node] != newIdom) {
+        idom[node] = newIdom;
+        changed = true;
+      }
+    }
+  }
+
+  // A node comes before its dominator in postorder, so its retained size is
+  // complete when it is added to the one of its dominator.
+  for (Node &node : nodes_)
+    node.retainedSize = node.selfSize;
+  for (uint32_t node = 0; node < root; ++node) {
+    nodes_[postorder[idom[node]]].retainedSize +=
+        nodes_[postorder[node]].retainedSize;
+  }
+}
+
+void HeapSnapshot::dumpJSON(std::ostream &os) const {
+  os << "{\"snapshot\":{\"meta\":{"
+     << "\"node_fields\":[\"type\",\"name\",\"id\",\"self_size\","
+        "\"edge_count\",\"trace_node_id\"],"
+     << "\"node_types\":[[";
+  const char *sep = "";
+  for (const char *name : nodeTypeNames) {
+    os << sep << "\"" << name << "\"";
+    sep = ",";
+  }
+  os << "],\"string\",\"number\",\"number\",\"number\",\"number\"],"
+     << "\"edge_fields\":[\"type\",\"name_or_index\",\"to_node\"],"
+     << "\"edge_types\":[[";
+  sep = "";
+  for (const char *name : edgeTypeNames) {
+    os << sep << "\"" << name << "\"";
+    sep = ",";
+  }
+  os << "],\"string_or_number\",\"node\"],"
+     << "\"trace_function_info_fields\":[\"function_id\",\"name\","
+        "\"script_name\",\"script_id\",\"line\",\"column\"],"
+     << "\"trace_node_fields\":[\"id\",\"function_info_index\",\"count\","
+        "\"size\",\"children\"],"
+     << "\"sample_fields\":[\"timestamp_us\",\"last_assigned_id\"],"
+     << "\"location_fields\":[\"object_index\",\"script_id\",\"line\","
+        "\"column\"]},"
+     << "\"node_count\":" << nodes_.size()
+     << ",\"edge_count\":" << edges_.size()
+     << ",\"trace_function_count\":0},\n";
+
+  // The ids are odd, as V8 keeps the even ones for its embedder objects.
+  os << "\"nodes\":[";
+  sep = "";
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    const Node &node = nodes_[i];
+    os << sep << unsigned(node.type) << "," << node.name << "," << (2 * i + 1)
+       << "," << node.selfSize << "," << node.edgeCount << ",0";
+    sep = ",\n";
+  }
+  os << "],\n\"edges\":[";
+  sep = "";
+  for (const Edge &edge : edges_) {
+    os << sep << unsigned(edge.type) << "," << edge.nameOrIndex << ","
+       << size_t(edge.to) * kNodeFieldCount;
+    sep = ",\n";
+  }
+  os << "],\n\"trace_function_infos\":[],\"trace_tree\":[],\"samples\":[],"
+     << "\"locations\":[],\n\"strings\":[";
+  sep = "";
+  for (const std::string &str : strings_) {
+    os << sep;
+    writeJSONString(os, str);
+    sep = ",\n";
+  }
+  os << "]}\n";
+}
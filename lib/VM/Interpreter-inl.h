@@ -9,10 +9,33 @@
 #define InterpreterInl_h
 
 #include "cobra/VM/Interpreter.h"
+#include "cobra/VM/Operations.h"
+#include "cobra/VM/String.h"
+#include "cobra/VM/Array.h"
+#include "cobra/VM/Class.h"
+#include "cobra/VM/Runtime.h"
+#include "cobra/Inst/Inst.h"
 
 namespace cobra {
 namespace vm {
 
+/// Rewrite the opcode of the instruction at \p ip in place. The adaptive
+/// interpreter uses this to quicken a generic instruction into a specialized
+/// variant, and to turn the variant back into the generic instruction when its
+/// guard fails. The replacement must have the same layout as the original.
+///
+/// The instructions a method runs are the private copy of its bytecode the
+/// class linker made (Method::setInstructions), which is writable and shared
+/// by nothing else, never the bytecode of the mapped file.
+inline void patchOpCode(const inst::Inst *ip, inst::OpCode opCode) {
+  const_cast<inst::Inst *>(ip)->opCode = opCode;
+}
+
+/// \return the sum of x and y.
+inline double doAdd(double x, double y) {
+  return x + y;
+}
+
 inline double doDiv(double x, double y) {
   // UBSan will complain about float divide by zero as our implementation
   // of OpCode::Div depends on IEEE 754 float divide by zero. All modern
@@ -74,6 +97,242 @@ inline double doDec(double d) {
   return d - 1;
 }
 
+/// \return true and set \p result if \p value is a number with an exact int32
+/// representation. -0 is rejected, so that integer arithmetic on the operands
+/// produces the same bits as the double one.
+inline bool getInt32(CBValue value, int32_t &result) {
+  if (!value.isNumber())
+    return false;
+  double number = value.getNumber();
+  if (!(number > -2147483649.0 && number < 2147483648.0))
+    return false;
+  result = (int32_t)number;
+  return CBValue::encodeTrustedNumberValue(result).getRaw() == value.getRaw();
+}
+
+/// The int32 fast path of the I32 instructions. When both operands are int32
+/// numbers, \p oper is computed exactly on 64-bit integers and kept if it
+/// fits in an int32.
+/// \return false on overflow, when the result could be -0 and when an
+/// operand is not an int32, where the instruction takes its generic path.
+template <typename IntOper>
+inline bool doArithI32Fast(CBValue x, CBValue y, IntOper oper, CBValue &result) {
+  int32_t a, b;
+  if (COBRA_LIKELY(getInt32(x, a) && getInt32(y, b))) {
+    int64_t value = oper((int64_t)a, (int64_t)b);
+    if (COBRA_LIKELY(
+            value == (int32_t)value && (value != 0 || (a | b) >= 0))) {
+      result = CBValue::encodeTrustedNumberValue((int32_t)value);
+      return true;
+    }
+  }
+  return false;
+}
+
+/// Implement the arithmetic of the I32 instructions, falling back to
+/// \p slowOper on doubles when the int32 fast path does not apply.
+template <typename IntOper, typename DoubleOper>
+inline CBValue
+doArithI32(CBValue x, CBValue y, IntOper oper, DoubleOper slowOper) {
+  CBValue result;
+  if (COBRA_LIKELY(doArithI32Fast(x, y, oper, result)))
+    return result;
+  return CBValue::encodeUntrustedNumberValue(
+      slowOper(toNumber(x), toNumber(y)));
+}
+
+/// The int32 fast path of AddI32, its generic path is the one of Add, which
+/// concatenates strings.
+inline bool doAddI32(CBValue x, CBValue y, CBValue &result) {
+  return doArithI32Fast(
+      x, y, [](int64_t a, int64_t b) { return a + b; }, result);
+}
+
+inline CBValue doSubI32(CBValue x, CBValue y) {
+  return doArithI32(
+      x, y, [](int64_t a, int64_t b) { return a - b; }, doSub);
+}
+
+inline CBValue doMulI32(CBValue x, CBValue y) {
+  return doArithI32(
+      x, y, [](int64_t a, int64_t b) { return a * b; }, doMul);
+}
+
+/// Bitwise instructions, with the operand conversions of ES5.1 11.7 and 11.10.
+/// Shift counts only use their low 5 bits.
+inline CBValue doBitAndOp(CBValue x, CBValue y) {
+  return CBValue::encodeTrustedNumberValue(doBitAnd(toInt32(x), toInt32(y)));
+}
+
+inline CBValue doBitOrOp(CBValue x, CBValue y) {
+  return CBValue::encodeTrustedNumberValue(doBitOr(toInt32(x), toInt32(y)));
+}
+
+inline CBValue doBitXorOp(CBValue x, CBValue y) {
+  return CBValue::encodeTrustedNumberValue(doBitXor(toInt32(x), toInt32(y)));
+}
+
+inline CBValue doLShiftOp(CBValue x, CBValue y) {
+  return CBValue::encodeTrustedNumberValue(
+      doLShift(toUInt32(x), toUInt32(y) & 0x1f));
+}
+
+inline CBValue doRShiftOp(CBValue x, CBValue y) {
+  return CBValue::encodeTrustedNumberValue(
+      doRShift(toInt32(x), toUInt32(y) & 0x1f));
+}
+
+inline CBValue doURshiftOp(CBValue x, CBValue y) {
+  return CBValue::encodeTrustedNumberValue(
+      doURshift(toUInt32(x), toUInt32(y) & 0x1f));
+}
+
+/// Relational comparisons of compare-and-branch instructions. Non-number
+/// operands are converted with ToNumber.
+inline bool doLess(CBValue x, CBValue y) {
+  return toNumber(x) < toNumber(y);
+}
+
+inline bool doLessEqual(CBValue x, CBValue y) {
+  return toNumber(x) <= toNumber(y);
+}
+
+inline bool doGreater(CBValue x, CBValue y) {
+  return toNumber(x) > toNumber(y);
+}
+
+inline bool doGreaterEqual(CBValue x, CBValue y) {
+  return toNumber(x) >= toNumber(y);
+}
+
+/// Comparisons of the numeric compare-and-branch instructions, both operands
+/// must be numbers.
+inline bool doEqN(CBValue x, CBValue y) {
+  return x.getNumber() == y.getNumber();
+}
+
+inline bool doLessN(CBValue x, CBValue y) {
+  return x.getNumber() < y.getNumber();
+}
+
+inline bool doLessEqualN(CBValue x, CBValue y) {
+  return x.getNumber() <= y.getNumber();
+}
+
+inline bool doGreaterN(CBValue x, CBValue y) {
+  return x.getNumber() > y.getNumber();
+}
+
+inline bool doGreaterEqualN(CBValue x, CBValue y) {
+  return x.getNumber() >= y.getNumber();
+}
+
+/// Slow path of GetField and SetField, taken when the receiver class \p clazz
+/// is not in the inline cache \p cache. Resolve the field by name, and record
+/// its offset in the inline cache, or in the runtime's megamorphic cache once
+/// the inline cache has seen too many classes or if the instruction has no
+/// inline cache, in which case \p cache is null.
+/// \return false if \p clazz has no field named by \p nameID.
+inline bool resolveFieldOffset(
+    Runtime *runtime,
+    Method *method,
+    InlineCache *cache,
+    Class *clazz,
+    uint32_t nameID,
+    uint32_t &offset) {
+  // Objects created by NewObject have no class, and thus no field.
+  if (clazz == nullptr)
+    return false;
+  
+  MegamorphicCache &megamorphicCache = runtime->getMegamorphicCache();
+  bool megamorphic = cache == nullptr || cache->isMegamorphic();
+  if (megamorphic && megamorphicCache.lookup(clazz, nameID, offset))
+    return true;
+  
+  const CexFile *file = method->getCexFile();
+  Field *field = clazz->findInstanceField(
+      file->getStringData(file->getStringId(nameID)));
+  if (field == nullptr)
+    return false;
+  
+  offset = field->getOffset();
+  if (cache != nullptr)
+    cache->update(clazz, offset);
+  if (cache == nullptr || cache->isMegamorphic())
+    megamorphicCache.update(clazz, nameID, offset);
+  return true;
+}
+
+/// \return the inline cache \p cacheIdx of \p method, null if the
+/// instruction has none.
+inline InlineCache *getInlineCache(Method *method, uint16_t cacheIdx) {
+  if (COBRA_UNLIKELY(cacheIdx == inst::kNoInlineCacheIndex))
+    return nullptr;
+  return method->getInlineCache(cacheIdx);
+}
+
+/// Load the field named by \p nameID of \p receiver, using the inline cache
+/// \p cacheIdx of \p method.
+/// \return undefined if \p receiver is not an object or has no such field.
+inline CBValue doGetField(
+    Runtime *runtime,
+    Method *method,
+    CBValue receiver,
+    uint16_t cacheIdx,
+    uint32_t nameID) {
+  uint32_t offset;
+  if (COBRA_LIKELY(receiver.isObject())) {
+    auto *obj = static_cast<Object *>(receiver.getObject());
+    Class *clazz = obj->getClass();
+    InlineCache *cache = getInlineCache(method, cacheIdx);
+    if (COBRA_LIKELY(cache != nullptr && cache->lookup(clazz, offset)) ||
+        resolveFieldOffset(runtime, method, cache, clazz, nameID, offset)) {
+      return obj->getField<CBValue>(offset);
+    }
+  }
+  return CBValue::encodeUndefinedValue();
+}
+
+/// Store \p value in the field named by \p nameID of \p receiver, using the
+/// inline cache \p cacheIdx of \p method. Does nothing if \p receiver is not
+/// an object or has no such field.
+inline void doSetField(
+    Runtime *runtime,
+    Method *method,
+    CBValue receiver,
+    CBValue value,
+    uint16_t cacheIdx,
+    uint32_t nameID) {
+  uint32_t offset;
+  if (COBRA_LIKELY(receiver.isObject())) {
+    auto *obj = static_cast<Object *>(receiver.getObject());
+    Class *clazz = obj->getClass();
+    InlineCache *cache = getInlineCache(method, cacheIdx);
+    if (COBRA_LIKELY(cache != nullptr && cache->lookup(clazz, offset)) ||
+        resolveFieldOffset(runtime, method, cache, clazz, nameID, offset)) {
+      runtime->getHeap().writeBarrier(
+          obj, reinterpret_cast<char *>(obj) + offset, value);
+      ObjectAccessor::setPrimitive<CBValue>(obj, offset, value);
+    }
+  }
+}
+
+/// \return the method \p callee refers to, null if it is not a method.
+inline Method *getCallee(CBValue callee) {
+  if (COBRA_UNLIKELY(!callee.isObject()))
+    return nullptr;
+  auto *cell = static_cast<GCCell *>(callee.getObject());
+  if (COBRA_UNLIKELY(cell->getKind() != MethodKind))
+    return nullptr;
+  return static_cast<Method *>(cell);
+}
+
+/// \return true if the strings \p x and \p y have the same contents.
+inline bool doStringEq(CBValue x, CBValue y) {
+  return static_cast<String *>(x.getPointer())
+      ->equals(static_cast<String *>(y.getPointer()));
+}
+
 
 }
 } 
@@ -8,10 +8,17 @@
 #include "cobra/VM/Interpreter.h"
 #include "cobra/Inst/Inst.h"
 #include "cobra/VM/Operations.h"
+#include "cobra/VM/Class.h"
+#include "cobra/VM/Runtime.h"
+#include "cobra/VM/JIT.h"
 #include "cobra/Support/Common.h"
 
 #include "Interpreter-inl.h"
 
+#if defined(COBRA_TAIL_CALL_INTERPRETER) && !defined(COBRA_MUSTTAIL)
+#error "The tail-call interpreter requires a compiler with musttail support"
+#endif
+
 using namespace cobra;
 using namespace vm;
 using namespace inst;
@@ -20,6 +27,9 @@ using namespace inst;
 // one.
 #define NEXTINST(name) ((const Inst *)(&ip->i##name + 1))
 
+// Add an arbitrary byte offset to ip.
+#define IPADD(val) ((const Inst *)((const uint8_t *)ip + (val)))
+
 #define REG(index) frameRegs[index]
 
 #define O1REG(name) REG(ip->i##name.op1)
@@ -29,6 +39,267 @@ using namespace inst;
 #define O5REG(name) REG(ip->i##name.op5)
 #define O6REG(name) REG(ip->i##name.op6)
 
+/// Hooks of the execution profiler, which compile to nothing unless the
+/// interpreter is built with COBRA_INTERPRETER_PROFILER.
+#ifdef COBRA_INTERPRETER_PROFILER
+#define PROFILE_INSTRUCTION() \
+  runtime->getInterpreterProfiler().onInstruction(ip->opCode)
+#define PROFILE_METHOD_ENTRY() \
+  runtime->getInterpreterProfiler().onMethodEntry(frame->getMethod())
+#define PROFILE_BACK_EDGE(offset) \
+  if ((offset) < 0)               \
+  runtime->getInterpreterProfiler().onBackEdge(frame->getMethod())
+#else
+#define PROFILE_INSTRUCTION()
+#define PROFILE_METHOD_ENTRY()
+#define PROFILE_BACK_EDGE(offset)
+#endif
+
+/// Hook of the sampling profiler, which remembers ip as the current
+/// instruction of the frame. It is only called on method entries, returns and
+/// taken jumps, so the sampled offset of the innermost frame is the last one
+/// of these, e.g. the back-edge of the loop it is running.
+#ifdef COBRA_SAMPLING_PROFILER
+#define SAMPLE_IP() frame->setSampledIP((const uint8_t *)ip)
+#else
+#define SAMPLE_IP()
+#endif
+
+/// Hook of the allocation sampler, which attributes the next allocation to
+/// the instruction at ip.
+#ifdef COBRA_ALLOCATION_SAMPLER
+#define SAMPLE_ALLOCATION_SITE()                      \
+  runtime->getAllocationSampler().setSite(            \
+      frame->getMethod(),                             \
+      (uint32_t)((const uint8_t *)ip - frame->getInstructions()))
+#else
+#define SAMPLE_ALLOCATION_SITE()
+#endif
+
+/// Run the method \p callee of the call instruction \p name on \p newFrame in
+/// compiled code, if it has some or just became hot, and continue after the
+/// call instruction. Once compiled code is nested too deeply on the native
+/// stack, the callee runs in this loop instead.
+#ifdef COBRA_ENABLE_JIT
+#define JIT_CALL(name, callee, newFrame)                            \
+  if (JIT::compileIfHot(callee) && runtime->canEnterNativeCall()) { \
+    if (COBRA_UNLIKELY(!(callee)->invokeCompiledCode(newFrame)))    \
+      UNWIND();                                                     \
+    ip = NEXTINST(name);                                            \
+    DISPATCH;                                                       \
+  }
+#else
+#define JIT_CALL(name, callee, newFrame)
+#endif
+
+/// Record \p message as the pending error of the runtime, and leave the
+/// interpreter through the unwind path.
+#define RAISE_ERROR(message)      \
+  do {                            \
+    runtime->raiseError(message); \
+    UNWIND();                     \
+  } while (0)
+
+#define STACK_OVERFLOW() RAISE_ERROR("stack overflow")
+
+#define OUT_OF_MEMORY() RAISE_ERROR("out of memory")
+
+/// Quicken the current instruction into the specialized opcode \p name.
+/// In adaptive mode this rewrites the bytecode in place, so that the next
+/// execution dispatches directly to the specialized handler.
+#ifdef COBRA_ENABLE_ADAPTIVE_INTERPRETER
+#define QUICKEN(name) patchOpCode(ip, OpCode::name)
+#else
+#define QUICKEN(name)
+#endif
+
+/// Turn a specialized instruction back into the generic opcode \p name and
+/// run the current instruction again with its handler, whose operands did not
+/// match the guess that was made when it was quickened. The instruction was
+/// already counted by the profiler, it is not counted again.
+#define DEQUICKEN(name)          \
+  patchOpCode(ip, OpCode::name); \
+  GOTO_HANDLER(name)
+
+/// The generic path of an arithmetic instruction, which converts the operands
+/// with ToNumber before applying \p oper.
+#define NUMBER_SLOW_PATH(name, oper)                                      \
+  O1REG(name) = CBValue::encodeUntrustedNumberValue(                      \
+      oper(toNumber(O2REG(name)), toNumber(O3REG(name))));                \
+  ip = NEXTINST(name);                                                    \
+  DISPATCH;
+
+/// The generic path of the additions, which concatenates the operands when
+/// either of them is a string.
+#define ADD_SLOW_PATH(name, oper)                                         \
+  SAMPLE_ALLOCATION_SITE();                                               \
+  if (COBRA_UNLIKELY(!addValues(                                          \
+          runtime->getHeap(), O2REG(name), O3REG(name), O1REG(name))))    \
+    OUT_OF_MEMORY();                                                      \
+  ip = NEXTINST(name);                                                    \
+  DISPATCH;
+
+/// Implement a generic arithmetic instruction and its numeric variant.
+/// The generic instruction quickens itself into \p name##N when both operands
+/// are numbers, the numeric variant only checks the operand tags.
+/// \param oper is the function implementing the operation on doubles.
+/// \param encode is the CBValue function used to box the result.
+/// \param slowPath is the macro implementing the instruction on operands
+/// that are not both numbers.
+#define BINOP(name, oper, encode, slowPath)                               \
+  CASE(name) {                                                            \
+    if (COBRA_LIKELY(                                                     \
+            O2REG(name).isNumber() && O3REG(name).isNumber())) {          \
+      QUICKEN(name##N);                                                   \
+      O1REG(name) = CBValue::encode(                                      \
+          oper(O2REG(name).getNumber(), O3REG(name).getNumber()));        \
+      ip = NEXTINST(name);                                                \
+      DISPATCH;                                                           \
+    }                                                                     \
+    slowPath(name, oper)                                                  \
+  }                                                                       \
+  CASE(name##N) {                                                         \
+    if (COBRA_UNLIKELY(                                                   \
+            !O2REG(name##N).isNumber() || !O3REG(name##N).isNumber())) {  \
+      DEQUICKEN(name);                                                    \
+    }                                                                     \
+    O1REG(name##N) = CBValue::encode(                                     \
+        oper(O2REG(name##N).getNumber(), O3REG(name##N).getNumber()));    \
+    ip = NEXTINST(name##N);                                               \
+    DISPATCH;                                                             \
+  }
+
+/// Implement the wide variant of the generic arithmetic instruction \p name.
+/// Wide variants are not quickened, they check the operand tags every time.
+#define WIDE_BINOP(name, oper, encode, slowPath)                            \
+  CASE(name##Wide) {                                                        \
+    if (COBRA_LIKELY(                                                       \
+            O2REG(name##Wide).isNumber() && O3REG(name##Wide).isNumber())) { \
+      O1REG(name##Wide) = CBValue::encode(oper(                             \
+          O2REG(name##Wide).getNumber(), O3REG(name##Wide).getNumber()));   \
+      ip = NEXTINST(name##Wide);                                            \
+      DISPATCH;                                                             \
+    }                                                                       \
+    slowPath(name##Wide, oper)                                              \
+  }
+
+/// Implement the int32 addition \p name, which takes the generic path of
+/// the additions when its operands or its sum are not int32.
+#define ADD_I32(name)                                                      \
+  CASE(name) {                                                             \
+    if (COBRA_LIKELY(doAddI32(O2REG(name), O3REG(name), O1REG(name)))) {   \
+      ip = NEXTINST(name);                                                 \
+      DISPATCH;                                                            \
+    }                                                                      \
+    ADD_SLOW_PATH(name, doAdd)                                             \
+  }
+
+/// Implement an instruction whose result is \p oper applied to the values of
+/// its two operand registers.
+#define VALUE_BINOP(name, oper)                                \
+  CASE(name) {                                                 \
+    O1REG(name) = oper(O2REG(name), O3REG(name));              \
+    ip = NEXTINST(name);                                       \
+    DISPATCH;                                                  \
+  }
+
+/// Implement a conditional jump to the first operand of the instruction
+/// \p name when \p cond holds.
+#define JCOND_IMPL(name, cond)            \
+  CASE(name) {                            \
+    if (cond) {                           \
+      PROFILE_BACK_EDGE(ip->i##name.op1); \
+      SAMPLE_IP();                        \
+      ip = IPADD(ip->i##name.op1);        \
+      DISPATCH;                           \
+    }                                     \
+    ip = NEXTINST(name);                  \
+    DISPATCH;                             \
+  }
+
+/// Implement the conditional jump \p name and its long and wide variants,
+/// which jump if \p neg \p pred(Arg2) holds. \p neg is either empty or '!'.
+#define JCOND1(name, neg, pred)                           \
+  JCOND_IMPL(name, neg pred(O2REG(name)))                 \
+  JCOND_IMPL(name##Long, neg pred(O2REG(name##Long)))     \
+  JCOND_IMPL(name##Wide, neg pred(O2REG(name##Wide)))
+
+/// Implement the compare-and-branch instruction \p name and its long and
+/// wide variants, which jump if \p neg \p pred(Arg2, Arg3) holds.
+#define JCOND2(name, neg, pred)                                       \
+  JCOND_IMPL(name, neg pred(O2REG(name), O3REG(name)))                \
+  JCOND_IMPL(name##Long, neg pred(O2REG(name##Long), O3REG(name##Long))) \
+  JCOND_IMPL(name##Wide, neg pred(O2REG(name##Wide), O3REG(name##Wide)))
+
+/// Call the method in the second operand of the call instruction \p name.
+/// Its \p argCount parameters (including 'this') must be the registers right
+/// below the top of the register stack. \p prevTop is the top of the register
+/// stack before the parameters were pushed. Raises an error if the operand is
+/// not a method.
+#define DO_CALL(name, argCount, prevTop)                                    \
+  {                                                                         \
+    assert((argCount) > 0 && "'this' must be passed");                      \
+    RegisterStack &stack = runtime->getRegisterStack();                     \
+    Method *callee = getCallee(O2REG(name));                                \
+    if (COBRA_UNLIKELY(callee == nullptr)) {                                \
+      stack.release(prevTop);                                               \
+      RAISE_ERROR("callee is not a function");                              \
+    }                                                                       \
+    StackFrame *newFrame = StackFrame::create(                              \
+        stack, frame, callee, (argCount) - 1, prevTop, &O1REG(name));       \
+    if (COBRA_UNLIKELY(newFrame == nullptr)) {                              \
+      stack.release(prevTop);                                               \
+      STACK_OVERFLOW();                                                     \
+    }                                                                       \
+    JIT_CALL(name, callee, newFrame);                                       \
+    newFrame->setReturnIP((const uint8_t *)NEXTINST(name));                 \
+    frame = newFrame;                                                       \
+    runtime->setCurrentFrame(frame);                                        \
+    frame->setInstructions(callee->getInstructions());                      \
+    ip = (const Inst *)frame->getInstructions();                            \
+    frameRegs = frame->getRegisters();                                      \
+    PROFILE_METHOD_ENTRY();                                                 \
+    SAMPLE_IP();                                                            \
+    DISPATCH;                                                               \
+  }
+
+/// Allocate \p argCount parameter registers at the top of the register
+/// stack, as \c params, and remember the previous top as \c prevTop.
+#define PUSH_PARAMS(argCount)                                       \
+  CBValue *prevTop = runtime->getRegisterStack().getTop();          \
+  CBValue *params = runtime->getRegisterStack().allocate(argCount); \
+  if (COBRA_UNLIKELY(params == nullptr))                            \
+    STACK_OVERFLOW();
+
+/// Pop the current frame, store \p value in the result register of the
+/// caller, and resume the caller after its call instruction.
+#define DO_RETURN(value)                                                    \
+  {                                                                         \
+    if (CBValue *resultReg = frame->getResult())                            \
+      *resultReg = (value);                                                 \
+    StackFrame *prevFrame = frame->getPrevFrame();                          \
+    const Inst *returnIP = (const Inst *)frame->getReturnIP();              \
+    bool isEntryFrame = frame == entryFrame;                                \
+    runtime->setCurrentFrame(prevFrame);                                    \
+    StackFrame::destroy(runtime->getRegisterStack(), frame);                \
+    if (isEntryFrame)                                                       \
+      return true;                                                          \
+    frame = prevFrame;                                                      \
+    frameRegs = frame->getRegisters();                                      \
+    ip = returnIP;                                                          \
+    SAMPLE_IP();                                                            \
+    DISPATCH;                                                               \
+  }
+
+/// Load a constant.
+/// \param value is the value to store in the output register.
+#define LOAD_CONST(name, value) \
+  CASE(name) {                  \
+    O1REG(name) = value;        \
+    ip = NEXTINST(name);        \
+    DISPATCH;                   \
+  }
+
 static bool isCallType(OpCode opcode) {
   switch (opcode) {
 #define DEFINE_RET_TARGET(name) \
@@ -41,29 +312,54 @@ static bool isCallType(OpCode opcode) {
 }
 
 bool Interpreter::execute(Method *method, uint32_t *args, uint32_t argCount) {
-  const char *desc = &(method->getShorty()[1]); // [0] is the return type.
-  while (*desc != '\0') {
-    switch (*(desc++)) {
-        // TODO
-    }
+  auto runtime = Runtime::getCurrent();
+  StackFrame *newFrame = StackFrame::createWithArgs(
+      runtime->getRegisterStack(),
+      runtime->getCurrentFrame(),
+      method,
+      args,
+      argCount);
+  if (newFrame == nullptr) {
+    runtime->raiseError("stack overflow");
+    return false;
   }
-  
-  auto frame = Runtime::getCurrent()->getCurrentFrame();
-  StackFrame *newFrame = StackFrame::create(frame, method, argCount);
   return execute(newFrame);
 }
 
 bool Interpreter::execute(StackFrame *frame) {
-  auto runtime = Runtime::getCurrent();
+#ifdef COBRA_ENABLE_JIT
+  if (JIT::compileIfHot(frame->getMethod()) &&
+      Runtime::getCurrent()->canEnterNativeCall())
+    return frame->getMethod()->invokeCompiledCode(frame);
+#endif
   
-  const uint8_t *insts = frame->getMethod()->getInstructions();
-  frame->setInstructions(insts);
+  frame->setInstructions(frame->getMethod()->getInstructions());
+  return run(frame);
+}
+
+/// Leave the interpreter after an error, such as a stack overflow or an
+/// exhausted heap.
+static bool unwind(Runtime *runtime, StackFrame *entryFrame) {
+  runtime->setCurrentFrame(entryFrame->getPrevFrame());
+  StackFrame::destroy(runtime->getRegisterStack(), entryFrame);
+  return false;
+}
+
+/// Run \p frame in a loop that jumps to the handler of the next instruction
+/// through a table of label addresses (computed goto).
+static bool runComputedGoto(StackFrame *frame) {
+  Runtime *runtime = Runtime::getCurrent();
   
-  const Inst *ip = (Inst const *)insts;
+  /// The frame this invocation of the interpreter was entered with, returning
+  /// from it returns from the interpreter.
+  StackFrame *const entryFrame = frame;
+  runtime->setCurrentFrame(frame);
   
-  CBValue *frameRegs;
+  const Inst *ip = (const Inst *)frame->getInstructions();
+  CBValue *frameRegs = frame->getRegisters();
   
-  CBValue* result;
+  PROFILE_METHOD_ENTRY();
+  SAMPLE_IP();
 
   static void *opcodeDispatch[] = {
 #define DEFINE_OPCODE(name) &&case_##name,
@@ -71,267 +367,100 @@ bool Interpreter::execute(StackFrame *frame) {
   };
   
 #define CASE(name) case_##name:
-
-#define DEFAULT_CASE
   
 #define DISPATCH                                \
+  PROFILE_INSTRUCTION();                        \
   goto *opcodeDispatch[(unsigned)ip->opCode]
   
+#define GOTO_HANDLER(name) goto case_##name
+  
+#define UNWIND() goto unwind
+  
   for (;;) {
-    goto *opcodeDispatch[(unsigned)ip->opCode];
+    DISPATCH;
     
-/// Load a constant.
-/// \param value is the value to store in the output register.
-#define LOAD_CONST(name, value) \
-  CASE(name) {                  \
-    O1REG(name) = value;        \
-    ip = NEXTINST(name);        \
-    DISPATCH;                   \
+#include "InterpreterHandlers.def"
   }
-    
-    DEFAULT_CASE
-    CASE(Unreachable) {
-      
-      DISPATCH;
-    }
-    
-    CASE(Class) {
-      
-      DISPATCH;
-    }
-    
-    CASE(NewObject) {
-      
-      DISPATCH;
-    }
-    
-    CASE(NewInstance) {
-      
-      DISPATCH;
-    }
-    
-    CASE(NewFunction) {
-      
-      DISPATCH;
-    }
-    
-    CASE(NewArray) {
-      
-      DISPATCH;
-    }
-    
-    CASE(Mov) {
-      
-      
-      DISPATCH;
-    }
-    
-    CASE(MovLong) {
-      
-      
-      DISPATCH;
-    }
-    
-    CASE(MovObject) {
-      
-      
-      DISPATCH;
-    }
-    
-    CASE(Eq) {
-      
-      
-      DISPATCH;
-    }
-    
-    CASE(Add) {
-      
-      
-      DISPATCH;
-    }
-    
-    CASE(AddN) {
-      O1REG(AddN) = CBValue::encodeTrustedNumberValue(
-          O2REG(Add).getNumber() + O3REG(Add).getNumber());
-      ip = NEXTINST(Add);
-      DISPATCH;
-    }
-    
-    CASE(Mul) {
-      
-      
-      DISPATCH;
-    }
-    
-    CASE(MulN) {
-      
-      
-      DISPATCH;
-    }
-    
-    CASE(Div) {
-      
-      
-      DISPATCH;
-    }
-    
-    CASE(DivN) {
-      
-      
-      DISPATCH;
-    }
-    
-    CASE(Mod) {
-      
-      
-      DISPATCH;
-    }
-    
-    CASE(ModN) {
-      O1REG(Mod) = CBValue::encodeUntrustedNumberValue(
-          doMod(O2REG(Mod).getNumber(), O3REG(Mod).getNumber()));
-      ip = NEXTINST(Mod);
-      DISPATCH;
-      
-      DISPATCH;
-    }
-    
-    CASE(Sub) {
-      
-      
-      DISPATCH;
-    }
-    
-    CASE(SubN) {
-      
-      
-      DISPATCH;
-    }
-    
-    CASE(GetField) {
-      
-      DISPATCH;
-    }
-    
-    CASE(SetField) {
-      
-      DISPATCH;
-    }
-    
-    CASE(Call) {
-      
-      DISPATCH;
-    }
-    
-    CASE(Call1) {
-      
-      DISPATCH;
-    }
-    
-    CASE(Call2) {
-      
-      DISPATCH;
-    }
-    
-    CASE(Call3) {
-      
-      DISPATCH;
-    }
-    
-    CASE(Call4) {
-      
-      DISPATCH;
-    }
-    
-    CASE(Ret) {
-      
-      DISPATCH;
-    }
-    
-    CASE(RetObject) {
-      
-      DISPATCH;
-    }
-    
-    CASE(RetVoid) {
-      
-      DISPATCH;
-    }
-    
-    CASE(ToNumber) {
-      
-      DISPATCH;
-    }
-    
-    CASE(ToString) {
-      
-      DISPATCH;
-    }
-    
-    CASE(LoadConstString) {
-      
-      DISPATCH;
-    }
-    
-    LOAD_CONST(
-        LoadConstUInt8,
-        CBValue::encodeTrustedNumberValue(ip->iLoadConstUInt8.op2));
-    
-    LOAD_CONST(
-        LoadConstInt,
-        CBValue::encodeTrustedNumberValue(ip->iLoadConstInt.op2));
-    
-    LOAD_CONST(
-        LoadConstDouble,
-        CBValue::encodeTrustedNumberValue(ip->iLoadConstDouble.op2));
-    
-    LOAD_CONST(LoadConstEmpty, CBValue::encodeEmptyValue());
-    LOAD_CONST(LoadConstUndefined, CBValue::encodeUndefinedValue());
-    LOAD_CONST(LoadConstNull, CBValue::encodeNullValue());
-    LOAD_CONST(LoadConstTrue, CBValue::encodeBoolValue(true));
-    LOAD_CONST(LoadConstFalse, CBValue::encodeBoolValue(false));
-    LOAD_CONST(LoadConstZero, CBValue::encodeTrustedNumberValue(0));
-    
-    CASE(LoadParam) {
-      if (COBRA_LIKELY(ip->iLoadParam.op2 <= frame->getArgCount())) {
-        ip = NEXTINST(LoadParam);
-        DISPATCH;
-      }
-      O1REG(LoadParam) = CBValue::encodeUndefinedValue();
-      ip = NEXTINST(LoadParam);
-      DISPATCH;
-    }
-    
-    CASE(Jmp) {
-      
-      DISPATCH;
-    }
-    
-    CASE(JmpLong) {
-      
-      DISPATCH;
-    }
-    
-    CASE(JmpTrue) {
+  
+unwind:
+  return unwind(runtime, entryFrame);
+  
+#undef CASE
+#undef DISPATCH
+#undef GOTO_HANDLER
+#undef UNWIND
+}
 
-      DISPATCH;
-    }
-    
-    CASE(JmpTrueLong) {
-      
-      DISPATCH;
-    }
-    
-    CASE(JmpFalse) {
+#ifdef COBRA_MUSTTAIL
 
-      DISPATCH;
-    }
-    
-    CASE(JmpFalseLong) {
+namespace {
 
-      DISPATCH;
-    }
+/// Every handler of the tail-call interpreter takes the interpreter state as
+/// arguments, and passes it on to the handler of the next instruction with a
+/// guaranteed tail call. The state thus stays in argument registers across
+/// handlers, instead of being spilled around a dispatch loop.
+#define HANDLER_PARAMS                                         \
+  const Inst *ip, CBValue *frameRegs, StackFrame *frame,       \
+      StackFrame *const entryFrame, Runtime *const runtime
 
-  }
+using Handler = bool (*)(HANDLER_PARAMS);
+
+#define DEFINE_OPCODE(name) bool handle##name(HANDLER_PARAMS);
+#include "cobra/BCGen/BytecodeList.def"
 
+const Handler handlers[] = {
+#define DEFINE_OPCODE(name) handle##name,
+#include "cobra/BCGen/BytecodeList.def"
+};
+
+#define CASE(name) bool handle##name(HANDLER_PARAMS)
+
+#define DISPATCH                                                \
+  PROFILE_INSTRUCTION();                                        \
+  COBRA_MUSTTAIL return handlers[(unsigned)ip->opCode](         \
+      ip, frameRegs, frame, entryFrame, runtime)
+
+#define GOTO_HANDLER(name)                                      \
+  COBRA_MUSTTAIL return handle##name(                           \
+      ip, frameRegs, frame, entryFrame, runtime)
+
+#define UNWIND() return unwind(runtime, entryFrame)
+
+#include "InterpreterHandlers.def"
+
+#undef CASE
+#undef DISPATCH
+#undef GOTO_HANDLER
+#undef UNWIND
+#undef HANDLER_PARAMS
+
+} // namespace
+
+/// Run \p frame with one function per instruction handler, each of which tail
+/// calls the handler of the next instruction.
+static bool runTailCall(StackFrame *frame) {
+  Runtime *runtime = Runtime::getCurrent();
+  runtime->setCurrentFrame(frame);
+  
+  const Inst *ip = (const Inst *)frame->getInstructions();
+  
+  PROFILE_METHOD_ENTRY();
+  SAMPLE_IP();
+  PROFILE_INSTRUCTION();
+  return handlers[(unsigned)ip->opCode](
+      ip, frame->getRegisters(), frame, frame, runtime);
+}
+
+#endif // COBRA_MUSTTAIL
+
+bool Interpreter::run(StackFrame *frame, Dispatch dispatch) {
+  switch (dispatch) {
+    case Dispatch::ComputedGoto:
+      return runComputedGoto(frame);
+#ifdef COBRA_MUSTTAIL
+    case Dispatch::TailCall:
+      return runTailCall(frame);
+#endif
+  }
+  COBRA_UNREACHABLE();
 }
@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifdef COBRA_INTERPRETER_PROFILER
+
+#include "cobra/VM/InterpreterProfiler.h"
+#include "cobra/VM/Method.h"
+
+#include <algorithm>
+#include <tuple>
+
+using namespace cobra;
+using namespace vm;
+
+static const char *opCodeNames[] = {
+#define DEFINE_OPCODE(name) #name,
+#include "cobra/BCGen/BytecodeList.def"
+};
+
+void InterpreterProfiler::reset() {
+  std::fill(std::begin(opCodeCounts_), std::end(opCodeCounts_), 0);
+  std::fill(pairCounts_.begin(), pairCounts_.end(), 0);
+  prevOpCode_ = kNumOpCodes;
+  methodCounters_.clear();
+}
+
+void InterpreterProfiler::dumpJSON(std::ostream &os) const {
+  os << "{\n  \"opcodes\": {";
+  std::vector<std::pair<uint64_t, unsigned>> opCodes;
+  for (unsigned op = 0; op < kNumOpCodes; ++op) {
+    if (opCodeCounts_[op])
+      opCodes.emplace_back(opCodeCounts_[op], op);
+  }
+  std::sort(opCodes.rbegin(), opCodes.rend());
+  const char *sep = "\n";
+  for (auto &entry : opCodes) {
+    os << sep << "    \"" << opCodeNames[entry.second] << "\": " << entry.first;
+    sep = ",\n";
+  }
+  os << "\n  },\n  \"pairs\": [";
+  
+  std::vector<std::pair<uint64_t, unsigned>> pairs;
+  for (unsigned i = 0, e = pairCounts_.size(); i < e; ++i) {
+    if (pairCounts_[i])
+      pairs.emplace_back(pairCounts_[i], i);
+  }
+  std::sort(pairs.rbegin(), pairs.rend());
+  sep = "\n";
+  for (auto &entry : pairs) {
+    os << sep << "    {\"first\": \"" << opCodeNames[entry.second / kNumOpCodes]
+       << "\", \"second\": \"" << opCodeNames[entry.second % kNumOpCodes]
+       << "\", \"count\": " << entry.first << "}";
+    sep = ",\n";
+  }
+  os << "\n  ],\n  \"methods\": [";
+  
+  std::vector<std::tuple<uint64_t, uint64_t, Method *>> methods;
+  for (auto &entry : methodCounters_) {
+    methods.emplace_back(
+        entry.second.entries, entry.second.backEdges, entry.first);
+  }
+  std::sort(methods.rbegin(), methods.rend());
+  sep = "\n";
+  for (auto &entry : methods) {
+    os << sep << "    {\"index\": " << std::get<2>(entry)->getMethodIndex()
+       << ", \"entries\": " << std::get<0>(entry)
+       << ", \"backEdges\": " << std::get<1>(entry) << "}";
+    sep = ",\n";
+  }
+  os << "\n  ]\n}\n";
+}
+
+#endif // COBRA_INTERPRETER_PROFILER
@@ -0,0 +1,906 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifdef COBRA_ENABLE_JIT
+
+#include "cobra/VM/JIT.h"
+#include "cobra/VM/X86_64Assembler.h"
+#include "cobra/VM/Interpreter.h"
+#include "cobra/Support/OSCompat.h"
+
+#include "Interpreter-inl.h"
+
+#include <initializer_list>
+#include <map>
+#include <type_traits>
+#include <vector>
+
+using namespace cobra;
+using namespace vm;
+using namespace inst;
+
+using Asm = X86_64Assembler;
+
+// Helpers take and return CBValues in general purpose registers, exactly like
+// the raw 64-bit words the templates load from the frame.
+static_assert(
+    std::is_trivially_copyable<CBValue>::value &&
+        sizeof(CBValue) == sizeof(uint64_t),
+    "CBValue must be passed as a 64-bit integer");
+
+namespace {
+
+/// Size in bytes of every instruction, indexed by opcode.
+constexpr uint8_t kInstSizes[] = {
+#define DEFINE_OPCODE(name) sizeof(name##Inst),
+#include "cobra/BCGen/BytecodeList.def"
+};
+
+/// Registers pinned by compiled code, both callee-saved.
+constexpr Asm::Reg kFrameReg = Asm::R12;
+constexpr Asm::Reg kRegsReg = Asm::RBX;
+
+/// Raw values at or above this one are not numbers.
+constexpr uint64_t kFirstNonNumber =
+    (uint64_t)CBValue::Tag::First << CBValue::kNumDataBits;
+
+/// Out-of-line helper implementing a whole instruction on the frame.
+/// \return false when the stack or the heap is exhausted.
+using InstHelper = bool (*)(StackFrame *frame, CBValue *regs, const Inst *ip);
+
+#define SLOW_BINOP(name, oper)                          \
+  CBValue name##SlowPath(CBValue x, CBValue y) {        \
+    return CBValue::encodeUntrustedNumberValue(         \
+        oper(toNumber(x), toNumber(y)));                \
+  }
+
+SLOW_BINOP(sub, doSub)
+SLOW_BINOP(mul, doMul)
+SLOW_BINOP(div, doDiv)
+SLOW_BINOP(mod, doMod)
+
+CBValue eqHelper(CBValue x, CBValue y) {
+  return CBValue::encodeBoolValue(strictEqualityTest(x, y));
+}
+
+void setResultHelper(StackFrame *frame, CBValue value) {
+  if (CBValue *resultReg = frame->getResult())
+    *resultReg = value;
+}
+
+/// The slow path of Add and its variants, which have the same layout. It
+/// concatenates strings, so it allocates.
+bool addHelper(StackFrame *frame, CBValue *regs, const Inst *ip) {
+  Runtime *runtime = Runtime::getCurrent();
+  if (COBRA_UNLIKELY(!addValues(
+          runtime->getHeap(),
+          regs[ip->iAdd.op2],
+          regs[ip->iAdd.op3],
+          regs[ip->iAdd.op1]))) {
+    runtime->raiseError("out of memory");
+    return false;
+  }
+  return true;
+}
+
+bool addWideHelper(StackFrame *frame, CBValue *regs, const Inst *ip) {
+  Runtime *runtime = Runtime::getCurrent();
+  if (COBRA_UNLIKELY(!addValues(
+          runtime->getHeap(),
+          regs[ip->iAddWide.op2],
+          regs[ip->iAddWide.op3],
+          regs[ip->iAddWide.op1]))) {
+    runtime->raiseError("out of memory");
+    return false;
+  }
+  return true;
+}
+
+bool loadParamHelper(StackFrame *frame, CBValue *regs, const Inst *ip) {
+  if (COBRA_LIKELY(ip->iLoadParam.op2 <= frame->getArgCount())) {
+    regs[ip->iLoadParam.op1] = frame->getParam(ip->iLoadParam.op2);
+  } else {
+    regs[ip->iLoadParam.op1] = CBValue::encodeUndefinedValue();
+  }
+  return true;
+}
+
+bool loadParamWideHelper(StackFrame *frame, CBValue *regs, const Inst *ip) {
+  if (COBRA_LIKELY(ip->iLoadParamWide.op2 <= frame->getArgCount())) {
+    regs[ip->iLoadParamWide.op1] = frame->getParam(ip->iLoadParamWide.op2);
+  } else {
+    regs[ip->iLoadParamWide.op1] = CBValue::encodeUndefinedValue();
+  }
+  return true;
+}
+
+bool getFieldHelper(StackFrame *frame, CBValue *regs, const Inst *ip) {
+  regs[ip->iGetField.op1] = doGetField(
+      Runtime::getCurrent(),
+      frame->getMethod(),
+      regs[ip->iGetField.op2],
+      ip->iGetField.op3,
+      ip->iGetField.op4);
+  return true;
+}
+
+bool setFieldHelper(StackFrame *frame, CBValue *regs, const Inst *ip) {
+  doSetField(
+      Runtime::getCurrent(),
+      frame->getMethod(),
+      regs[ip->iSetField.op1],
+      regs[ip->iSetField.op2],
+      ip->iSetField.op3,
+      ip->iSetField.op4);
+  return true;
+}
+
+/// Call \p callee, whose \p argCount parameters (including 'this') are right
+/// below the top of the register stack, and store its return value in
+/// \p result. \p prevTop is the top of the stack before the parameters were
+/// pushed. The callee runs in the interpreter, or in its compiled code if it
+/// has some. Raises an error if \p callee is not a method.
+bool doCall(
+    StackFrame *frame,
+    CBValue *result,
+    CBValue callee,
+    uint32_t argCount,
+    CBValue *prevTop) {
+  Runtime *runtime = Runtime::getCurrent();
+  RegisterStack &stack = runtime->getRegisterStack();
+  Method *method = getCallee(callee);
+  if (COBRA_UNLIKELY(method == nullptr)) {
+    stack.release(prevTop);
+    runtime->raiseError("callee is not a function");
+    return false;
+  }
+  StackFrame *newFrame = StackFrame::create(
+      stack, frame, method, argCount - 1, prevTop, result);
+  if (COBRA_UNLIKELY(newFrame == nullptr)) {
+    stack.release(prevTop);
+    runtime->raiseError("stack overflow");
+    return false;
+  }
+  return Interpreter::execute(newFrame);
+}
+
+/// Push \p args as parameters, 'this' first, then call \p callee.
+bool pushParamsAndCall(
+    StackFrame *frame,
+    CBValue *result,
+    CBValue callee,
+    std::initializer_list<CBValue> args) {
+  Runtime *runtime = Runtime::getCurrent();
+  RegisterStack &stack = runtime->getRegisterStack();
+  CBValue *prevTop = stack.getTop();
+  CBValue *params = stack.allocate(args.size());
+  if (COBRA_UNLIKELY(params == nullptr)) {
+    runtime->raiseError("stack overflow");
+    return false;
+  }
+  // The parameters are in reverse order.
+  uint32_t idx = args.size();
+  for (CBValue arg : args)
+    params[--idx] = arg;
+  return doCall(frame, result, callee, args.size(), prevTop);
+}
+
+bool callHelper(StackFrame *frame, CBValue *regs, const Inst *ip) {
+  // The parameters are the last registers of the current frame, which end at
+  // the top of the register stack.
+  return doCall(
+      frame,
+      &regs[ip->iCall.op1],
+      regs[ip->iCall.op2],
+      ip->iCall.op3,
+      Runtime::getCurrent()->getRegisterStack().getTop());
+}
+
+bool call1Helper(StackFrame *frame, CBValue *regs, const Inst *ip) {
+  return pushParamsAndCall(
+      frame, &regs[ip->iCall1.op1], regs[ip->iCall1.op2],
+      {regs[ip->iCall1.op3]});
+}
+
+bool call2Helper(StackFrame *frame, CBValue *regs, const Inst *ip) {
+  return pushParamsAndCall(
+      frame, &regs[ip->iCall2.op1], regs[ip->iCall2.op2],
+      {regs[ip->iCall2.op3], regs[ip->iCall2.op4]});
+}
+
+bool call3Helper(StackFrame *frame, CBValue *regs, const Inst *ip) {
+  return pushParamsAndCall(
+      frame, &regs[ip->iCall3.op1], regs[ip->iCall3.op2],
+      {regs[ip->iCall3.op3], regs[ip->iCall3.op4], regs[ip->iCall3.op5]});
+}
+
+bool call4Helper(StackFrame *frame, CBValue *regs, const Inst *ip) {
+  return pushParamsAndCall(
+      frame, &regs[ip->iCall4.op1], regs[ip->iCall4.op2],
+      {regs[ip->iCall4.op3], regs[ip->iCall4.op4], regs[ip->iCall4.op5],
+       regs[ip->iCall4.op6]});
+}
+
+/// Translates the bytecode of one method to machine code, one template per
+/// instruction. Compiled code is entered with the frame in rdi and its
+/// registers in rsi, which stay in r12 and rbx for the whole method.
+class TemplateCompiler {
+public:
+  explicit TemplateCompiler(Method *method)
+      : insts_(method->getInstructions()) {}
+
+  /// \return the entry point of the compiled code, null if the method uses an
+  /// instruction without a template. The code takes \p size bytes of pages.
+  JITCompiledCode compile(size_t &size);
+
+private:
+  const uint8_t *insts_;
+
+  Asm asm_{};
+
+  /// Native offset of every reachable instruction, by bytecode offset.
+  std::map<uint32_t, size_t> labels_{};
+
+  /// Branch displacements to patch, with the bytecode offset they target.
+  std::vector<std::pair<size_t, uint32_t>> branches_{};
+
+  /// Branch displacements to patch to the normal exit.
+  std::vector<size_t> returnExits_{};
+
+  /// Branch displacements to patch to the failure exit, taken when the stack
+  /// or the heap is exhausted.
+  std::vector<size_t> failureExits_{};
+
+  /// Find every instruction reachable from the method entry. Bytecode has no
+  /// explicit end, so the code is discovered by following branches.
+  /// \return false if an invalid opcode is found.
+  bool findInstructions();
+
+  /// Emit the template of every instruction.
+#define DEFINE_OPCODE(name) bool emit##name(const Inst *ip);
+#include "cobra/BCGen/BytecodeList.def"
+
+  static int32_t regOffset(uint32_t reg) {
+    return reg * sizeof(CBValue);
+  }
+
+  uint32_t offsetOf(const Inst *ip) const {
+    return (const uint8_t *)ip - insts_;
+  }
+
+  void loadReg(Asm::Reg dst, uint32_t reg) {
+    asm_.load(dst, kRegsReg, regOffset(reg));
+  }
+
+  void storeReg(uint32_t reg, Asm::Reg src) {
+    asm_.store(kRegsReg, regOffset(reg), src);
+  }
+
+  template <typename Fn>
+  void emitHelperCall(Fn *fn) {
+    asm_.movImm(Asm::RAX, reinterpret_cast<uintptr_t>(fn));
+    asm_.call(Asm::RAX);
+  }
+
+  void emitInstHelperCall(InstHelper fn, const Inst *ip) {
+    asm_.mov(Asm::RDI, kFrameReg);
+    asm_.mov(Asm::RSI, kRegsReg);
+    asm_.movImm(Asm::RDX, reinterpret_cast<uintptr_t>(ip));
+    emitHelperCall(fn);
+  }
+
+  /// Leave through the failure exit if the helper returned false.
+  void exitOnFailure() {
+    asm_.testAL();
+    failureExits_.push_back(asm_.jcc(Asm::Equal));
+  }
+
+  void jumpTo(const Inst *ip, int32_t offset) {
+    branches_.emplace_back(asm_.jmp(), offsetOf(ip) + offset);
+  }
+
+  void branchTo(Asm::Cond cond, const Inst *ip, int32_t offset) {
+    branches_.emplace_back(asm_.jcc(cond), offsetOf(ip) + offset);
+  }
+
+  void emitMov(uint32_t dst, uint32_t src) {
+    loadReg(Asm::RAX, src);
+    storeReg(dst, Asm::RAX);
+  }
+
+  void emitLoadConst(uint32_t dst, CBValue value) {
+    asm_.movImm(Asm::RAX, value.getRaw());
+    storeReg(dst, Asm::RAX);
+  }
+
+  /// dst = slowPath(x, y)
+  void emitBinaryHelper(
+      uint32_t dst,
+      uint32_t x,
+      uint32_t y,
+      CBValue (*slowPath)(CBValue, CBValue));
+
+  /// Compute \p op on the doubles in \p x and \p y into rax, leaving the
+  /// operands in rax and rcx and adding the branches taken when one of them
+  /// is not a number to \p notNumber.
+  void emitNumberArithmetic(
+      uint32_t x,
+      uint32_t y,
+      Asm::SSEOp op,
+      std::vector<size_t> &notNumber);
+
+  /// Arithmetic on doubles inline, or through \p slowPath if an operand is
+  /// not a number.
+  void emitArithmetic(
+      uint32_t dst,
+      uint32_t x,
+      uint32_t y,
+      Asm::SSEOp op,
+      CBValue (*slowPath)(CBValue, CBValue));
+
+  /// Addition of doubles inline, or through the instruction helper
+  /// \p slowPath, which may fail, if an operand is not a number.
+  void emitAddition(
+      const Inst *ip,
+      uint32_t dst,
+      uint32_t x,
+      uint32_t y,
+      InstHelper slowPath);
+
+  /// Jump to \p offset if \p pred(x, y) is \p expected.
+  void emitCompareBranch(
+      const Inst *ip,
+      int32_t offset,
+      uint32_t x,
+      uint32_t y,
+      bool (*pred)(CBValue, CBValue),
+      bool expected);
+
+  /// Compare the numbers in \p lhs and \p rhs and jump to \p offset on
+  /// \p cond. Unordered comparisons set CF and ZF, so the conditions of the
+  /// negated comparisons, which hold for NaN, are Below and BelowEqual.
+  void emitNumberCompareBranch(
+      const Inst *ip,
+      int32_t offset,
+      uint32_t lhs,
+      uint32_t rhs,
+      Asm::Cond cond) {
+    asm_.movsd(Asm::XMM0, kRegsReg, regOffset(lhs));
+    asm_.ucomisd(Asm::XMM0, kRegsReg, regOffset(rhs));
+    branchTo(cond, ip, offset);
+  }
+
+  /// Restore the callee-saved registers and return \p result.
+  void emitEpilogue(bool result) {
+    asm_.movImm(Asm::RAX, result);
+    asm_.pop(kFrameReg);
+    asm_.pop(kRegsReg);
+    asm_.pop(Asm::RBP);
+    asm_.ret();
+  }
+};
+
+bool TemplateCompiler::findInstructions() {
+  std::vector<uint32_t> worklist{0};
+  while (!worklist.empty()) {
+    uint32_t offset = worklist.back();
+    worklist.pop_back();
+    while (!labels_.count(offset)) {
+      labels_[offset] = 0;
+      auto *ip = (const Inst *)(insts_ + offset);
+      if ((unsigned)ip->opCode >= (unsigned)OpCode::_last)
+        return false;
+
+      switch (ip->opCode) {
+#define DEFINE_JUMP_LONG_VARIANT(name, nameLong)          \
+  case OpCode::name:                                      \
+    worklist.push_back(offset + ip->i##name.op1);         \
+    break;                                                \
+  case OpCode::nameLong:                                  \
+    worklist.push_back(offset + ip->i##nameLong.op1);     \
+    break;
+#define DEFINE_JUMP_WIDE_VARIANT(name, nameWide)          \
+  case OpCode::nameWide:                                  \
+    worklist.push_back(offset + ip->i##nameWide.op1);     \
+    break;
+#include "cobra/BCGen/BytecodeList.def"
+        default:
+          break;
+      }
+
+      switch (ip->opCode) {
+        case OpCode::Jmp:
+        case OpCode::JmpLong:
+        case OpCode::Ret:
+        case OpCode::RetWide:
+        case OpCode::RetObject:
+        case OpCode::RetVoid:
+        case OpCode::Unreachable:
+          break;
+        default:
+          offset += kInstSizes[(unsigned)ip->opCode];
+          continue;
+      }
+      break;
+    }
+  }
+  return true;
+}
+
+JITCompiledCode TemplateCompiler::compile(size_t &size) {
+  if (!findInstructions())
+    return nullptr;
+
+  asm_.push(Asm::RBP);
+  asm_.mov(Asm::RBP, Asm::RSP);
+  asm_.push(kRegsReg);
+  asm_.push(kFrameReg);
+  asm_.mov(kFrameReg, Asm::RDI);
+  asm_.mov(kRegsReg, Asm::RSI);
+
+  // Instructions are emitted in bytecode order, so an instruction that does
+  // not end with a jump falls through to its successor.
+  for (auto &label : labels_) {
+    label.second = asm_.size();
+    auto *ip = (const Inst *)(insts_ + label.first);
+    bool supported = false;
+    switch (ip->opCode) {
+#define DEFINE_OPCODE(name)       \
+  case OpCode::name:              \
+    supported = emit##name(ip);   \
+    break;
+#include "cobra/BCGen/BytecodeList.def"
+      default:
+        break;
+    }
+    if (!supported)
+      return nullptr;
+  }
+
+  for (size_t pos : returnExits_)
+    asm_.bind(pos);
+  emitEpilogue(true);
+  for (size_t pos : failureExits_)
+    asm_.bind(pos);
+  emitEpilogue(false);
+
+  for (auto &branch : branches_)
+    asm_.patch(branch.first, labels_[branch.second]);
+
+  // The code is written while the pages are writable, and only then made
+  // executable, so they are never writable and executable at the same time.
+  size = alignTo(asm_.size(), oscompat::page_size());
+  void *code = oscompat::vm_allocate(size);
+  if (code == nullptr)
+    return nullptr;
+  memcpy(code, asm_.data(), asm_.size());
+  if (!oscompat::vm_protect(code, size, oscompat::ProtectMode::ReadExecute)) {
+    oscompat::vm_free(code, size);
+    return nullptr;
+  }
+  return reinterpret_cast<JITCompiledCode>(code);
+}
+
+void TemplateCompiler::emitBinaryHelper(
+    uint32_t dst,
+    uint32_t x,
+    uint32_t y,
+    CBValue (*slowPath)(CBValue, CBValue)) {
+  loadReg(Asm::RDI, x);
+  loadReg(Asm::RSI, y);
+  emitHelperCall(slowPath);
+  storeReg(dst, Asm::RAX);
+}
+
+void TemplateCompiler::emitNumberArithmetic(
+    uint32_t x,
+    uint32_t y,
+    Asm::SSEOp op,
+    std::vector<size_t> &notNumber) {
+  loadReg(Asm::RAX, x);
+  loadReg(Asm::RCX, y);
+  asm_.movImm(Asm::RDX, kFirstNonNumber);
+  asm_.cmp(Asm::RAX, Asm::RDX);
+  notNumber.push_back(asm_.jcc(Asm::AboveEqual));
+  asm_.cmp(Asm::RCX, Asm::RDX);
+  notNumber.push_back(asm_.jcc(Asm::AboveEqual));
+  asm_.movq(Asm::XMM0, Asm::RAX);
+  asm_.movq(Asm::XMM1, Asm::RCX);
+  asm_.sse(op, Asm::XMM0, Asm::XMM1);
+  asm_.movq(Asm::RAX, Asm::XMM0);
+}
+
+void TemplateCompiler::emitArithmetic(
+    uint32_t dst,
+    uint32_t x,
+    uint32_t y,
+    Asm::SSEOp op,
+    CBValue (*slowPath)(CBValue, CBValue)) {
+  std::vector<size_t> notNumber;
+  emitNumberArithmetic(x, y, op, notNumber);
+  size_t done = asm_.jmp();
+
+  for (size_t pos : notNumber)
+    asm_.bind(pos);
+  asm_.mov(Asm::RDI, Asm::RAX);
+  asm_.mov(Asm::RSI, Asm::RCX);
+  emitHelperCall(slowPath);
+
+  asm_.bind(done);
+  storeReg(dst, Asm::RAX);
+}
+
+void TemplateCompiler::emitAddition(
+    const Inst *ip,
+    uint32_t dst,
+    uint32_t x,
+    uint32_t y,
+    InstHelper slowPath) {
+  std::vector<size_t> notNumber;
+  emitNumberArithmetic(x, y, Asm::AddSD, notNumber);
+  storeReg(dst, Asm::RAX);
+  size_t done = asm_.jmp();
+
+  for (size_t pos : notNumber)
+    asm_.bind(pos);
+  emitInstHelperCall(slowPath, ip);
+  exitOnFailure();
+
+  asm_.bind(done);
+}
+
+void TemplateCompiler::emitCompareBranch(
+    const Inst *ip,
+    int32_t offset,
+    uint32_t x,
+    uint32_t y,
+    bool (*pred)(CBValue, CBValue),
+    bool expected) {
+  loadReg(Asm::RDI, x);
+  loadReg(Asm::RSI, y);
+  emitHelperCall(pred);
+  asm_.testAL();
+  branchTo(expected ? Asm::NotEqual : Asm::Equal, ip, offset);
+}
+
+} // namespace
+
+// Instructions that are not implemented by the interpreter either.
+#define UNSUPPORTED(name)                                  \
+  bool TemplateCompiler::emit##name(const Inst *ip) {      \
+    return false;                                          \
+  }
+
+UNSUPPORTED(Unreachable)
+UNSUPPORTED(Class)
+UNSUPPORTED(NewObject)
+UNSUPPORTED(NewArray)
+UNSUPPORTED(NewInstance)
+UNSUPPORTED(NewFunction)
+UNSUPPORTED(LoadConstString)
+UNSUPPORTED(ToNumber)
+UNSUPPORTED(ToString)
+
+#define MOV(name)                                          \
+  bool TemplateCompiler::emit##name(const Inst *ip) {      \
+    emitMov(ip->i##name.op1, ip->i##name.op2);             \
+    return true;                                           \
+  }
+
+MOV(Mov)
+MOV(MovLong)
+MOV(MovObject)
+
+/// The verifier proved that the parameter is declared, and frames hold at
+/// least the declared parameters, right below the frame header.
+#define LOAD_PARAM_UNCHECKED(name)                         \
+  bool TemplateCompiler::emit##name(const Inst *ip) {      \
+    asm_.load(                                             \
+        Asm::RAX,                                          \
+        kFrameReg,                                         \
+        -(int32_t)sizeof(CBValue) * (1 + ip->i##name.op2)); \
+    storeReg(ip->i##name.op1, Asm::RAX);                   \
+    return true;                                           \
+  }
+
+LOAD_PARAM_UNCHECKED(LoadParamUnchecked)
+LOAD_PARAM_UNCHECKED(LoadParamWideUnchecked)
+
+#define LOAD_CONST(name, value)                            \
+  bool TemplateCompiler::emit##name(const Inst *ip) {      \
+    emitLoadConst(ip->i##name.op1, value);                 \
+    return true;                                           \
+  }
+
+LOAD_CONST(
+    LoadConstUInt8,
+    CBValue::encodeTrustedNumberValue(ip->iLoadConstUInt8.op2))
+LOAD_CONST(
+    LoadConstInt,
+    CBValue::encodeTrustedNumberValue(ip->iLoadConstInt.op2))
+LOAD_CONST(
+    LoadConstDouble,
+    CBValue::encodeTrustedNumberValue(ip->iLoadConstDouble.op2))
+LOAD_CONST(LoadConstEmpty, CBValue::encodeEmptyValue())
+LOAD_CONST(LoadConstUndefined, CBValue::encodeUndefinedValue())
+LOAD_CONST(LoadConstNull, CBValue::encodeNullValue())
+LOAD_CONST(LoadConstTrue, CBValue::encodeBoolValue(true))
+LOAD_CONST(LoadConstFalse, CBValue::encodeBoolValue(false))
+LOAD_CONST(LoadConstZero, CBValue::encodeTrustedNumberValue(0))
+LOAD_CONST(
+    LoadConstUInt8Wide,
+    CBValue::encodeTrustedNumberValue(ip->iLoadConstUInt8Wide.op2))
+LOAD_CONST(
+    LoadConstDoubleWide,
+    CBValue::encodeTrustedNumberValue(ip->iLoadConstDoubleWide.op2))
+LOAD_CONST(LoadConstZeroWide, CBValue::encodeTrustedNumberValue(0))
+
+/// The generic, the numeric and the wide variant of an arithmetic instruction
+/// share the template: the type guard is cheap once compiled, and it cannot
+/// deoptimize.
+#define ARITHMETIC(name, op, slowPath)                                \
+  bool TemplateCompiler::emit##name(const Inst *ip) {                 \
+    emitArithmetic(                                                   \
+        ip->i##name.op1, ip->i##name.op2, ip->i##name.op3, op, slowPath); \
+    return true;                                                      \
+  }                                                                   \
+  bool TemplateCompiler::emit##name##N(const Inst *ip) {              \
+    return emit##name(ip);                                            \
+  }                                                                   \
+  bool TemplateCompiler::emit##name##Wide(const Inst *ip) {           \
+    emitArithmetic(                                                   \
+        ip->i##name##Wide.op1, ip->i##name##Wide.op2,                 \
+        ip->i##name##Wide.op3, op, slowPath);                         \
+    return true;                                                      \
+  }
+
+/// Add concatenates strings, so its slow path allocates and may fail.
+bool TemplateCompiler::emitAdd(const Inst *ip) {
+  emitAddition(ip, ip->iAdd.op1, ip->iAdd.op2, ip->iAdd.op3, addHelper);
+  return true;
+}
+
+bool TemplateCompiler::emitAddN(const Inst *ip) {
+  return emitAdd(ip);
+}
+
+bool TemplateCompiler::emitAddWide(const Inst *ip) {
+  emitAddition(
+      ip, ip->iAddWide.op1, ip->iAddWide.op2, ip->iAddWide.op3,
+      addWideHelper);
+  return true;
+}
+
+ARITHMETIC(Sub, Asm::SubSD, subSlowPath)
+ARITHMETIC(Mul, Asm::MulSD, mulSlowPath)
+ARITHMETIC(Div, Asm::DivSD, divSlowPath)
+
+/// Int32 arithmetic produces the same bits as the double one, which the
+/// template computes without converting the operands to integers.
+#define ARITHMETIC_I32(name)                                          \
+  bool TemplateCompiler::emit##name##I32(const Inst *ip) {            \
+    return emit##name(ip);                                            \
+  }                                                                   \
+  bool TemplateCompiler::emit##name##I32Wide(const Inst *ip) {        \
+    return emit##name##Wide(ip);                                      \
+  }
+
+ARITHMETIC_I32(Add)
+ARITHMETIC_I32(Sub)
+ARITHMETIC_I32(Mul)
+
+#define BINARY_HELPER(name, slowPath)                                     \
+  bool TemplateCompiler::emit##name(const Inst *ip) {                     \
+    emitBinaryHelper(                                                     \
+        ip->i##name.op1, ip->i##name.op2, ip->i##name.op3, slowPath);     \
+    return true;                                                          \
+  }
+
+BINARY_HELPER(Mod, modSlowPath)
+BINARY_HELPER(ModN, modSlowPath)
+BINARY_HELPER(Eq, eqHelper)
+BINARY_HELPER(EqN, eqHelper)
+BINARY_HELPER(EqS, eqHelper)
+BINARY_HELPER(BitAnd, doBitAndOp)
+BINARY_HELPER(BitOr, doBitOrOp)
+BINARY_HELPER(BitXor, doBitXorOp)
+BINARY_HELPER(LShift, doLShiftOp)
+BINARY_HELPER(RShift, doRShiftOp)
+BINARY_HELPER(URshift, doURshiftOp)
+BINARY_HELPER(ModWide, modSlowPath)
+BINARY_HELPER(EqWide, eqHelper)
+BINARY_HELPER(BitAndWide, doBitAndOp)
+BINARY_HELPER(BitOrWide, doBitOrOp)
+BINARY_HELPER(BitXorWide, doBitXorOp)
+BINARY_HELPER(LShiftWide, doLShiftOp)
+BINARY_HELPER(RShiftWide, doRShiftOp)
+BINARY_HELPER(URshiftWide, doURshiftOp)
+
+#define INST_HELPER(name, helper, mayFail)                 \
+  bool TemplateCompiler::emit##name(const Inst *ip) {      \
+    emitInstHelperCall(helper, ip);                            \
+    if (mayFail)                                           \
+      exitOnFailure();                                     \
+    return true;                                           \
+  }
+
+INST_HELPER(LoadParam, loadParamHelper, false)
+INST_HELPER(LoadParamWide, loadParamWideHelper, false)
+INST_HELPER(GetField, getFieldHelper, false)
+INST_HELPER(SetField, setFieldHelper, false)
+INST_HELPER(Call, callHelper, true)
+INST_HELPER(Call1, call1Helper, true)
+INST_HELPER(Call2, call2Helper, true)
+INST_HELPER(Call3, call3Helper, true)
+INST_HELPER(Call4, call4Helper, true)
+
+bool TemplateCompiler::emitRet(const Inst *ip) {
+  asm_.mov(Asm::RDI, kFrameReg);
+  loadReg(Asm::RSI, ip->iRet.op1);
+  emitHelperCall(setResultHelper);
+  returnExits_.push_back(asm_.jmp());
+  return true;
+}
+
+bool TemplateCompiler::emitRetWide(const Inst *ip) {
+  asm_.mov(Asm::RDI, kFrameReg);
+  loadReg(Asm::RSI, ip->iRetWide.op1);
+  emitHelperCall(setResultHelper);
+  returnExits_.push_back(asm_.jmp());
+  return true;
+}
+
+bool TemplateCompiler::emitRetObject(const Inst *ip) {
+  asm_.mov(Asm::RDI, kFrameReg);
+  loadReg(Asm::RSI, ip->iRetObject.op1);
+  emitHelperCall(setResultHelper);
+  returnExits_.push_back(asm_.jmp());
+  return true;
+}
+
+bool TemplateCompiler::emitRetVoid(const Inst *ip) {
+  asm_.mov(Asm::RDI, kFrameReg);
+  asm_.movImm(Asm::RSI, CBValue::encodeUndefinedValue().getRaw());
+  emitHelperCall(setResultHelper);
+  returnExits_.push_back(asm_.jmp());
+  return true;
+}
+
+bool TemplateCompiler::emitJmp(const Inst *ip) {
+  jumpTo(ip, ip->iJmp.op1);
+  return true;
+}
+
+bool TemplateCompiler::emitJmpLong(const Inst *ip) {
+  jumpTo(ip, ip->iJmpLong.op1);
+  return true;
+}
+
+/// Jump if toBoolean(Arg2) is \p expected.
+#define JCOND1(name, expected)                                       \
+  bool TemplateCompiler::emit##name(const Inst *ip) {                \
+    loadReg(Asm::RDI, ip->i##name.op2);                              \
+    emitHelperCall(toBoolean);                                           \
+    asm_.testAL();                                                   \
+    branchTo(expected ? Asm::NotEqual : Asm::Equal, ip, ip->i##name.op1); \
+    return true;                                                     \
+  }
+
+JCOND1(JmpTrue, true)
+JCOND1(JmpTrueLong, true)
+JCOND1(JmpTrueWide, true)
+JCOND1(JmpFalse, false)
+JCOND1(JmpFalseLong, false)
+JCOND1(JmpFalseWide, false)
+
+/// Jump if pred(Arg2, Arg3) is \p expected, for the compare-and-branch
+/// instruction \p name and its long and wide variants.
+#define JCOND2(name, pred, expected)                                     \
+  bool TemplateCompiler::emit##name(const Inst *ip) {                    \
+    emitCompareBranch(                                                   \
+        ip, ip->i##name.op1, ip->i##name.op2, ip->i##name.op3, pred,     \
+        expected);                                                       \
+    return true;                                                         \
+  }                                                                      \
+  bool TemplateCompiler::emit##name##Long(const Inst *ip) {              \
+    emitCompareBranch(                                                   \
+        ip, ip->i##name##Long.op1, ip->i##name##Long.op2,                \
+        ip->i##name##Long.op3, pred, expected);                          \
+    return true;                                                         \
+  }                                                                      \
+  bool TemplateCompiler::emit##name##Wide(const Inst *ip) {              \
+    emitCompareBranch(                                                   \
+        ip, ip->i##name##Wide.op1, ip->i##name##Wide.op2,                \
+        ip->i##name##Wide.op3, pred, expected);                          \
+    return true;                                                         \
+  }
+
+JCOND2(JEq, strictEqualityTest, true)
+JCOND2(JNotEq, strictEqualityTest, false)
+JCOND2(JLess, doLess, true)
+JCOND2(JNotLess, doLess, false)
+JCOND2(JLessEqual, doLessEqual, true)
+JCOND2(JNotLessEqual, doLessEqual, false)
+JCOND2(JGreater, doGreater, true)
+JCOND2(JNotGreater, doGreater, false)
+JCOND2(JGreaterEqual, doGreaterEqual, true)
+JCOND2(JNotGreaterEqual, doGreaterEqual, false)
+
+/// Numeric compare-and-branch \p name and its long and wide variants. x < y is computed
+/// as y > x, so that every condition is an unsigned 'above' test of ucomisd,
+/// which is false for unordered operands.
+#define JCOND2N(name, swap, cond)                                        \
+  bool TemplateCompiler::emit##name(const Inst *ip) {                    \
+    emitNumberCompareBranch(                                             \
+        ip, ip->i##name.op1,                                             \
+        swap ? ip->i##name.op3 : ip->i##name.op2,                        \
+        swap ? ip->i##name.op2 : ip->i##name.op3, cond);                 \
+    return true;                                                         \
+  }                                                                      \
+  bool TemplateCompiler::emit##name##Long(const Inst *ip) {              \
+    emitNumberCompareBranch(                                             \
+        ip, ip->i##name##Long.op1,                                       \
+        swap ? ip->i##name##Long.op3 : ip->i##name##Long.op2,            \
+        swap ? ip->i##name##Long.op2 : ip->i##name##Long.op3, cond);     \
+    return true;                                                         \
+  }                                                                      \
+  bool TemplateCompiler::emit##name##Wide(const Inst *ip) {              \
+    emitNumberCompareBranch(                                             \
+        ip, ip->i##name##Wide.op1,                                       \
+        swap ? ip->i##name##Wide.op3 : ip->i##name##Wide.op2,            \
+        swap ? ip->i##name##Wide.op2 : ip->i##name##Wide.op3, cond);     \
+    return true;                                                         \
+  }
+
+JCOND2N(JLessN, true, Asm::Above)
+JCOND2N(JNotLessN, true, Asm::BelowEqual)
+JCOND2N(JLessEqualN, true, Asm::AboveEqual)
+JCOND2N(JNotLessEqualN, true, Asm::Below)
+JCOND2N(JGreaterN, false, Asm::Above)
+JCOND2N(JNotGreaterN, false, Asm::BelowEqual)
+JCOND2N(JGreaterEqualN, false, Asm::AboveEqual)
+JCOND2N(JNotGreaterEqualN, false, Asm::Below)
+
+/// Numeric equality: ZF is also set for unordered operands, which PF tells
+/// apart.
+#define JEQN(name)                                                       \
+  bool TemplateCompiler::emit##name(const Inst *ip) {                    \
+    asm_.movsd(Asm::XMM0, kRegsReg, regOffset(ip->i##name.op2));         \
+    asm_.ucomisd(Asm::XMM0, kRegsReg, regOffset(ip->i##name.op3));       \
+    size_t unordered = asm_.jcc(Asm::Parity);                            \
+    branchTo(Asm::Equal, ip, ip->i##name.op1);                           \
+    asm_.bind(unordered);                                                \
+    return true;                                                         \
+  }
+
+JEQN(JEqN)
+JEQN(JEqNLong)
+JEQN(JEqNWide)
+
+#define JNOTEQN(name)                                                    \
+  bool TemplateCompiler::emit##name(const Inst *ip) {                    \
+    asm_.movsd(Asm::XMM0, kRegsReg, regOffset(ip->i##name.op2));         \
+    asm_.ucomisd(Asm::XMM0, kRegsReg, regOffset(ip->i##name.op3));       \
+    branchTo(Asm::Parity, ip, ip->i##name.op1);                          \
+    branchTo(Asm::NotEqual, ip, ip->i##name.op1);                        \
+    return true;                                                         \
+  }
+
+JNOTEQN(JNotEqN)
+JNOTEQN(JNotEqNLong)
+JNOTEQN(JNotEqNWide)
+
+bool JIT::compile(Method *method) {
+  size_t size;
+  JITCompiledCode code = TemplateCompiler(method).compile(size);
+  if (code == nullptr)
+    return false;
+  method->setCompiledCode(code, size);
+  return true;
+}
+
+#endif // COBRA_ENABLE_JIT
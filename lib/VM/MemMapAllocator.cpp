@@ -5,8 +5,140 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <algorithm>
+
 #include "cobra/VM/MemMapAllocator.h"
+#include "cobra/VM/HeapCage.h"
+#include "cobra/VM/HeapRegion.h"
+#include "cobra/Support/OSCompat.h"
 
 using namespace cobra;
 using namespace vm;
 
+static bool isRegionAligned(void *p) {
+  return (reinterpret_cast<uintptr_t>(p) & (HeapRegion::kSize - 1)) == 0;
+}
+
+static_assert(
+    HeapRegion::kSize % oscompat::kHugePageSize == 0,
+    "regions must be made of whole huge pages");
+
+MemMapAllocator::MemMapAllocator(bool hugePages) : hugePages_(hugePages) {
+  // Without a cage, every allocation fails.
+  HeapCage::init();
+}
+
+MemMapAllocator::~MemMapAllocator() {
+  for (FreeRegion &region : freeRegions_) {
+    oscompat::vm_uncommit(region.storage, HeapRegion::kSize);
+    HeapCage::giveBack(region.storage);
+  }
+}
+
+void *MemMapAllocator::alloc(size_t size, const char *name) {
+  assert(size % HeapRegion::kSize == 0 && "size must be aligned");
+  void *mem = nullptr;
+  size_t count = size / HeapRegion::kSize;
+  if (count == 1 && !freeRegions_.empty()) {
+    // The most recently freed region is the likeliest to be resident.
+    mem = freeRegions_.back().storage;
+    freeRegions_.pop_back();
+    if (releasedCount_ > freeRegions_.size())
+      releasedCount_ = freeRegions_.size();
+  } else if (count > 1) {
+    mem = takeFreeRun(count);
+  }
+  if (mem == nullptr) {
+    mem = HeapCage::claim(size);
+    if (mem == nullptr)
+      return nullptr;
+    if (oscompat::vm_commit(mem, size) == nullptr) {
+      for (size_t i = 0; i < count; ++i)
+        HeapCage::giveBack(static_cast<char *>(mem) + i * HeapRegion::kSize);
+      return nullptr;
+    }
+    adviseHugePages(mem, size);
+  }
+  assert(isRegionAligned(mem));
+  
+  // Name the memory region on platforms that support naming.
+  oscompat::vm_name(mem, size, name);
+  return mem;
+}
+
+void *MemMapAllocator::takeFreeRun(size_t count) {
+  if (freeRegions_.size() < count)
+    return nullptr;
+  std::vector<size_t> byAddress(freeRegions_.size());
+  for (size_t i = 0; i < byAddress.size(); ++i)
+    byAddress[i] = i;
+  std::sort(byAddress.begin(), byAddress.end(), [this](size_t a, size_t b) {
+    return freeRegions_[a].storage < freeRegions_[b].storage;
+  });
+  
+  size_t runStart = 0;
+  for (size_t i = 1; i <= byAddress.size(); ++i) {
+    if (i - runStart == count)
+      break;
+    if (i == byAddress.size())
+      return nullptr;
+    auto *prev = static_cast<char *>(freeRegions_[byAddress[i - 1]].storage);
+    if (freeRegions_[byAddress[i]].storage != prev + HeapRegion::kSize)
+      runStart = i;
+  }
+  void *storage = freeRegions_[byAddress[runStart]].storage;
+  
+  // Remove the run from the back, so that the indices stay valid.
+  std::vector<size_t> run(
+      byAddress.begin() + runStart, byAddress.begin() + runStart + count);
+  std::sort(run.rbegin(), run.rend());
+  for (size_t index : run) {
+    freeRegions_.erase(freeRegions_.begin() + index);
+    if (index < releasedCount_)
+      --releasedCount_;
+  }
+  return storage;
+}
+
+void MemMapAllocator::adviseHugePages(void *mem, size_t size) {
+  // A reused region keeps the advice of its mapping.
+  if (!hugePages_)
+    return;
+  hugePageRequestedBytes_ += size;
+  if (oscompat::vm_hugepage(mem, size))
+    hugePageAdvisedBytes_ += size;
+}
+
+void MemMapAllocator::free(void *storage, size_t size, bool release) {
+  assert(size % HeapRegion::kSize == 0 && "size must be aligned");
+  Clock::time_point now = Clock::now();
+  if (release) {
+    // The released regions are kept before the ones still resident, which
+    // are reused first.
+    oscompat::vm_unused(storage, size);
+    std::vector<FreeRegion> regions;
+    for (size_t offset = 0; offset < size; offset += HeapRegion::kSize)
+      regions.push_back({static_cast<char *>(storage) + offset, now});
+    freeRegions_.insert(
+        freeRegions_.begin() + releasedCount_, regions.begin(), regions.end());
+    releasedCount_ += regions.size();
+    return;
+  }
+  for (size_t offset = 0; offset < size; offset += HeapRegion::kSize)
+    freeRegions_.push_back({static_cast<char *>(storage) + offset, now});
+}
+
+void MemMapAllocator::releaseIdleRegions() {
+  if (releasedCount_ == freeRegions_.size())
+    return;
+  Clock::time_point releaseBefore = Clock::now() - releaseDelay_;
+  while (releasedCount_ < freeRegions_.size() &&
+         freeRegions_[releasedCount_].freedAt <= releaseBefore) {
+    oscompat::vm_unused(freeRegions_[releasedCount_].storage, HeapRegion::kSize);
+    ++releasedCount_;
+  }
+}
+
+size_t MemMapAllocator::getRetainedBytes() const {
+  return (freeRegions_.size() - releasedCount_) * HeapRegion::kSize;
+}
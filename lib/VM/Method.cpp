@@ -7,23 +7,84 @@
 
 #include "cobra/VM/Method.h"
 #include "cobra/VM/Runtime.h"
+#include "cobra/Support/OSCompat.h"
+
+#include <cstring>
 
 using namespace cobra;
 using namespace vm;
 
 class Interpreter;
 
-void Method::invoke(uint32_t *args, uint32_t argCount) {
-  auto frame = Runtime::getCurrent()->getCurrentFrame();
-  StackFrame *newFrame = StackFrame::create(frame, this, argCount);
-  if (!isNative()) {
-    Interpreter::execute(newFrame);
+Method::Method(const CexFile *file, uint16_t methodIndex, const char *shorty)
+    : Object(MethodKind, heapAlignSize(sizeof(Method))),
+      methodIndex_(methodIndex),
+      file_(file),
+      shorty_(shorty) {}
+
+Method::~Method() {
+  delete[] inlineCaches_;
+  if (compiledCode_ != nullptr)
+    oscompat::vm_free(reinterpret_cast<void *>(compiledCode_), compiledCodeSize_);
+}
+
+void Method::setInstructions(const uint8_t *insts, uint32_t codeSize) {
+  instructions_.reset(new uint8_t[codeSize]);
+  memcpy(instructions_.get(), insts, codeSize);
+  codeSize_ = codeSize;
+}
+
+void Method::initInlineCaches(uint32_t count) {
+  delete[] inlineCaches_;
+  inlineCaches_ = count ? new InlineCache[count] : nullptr;
+  inlineCacheCount_ = count;
+}
+
+bool Method::invoke(uint32_t *args, uint32_t argCount) {
+  if (!isNative() &&
+      (compiledCode_ == nullptr ||
+       !Runtime::getCurrent()->canEnterNativeCall()))
+    return Interpreter::execute(this, args, argCount);
+  
+  return invokeCompiledCode(args, argCount);
+}
+
+bool Method::invokeCompiledCode(uint32_t *args, uint32_t argCount) {
+  auto runtime = Runtime::getCurrent();
+  // The runtime has no native method registry, there is no code to call.
+  if (isNative()) {
+    runtime->raiseError("native methods cannot be invoked");
+    return false;
   }
   
-  invokeCompiledCode(args, argCount);
+  StackFrame *frame = StackFrame::createWithArgs(
+      runtime->getRegisterStack(),
+      runtime->getCurrentFrame(),
+      this,
+      args,
+      argCount);
+  if (frame == nullptr) {
+    runtime->raiseError("stack overflow");
+    return false;
+  }
+  return invokeCompiledCode(frame);
 }
 
-void Method::invokeCompiledCode(uint32_t *args, uint32_t argCount) {
-  auto frame = Runtime::getCurrent()->getCurrentFrame();
-  auto newFrame = StackFrame::create(frame, this, argCount);
+bool Method::invokeCompiledCode(StackFrame *frame) {
+  assert(compiledCode_ && "Method was not compiled");
+  auto runtime = Runtime::getCurrent();
+  // Every call made by compiled code nests on the native stack.
+  if (COBRA_UNLIKELY(!runtime->canEnterNativeCall())) {
+    StackFrame::destroy(runtime->getRegisterStack(), frame);
+    runtime->raiseError("stack overflow");
+    return false;
+  }
+  runtime->enterNativeCall();
+  StackFrame *prevFrame = frame->getPrevFrame();
+  runtime->setCurrentFrame(frame);
+  bool result = compiledCode_(frame, frame->getRegisters());
+  StackFrame::destroy(runtime->getRegisterStack(), frame);
+  runtime->setCurrentFrame(prevFrame);
+  runtime->leaveNativeCall();
+  return result;
 }
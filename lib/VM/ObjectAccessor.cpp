@@ -6,6 +6,7 @@
  */
 
 #include "cobra/VM/ObjectAccessor.h"
+#include "cobra/VM/Runtime.h"
 
 using namespace cobra;
 using namespace vm;
@@ -18,7 +19,15 @@ Object *ObjectAccessor::getObject(const void *obj, size_t offset) {
 template <bool IsVolatile /* = false */, bool needWriterBarrier /* = true */>
 void ObjectAccessor::setObject(void *obj, size_t offset, Object *value) {
   if (needWriterBarrier) {
-    // TODO: record obj to BarrierSet
+    GC &heap = Runtime::getCurrent()->getHeap();
+    if (Object *oldValue = get<Object *, IsVolatile>(obj, offset))
+      heap.snapshotBarrier(CBValue::encodeObjectValue(oldValue));
+    if (value != nullptr) {
+      heap.cardBarrier(
+          obj,
+          reinterpret_cast<char *>(obj) + offset,
+          CBValue::encodeObjectValue(value));
+    }
   }
   
   set<Object *, IsVolatile>(obj, offset, value);
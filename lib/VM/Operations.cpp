@@ -6,6 +6,12 @@
  */
 
 #include "cobra/VM/Operations.h"
+#include "cobra/VM/String.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
 
 namespace cobra {
 namespace vm {
@@ -22,12 +28,157 @@ bool strictEqualityTest(CBValue x, CBValue y) {
   if (x.getTag() != y.getTag())
     return false;
   // Strings need deep comparison.
-  
-  // TODO
+  if (x.isString()) {
+    return static_cast<String *>(x.getPointer())
+        ->equals(static_cast<String *>(y.getPointer()));
+  }
   
   return false;
 }
 
+double toNumber(CBValue value) {
+  if (value.isNumber())
+    return value.getNumber();
+  if (value.isBool())
+    return value.getBool() ? 1 : 0;
+  if (value.isNull())
+    return 0;
+  
+  return std::numeric_limits<double>::quiet_NaN();
+}
+
+int32_t toInt32(CBValue value) {
+  double number = toNumber(value);
+  // Fast path for numbers that already are in the int32 range, where the
+  // conversion is a truncation.
+  if (COBRA_LIKELY(number > -2147483649.0 && number < 2147483648.0))
+    return (int32_t)number;
+  if (!std::isfinite(number))
+    return 0;
+  // Reduce modulo 2^32 to a value in [0, 2^32).
+  double bits = std::fmod(std::trunc(number), 4294967296.0);
+  if (bits < 0)
+    bits += 4294967296.0;
+  return (int32_t)(uint32_t)bits;
+}
+
+uint32_t toUInt32(CBValue value) {
+  return (uint32_t)toInt32(value);
+}
+
+bool toBoolean(CBValue value) {
+  if (value.isBool())
+    return value.getBool();
+  if (value.isNumber()) {
+    double m = value.getNumber();
+    return m != 0 && !std::isnan(m);
+  }
+  if (value.isString())
+    return !static_cast<String *>(value.getPointer())->isEmpty();
+  // Null and undefined are false, objects are true.
+  return value.isPointer() || value.isSymbol();
 }
+
+static void appendASCII(const char *chars, std::u16string &out) {
+  while (*chars != '\0')
+    out.push_back((char16_t)*chars++);
 }
 
+/// Append the string of \p m following ES5.1 9.8.1, with the fewest digits
+/// that read back as \p m.
+static void appendNumber(double m, std::u16string &out) {
+  if (std::isnan(m))
+    return appendASCII("NaN", out);
+  if (m == 0)
+    return appendASCII("0", out);
+  if (m < 0) {
+    out.push_back(u'-');
+    m = -m;
+  }
+  if (std::isinf(m))
+    return appendASCII("Infinity", out);
+  
+  char buf[32];
+  for (int precision = 1; precision <= 17; ++precision) {
+    snprintf(buf, sizeof(buf), "%.*e", precision - 1, m);
+    if (strtod(buf, nullptr) == m)
+      break;
+  }
+  // buf holds d[.ddd]e[+-]xx, the digits and the exponent of 9.8.1 are
+  // taken from it.
+  std::string digits;
+  const char *p = buf;
+  for (; *p != 'e'; ++p) {
+    if (*p != '.')
+      digits.push_back(*p);
+  }
+  while (digits.size() > 1 && digits.back() == '0')
+    digits.pop_back();
+  int k = (int)digits.size();
+  int n = atoi(p + 1) + 1;
+  
+  std::string str;
+  if (k <= n && n <= 21) {
+    str = digits + std::string(n - k, '0');
+  } else if (0 < n && n <= 21) {
+    str = digits.substr(0, n) + "." + digits.substr(n);
+  } else if (-6 < n && n <= 0) {
+    str = "0." + std::string(-n, '0') + digits;
+  } else {
+    str = digits.substr(0, 1);
+    if (k > 1)
+      str += "." + digits.substr(1);
+    str += n - 1 >= 0 ? "e+" : "e-";
+    str += std::to_string(std::abs(n - 1));
+  }
+  appendASCII(str.c_str(), out);
+}
+
+void appendToString(CBValue value, std::u16string &out) {
+  if (value.isString()) {
+    auto *str = static_cast<String *>(value.getPointer());
+    uint32_t length = str->getLength();
+    if (str->isCompressed()) {
+      const uint8_t *chars = str->getDataCompressed();
+      out.append(chars, chars + length);
+    } else {
+      const uint16_t *chars = str->getData();
+      out.append(chars, chars + length);
+    }
+  } else if (value.isNumber()) {
+    appendNumber(value.getNumber(), out);
+  } else if (value.isBool()) {
+    appendASCII(value.getBool() ? "true" : "false", out);
+  } else if (value.isNull()) {
+    appendASCII("null", out);
+  } else if (value.isUndefined()) {
+    appendASCII("undefined", out);
+  } else if (value.isSymbol()) {
+    appendASCII("Symbol()", out);
+  } else {
+    appendASCII("[object Object]", out);
+  }
+}
+
+bool addValues(GC &heap, CBValue x, CBValue y, CBValue &result) {
+  if (!x.isString() && !y.isString()) {
+    result = CBValue::encodeUntrustedNumberValue(toNumber(x) + toNumber(y));
+    return true;
+  }
+  
+  // The characters are copied out before allocating, the collection the
+  // allocation may start can move the operands.
+  std::u16string chars;
+  appendToString(x, chars);
+  appendToString(y, chars);
+  String *str = String::create(
+      heap, reinterpret_cast<const uint16_t *>(chars.data()),
+      (uint32_t)chars.size());
+  if (COBRA_UNLIKELY(str == nullptr))
+    return false;
+  result = CBValue::encodeStringValue(str);
+  return true;
+}
+
+}
+}
@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "cobra/VM/ParallelMarker.h"
+#include "cobra/VM/GC.h"
+
+#include <thread>
+#include <utility>
+
+using namespace cobra;
+using namespace vm;
+
+struct alignas(64) ParallelMarker::Worker {
+  WorkStealingDeque<GCCell *> deque{};
+  uint64_t markedBytes{0};
+  /// The bytes scanned since the budget was last charged.
+  uint64_t unchargedBytes{0};
+  /// The slots referencing an evacuation candidate.
+  std::vector<CBValue *> candidateSlots{};
+  /// State of the random choice of the victims of steal().
+  uint32_t seed;
+
+  explicit Worker(uint32_t id) : seed(id * 2654435761u + 1) {}
+};
+
+ParallelMarker::ParallelMarker(
+    std::vector<HeapRegionSpace *> spaces,
+    uint32_t numThreads)
+    : spaces_(std::move(spaces)) {
+  assert(numThreads > 0 && "The marker needs a thread");
+  for (uint32_t id = 0; id < numThreads; ++id)
+    workers_.emplace_back(new Worker(id));
+}
+
+ParallelMarker::~ParallelMarker() = default;
+
+void ParallelMarker::mark(const std::vector<GCCell *> &roots) {
+  // The roots are spread over the workers before their threads start, while
+  // every deque is still owned by this thread.
+  for (size_t i = 0; i < roots.size(); ++i) {
+    if (contains(roots[i]))
+      markCell(*workers_[i % workers_.size()], roots[i]);
+  }
+  runWorkers(UINT64_MAX);
+}
+
+bool ParallelMarker::markFrom(
+    const std::vector<GCCell *> &grey,
+    uint64_t budget) {
+  for (size_t i = 0; i < grey.size(); ++i)
+    workers_[i % workers_.size()]->deque.push(grey[i]);
+  runWorkers(budget);
+  return !hasWork();
+}
+
+void ParallelMarker::takeGrey(std::vector<GCCell *> &grey) {
+  // The worker threads are joined, this thread owns every deque again.
+  for (auto &worker : workers_) {
+    GCCell *cell;
+    while (worker->deque.pop(cell))
+      grey.push_back(cell);
+  }
+}
+
+void ParallelMarker::runWorkers(uint64_t budget) {
+  budget_ = budget;
+  scannedBytes_.store(0, std::memory_order_relaxed);
+  outOfBudget_.store(false, std::memory_order_relaxed);
+  idleCount_.store(0, std::memory_order_relaxed);
+  for (auto &worker : workers_)
+    worker->unchargedBytes = 0;
+  std::vector<std::thread> threads;
+  for (uint32_t id = 1; id < workers_.size(); ++id)
+    threads.emplace_back(&ParallelMarker::run, this, id);
+  run(0);
+  for (auto &thread : threads)
+    thread.join();
+}
+
+uint64_t ParallelMarker::getMarkedBytes() const {
+  uint64_t markedBytes = 0;
+  for (auto &worker : workers_)
+    markedBytes += worker->markedBytes;
+  return markedBytes;
+}
+
+void ParallelMarker::rememberCandidateSlots() {
+  for (auto &worker : workers_) {
+    for (CBValue *slot : worker->candidateSlots) {
+      HeapRegion *region = HeapRegion::getHeapRegion(slot->getPointer());
+      region->getRememberedSet().push_back(slot);
+    }
+    worker->candidateSlots.clear();
+  }
+}
+
+void ParallelMarker::run(uint32_t id) {
+  Worker &worker = *workers_[id];
+  uint32_t numWorkers = workers_.size();
+  for (;;) {
+    GCCell *cell;
+    while (worker.deque.pop(cell)) {
+      scan(worker, cell);
+      if (!chargeBudget(worker, cell->getSize()))
+        return;
+    }
+    if (steal(id, cell)) {
+      scan(worker, cell);
+      if (!chargeBudget(worker, cell->getSize()))
+        return;
+      continue;
+    }
+
+    // Out of work. A worker only becomes idle with an empty deque, and only
+    // pushes on its own deque, so there is no work left once every worker
+    // is idle.
+    idleCount_.fetch_add(1, std::memory_order_acq_rel);
+    for (;;) {
+      if (idleCount_.load(std::memory_order_acquire) == numWorkers ||
+          outOfBudget_.load(std::memory_order_relaxed))
+        return;
+      if (hasWork()) {
+        idleCount_.fetch_sub(1, std::memory_order_acq_rel);
+        break;
+      }
+      std::this_thread::yield();
+    }
+  }
+}
+
+bool ParallelMarker::chargeBudget(Worker &worker, uint64_t size) {
+  if (budget_ == UINT64_MAX)
+    return true;
+  if (outOfBudget_.load(std::memory_order_relaxed))
+    return false;
+  worker.unchargedBytes += size;
+  if (worker.unchargedBytes < kBudgetCheckBytes)
+    return true;
+  uint64_t scanned = scannedBytes_.fetch_add(
+      worker.unchargedBytes, std::memory_order_relaxed) +
+      worker.unchargedBytes;
+  worker.unchargedBytes = 0;
+  if (scanned < budget_)
+    return true;
+  outOfBudget_.store(true, std::memory_order_relaxed);
+  return false;
+}
+
+bool ParallelMarker::steal(uint32_t id, GCCell *&cell) {
+  uint32_t numWorkers = workers_.size();
+  if (numWorkers == 1)
+    return false;
+  Worker &worker = *workers_[id];
+  // Start from a random victim, so that the thieves spread over the deques.
+  worker.seed = worker.seed * 1103515245 + 12345;
+  uint32_t first = (worker.seed >> 16) % numWorkers;
+  for (uint32_t i = 0; i < numWorkers; ++i) {
+    uint32_t victim = (first + i) % numWorkers;
+    if (victim != id && workers_[victim]->deque.steal(cell))
+      return true;
+  }
+  return false;
+}
+
+bool ParallelMarker::hasWork() const {
+  for (auto &worker : workers_) {
+    if (!worker->deque.isEmpty())
+      return true;
+  }
+  return false;
+}
+
+bool ParallelMarker::contains(const GCCell *cell) const {
+  for (HeapRegionSpace *space : spaces_) {
+    if (space->contains(cell))
+      return true;
+  }
+  return false;
+}
+
+void ParallelMarker::markCell(Worker &worker, GCCell *cell) {
+  if (!HeapRegion::testAndSetCellMarkBit(cell))
+    return;
+  worker.markedBytes += cell->getSize();
+  worker.deque.push(cell);
+}
+
+void ParallelMarker::scan(Worker &worker, GCCell *cell) {
+  CBValue *begin, *end;
+  GC::getSlots(cell, begin, end);
+  for (CBValue *slot = begin; slot < end; ++slot) {
+    // The mutator is stopped, the slots can be read plainly.
+    CBValue value = *slot;
+    if (!value.isPointer())
+      continue;
+    auto *target = static_cast<GCCell *>(value.getPointer());
+    if (!contains(target))
+      continue;
+    if (HeapRegion::getHeapRegion(target)->isEvacuationCandidate())
+      worker.candidateSlots.push_back(slot);
+    markCell(worker, target);
+  }
+}
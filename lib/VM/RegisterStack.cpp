@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "cobra/VM/RegisterStack.h"
+#include "cobra/Support/MathExtras.h"
+#include "cobra/Support/OSCompat.h"
+
+using namespace cobra;
+using namespace vm;
+
+std::unique_ptr<RegisterStack> RegisterStack::create(
+    uint32_t numRegisters,
+    bool hugePages) {
+  size_t commitSize = hugePages ? oscompat::kHugePageSize : kCommitSize;
+  size_t size = alignTo(numRegisters * sizeof(CBValue), commitSize);
+  void *mem = oscompat::vm_reserve_aligned(size, commitSize);
+  if (mem == nullptr)
+    return nullptr;
+  oscompat::vm_name(mem, size, "cobra-register-stack");
+  return std::unique_ptr<RegisterStack>(new RegisterStack(
+      static_cast<CBValue *>(mem), size / sizeof(CBValue), hugePages));
+}
+
+RegisterStack::~RegisterStack() {
+  oscompat::vm_release_aligned(start_, getReservedSize());
+}
+
+size_t RegisterStack::getCommitSize() const {
+  return hugePages_ ? oscompat::kHugePageSize : kCommitSize;
+}
+
+bool RegisterStack::commit(CBValue *newTop) {
+  if (newTop > end_)
+    return false;
+  
+  auto *from = reinterpret_cast<char *>(committedEnd_);
+  auto *to = reinterpret_cast<char *>(start_) +
+      alignTo(
+          reinterpret_cast<char *>(newTop) - reinterpret_cast<char *>(start_),
+          getCommitSize());
+  if (oscompat::vm_commit(from, to - from) == nullptr)
+    return false;
+  // Committing maps the pages anew, they must be advised every time.
+  if (hugePages_)
+    oscompat::vm_hugepage(from, to - from);
+  committedEnd_ = reinterpret_cast<CBValue *>(to);
+  return true;
+}
+
+void RegisterStack::trim() {
+  auto *from = reinterpret_cast<char *>(start_) +
+      alignTo(
+          reinterpret_cast<char *>(top_) - reinterpret_cast<char *>(start_),
+          getCommitSize());
+  auto *to = reinterpret_cast<char *>(committedEnd_);
+  if (from < to) {
+    oscompat::vm_uncommit(from, to - from);
+    committedEnd_ = reinterpret_cast<CBValue *>(from);
+  }
+}
@@ -7,54 +7,67 @@
 
 #include "cobra/VM/Runtime.h"
 #include "cobra/VM/GCPointer.h"
+#include "cobra/VM/RuntimeModule.h"
 
 using namespace cobra;
 using namespace vm;
 
-Runtime *Runtime::instance_ = nullptr;
+thread_local Runtime *Runtime::current_ = nullptr;
 
 Runtime::Runtime() {
   
 }
 
 Runtime::~Runtime() {
-  
+  if (current_ == this)
+    current_ = nullptr;
 }
 
-bool Runtime::create(const RuntimeOptions &options) {
-  if (instance_ != nullptr) {
-    return false;
+Runtime *Runtime::create(const RuntimeOptions &options) {
+  if (current_ != nullptr) {
+    return nullptr;
   }
-  instance_ = new Runtime;
-  if (!instance_->init(std::move(options))) {
-    instance_ = nullptr;
-    return false;
+  auto *runtime = new Runtime;
+  if (!runtime->init(options)) {
+    delete runtime;
+    return nullptr;
   }
-  return true;
+  current_ = runtime;
+  return runtime;
 }
 
 bool Runtime::destroy() {
-  if (instance_ == nullptr) {
+  if (current_ == nullptr) {
     return false;
   }
-  
+  delete current_;
   return true;
 }
 
-Runtime *Runtime::getCurrent() {
-  return instance_;
-}
-
 inline HandleScope *Runtime::getTopScope() {
   return topScope_;
 }
 
-bool Runtime::runBytecode(std::shared_ptr<BytecodeRawData> &&bytecode) {
-//  return Interpreter::interpretFunction(code);
-  
+bool Runtime::runBytecode(
+    std::shared_ptr<BytecodeRawData> &&bytecode,
+    std::string &error) {
+  auto module = RuntimeModule::create(*this, std::move(bytecode), error);
+  if (module == nullptr)
+    return false;
+  modules_.push_back(std::move(module));
   return true;
 }
 
 bool Runtime::init(const RuntimeOptions &options) {
+  options_ = options;
+  
+  heap_ = std::make_unique<GC>(*this);
+  classLinker_ = std::make_unique<ClassLinker>();
   
+  registerStack_ = RegisterStack::create(
+      RegisterStack::kDefaultNumRegisters, options.getHugePages());
+  if (registerStack_ == nullptr)
+    return false;
+  
+  return true;
 }
@@ -10,3 +10,40 @@
 using namespace cobra;
 using namespace vm;
 
+
+RuntimeModule::~RuntimeModule() = default;
+
+std::unique_ptr<RuntimeModule> RuntimeModule::create(
+    Runtime &runtime,
+    std::shared_ptr<BytecodeRawData> bytecode,
+    std::string &error) {
+  std::unique_ptr<RuntimeModule> module{new RuntimeModule(runtime)};
+  uint32_t count = bytecode->getNumFunctions();
+  module->methods_.reserve(count);
+  // The methods point to their shorty, which must not move.
+  module->shorties_.reserve(count);
+  
+  for (uint32_t functionID = 0; functionID < count; ++functionID) {
+    BytecodeFunction &function = bytecode->getFunction(functionID);
+    module->shorties_.push_back(std::string(function.getParamCount() + 1, 'L'));
+    auto method = std::make_unique<Method>(
+        nullptr, functionID, module->shorties_.back().c_str());
+    method->setArgCount(function.getParamCount());
+    method->setFrameSize(function.getFrameSize());
+    
+    const std::vector<opcode_t> &opcodes = function.getOpcodes();
+    if (!runtime.getClassLinker().linkMethod(
+            method.get(),
+            opcodes.data(),
+            opcodes.size(),
+            function.getInlineCacheCount(),
+            error)) {
+      error = "function " + std::to_string(functionID) + ": " + error;
+      return nullptr;
+    }
+    module->methods_.push_back(std::move(method));
+  }
+  
+  module->bytecode_ = std::move(bytecode);
+  return module;
+}
@@ -0,0 +1,308 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifdef COBRA_SAMPLING_PROFILER
+
+#include "cobra/VM/SamplingProfiler.h"
+#include "cobra/VM/Method.h"
+#include "cobra/VM/Runtime.h"
+#include "cobra/VM/StackFrame.h"
+
+#include <cassert>
+#include <cerrno>
+#include <ctime>
+#include <map>
+#include <signal.h>
+#include <string>
+#include <sys/time.h>
+#include <tuple>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Older C libraries only name the thread of a SIGEV_THREAD_ID event through
+// the union.
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+#endif // __linux__
+
+using namespace cobra;
+using namespace vm;
+
+std::atomic<SamplingProfiler *> SamplingProfiler::active_{nullptr};
+
+/// \return the name of \p method in the exported profiles.
+static std::string methodName(Method *method) {
+  if (method == nullptr)
+    return "(anonymous)";
+  return "method#" + std::to_string(method->getMethodIndex());
+}
+
+/// \return the offset of \p ip in the instructions of \p frame.
+static uint32_t frameOffset(const StackFrame *frame, const uint8_t *ip) {
+  const uint8_t *insts = frame->getInstructions();
+  if (ip == nullptr || insts == nullptr || ip < insts)
+    return SamplingProfiler::kUnknownOffset;
+  return (uint32_t)(ip - insts);
+}
+
+SamplingProfiler::~SamplingProfiler() {
+  stop();
+}
+
+bool SamplingProfiler::start(
+    Runtime *runtime,
+    uint32_t frequency,
+    uint32_t capacity) {
+  if (frequency == 0 || capacity == 0)
+    return false;
+  SamplingProfiler *expected = nullptr;
+  if (!active_.compare_exchange_strong(expected, this))
+    return false;
+
+  runtime_ = runtime;
+  thread_ = pthread_self();
+  capacity_ = 1;
+  while (capacity_ < capacity)
+    capacity_ <<= 1;
+  buffer_.reset(new Sample[capacity_]);
+  head_.store(0, std::memory_order_relaxed);
+  tail_.store(0, std::memory_order_relaxed);
+
+  struct sigaction action = {};
+  action.sa_handler = handleSignal;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(SIGPROF, &action, nullptr) != 0) {
+    active_.store(nullptr);
+    return false;
+  }
+
+  if (!startTimer(frequency)) {
+    signal(SIGPROF, SIG_DFL);
+    active_.store(nullptr);
+    return false;
+  }
+
+  // The drainer inherits the signal mask of this thread: SIGPROF is blocked
+  // while it is created so that the timer only interrupts threads that can
+  // take a sample.
+  sigset_t profMask, savedMask;
+  sigemptyset(&profMask);
+  sigaddset(&profMask, SIGPROF);
+  pthread_sigmask(SIG_BLOCK, &profMask, &savedMask);
+  stopDrainer_ = false;
+  drainer_ = std::thread(&SamplingProfiler::runDrainer, this);
+  pthread_sigmask(SIG_SETMASK, &savedMask, nullptr);
+
+  running_ = true;
+  return true;
+}
+
+void SamplingProfiler::stop() {
+  if (!running_)
+    return;
+  stopTimer();
+  // A signal that is already pending is ignored instead of terminating the
+  // process.
+  signal(SIGPROF, SIG_IGN);
+  active_.store(nullptr);
+  {
+    std::lock_guard<std::mutex> lock(drainerMutex_);
+    stopDrainer_ = true;
+  }
+  drainerCond_.notify_one();
+  drainer_.join();
+  running_ = false;
+  drain();
+}
+
+bool SamplingProfiler::startTimer(uint32_t frequency) {
+  long periodNs = frequency >= 1000000000 ? 1 : 1000000000 / frequency;
+#ifdef __linux__
+  // The timer counts the CPU time of the profiled thread and only signals
+  // that thread, so an idle runtime is not sampled and the other threads of
+  // the process neither consume nor trigger its ticks.
+  clockid_t clock;
+  if (pthread_getcpuclockid(thread_, &clock) != 0)
+    return false;
+  struct sigevent event = {};
+  event.sigev_notify = SIGEV_THREAD_ID;
+  event.sigev_signo = SIGPROF;
+  event.sigev_notify_thread_id = (pid_t)syscall(SYS_gettid);
+  if (timer_create(clock, &event, &timer_) != 0)
+    return false;
+  struct itimerspec spec = {};
+  spec.it_interval.tv_sec = periodNs / 1000000000;
+  spec.it_interval.tv_nsec = periodNs % 1000000000;
+  spec.it_value = spec.it_interval;
+  if (timer_settime(timer_, 0, &spec, nullptr) != 0) {
+    timer_delete(timer_);
+    return false;
+  }
+  return true;
+#else
+  // Without per-thread timers the timer counts the CPU time of the whole
+  // process and its signal goes to any thread that does not block it. The
+  // ticks delivered to other threads are counted as dropped.
+  struct itimerval timer = {};
+  timer.it_interval.tv_sec = periodNs / 1000000000;
+  timer.it_interval.tv_usec = periodNs % 1000000000 / 1000;
+  if (timer.it_interval.tv_sec == 0 && timer.it_interval.tv_usec == 0)
+    timer.it_interval.tv_usec = 1;
+  timer.it_value = timer.it_interval;
+  return setitimer(ITIMER_PROF, &timer, nullptr) == 0;
+#endif
+}
+
+void SamplingProfiler::stopTimer() {
+#ifdef __linux__
+  timer_delete(timer_);
+#else
+  struct itimerval timer = {};
+  setitimer(ITIMER_PROF, &timer, nullptr);
+#endif
+}
+
+void SamplingProfiler::runDrainer() {
+  std::unique_lock<std::mutex> lock(drainerMutex_);
+  while (!drainerCond_.wait_for(
+      lock, kDrainInterval, [this] { return stopDrainer_; }))
+    drain();
+}
+
+void SamplingProfiler::handleSignal(int sig) {
+  int savedErrno = errno;
+  SamplingProfiler *profiler = active_.load(std::memory_order_acquire);
+  if (profiler != nullptr) {
+    if (pthread_equal(pthread_self(), profiler->thread_))
+      profiler->takeSample();
+    else
+      profiler->dropped_.fetch_add(1, std::memory_order_relaxed);
+  }
+  errno = savedErrno;
+}
+
+void SamplingProfiler::takeSample() {
+  uint64_t head = head_.load(std::memory_order_relaxed);
+  if (head - tail_.load(std::memory_order_acquire) == capacity_) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  Sample &sample = buffer_[head & (capacity_ - 1)];
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  sample.timestamp = (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+
+  // The innermost frame is at the instruction the interpreter last recorded
+  // in it, every caller is at the return address of its callee.
+  std::atomic_signal_fence(std::memory_order_acquire);
+  uint32_t depth = 0;
+  StackFrame *callee = nullptr;
+  for (StackFrame *frame = runtime_->getCurrentFrame();
+       frame != nullptr && depth < kMaxDepth;
+       callee = frame, frame = frame->getPrevFrame()) {
+    const uint8_t *ip =
+        callee ? callee->getReturnIP() : frame->getSampledIP();
+    sample.frames[depth++] = {frame->getMethod(), frameOffset(frame, ip)};
+  }
+  sample.depth = depth;
+
+  head_.store(head + 1, std::memory_order_release);
+}
+
+void SamplingProfiler::drain() {
+  if (!buffer_)
+    return;
+  uint64_t tail = tail_.load(std::memory_order_relaxed);
+  uint64_t head = head_.load(std::memory_order_acquire);
+  for (; tail != head; ++tail)
+    samples_.push_back(buffer_[tail & (capacity_ - 1)]);
+  tail_.store(tail, std::memory_order_release);
+}
+
+void SamplingProfiler::reset() {
+  assert(!running_ && "The drainer thread owns the samples");
+  samples_.clear();
+  dropped_.store(0, std::memory_order_relaxed);
+}
+
+void SamplingProfiler::dumpFoldedStacks(std::ostream &os) const {
+  std::map<std::string, uint64_t> stacks;
+  for (auto &sample : samples_) {
+    if (sample.depth == 0)
+      continue;
+    std::string stack;
+    for (uint32_t i = sample.depth; i > 0; --i) {
+      if (!stack.empty())
+        stack += ';';
+      stack += methodName(sample.frames[i - 1].method);
+    }
+    ++stacks[stack];
+  }
+  for (auto &entry : stacks)
+    os << entry.first << " " << entry.second << "\n";
+}
+
+void SamplingProfiler::dumpChromeTrace(std::ostream &os) const {
+  // Every distinct (parent, method, offset) frame gets a node in the
+  // stackFrames tree, and each sample points to the node of its innermost
+  // frame.
+  std::map<std::tuple<uint32_t, Method *, uint32_t>, uint32_t> nodeIds;
+  std::vector<std::tuple<uint32_t, Method *, uint32_t>> nodes;
+  std::vector<std::pair<uint64_t, uint32_t>> events;
+
+  for (auto &sample : samples_) {
+    if (sample.depth == 0)
+      continue;
+    uint32_t parent = 0;
+    for (uint32_t i = sample.depth; i > 0; --i) {
+      auto key = std::make_tuple(
+          parent, sample.frames[i - 1].method, sample.frames[i - 1].offset);
+      auto it = nodeIds.find(key);
+      if (it == nodeIds.end()) {
+        nodes.push_back(key);
+        it = nodeIds.emplace(key, nodes.size()).first;
+      }
+      parent = it->second;
+    }
+    events.emplace_back(sample.timestamp, parent);
+  }
+
+  os << "{\n  \"traceEvents\": [],\n  \"stackFrames\": {";
+  const char *sep = "\n";
+  for (uint32_t id = 1; id <= nodes.size(); ++id) {
+    auto &node = nodes[id - 1];
+    os << sep << "    \"" << id << "\": {\"category\": \"cobra\", "
+       << "\"name\": \"" << methodName(std::get<1>(node));
+    if (std::get<2>(node) != kUnknownOffset)
+      os << " @" << std::get<2>(node);
+    os << "\"";
+    if (std::get<0>(node) != 0)
+      os << ", \"parent\": \"" << std::get<0>(node) << "\"";
+    os << "}";
+    sep = ",\n";
+  }
+  os << "\n  },\n  \"samples\": [";
+
+  uint64_t start = events.empty() ? 0 : events.front().first;
+  sep = "\n";
+  for (auto &event : events) {
+    // Timestamps are in microseconds.
+    os << sep << "    {\"cpu\": 0, \"tid\": 1, \"ts\": "
+       << (event.first - start) / 1000
+       << ", \"name\": \"sample\", \"sf\": \"" << event.second
+       << "\", \"weight\": 1}";
+    sep = ",\n";
+  }
+  os << "\n  ]\n}\n";
+}
+
+#endif // COBRA_SAMPLING_PROFILER
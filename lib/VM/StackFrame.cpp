@@ -7,6 +7,111 @@
 
 #include "cobra/VM/StackFrame.h"
 
+#include <cstring>
+
 using namespace cobra;
 using namespace vm;
 
+StackFrame *StackFrame::createWithMissingArgs(
+    RegisterStack &stack,
+    StackFrame *prev,
+    Method *method,
+    uint32_t argCount,
+    CBValue *prevTop,
+    CBValue *result) {
+  uint32_t declaredCount = method->getArgCount();
+  assert(argCount < declaredCount && "No parameter is missing");
+  
+  // Parameter idx is the register -1 - idx from the frame, so 'this' and the
+  // passed arguments keep their distance to the new frame.
+  CBValue *passed = stack.getTop() - (argCount + 1);
+  CBValue *params = stack.allocate(declaredCount + 1);
+  if (params == nullptr)
+    return nullptr;
+  for (uint32_t idx = 0; idx <= declaredCount; ++idx) {
+    params[declaredCount - idx] = idx <= argCount
+        ? passed[argCount - idx]
+        : CBValue::encodeUndefinedValue();
+  }
+  
+  return createWithFrameSize(
+      stack,
+      prev,
+      method,
+      method->getFrameSize(),
+      declaredCount,
+      prevTop,
+      result);
+}
+
+/// Decode the parameter of shorty type \p type at \p args[slot], and advance
+/// \p slot past its words.
+static CBValue decodeArg(char type, const uint32_t *args, uint32_t &slot) {
+  switch (type) {
+    case 'Z':
+      return CBValue::encodeBoolValue(args[slot++] != 0);
+    case 'B':
+      return CBValue::encodeTrustedNumberValue((int8_t)args[slot++]);
+    case 'C':
+      return CBValue::encodeTrustedNumberValue((uint16_t)args[slot++]);
+    case 'S':
+      return CBValue::encodeTrustedNumberValue((int16_t)args[slot++]);
+    case 'I':
+      return CBValue::encodeTrustedNumberValue((int32_t)args[slot++]);
+    case 'F': {
+      float value;
+      memcpy(&value, &args[slot++], sizeof(value));
+      return CBValue::encodeUntrustedNumberValue(value);
+    }
+    case 'J': {
+      uint64_t bits = args[slot] | ((uint64_t)args[slot + 1] << 32);
+      slot += 2;
+      return CBValue::encodeTrustedNumberValue((double)(int64_t)bits);
+    }
+    case 'D': {
+      uint64_t bits = args[slot] | ((uint64_t)args[slot + 1] << 32);
+      slot += 2;
+      double value;
+      memcpy(&value, &bits, sizeof(value));
+      return CBValue::encodeUntrustedNumberValue(value);
+    }
+    case 'L': {
+      uint64_t bits = args[slot] | ((uint64_t)args[slot + 1] << 32);
+      slot += 2;
+      auto *cell = reinterpret_cast<GCCell *>((uintptr_t)bits);
+      if (cell == nullptr)
+        return CBValue::encodeNullValue();
+      if (cell->getKind() == StringKind)
+        return CBValue::encodeStringValue(cell);
+      return CBValue::encodeObjectValue(cell);
+    }
+    default:
+      COBRA_UNREACHABLE();
+  }
+}
+
+StackFrame *StackFrame::createWithArgs(
+    RegisterStack &stack,
+    StackFrame *prev,
+    Method *method,
+    uint32_t *args,
+    uint32_t argCount) {
+  const char *paramTypes = &method->getShorty()[1]; // [0] is the return type.
+  uint32_t paramCount = strlen(paramTypes);
+  
+  // Push the parameters in reverse order, 'this' comes first.
+  CBValue *prevTop = stack.getTop();
+  CBValue *params = stack.allocate(paramCount + 1);
+  if (params == nullptr)
+    return nullptr;
+  params[paramCount] = CBValue::encodeUndefinedValue();
+  uint32_t slot = 0;
+  for (uint32_t i = 0; i < paramCount; ++i)
+    params[paramCount - 1 - i] = decodeArg(paramTypes[i], args, slot);
+  assert(slot == argCount && "Arguments do not match the shorty");
+  
+  StackFrame *frame = create(stack, prev, method, paramCount, prevTop);
+  if (frame == nullptr)
+    stack.release(prevTop);
+  return frame;
+}
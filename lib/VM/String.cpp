@@ -23,6 +23,62 @@ int32_t computeUtf16Hash(const MemoryType* chars, size_t char_count) {
   return static_cast<int32_t>(hash);
 }
 
+String *String::allocate(GC &heap, uint32_t length, bool compressed) {
+  size_t size = sizeof(String) + (compressed ? length : sizeof(uint16_t) * (size_t)length);
+  if (COBRA_UNLIKELY(size > GC::kMaxObjectSize))
+    return nullptr;
+  size = heapAlignSize(size);
+  void *mem = heap.alloc(size);
+  if (COBRA_UNLIKELY(mem == nullptr))
+    return nullptr;
+  
+  auto *str = new (mem) String(size);
+  if (kUseStringCompression) {
+    auto flag = compressed ? StringCompressionFlag::kCompressed : StringCompressionFlag::kUncompressed;
+    str->length_ = (length << 1U) | (uint32_t)flag;
+  } else {
+    str->length_ = length;
+  }
+  str->hashCode_ = 0;
+  return str;
+}
+
+String *String::create(GC &heap, const char *chars, uint32_t length) {
+  bool compressed = kUseStringCompression;
+  for (uint32_t i = 0; compressed && i < length; ++i)
+    compressed = (uint8_t)chars[i] < 0x80;
+  
+  String *str = allocate(heap, length, compressed);
+  if (COBRA_UNLIKELY(str == nullptr))
+    return nullptr;
+  if (compressed) {
+    memcpy(str->getDataCompressed(), chars, length);
+  } else {
+    uint16_t *data = str->getData();
+    for (uint32_t i = 0; i < length; ++i)
+      data[i] = (uint8_t)chars[i];
+  }
+  return str;
+}
+
+String *String::create(GC &heap, const uint16_t *chars, uint32_t length) {
+  bool compressed = kUseStringCompression;
+  for (uint32_t i = 0; compressed && i < length; ++i)
+    compressed = chars[i] < 0x80;
+  
+  String *str = allocate(heap, length, compressed);
+  if (COBRA_UNLIKELY(str == nullptr))
+    return nullptr;
+  if (compressed) {
+    uint8_t *data = str->getDataCompressed();
+    for (uint32_t i = 0; i < length; ++i)
+      data[i] = (uint8_t)chars[i];
+  } else {
+    memcpy(str->getData(), chars, sizeof(uint16_t) * (size_t)length);
+  }
+  return str;
+}
+
 uint32_t String::computeHashCode() {
   uint32_t hash = isCompressed()
         ? computeUtf16Hash(getDataCompressed(), getLength())
@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "cobra/VM/Verifier.h"
+#include "cobra/Inst/Inst.h"
+#include "Interpreter-inl.h"
+
+#include <vector>
+
+using namespace cobra;
+using namespace vm;
+using namespace inst;
+
+namespace {
+
+enum class OperandType : uint8_t {
+#define DEFINE_OPERAND_TYPE(name, type) name,
+#include "cobra/BCGen/BytecodeList.def"
+};
+
+const uint8_t operandSizes[] = {
+#define DEFINE_OPERAND_TYPE(name, type) sizeof(type),
+#include "cobra/BCGen/BytecodeList.def"
+};
+
+/// The operand types of an opcode.
+struct OpCodeInfo {
+  uint8_t numOperands;
+  OperandType operands[6];
+};
+
+const OpCodeInfo opCodeInfos[] = {
+#define DEFINE_OPCODE_0(name) {0, {}},
+#define DEFINE_OPCODE_1(name, t1) {1, {OperandType::t1}},
+#define DEFINE_OPCODE_2(name, t1, t2) \
+  {2, {OperandType::t1, OperandType::t2}},
+#define DEFINE_OPCODE_3(name, t1, t2, t3) \
+  {3, {OperandType::t1, OperandType::t2, OperandType::t3}},
+#define DEFINE_OPCODE_4(name, t1, t2, t3, t4) \
+  {4, {OperandType::t1, OperandType::t2, OperandType::t3, OperandType::t4}},
+#define DEFINE_OPCODE_5(name, t1, t2, t3, t4, t5)                          \
+  {5,                                                                      \
+   {OperandType::t1, OperandType::t2, OperandType::t3, OperandType::t4,    \
+    OperandType::t5}},
+#define DEFINE_OPCODE_6(name, t1, t2, t3, t4, t5, t6)                      \
+  {6,                                                                      \
+   {OperandType::t1, OperandType::t2, OperandType::t3, OperandType::t4,    \
+    OperandType::t5, OperandType::t6}},
+#include "cobra/BCGen/BytecodeList.def"
+};
+
+const uint8_t instSizes[] = {
+#define DEFINE_OPCODE(name) sizeof(name##Inst),
+#include "cobra/BCGen/BytecodeList.def"
+};
+
+const char *opCodeNames[] = {
+#define DEFINE_OPCODE(name) #name,
+#include "cobra/BCGen/BytecodeList.def"
+};
+
+/// \return the number of the string ID operand of \p opCode, 0 if none.
+unsigned getStringOperand(OpCode opCode) {
+  switch (opCode) {
+#define OPERAND_STRING_ID(name, operandNumber) \
+  case OpCode::name:                           \
+    return operandNumber;
+#include "cobra/BCGen/BytecodeList.def"
+    default:
+      return 0;
+  }
+}
+
+/// \return the number of the function ID operand of \p opCode, 0 if none.
+unsigned getFunctionOperand(OpCode opCode) {
+  switch (opCode) {
+#define OPERAND_FUNCTION_ID(name, operandNumber) \
+  case OpCode::name:                             \
+    return operandNumber;
+#include "cobra/BCGen/BytecodeList.def"
+    default:
+      return 0;
+  }
+}
+
+/// \return true if execution never continues after an instruction with
+/// opcode \p opCode.
+bool isTerminator(OpCode opCode) {
+  switch (opCode) {
+    case OpCode::Ret:
+    case OpCode::RetObject:
+    case OpCode::RetVoid:
+    case OpCode::RetWide:
+    case OpCode::Jmp:
+    case OpCode::JmpLong:
+    case OpCode::Unreachable:
+      return true;
+    default:
+      return false;
+  }
+}
+
+/// Verifies the instructions of one method.
+class MethodVerifier {
+public:
+  MethodVerifier(
+      Method *method,
+      const uint8_t *insts,
+      uint32_t codeSize,
+      std::string &error)
+      : method_(method),
+        insts_(insts),
+        codeSize_(codeSize),
+        error_(error),
+        boundaries_(codeSize, false) {}
+
+  bool verify() {
+    return findInstructions() && verifyOperands();
+  }
+
+  /// Rewrite the instructions that check at runtime what was verified into
+  /// their unchecked variants.
+  void rewriteCheckedInstructions() {
+    for (uint32_t offset = 0; offset < codeSize_;
+         offset += instSizes[insts_[offset]]) {
+      auto *ip = (const Inst *)(insts_ + offset);
+      switch (ip->opCode) {
+        case OpCode::LoadParam:
+          patchOpCode(ip, OpCode::LoadParamUnchecked);
+          break;
+        case OpCode::LoadParamWide:
+          patchOpCode(ip, OpCode::LoadParamWideUnchecked);
+          break;
+        default:
+          break;
+      }
+    }
+  }
+
+private:
+  Method *method_;
+  const uint8_t *insts_;
+  uint32_t codeSize_;
+  std::string &error_;
+
+  /// Whether an instruction starts at each offset.
+  std::vector<bool> boundaries_;
+
+  bool fail(uint32_t offset, const std::string &message) {
+    error_ = "offset " + std::to_string(offset);
+    if (offset < codeSize_ && insts_[offset] < (unsigned)OpCode::_last)
+      error_ += std::string(" (") + opCodeNames[insts_[offset]] + ")";
+    error_ += ": " + message;
+    return false;
+  }
+
+  /// Decode the instruction boundaries, and check that every instruction is
+  /// complete.
+  bool findInstructions() {
+    if (codeSize_ == 0)
+      return fail(0, "empty code");
+    uint32_t offset = 0;
+    OpCode last = OpCode::Unreachable;
+    while (offset < codeSize_) {
+      if (insts_[offset] >= (unsigned)OpCode::_last)
+        return fail(offset, "invalid opcode");
+      last = (OpCode)insts_[offset];
+      if (instSizes[insts_[offset]] > codeSize_ - offset)
+        return fail(offset, "truncated instruction");
+      boundaries_[offset] = true;
+      offset += instSizes[insts_[offset]];
+    }
+    if (!isTerminator(last))
+      return fail(codeSize_, "execution falls through the end of the code");
+    return true;
+  }
+
+  bool verifyOperands() {
+    uint32_t frameSize = method_->getFrameSize();
+    const CexFile *file = method_->getCexFile();
+    uint32_t stringCount = file ? file->stringIdxCount() : 0;
+    uint32_t functionCount = file ? file->methodIdxCount() : 0;
+
+    for (uint32_t offset = 0; offset < codeSize_;
+         offset += instSizes[insts_[offset]]) {
+      auto opCode = (OpCode)insts_[offset];
+      const OpCodeInfo &info = opCodeInfos[(unsigned)opCode];
+      unsigned stringOperand = getStringOperand(opCode);
+      unsigned functionOperand = getFunctionOperand(opCode);
+
+      const uint8_t *operand = insts_ + offset + 1;
+      for (unsigned i = 0; i < info.numOperands; ++i) {
+        OperandType type = info.operands[i];
+        int64_t value = readOperand(type, operand);
+        operand += operandSizes[(unsigned)type];
+        unsigned number = i + 1;
+
+        switch (type) {
+          case OperandType::Reg8:
+          case OperandType::Reg16:
+          case OperandType::Reg32:
+            if (value >= frameSize)
+              return fail(offset, "register out of frame bounds");
+            break;
+          case OperandType::Addr8:
+          case OperandType::Addr32: {
+            int64_t target = (int64_t)offset + value;
+            if (target < 0 || target >= codeSize_ || !boundaries_[target])
+              return fail(offset, "jump target is not an instruction");
+            break;
+          }
+          default:
+            break;
+        }
+        if (number == stringOperand && value >= stringCount)
+          return fail(offset, "string ID out of range");
+        if (number == functionOperand && value >= functionCount)
+          return fail(offset, "function ID out of range");
+      }
+
+      if (!verifyInstruction(offset, (const Inst *)(insts_ + offset)))
+        return false;
+    }
+    return true;
+  }
+
+  /// Check the operands whose range depends on the instruction.
+  bool verifyInstruction(uint32_t offset, const Inst *ip) {
+    switch (ip->opCode) {
+      case OpCode::LoadParam:
+        if (ip->iLoadParam.op2 > method_->getArgCount())
+          return fail(offset, "parameter is not declared");
+        break;
+      case OpCode::LoadParamWide:
+        if (ip->iLoadParamWide.op2 > method_->getArgCount())
+          return fail(offset, "parameter is not declared");
+        break;
+      case OpCode::LoadParamUnchecked:
+      case OpCode::LoadParamWideUnchecked:
+        return fail(offset, "unchecked instruction in unverified code");
+      case OpCode::GetField:
+        if (!isInlineCacheIndex(ip->iGetField.op3))
+          return fail(offset, "inline cache index out of range");
+        break;
+      case OpCode::SetField:
+        if (!isInlineCacheIndex(ip->iSetField.op3))
+          return fail(offset, "inline cache index out of range");
+        break;
+      case OpCode::Call:
+        // The arguments are the last registers of the frame.
+        if (ip->iCall.op3 == 0 || ip->iCall.op3 > method_->getFrameSize())
+          return fail(offset, "invalid argument count");
+        break;
+      default:
+        break;
+    }
+    return true;
+  }
+
+  /// \return true if \p idx is an index of the inline cache table of the
+  /// method, or kNoInlineCacheIndex for an access without a cache.
+  bool isInlineCacheIndex(uint16_t idx) const {
+    return idx == kNoInlineCacheIndex || idx < method_->getInlineCacheCount();
+  }
+
+  static int64_t readOperand(OperandType operandType, const uint8_t *operand) {
+    switch (operandType) {
+#define DEFINE_OPERAND_TYPE(name, type)                                 \
+  case OperandType::name: {                                             \
+    type value;                                                         \
+    memcpy(&value, operand, sizeof(type));                              \
+    return std::is_floating_point<type>::value ? 0 : (int64_t)value;   \
+  }
+#include "cobra/BCGen/BytecodeList.def"
+    }
+    return 0;
+  }
+};
+
+} // namespace
+
+bool Verifier::verify(Method *method, uint32_t codeSize, std::string &error) {
+  return verify(method, method->getInstructions(), codeSize, error);
+}
+
+bool Verifier::verify(
+    Method *method,
+    const uint8_t *insts,
+    uint32_t codeSize,
+    std::string &error) {
+  if (method->isVerified())
+    return true;
+  MethodVerifier verifier(method, insts, codeSize, error);
+  if (!verifier.verify())
+    return false;
+  verifier.rewriteCheckedInstructions();
+  method->setAccessFlags(method->getAccessFlags() | kAccVerified);
+  return true;
+}
@@ -9,6 +9,8 @@
 #include <string>
 #include <fstream>
 #include "cobra/VM/CobraVM.h"
+#include "cobra/VM/HeapSnapshot.h"
+#include "cobra/VM/Runtime.h"
 #include "cobra/Driver/Driver.h"
 #include "cobra/Support/BitSet.h"
 
@@ -25,11 +27,203 @@ static std::string loadFile(std::string path) {
   return source;
 }
 
+static constexpr const char kProfileInterpFlag[] = "--profile-interp=";
+static constexpr const char kEmitObjectFlag[] = "--emit-object=";
+static constexpr const char kSampleProfileFlag[] = "--sample-profile=";
+static constexpr const char kHugePagesFlag[] = "--huge-pages";
+static constexpr const char kGCStatsFlag[] = "--gc-stats";
+static constexpr const char kHeapSnapshotFlag[] = "--heap-snapshot=";
+static constexpr const char kSampleAllocationsFlag[] = "--sample-allocations=";
+
+#ifdef COBRA_SAMPLING_PROFILER
+/// \return true if \p str ends with \p suffix.
+static bool endsWith(const std::string &str, const std::string &suffix) {
+  return str.size() >= suffix.size() &&
+      str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+#endif
+
 int main(int argc, const char * argv[]) {
   
-  std::string source = loadFile(argv[1]);
+  std::string sourcePath;
+  std::string profilePath;
+  std::string objectPath;
+  std::string samplePath;
+  std::string gcStatsPath;
+  std::string snapshotPath;
+  std::string allocationsPath;
+  bool gcStats = false;
+  RuntimeOptions options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.rfind(kProfileInterpFlag, 0) == 0) {
+      profilePath = arg.substr(sizeof(kProfileInterpFlag) - 1);
+    } else if (arg.rfind(kEmitObjectFlag, 0) == 0) {
+      objectPath = arg.substr(sizeof(kEmitObjectFlag) - 1);
+    } else if (arg.rfind(kSampleProfileFlag, 0) == 0) {
+      samplePath = arg.substr(sizeof(kSampleProfileFlag) - 1);
+    } else if (arg == kGCStatsFlag) {
+      gcStats = true;
+    } else if (arg.rfind(kGCStatsFlag, 0) == 0 &&
+               arg[sizeof(kGCStatsFlag) - 1] == '=') {
+      gcStats = true;
+      gcStatsPath = arg.substr(sizeof(kGCStatsFlag));
+    } else if (arg.rfind(kHeapSnapshotFlag, 0) == 0) {
+      snapshotPath = arg.substr(sizeof(kHeapSnapshotFlag) - 1);
+    } else if (arg.rfind(kSampleAllocationsFlag, 0) == 0) {
+      allocationsPath = arg.substr(sizeof(kSampleAllocationsFlag) - 1);
+    } else if (arg == kHugePagesFlag) {
+      options.setHugePages(true);
+    } else {
+      sourcePath = arg;
+    }
+  }
+  
+  if (sourcePath.empty()) {
+    std::cerr << "usage: cobra [--profile-interp=<file.json>] "
+                 "[--sample-profile=<file.folded|file.json>] "
+                 "[--sample-allocations=<file.json>] "
+                 "[--emit-object=<file.o>] [--gc-stats[=<file.json>]] "
+                 "[--heap-snapshot=<file.heapsnapshot>] "
+                 "[--huge-pages] <source>\n";
+    return 1;
+  }
+  
+#ifndef COBRA_INTERPRETER_PROFILER
+  if (!profilePath.empty()) {
+    std::cerr << "--profile-interp requires a build with "
+                 "COBRA_INTERPRETER_PROFILER\n";
+    return 1;
+  }
+#endif
+  
+#ifndef COBRA_SAMPLING_PROFILER
+  if (!samplePath.empty()) {
+    std::cerr << "--sample-profile requires a build with "
+                 "COBRA_SAMPLING_PROFILER\n";
+    return 1;
+  }
+#endif
+  
+#ifndef COBRA_ALLOCATION_SAMPLER
+  if (!allocationsPath.empty()) {
+    std::cerr << "--sample-allocations requires a build with "
+                 "COBRA_ALLOCATION_SAMPLER\n";
+    return 1;
+  }
+#endif
+  
+#ifndef COBRA_ENABLE_LLVM_BACKEND
+  if (!objectPath.empty()) {
+    std::cerr << "--emit-object requires a build with the LLVM backend\n";
+    return 1;
+  }
+#endif
+  
+  std::string source = loadFile(sourcePath);
+  
+#ifdef COBRA_ENABLE_LLVM_BACKEND
+  if (!objectPath.empty())
+    return driver::compileToObject(source, objectPath) ? 0 : 1;
+#endif
+  
+  // Create the runtime up front, so that it gets the options of the command
+  // line rather than the default ones of the driver.
+  vm::Runtime::create(options);
+  
+#ifdef COBRA_SAMPLING_PROFILER
+  if (!samplePath.empty()) {
+    // The runtime was created up front, so its frames are sampled from the
+    // start.
+    vm::Runtime *runtime = vm::Runtime::getCurrent();
+    if (!runtime || !runtime->getSamplingProfiler().start(runtime)) {
+      std::cerr << "cannot start the sampling profiler\n";
+      return 1;
+    }
+  }
+#endif
+  
+#ifdef COBRA_ALLOCATION_SAMPLER
+  if (!allocationsPath.empty()) {
+    vm::Runtime *runtime = vm::Runtime::getCurrent();
+    if (!runtime || !runtime->getAllocationSampler().start(runtime)) {
+      std::cerr << "cannot start the allocation sampler\n";
+      return 1;
+    }
+  }
+#endif
+  
   driver::compile(source);
   
+#ifdef COBRA_ALLOCATION_SAMPLER
+  if (!allocationsPath.empty()) {
+    auto &sampler = vm::Runtime::getCurrent()->getAllocationSampler();
+    sampler.stop();
+    std::ofstream file{allocationsPath};
+    if (!file) {
+      std::cerr << "cannot open " << allocationsPath << "\n";
+      return 1;
+    }
+    sampler.dumpJSON(file);
+  }
+#endif
+  
+#ifdef COBRA_SAMPLING_PROFILER
+  if (!samplePath.empty()) {
+    auto &profiler = vm::Runtime::getCurrent()->getSamplingProfiler();
+    profiler.stop();
+    std::ofstream profile{samplePath};
+    if (!profile) {
+      std::cerr << "cannot open " << samplePath << "\n";
+      return 1;
+    }
+    if (endsWith(samplePath, ".json"))
+      profiler.dumpChromeTrace(profile);
+    else
+      profiler.dumpFoldedStacks(profile);
+    if (profiler.getDroppedSamples())
+      std::cerr << profiler.getDroppedSamples() << " samples were dropped\n";
+  }
+#endif
+  
+#ifdef COBRA_INTERPRETER_PROFILER
+  if (!profilePath.empty()) {
+    std::ofstream profile{profilePath};
+    if (!profile) {
+      std::cerr << "cannot open " << profilePath << "\n";
+      return 1;
+    }
+    vm::Runtime::getCurrent()->getInterpreterProfiler().dumpJSON(profile);
+  }
+#endif
+  
+  if (gcStats) {
+    vm::Runtime::getCurrent()->getHeap().measureHugePages();
+    auto &stats = vm::Runtime::getCurrent()->getGCStats();
+    if (gcStatsPath.empty()) {
+      stats.dumpJSON(std::cerr);
+    } else {
+      std::ofstream file{gcStatsPath};
+      if (!file) {
+        std::cerr << "cannot open " << gcStatsPath << "\n";
+        return 1;
+      }
+      stats.dumpJSON(file);
+    }
+  }
+  
+  if (!snapshotPath.empty()) {
+    // The objects still held by the registers of the runtime when the
+    // program returned.
+    vm::HeapSnapshot snapshot(*vm::Runtime::getCurrent());
+    std::ofstream file{snapshotPath};
+    if (!file) {
+      std::cerr << "cannot open " << snapshotPath << "\n";
+      return 1;
+    }
+    snapshot.dumpJSON(file);
+  }
+  
 //  auto to = cbLexer.advance();
 //
 //  while (to->getKind() != parser::TokenKind::eof) {
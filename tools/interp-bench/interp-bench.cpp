@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Compare the dispatch strategies of the interpreter on the same bytecode.
+// Every benchmark is a loop built directly out of instructions, which is run
+// on a fresh copy of its bytecode by each strategy, so quickening does not
+// leak from one run to the next.
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "cobra/Inst/Inst.h"
+#include "cobra/VM/Interpreter.h"
+#include "cobra/VM/Runtime.h"
+
+using namespace cobra;
+using namespace vm;
+using namespace inst;
+
+namespace {
+
+/// Appends instructions to a bytecode buffer.
+class BytecodeBuilder {
+  std::vector<uint8_t> insts_;
+
+public:
+  /// Append \p inst. \return its offset.
+  template <typename T>
+  uint32_t emit(const T &inst) {
+    uint32_t offset = insts_.size();
+    insts_.resize(offset + sizeof(T));
+    memcpy(&insts_[offset], &inst, sizeof(T));
+    return offset;
+  }
+
+  uint32_t getCurrentOffset() const {
+    return insts_.size();
+  }
+
+  /// \return the jump offset from the instruction at \p from to \p to.
+  static int32_t jumpOffset(uint32_t from, uint32_t to) {
+    return (int32_t)to - (int32_t)from;
+  }
+
+  const std::vector<uint8_t> &getInstructions() const {
+    return insts_;
+  }
+};
+
+struct Benchmark {
+  const char *name;
+  std::vector<uint8_t> insts;
+  /// Number of registers used by the bytecode.
+  uint32_t frameSize;
+  /// Number of instructions executed by one run of the benchmark.
+  uint64_t instructions;
+};
+
+/// sum += i - (i & 7) for i in [0, n): generic arithmetic that quickens into
+/// numeric instructions, and a bitwise operator.
+Benchmark buildArithmetic(uint32_t n) {
+  BytecodeBuilder B;
+  B.emit(LoadConstZeroInst{OpCode::LoadConstZero, 0});
+  B.emit(LoadConstZeroInst{OpCode::LoadConstZero, 1});
+  B.emit(LoadConstDoubleInst{OpCode::LoadConstDouble, 2, (double)n});
+  B.emit(LoadConstUInt8Inst{OpCode::LoadConstUInt8, 3, 1});
+  B.emit(LoadConstUInt8Inst{OpCode::LoadConstUInt8, 4, 7});
+  uint32_t loop = B.getCurrentOffset();
+  B.emit(AddInst{OpCode::Add, 0, 0, 1});
+  B.emit(BitAndInst{OpCode::BitAnd, 5, 1, 4});
+  B.emit(SubInst{OpCode::Sub, 0, 0, 5});
+  B.emit(AddInst{OpCode::Add, 1, 1, 3});
+  uint32_t jump = B.getCurrentOffset();
+  B.emit(JLessNLongInst{
+      OpCode::JLessNLong, BytecodeBuilder::jumpOffset(jump, loop), 1, 2});
+  B.emit(RetInst{OpCode::Ret, 0});
+  // 5 instructions before the loop, 5 per iteration and the return.
+  return {"arithmetic", B.getInstructions(), 6, 5 + 5 * (uint64_t)n + 1};
+}
+
+/// Count the multiples of 3 in [0, n): a compare-and-branch that is taken
+/// two thirds of the time.
+Benchmark buildBranches(uint32_t n) {
+  BytecodeBuilder B;
+  B.emit(LoadConstZeroInst{OpCode::LoadConstZero, 0});
+  B.emit(LoadConstZeroInst{OpCode::LoadConstZero, 1});
+  B.emit(LoadConstDoubleInst{OpCode::LoadConstDouble, 2, (double)n});
+  B.emit(LoadConstUInt8Inst{OpCode::LoadConstUInt8, 3, 1});
+  B.emit(LoadConstUInt8Inst{OpCode::LoadConstUInt8, 4, 3});
+  B.emit(LoadConstZeroInst{OpCode::LoadConstZero, 6});
+  uint32_t loop = B.getCurrentOffset();
+  B.emit(ModInst{OpCode::Mod, 5, 1, 4});
+  uint32_t skipJump = B.emit(JNotEqNInst{OpCode::JNotEqN, 0, 5, 6});
+  B.emit(AddInst{OpCode::Add, 0, 0, 3});
+  uint32_t skip = B.getCurrentOffset();
+  B.emit(AddInst{OpCode::Add, 1, 1, 3});
+  uint32_t jump = B.getCurrentOffset();
+  B.emit(JLessNLongInst{
+      OpCode::JLessNLong, BytecodeBuilder::jumpOffset(jump, loop), 1, 2});
+  B.emit(RetInst{OpCode::Ret, 0});
+
+  // 6 instructions before the loop, 4 per iteration plus the Add of the
+  // (n + 2) / 3 iterations on a multiple of 3, and the return.
+  Benchmark benchmark{
+      "branches",
+      B.getInstructions(),
+      7,
+      6 + 4 * (uint64_t)n + (n + 2) / 3 + 1};
+  // Patch the forward jump once its target is known.
+  auto *skipInst = (JNotEqNInst *)&benchmark.insts[skipJump];
+  skipInst->op1 = BytecodeBuilder::jumpOffset(skipJump, skip);
+  return benchmark;
+}
+
+struct Result {
+  CBValue value;
+  double seconds;
+};
+
+/// Run \p benchmark once with \p dispatch, on a copy of its bytecode.
+bool run(const Benchmark &benchmark, Interpreter::Dispatch dispatch,
+    Result &result) {
+  std::vector<uint8_t> insts = benchmark.insts;
+  RegisterStack &stack = Runtime::getCurrent()->getRegisterStack();
+  result.value = CBValue::encodeUndefinedValue();
+  StackFrame *frame = StackFrame::createWithFrameSize(
+      stack,
+      Runtime::getCurrent()->getCurrentFrame(),
+      nullptr,
+      benchmark.frameSize,
+      0,
+      stack.getTop(),
+      &result.value);
+  if (frame == nullptr)
+    return false;
+  frame->setInstructions(insts.data());
+
+  auto start = std::chrono::steady_clock::now();
+  bool ok = Interpreter::run(frame, dispatch);
+  auto end = std::chrono::steady_clock::now();
+  result.seconds = std::chrono::duration<double>(end - start).count();
+  return ok;
+}
+
+struct Strategy {
+  const char *name;
+  Interpreter::Dispatch dispatch;
+};
+
+const Strategy strategies[] = {
+  {"computed-goto", Interpreter::Dispatch::ComputedGoto},
+#ifdef COBRA_MUSTTAIL
+  {"tail-call", Interpreter::Dispatch::TailCall},
+#endif
+};
+
+} // namespace
+
+int main(int argc, const char *argv[]) {
+  uint32_t iterations = 10000000;
+  uint32_t repetitions = 5;
+  if (argc > 1)
+    iterations = std::strtoul(argv[1], nullptr, 10);
+  if (argc > 2)
+    repetitions = std::strtoul(argv[2], nullptr, 10);
+  if (argc > 3 || iterations == 0 || repetitions == 0) {
+    std::cerr << "usage: interp-bench [iterations] [repetitions]\n";
+    return 1;
+  }
+
+  if (!Runtime::create(RuntimeOptions())) {
+    std::cerr << "cannot create the runtime\n";
+    return 1;
+  }
+
+#ifndef COBRA_MUSTTAIL
+  std::cout << "The tail-call interpreter is not available with this "
+               "compiler, only running computed goto.\n";
+#endif
+
+  const Benchmark benchmarks[] = {
+    buildArithmetic(iterations),
+    buildBranches(iterations),
+  };
+
+  std::cout << std::left << std::setw(12) << "benchmark" << std::setw(16)
+            << "dispatch" << std::setw(12) << "best (s)" << "ns/inst"
+            << "\n";
+  for (auto &benchmark : benchmarks) {
+    CBValue expected = CBValue::encodeUndefinedValue();
+    for (auto &strategy : strategies) {
+      double best = 0;
+      for (uint32_t i = 0; i < repetitions; ++i) {
+        Result result;
+        if (!run(benchmark, strategy.dispatch, result)) {
+          std::cerr << benchmark.name << ": "
+                    << Runtime::getCurrent()->getPendingError() << "\n";
+          return 1;
+        }
+        if (expected.isUndefined()) {
+          expected = result.value;
+        } else if (result.value.getRaw() != expected.getRaw()) {
+          std::cerr << benchmark.name << ": " << strategy.name
+                    << " computed a different result\n";
+          return 1;
+        }
+        if (i == 0 || result.seconds < best)
+          best = result.seconds;
+      }
+      double instructions = (double)benchmark.instructions;
+      std::cout << std::left << std::setw(12) << benchmark.name
+                << std::setw(16) << strategy.name << std::setw(12)
+                << std::fixed << std::setprecision(4) << best
+                << std::setprecision(3) << best * 1e9 / instructions << "\n";
+    }
+  }
+
+  return 0;
+}
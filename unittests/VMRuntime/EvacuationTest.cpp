@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "TestHelpers.h"
+
+using namespace cobra;
+using namespace cobra::vm;
+
+namespace {
+
+class EvacuationTest : public HeapTestFixture {
+protected:
+  /// Number of nodes of the table, and the stride of the ones kept.
+  static constexpr uint32_t kCount = 400000;
+  static constexpr uint32_t kStride = 20;
+
+  enum { Table, Chain, kNumRoots };
+
+  EvacuationTest() : roots(allocateRoots(kNumRoots)) {}
+
+  CBValue *table() {
+    return elements(toArray(roots[Table]));
+  }
+
+  /// Fill several old regions with nodes holding their index, referenced
+  /// from a large table, link every kStride-th node to the next kept one,
+  /// and drop the others so that the regions end up sparse.
+  void createSparseRegions() {
+    roots[Table] = CBValue::encodeObjectValue(Array::create(gc, kCount));
+    for (uint32_t i = 0; i < kCount; ++i) {
+      Array *node = Array::create(gc, 2);
+      elements(node)[0] = makeNumber(i);
+      store(toArray(roots[Table]), i, CBValue::encodeObjectValue(node));
+    }
+    gc.collectYoung();
+    for (uint32_t i = 0; i + kStride < kCount; i += kStride)
+      store(toArray(table()[i]), 1, table()[i + kStride]);
+    roots[Chain] = table()[0];
+    for (uint32_t i = 0; i < kCount; ++i) {
+      if (i % kStride != 0)
+        store(toArray(roots[Table]), i, CBValue::encodeUndefinedValue());
+    }
+  }
+
+  /// Check the kept nodes, and that the chain and the table reference the
+  /// same copies.
+  void checkKeptNodes() {
+    uint32_t index = 0;
+    for (CBValue node = roots[Chain]; node.isObject();
+         node = elements(toArray(node))[1]) {
+      ASSERT_EQ(table()[index].getRaw(), node.getRaw());
+      ASSERT_EQ(index, elements(toArray(node))[0].getNumber());
+      index += kStride;
+    }
+    EXPECT_EQ(kCount, index);
+  }
+
+  CBValue *roots;
+};
+
+TEST_F(EvacuationTest, EvacuatesSparseRegions) {
+  createSparseRegions();
+  // The first collection finds the live bytes of the regions, the second
+  // one evacuates the sparse ones.
+  gc.collectOld();
+  EXPECT_EQ(0u, gc.getEvacuatedBytes());
+  uint32_t regions = gc.getOldSpace().getRegionCount();
+  void *first = roots[Chain].getObject();
+  gc.collectOld();
+
+  EXPECT_GT(gc.getEvacuatedBytes(), 0u);
+  EXPECT_LT(gc.getOldSpace().getRegionCount(), regions);
+  EXPECT_NE(first, roots[Chain].getObject());
+  EXPECT_TRUE(gc.getOldSpace().contains(roots[Chain].getObject()));
+  ASSERT_NO_FATAL_FAILURE(checkKeptNodes());
+
+  // The evacuated nodes survive the following collections.
+  gc.collectOld();
+  ASSERT_NO_FATAL_FAILURE(checkKeptNodes());
+}
+
+TEST_F(EvacuationTest, KeepsDenseRegions) {
+  roots[Table] = CBValue::encodeObjectValue(Array::create(gc, kCount));
+  for (uint32_t i = 0; i < kCount; ++i) {
+    Array *node = Array::create(gc, 2);
+    elements(node)[0] = makeNumber(i);
+    store(toArray(roots[Table]), i, CBValue::encodeObjectValue(node));
+  }
+  gc.collectYoung();
+  void *first = table()[0].getObject();
+  gc.collectOld();
+  gc.collectOld();
+  EXPECT_EQ(0u, gc.getEvacuatedBytes());
+  EXPECT_EQ(first, table()[0].getObject());
+}
+
+} // anonymous namespace
@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "TestHelpers.h"
+
+#include "cobra/VM/FreeList.h"
+
+using namespace cobra;
+using namespace cobra::vm;
+
+namespace {
+
+/// The chunks are taken from the old generation, as the free list records
+/// their boundaries in the card tables of their regions.
+class FreeListTest : public HeapTestFixture {
+protected:
+  char *allocChunk(size_t size) {
+    return static_cast<char *>(gc.allocOld(size));
+  }
+
+  static const GCCell *cellAt(const char *mem) {
+    return reinterpret_cast<const GCCell *>(mem);
+  }
+
+  FreeList list;
+};
+
+TEST_F(FreeListTest, ReusesChunksOfTheSameSize) {
+  EXPECT_EQ(nullptr, list.alloc(64));
+  char *chunk = allocChunk(64);
+  list.addChunk(chunk, 64);
+  EXPECT_EQ(64u, list.getFreeBytes());
+  EXPECT_EQ(chunk, list.alloc(64));
+  EXPECT_EQ(0u, list.getFreeBytes());
+  EXPECT_EQ(nullptr, list.alloc(64));
+}
+
+TEST_F(FreeListTest, SplitsLargerChunksFromTheirEnd) {
+  char *chunk = allocChunk(4096);
+  list.addChunk(chunk, 4096);
+  EXPECT_EQ(chunk + 4032, list.alloc(64));
+  EXPECT_EQ(4032u, list.getFreeBytes());
+  // The remainder keeps the start of the chunk, as a free cell.
+  EXPECT_EQ(FreeKind, cellAt(chunk)->getKind());
+  EXPECT_EQ(4032u, cellAt(chunk)->getSize());
+  EXPECT_EQ(chunk + 3968, list.alloc(64));
+}
+
+TEST_F(FreeListTest, SkipsTooSmallChunksOfALargeClass) {
+  // Both chunks fall in the class of the sizes from 1024 to 2047 bytes.
+  char *small = allocChunk(1096);
+  char *large = allocChunk(2000);
+  list.addChunk(large, 2000);
+  list.addChunk(small, 1096);
+  EXPECT_EQ(large + 496, list.alloc(1504));
+  EXPECT_EQ(small, list.alloc(1096));
+  EXPECT_EQ(496u, list.getFreeBytes());
+}
+
+TEST_F(FreeListTest, KeepsTinyRemaindersWalkable) {
+  size_t tiny = HeapAlign;
+  ASSERT_LT(tiny, sizeof(FreeCell));
+  char *chunk = allocChunk(64 + tiny);
+  list.addChunk(chunk, 64 + tiny);
+  EXPECT_EQ(chunk + tiny, list.alloc(64));
+  // The remainder is too small for the list, but still a cell.
+  EXPECT_EQ(0u, list.getFreeBytes());
+  EXPECT_EQ(FreeKind, cellAt(chunk)->getKind());
+  EXPECT_EQ(tiny, cellAt(chunk)->getSize());
+  EXPECT_EQ(nullptr, list.alloc(tiny));
+}
+
+TEST_F(FreeListTest, RemovesChunks) {
+  char *first = allocChunk(128);
+  char *second = allocChunk(128);
+  list.addChunk(first, 128);
+  list.addChunk(second, 128);
+  list.removeIf([&](FreeCell *cell) { return (char *)cell == first; });
+  EXPECT_EQ(128u, list.getFreeBytes());
+  EXPECT_EQ(second, list.alloc(128));
+  EXPECT_EQ(nullptr, list.alloc(128));
+
+  list.addChunk(first, 128);
+  list.clear();
+  EXPECT_EQ(0u, list.getFreeBytes());
+  EXPECT_EQ(nullptr, list.alloc(128));
+}
+
+class OldGenSweepTest : public HeapTestFixture {
+protected:
+  /// Number of objects of the table.
+  static constexpr uint32_t kCount = 20000;
+
+  /// \return the bytes allocated by bumping the top of the old regions.
+  size_t getOldBytes() {
+    size_t bytes = 0;
+    for (HeapRegion *region : gc.getOldSpace().getRegions())
+      bytes += region->top() - region->start();
+    return bytes;
+  }
+
+  /// Check that every old region is a sequence of arrays and free cells.
+  void checkWalkable() {
+    for (HeapRegion *region : gc.getOldSpace().getRegions()) {
+      for (char *mem = region->start(); mem < region->top();) {
+        auto *cell = reinterpret_cast<GCCell *>(mem);
+        ASSERT_TRUE(
+            cell->getKind() == ArrayKind || cell->getKind() == FreeKind);
+        ASSERT_NE(0u, cell->getSize());
+        mem += cell->getSize();
+      }
+    }
+  }
+
+  /// Fill the old table in \p root with arrays holding their index, and
+  /// drop the odd ones before collecting the old generation.
+  void createSparseTable(CBValue *root) {
+    *root = CBValue::encodeObjectValue(Array::create(gc, kCount));
+    for (uint32_t i = 0; i < kCount; ++i) {
+      Array *array = Array::create(gc, 6);
+      elements(array)[0] = makeNumber(i);
+      store(toArray(*root), i, CBValue::encodeObjectValue(array));
+    }
+    gc.collectYoung();
+    for (uint32_t i = 1; i < kCount; i += 2)
+      store(toArray(*root), i, CBValue::encodeUndefinedValue());
+    gc.collectOld();
+  }
+};
+
+TEST_F(OldGenSweepTest, SweepsLazily) {
+  CBValue *root = allocateRoots(1);
+  createSparseTable(root);
+  bool needsSweep = false;
+  for (HeapRegion *region : gc.getOldSpace().getRegions())
+    needsSweep |= region->needsSweep();
+  EXPECT_TRUE(needsSweep);
+
+  // Allocating sweeps until a region frees a large enough chunk.
+  auto *reused = static_cast<char *>(gc.allocOld(
+      Array::computeSize(sizeof(CBValue), 6)));
+  HeapRegion *region = HeapRegion::getHeapRegion(reused);
+  EXPECT_FALSE(region->needsSweep());
+  EXPECT_LT(reused, region->top());
+}
+
+TEST_F(OldGenSweepTest, PromotionsReuseSweptMemory) {
+  CBValue *root = allocateRoots(1);
+  createSparseTable(root);
+  size_t oldBytes = getOldBytes();
+  uint32_t oldRegions = gc.getOldSpace().getRegionCount();
+
+  for (uint32_t i = 1; i < kCount; i += 2) {
+    Array *array = Array::create(gc, 6);
+    elements(array)[0] = makeNumber(i);
+    store(toArray(*root), i, CBValue::encodeObjectValue(array));
+  }
+  gc.collectYoung();
+  EXPECT_EQ(oldBytes, getOldBytes());
+  EXPECT_EQ(oldRegions, gc.getOldSpace().getRegionCount());
+  for (uint32_t i = 0; i < kCount; ++i) {
+    Array *array = toArray(elements(toArray(*root))[i]);
+    ASSERT_TRUE(gc.getOldSpace().contains(array));
+    ASSERT_EQ(i, elements(array)[0].getNumber());
+  }
+  ASSERT_NO_FATAL_FAILURE(checkWalkable());
+}
+
+} // anonymous namespace
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "TestHelpers.h"
+
+#include <cctype>
+#include <sstream>
+
+#include "cobra/VM/GCStats.h"
+
+using namespace cobra;
+using namespace cobra::vm;
+
+namespace {
+
+/// A recursive descent parser of JSON, which only checks the syntax.
+class JSONChecker {
+public:
+  explicit JSONChecker(const std::string &text) : text_(text) {}
+
+  /// \return true if the text is a single valid JSON value.
+  bool check() {
+    if (!value())
+      return false;
+    skipSpaces();
+    return pos_ == text_.size();
+  }
+
+private:
+  void skipSpaces() {
+    while (pos_ < text_.size() && std::isspace((unsigned char)text_[pos_]))
+      ++pos_;
+  }
+
+  bool consume(char c) {
+    skipSpaces();
+    if (pos_ < text_.size() && text_[pos_] == c) {
+      ++pos_;
+      return true;
+    }
+    return false;
+  }
+
+  bool consumeWord(const char *word) {
+    size_t length = std::strlen(word);
+    if (text_.compare(pos_, length, word) != 0)
+      return false;
+    pos_ += length;
+    return true;
+  }
+
+  bool string() {
+    if (!consume('"'))
+      return false;
+    while (pos_ < text_.size() && text_[pos_] != '"') {
+      if (text_[pos_] == '\\')
+        ++pos_;
+      ++pos_;
+    }
+    return consume('"');
+  }
+
+  bool number() {
+    size_t start = pos_;
+    if (pos_ < text_.size() && text_[pos_] == '-')
+      ++pos_;
+    while (pos_ < text_.size() &&
+           (std::isdigit((unsigned char)text_[pos_]) ||
+            std::strchr(".eE+-", text_[pos_])))
+      ++pos_;
+    return pos_ > start && std::isdigit((unsigned char)text_[pos_ - 1]);
+  }
+
+  template <typename Fn>
+  bool sequence(char close, Fn element) {
+    if (consume(close))
+      return true;
+    do {
+      if (!element())
+        return false;
+    } while (consume(','));
+    return consume(close);
+  }
+
+  bool value() {
+    skipSpaces();
+    if (pos_ >= text_.size())
+      return false;
+    switch (text_[pos_]) {
+      case '{':
+        ++pos_;
+        return sequence(
+            '}', [&] { return string() && consume(':') && value(); });
+      case '[':
+        ++pos_;
+        return sequence(']', [&] { return value(); });
+      case '"':
+        return string();
+      case 't':
+        return consumeWord("true");
+      case 'f':
+        return consumeWord("false");
+      case 'n':
+        return consumeWord("null");
+      default:
+        return number();
+    }
+  }
+
+  const std::string &text_;
+  size_t pos_{0};
+};
+
+size_t countOccurrences(const std::string &text, const std::string &word) {
+  size_t count = 0;
+  for (size_t pos = text.find(word); pos != std::string::npos;
+       pos = text.find(word, pos + 1))
+    ++count;
+  return count;
+}
+
+TEST(GCStatsTest, TotalsEveryPause) {
+  GCStats stats;
+  for (unsigned i = 0; i < 3; ++i) {
+    stats.beginCollection(GCKind::Young, GCTrigger::YoungFull, 1000);
+    stats.current().promotedBytes = 100;
+    stats.endCollection();
+  }
+  stats.addLargeAllocation(5000);
+  stats.beginCollection(GCKind::Full, GCTrigger::Explicit, 0);
+  stats.endCollection();
+
+  EXPECT_EQ(4u, stats.getCollectionCount());
+  ASSERT_EQ(4u, stats.getCollections().size());
+  EXPECT_EQ(300u, stats.getTotalPromotedBytes());
+  EXPECT_EQ(8000u, stats.getTotalAllocatedBytes());
+  EXPECT_EQ(5000u, stats.getCollections()[3].allocatedBytes);
+  EXPECT_DOUBLE_EQ(0.1, stats.getCollections()[0].getSurvivalRate());
+
+  uint64_t histogram = 0;
+  for (unsigned bucket = 0; bucket < GCStats::kNumPauseBuckets; ++bucket)
+    histogram += stats.getPauseBucketCount(bucket);
+  EXPECT_EQ(4u, histogram);
+  EXPECT_LE(stats.getPausePercentile(0.5), stats.getMaxPauseMicros());
+  EXPECT_LE(stats.getMaxPauseMicros(), stats.getTotalPauseMicros());
+}
+
+TEST(GCStatsTest, KeepsTheFirstRecords) {
+  GCStats stats;
+  size_t count = GCStats::kMaxRecordedCollections + 10;
+  for (size_t i = 0; i < count; ++i) {
+    stats.beginCollection(GCKind::Young, GCTrigger::YoungFull, i);
+    stats.endCollection();
+  }
+  EXPECT_EQ(count, stats.getCollectionCount());
+  ASSERT_EQ(GCStats::kMaxRecordedCollections, stats.getCollections().size());
+  EXPECT_EQ(0u, stats.getCollections().front().youngBytes);
+}
+
+using GCStatsHeapTest = HeapTestFixture;
+
+TEST_F(GCStatsHeapTest, RecordsThePausesOfTheHeap) {
+  CBValue *roots = allocateRoots(1);
+  roots[0] = CBValue::encodeObjectValue(Array::create(gc, 100));
+  gc.collectYoung();
+  gc.collectYoung();
+  gc.collectOld();
+
+  const GCStats &stats = gc.getStats();
+  ASSERT_EQ(3u, stats.getCollections().size());
+  const GCCollectionStats &first = stats.getCollections()[0];
+  EXPECT_EQ(GCKind::Young, first.kind);
+  EXPECT_EQ(GCTrigger::Explicit, first.trigger);
+  EXPECT_GE(first.promotedBytes, toArray(roots[0])->getSize());
+  EXPECT_GE(first.youngBytes, first.promotedBytes);
+  EXPECT_LE(first.youngRegions, GC::kYoungRegionCount);
+  EXPECT_GT(first.oldRegions, 0u);
+
+  const GCCollectionStats &last = stats.getCollections()[2];
+  EXPECT_EQ(GCKind::Full, last.kind);
+  EXPECT_TRUE(last.finishedOldCollection);
+}
+
+TEST_F(GCStatsHeapTest, DumpsValidJSON) {
+  CBValue *roots = allocateRoots(1);
+  roots[0] = CBValue::encodeObjectValue(Array::create(gc, 100));
+  gc.collectYoung();
+  gc.collectYoung();
+  gc.collectOld();
+  gc.measureHugePages();
+
+  std::ostringstream os;
+  gc.getStats().dumpJSON(os);
+  std::string json = os.str();
+  EXPECT_TRUE(JSONChecker(json).check()) << json;
+  EXPECT_NE(std::string::npos, json.find("\"collections\": 3,"));
+  EXPECT_NE(
+      std::string::npos,
+      json.find("\"kinds\": {\"young\": 2, \"incremental\": 0, \"full\": 1}"));
+  EXPECT_NE(std::string::npos, json.find("\"hugePages\": {"));
+  EXPECT_EQ(3u, countOccurrences(json, "\"trigger\": \"explicit\""));
+  EXPECT_EQ(1u, countOccurrences(json, "\"finishedOldCollection\": true"));
+}
+
+} // anonymous namespace
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "TestHelpers.h"
+
+using namespace cobra;
+using namespace cobra::vm;
+
+namespace {
+
+class IncrementalMarkingTest : public HeapTestFixture {
+protected:
+  /// Length of the arrays of the chains, about 512 bytes each.
+  static constexpr uint32_t kNodeLength = 62;
+
+  /// Bytes of the old chain, more than the first marking step scans and
+  /// less than the old generation holds before its first marking.
+  static constexpr size_t kChainBytes = 22 * 1024 * 1024;
+
+  enum { Chain, Hidden, Extra, kNumRoots };
+
+  IncrementalMarkingTest() : roots(allocateRoots(kNumRoots)) {}
+
+  /// Prepend a node holding \p value to the chain in \p head.
+  void prepend(CBValue &head, size_t value) {
+    Array *node = Array::create(gc, kNodeLength);
+    ASSERT_NE(nullptr, node);
+    elements(node)[0] = head;
+    elements(node)[1] = makeNumber(value);
+    head = CBValue::encodeObjectValue(node);
+  }
+
+  /// \return the last node of the chain in \p head.
+  static Array *getLast(CBValue head) {
+    Array *node = toArray(head);
+    while (elements(node)[0].isObject())
+      node = toArray(elements(node)[0]);
+    return node;
+  }
+
+  /// \return the length of the chain in \p head, checking its values.
+  static size_t checkChain(CBValue head, size_t length) {
+    size_t count = 0;
+    for (; head.isObject(); head = elements(toArray(head))[0]) {
+      EXPECT_EQ(length - 1 - count, elements(toArray(head))[1].getNumber());
+      ++count;
+    }
+    return count;
+  }
+
+  /// Build an old chain of kChainBytes in Chain, whose last node holds the
+  /// only reference to the old array hidden, then grow the old generation
+  /// with the chain in Extra until a young collection starts a marking. The
+  /// first step of the marking cannot reach the end of the chain.
+  void startMarking() {
+    prepend(roots[Chain], 0);
+    roots[Hidden] = CBValue::encodeObjectValue(Array::create(gc, 1));
+    elements(toArray(roots[Chain]))[2] = roots[Hidden];
+    size_t nodeSize = Array::computeSize(sizeof(CBValue), kNodeLength);
+    chainLength = kChainBytes / nodeSize;
+    for (size_t i = 1; i < chainLength; ++i)
+      ASSERT_NO_FATAL_FAILURE(prepend(roots[Chain], i));
+    gc.collectYoung();
+    ASSERT_FALSE(gc.isMarking());
+    hidden = static_cast<GCCell *>(roots[Hidden].getObject());
+    ASSERT_TRUE(gc.getOldSpace().contains(hidden));
+    roots[Hidden] = CBValue::encodeUndefinedValue();
+
+    for (size_t i = 0; !gc.isMarking(); ++i) {
+      ASSERT_LT(i, 10000000u);
+      ASSERT_NO_FATAL_FAILURE(prepend(roots[Extra], i));
+    }
+    EXPECT_EQ(0u, gc.getOldCollectionCount());
+  }
+
+  /// Allocate garbage until the marking completes.
+  void completeMarking() {
+    for (size_t i = 0; gc.isMarking(); ++i) {
+      ASSERT_LT(i, 10000000u);
+      Array::create(gc, 4);
+    }
+  }
+
+  CBValue *roots;
+  size_t chainLength{0};
+  GCCell *hidden{nullptr};
+};
+
+TEST_F(IncrementalMarkingTest, CompletesThroughYoungCollections) {
+  ASSERT_NO_FATAL_FAILURE(startMarking());
+  roots[Extra] = CBValue::encodeUndefinedValue();
+  ASSERT_NO_FATAL_FAILURE(completeMarking());
+  EXPECT_EQ(1u, gc.getOldCollectionCount());
+  EXPECT_EQ(chainLength, checkChain(roots[Chain], chainLength));
+
+  // The marking was spread over several pauses, the last one finished it.
+  unsigned incremental = 0, finished = 0;
+  for (const GCCollectionStats &stats : gc.getStats().getCollections()) {
+    incremental += stats.kind == GCKind::Incremental;
+    finished += stats.finishedOldCollection;
+  }
+  EXPECT_GT(incremental, 1u);
+  EXPECT_EQ(1u, finished);
+}
+
+TEST_F(IncrementalMarkingTest, SnapshotBarrierMarksOverwrittenReferences) {
+  ASSERT_NO_FATAL_FAILURE(startMarking());
+  Array *last = getLast(roots[Chain]);
+  ASSERT_EQ(hidden, elements(last)[2].getObject());
+  ASSERT_FALSE(HeapRegion::getCellMarkBit(hidden));
+
+  // The reference is gone before the marking reaches it, the object was
+  // reachable when the marking started.
+  store(last, 2, CBValue::encodeUndefinedValue());
+  EXPECT_TRUE(HeapRegion::getCellMarkBit(hidden));
+
+  ASSERT_NO_FATAL_FAILURE(completeMarking());
+  EXPECT_EQ(chainLength, checkChain(roots[Chain], chainLength));
+}
+
+TEST_F(IncrementalMarkingTest, PromotesMarkedDuringMarking) {
+  ASSERT_NO_FATAL_FAILURE(startMarking());
+  roots[Hidden] = CBValue::encodeObjectValue(Array::create(gc, 1));
+  gc.collectYoung();
+  ASSERT_TRUE(gc.isMarking());
+  auto *promoted = static_cast<GCCell *>(roots[Hidden].getObject());
+  EXPECT_TRUE(gc.getOldSpace().contains(promoted));
+  EXPECT_TRUE(HeapRegion::getCellMarkBit(promoted));
+}
+
+} // anonymous namespace
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "TestHelpers.h"
+
+#include "cobra/VM/InlineCache.h"
+
+using namespace cobra;
+using namespace cobra::vm;
+using namespace cobra::inst;
+
+namespace {
+
+/// \return a distinct receiver class. The caches only compare the classes,
+/// they are never dereferenced.
+Class *fakeClass(uintptr_t index) {
+  return reinterpret_cast<Class *>((index + 1) * 64);
+}
+
+TEST(InlineCacheTest, StartsEmpty) {
+  InlineCache cache;
+  uint32_t offset;
+  EXPECT_TRUE(cache.isEmpty());
+  EXPECT_FALSE(cache.isMegamorphic());
+  EXPECT_FALSE(cache.lookup(fakeClass(0), offset));
+  EXPECT_FALSE(cache.lookup(nullptr, offset));
+}
+
+TEST(InlineCacheTest, GoesFromMonomorphicToMegamorphic) {
+  InlineCache cache;
+  uint32_t offset = 0;
+  cache.update(fakeClass(0), 8);
+  EXPECT_TRUE(cache.isMonomorphic());
+  EXPECT_TRUE(cache.lookup(fakeClass(0), offset));
+  EXPECT_EQ(8u, offset);
+
+  for (uint32_t i = 1; i < InlineCache::kMaxEntries; ++i) {
+    cache.update(fakeClass(i), 8 + 8 * i);
+    EXPECT_TRUE(cache.isPolymorphic());
+    EXPECT_FALSE(cache.isMegamorphic());
+  }
+  for (uint32_t i = 0; i < InlineCache::kMaxEntries; ++i) {
+    ASSERT_TRUE(cache.lookup(fakeClass(i), offset));
+    EXPECT_EQ(8 + 8 * i, offset);
+  }
+
+  // One more class than the cache holds makes the site megamorphic, the new
+  // class is not recorded.
+  cache.update(fakeClass(InlineCache::kMaxEntries), 64);
+  EXPECT_TRUE(cache.isMegamorphic());
+  EXPECT_FALSE(cache.lookup(fakeClass(InlineCache::kMaxEntries), offset));
+  cache.update(fakeClass(InlineCache::kMaxEntries + 1), 72);
+  EXPECT_FALSE(cache.lookup(fakeClass(InlineCache::kMaxEntries + 1), offset));
+
+  cache.clear();
+  EXPECT_TRUE(cache.isEmpty());
+  EXPECT_FALSE(cache.isMegamorphic());
+  EXPECT_FALSE(cache.lookup(fakeClass(0), offset));
+}
+
+TEST(MegamorphicCacheTest, KeysOnClassAndName) {
+  MegamorphicCache cache;
+  uint32_t offset = 0;
+  EXPECT_FALSE(cache.lookup(fakeClass(0), 1, offset));
+  cache.update(fakeClass(0), 1, 16);
+  ASSERT_TRUE(cache.lookup(fakeClass(0), 1, offset));
+  EXPECT_EQ(16u, offset);
+  EXPECT_FALSE(cache.lookup(fakeClass(0), 2, offset));
+  EXPECT_FALSE(cache.lookup(fakeClass(1), 1, offset));
+
+  // Many classes can be cached at once, unlike in an inline cache.
+  for (uint32_t i = 1; i <= 16; ++i)
+    cache.update(fakeClass(i), 1, 16 + 8 * i);
+  for (uint32_t i = 1; i <= 16; ++i) {
+    ASSERT_TRUE(cache.lookup(fakeClass(i), 1, offset));
+    EXPECT_EQ(16 + 8 * i, offset);
+  }
+
+  cache.clear();
+  EXPECT_FALSE(cache.lookup(fakeClass(0), 1, offset));
+}
+
+using FieldAccessTest = RuntimeTestFixture;
+
+TEST_F(FieldAccessTest, ReceiversWithoutFields) {
+  // Neither a number nor an object without class has fields: GetField loads
+  // undefined and SetField does nothing.
+  BytecodeBuilder builder;
+  builder.emit(SetFieldInst{OpCode::SetField, 1, 2, kNoInlineCacheIndex, 0});
+  builder.emit(GetFieldInst{OpCode::GetField, 0, 1, kNoInlineCacheIndex, 0});
+  builder.emit(RetInst{OpCode::Ret, 0});
+  CBValue result = makeNumber(1);
+  ASSERT_TRUE(
+      builder.run(*runtime, 3, {result, makeNumber(2), makeNumber(3)}, result));
+  EXPECT_TRUE(result.isUndefined());
+
+  BytecodeBuilder objectBuilder;
+  objectBuilder.emit(NewObjectInst{OpCode::NewObject, 1});
+  objectBuilder.emit(
+      SetFieldInst{OpCode::SetField, 1, 2, kNoInlineCacheIndex, 0});
+  objectBuilder.emit(
+      GetFieldInst{OpCode::GetField, 0, 1, kNoInlineCacheIndex, 0});
+  objectBuilder.emit(RetInst{OpCode::Ret, 0});
+  result = makeNumber(1);
+  ASSERT_TRUE(objectBuilder.run(
+      *runtime, 3, {result, CBValue::encodeUndefinedValue(), makeNumber(3)},
+      result));
+  EXPECT_TRUE(result.isUndefined());
+}
+
+} // anonymous namespace
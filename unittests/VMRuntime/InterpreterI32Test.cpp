@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "TestHelpers.h"
+
+#include <cmath>
+
+#include "cobra/VM/String.h"
+
+using namespace cobra;
+using namespace cobra::vm;
+using namespace cobra::inst;
+
+namespace {
+
+class InterpreterI32Test : public RuntimeTestFixture {
+protected:
+  /// \return the result of \p op on \p x and \p y.
+  CBValue binop(OpCode op, CBValue x, CBValue y) {
+    BytecodeBuilder builder;
+    builder.emit(AddI32Inst{op, 0, 1, 2});
+    builder.emit(RetInst{OpCode::Ret, 0});
+    CBValue result = CBValue::encodeUndefinedValue();
+    EXPECT_TRUE(builder.run(*runtime, 3, {result, x, y}, result));
+    return result;
+  }
+
+  double number(OpCode op, double x, double y) {
+    CBValue result = binop(op, makeNumber(x), makeNumber(y));
+    EXPECT_TRUE(result.isNumber());
+    return result.getNumber();
+  }
+
+  bool isNegativeZero(double number) {
+    return number == 0 && std::signbit(number);
+  }
+};
+
+TEST_F(InterpreterI32Test, Int32Arithmetic) {
+  EXPECT_EQ(7, number(OpCode::AddI32, 3, 4));
+  EXPECT_EQ(-1, number(OpCode::SubI32, 3, 4));
+  EXPECT_EQ(-12, number(OpCode::MulI32, 3, -4));
+}
+
+TEST_F(InterpreterI32Test, OverflowFallsBackToDouble) {
+  EXPECT_EQ(2147483648.0, number(OpCode::AddI32, INT32_MAX, 1));
+  EXPECT_EQ(-2147483649.0, number(OpCode::SubI32, INT32_MIN, 1));
+  EXPECT_EQ(2147483648.0, number(OpCode::MulI32, INT32_MIN, -1));
+  EXPECT_EQ(4611686014132420609.0, number(OpCode::MulI32, INT32_MAX, INT32_MAX));
+}
+
+TEST_F(InterpreterI32Test, NegativeZero) {
+  EXPECT_TRUE(isNegativeZero(number(OpCode::MulI32, -1, 0)));
+  EXPECT_TRUE(isNegativeZero(number(OpCode::MulI32, 0, -5)));
+  EXPECT_TRUE(isNegativeZero(number(OpCode::AddI32, -0.0, -0.0)));
+  EXPECT_TRUE(isNegativeZero(number(OpCode::SubI32, -0.0, 0)));
+  EXPECT_FALSE(isNegativeZero(number(OpCode::AddI32, -0.0, 0)));
+  EXPECT_FALSE(isNegativeZero(number(OpCode::SubI32, 5, 5)));
+  EXPECT_FALSE(isNegativeZero(number(OpCode::MulI32, 0, 5)));
+}
+
+TEST_F(InterpreterI32Test, NonInt32Operands) {
+  EXPECT_EQ(4.0, number(OpCode::AddI32, 1.5, 2.5));
+  EXPECT_EQ(0.5, number(OpCode::MulI32, 0.25, 2));
+  EXPECT_TRUE(std::isnan(number(OpCode::SubI32, NAN, 1)));
+
+  CBValue ab = CBValue::encodeStringValue(String::create(gc, "ab", 2));
+  EXPECT_EQ("ab1", toStdString(binop(OpCode::AddI32, ab, makeNumber(1))));
+}
+
+TEST_F(InterpreterI32Test, Bitwise) {
+  EXPECT_EQ(5, number(OpCode::BitAnd, 4294967301.0, 7));
+  EXPECT_EQ(-1, number(OpCode::BitOr, -2, 1));
+  EXPECT_EQ(6, number(OpCode::BitXor, 3, 5));
+  EXPECT_EQ(2, number(OpCode::LShift, 1, 33));
+  EXPECT_EQ(-2, number(OpCode::RShift, -4, 1));
+  EXPECT_EQ(4294967295.0, number(OpCode::URshift, -1, 0));
+  EXPECT_EQ(0, number(OpCode::BitAnd, NAN, -1));
+}
+
+} // anonymous namespace
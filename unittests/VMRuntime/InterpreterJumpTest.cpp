@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "TestHelpers.h"
+
+#include "cobra/VM/String.h"
+
+#include <cmath>
+#include <utility>
+
+using namespace cobra;
+using namespace cobra::vm;
+using namespace cobra::inst;
+
+namespace {
+
+class InterpreterJumpTest : public RuntimeTestFixture {
+protected:
+  /// \return true if the compare-and-branch instruction \p op, of type
+  /// \p Inst, jumps when its operands are \p x and \p y.
+  template <typename Inst>
+  bool isTaken(OpCode op, CBValue x, CBValue y) {
+    constexpr auto kOffset =
+        sizeof(Inst) + sizeof(LoadConstUInt8Inst) + sizeof(RetInst);
+    BytecodeBuilder builder;
+    builder.emit(Inst{op, kOffset, 1, 2});
+    builder.emit(LoadConstUInt8Inst{OpCode::LoadConstUInt8, 0, 0});
+    builder.emit(RetInst{OpCode::Ret, 0});
+    builder.emit(LoadConstUInt8Inst{OpCode::LoadConstUInt8, 0, 1});
+    builder.emit(RetInst{OpCode::Ret, 0});
+    CBValue result = CBValue::encodeUndefinedValue();
+    EXPECT_TRUE(builder.run(*runtime, 3, {result, x, y}, result));
+    return result.getNumber() == 1;
+  }
+
+  /// Check that the short and long forms of \p op agree on \p x and \p y.
+  /// \return true if they jump.
+  bool isTaken(OpCode op, OpCode longOp, CBValue x, CBValue y) {
+    bool taken = isTaken<JEqInst>(op, x, y);
+    EXPECT_EQ(taken, isTaken<JEqLongInst>(longOp, x, y));
+    return taken;
+  }
+};
+
+struct CompareCase {
+  OpCode op;
+  OpCode longOp;
+  OpCode numberOp;
+  OpCode numberLongOp;
+  /// The expected outcome of 1 op 2, 2 op 2, 2 op 1 and NaN op 2.
+  bool taken[4];
+};
+
+#define COMPARE_CASE(name, ...)                                         \
+  CompareCase {                                                         \
+    OpCode::name, OpCode::name##Long, OpCode::name##N,                  \
+        OpCode::name##NLong, { __VA_ARGS__ }                            \
+  }
+
+const CompareCase kCompareCases[] = {
+    COMPARE_CASE(JEq, false, true, false, false),
+    COMPARE_CASE(JNotEq, true, false, true, true),
+    COMPARE_CASE(JLess, true, false, false, false),
+    COMPARE_CASE(JNotLess, false, true, true, true),
+    COMPARE_CASE(JLessEqual, true, true, false, false),
+    COMPARE_CASE(JNotLessEqual, false, false, true, true),
+    COMPARE_CASE(JGreater, false, false, true, false),
+    COMPARE_CASE(JNotGreater, true, true, false, true),
+    COMPARE_CASE(JGreaterEqual, false, true, true, false),
+    COMPARE_CASE(JNotGreaterEqual, true, false, false, true),
+};
+
+#undef COMPARE_CASE
+
+TEST_F(InterpreterJumpTest, CompareAndBranchOnNumbers) {
+  const std::pair<double, double> operands[] = {
+      {1, 2}, {2, 2}, {2, 1}, {NAN, 2}};
+  for (const CompareCase &c : kCompareCases) {
+    for (unsigned i = 0; i < 4; ++i) {
+      CBValue x = makeNumber(operands[i].first);
+      CBValue y = makeNumber(operands[i].second);
+      SCOPED_TRACE(testing::Message() << "opcode " << (unsigned)c.op
+                                      << ", operands " << i);
+      EXPECT_EQ(c.taken[i], isTaken(c.op, c.longOp, x, y));
+      EXPECT_EQ(c.taken[i], isTaken(c.numberOp, c.numberLongOp, x, y));
+    }
+  }
+}
+
+TEST_F(InterpreterJumpTest, CompareAndBranchOnOtherValues) {
+  CBValue undefined = CBValue::encodeUndefinedValue();
+  CBValue null = CBValue::encodeNullValue();
+  CBValue one = makeNumber(1);
+
+  // undefined converts to NaN, null to 0.
+  EXPECT_FALSE(isTaken(OpCode::JLess, OpCode::JLessLong, undefined, one));
+  EXPECT_TRUE(isTaken(OpCode::JNotLess, OpCode::JNotLessLong, undefined, one));
+  EXPECT_TRUE(isTaken(OpCode::JLess, OpCode::JLessLong, null, one));
+  EXPECT_FALSE(
+      isTaken(OpCode::JGreaterEqual, OpCode::JGreaterEqualLong, null, one));
+
+  // Equality is strict and compares the contents of strings.
+  CBValue a1 = CBValue::encodeStringValue(String::create(gc, "a", 1));
+  CBValue a2 = CBValue::encodeStringValue(String::create(gc, "a", 1));
+  CBValue b = CBValue::encodeStringValue(String::create(gc, "b", 1));
+  EXPECT_TRUE(isTaken(OpCode::JEq, OpCode::JEqLong, a1, a2));
+  EXPECT_FALSE(isTaken(OpCode::JEq, OpCode::JEqLong, a1, b));
+  EXPECT_TRUE(isTaken(OpCode::JNotEq, OpCode::JNotEqLong, a1, b));
+  EXPECT_FALSE(isTaken(OpCode::JEq, OpCode::JEqLong, null, undefined));
+  EXPECT_TRUE(isTaken(OpCode::JNotEq, OpCode::JNotEqLong, one, a1));
+}
+
+TEST_F(InterpreterJumpTest, BackwardCompareAndBranch) {
+  // Count r1 from 0 to 10 with a fused branch at the bottom of the loop.
+  BytecodeBuilder builder;
+  builder.emit(LoadConstZeroInst{OpCode::LoadConstZero, 0});
+  builder.emit(LoadConstUInt8Inst{OpCode::LoadConstUInt8, 1, 1});
+  builder.emit(LoadConstUInt8Inst{OpCode::LoadConstUInt8, 2, 10});
+  uint32_t loop = builder.emit(AddInst{OpCode::Add, 0, 0, 1});
+  uint32_t jump = builder.getOffset();
+  builder.emit(JLessInst{OpCode::JLess, (int8_t)(loop - jump), 0, 2});
+  builder.emit(RetInst{OpCode::Ret, 0});
+  CBValue result = CBValue::encodeUndefinedValue();
+  ASSERT_TRUE(builder.run(*runtime, 3, {result}, result));
+  EXPECT_EQ(10, result.getNumber());
+}
+
+} // anonymous namespace
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#if defined(COBRA_INTERPRETER_PROFILER) && \
+    defined(COBRA_ENABLE_ADAPTIVE_INTERPRETER)
+
+#include "TestHelpers.h"
+
+#include "cobra/VM/InterpreterProfiler.h"
+#include "cobra/VM/String.h"
+
+using namespace cobra;
+using namespace cobra::vm;
+using namespace cobra::inst;
+
+namespace {
+
+using InterpreterProfilerTest = RuntimeTestFixture;
+
+TEST_F(InterpreterProfilerTest, CountsEveryInstructionOnce) {
+  InterpreterProfiler &profiler = runtime->getInterpreterProfiler();
+  profiler.reset();
+  BytecodeBuilder builder;
+  builder.emit(AddInst{OpCode::Add, 0, 1, 2});
+  builder.emit(RetInst{OpCode::Ret, 0});
+
+  CBValue result = CBValue::encodeUndefinedValue();
+  ASSERT_TRUE(
+      builder.run(*runtime, 3, {result, makeNumber(1), makeNumber(2)}, result));
+  CBValue str = CBValue::encodeStringValue(String::create(gc, "a", 1));
+  ASSERT_TRUE(builder.run(*runtime, 3, {result, str, str}, result));
+  EXPECT_EQ("aa", toStdString(result));
+
+  // The second run executed the quickened AddN, which went back to Add.
+  EXPECT_EQ(1u, profiler.getOpCodeCount(OpCode::Add));
+  EXPECT_EQ(1u, profiler.getOpCodeCount(OpCode::AddN));
+  EXPECT_EQ(2u, profiler.getOpCodeCount(OpCode::Ret));
+  EXPECT_EQ(0u, profiler.getPairCount(OpCode::AddN, OpCode::Add));
+  EXPECT_EQ(1u, profiler.getPairCount(OpCode::AddN, OpCode::Ret));
+}
+
+} // anonymous namespace
+
+#endif
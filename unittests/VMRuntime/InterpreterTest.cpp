@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "TestHelpers.h"
+
+#include "cobra/VM/String.h"
+
+#include <cmath>
+#include <utility>
+
+using namespace cobra;
+using namespace cobra::vm;
+using namespace cobra::inst;
+
+namespace {
+
+class InterpreterTest : public RuntimeTestFixture {
+protected:
+  /// \return the result of the instruction \p op on \p value.
+  CBValue unop(OpCode op, CBValue value) {
+    BytecodeBuilder builder;
+    builder.emit(MovInst{op, 0, 1});
+    builder.emit(RetInst{OpCode::Ret, 0});
+    CBValue result = CBValue::encodeUndefinedValue();
+    EXPECT_TRUE(builder.run(*runtime, 2, {result, value}, result));
+    return result;
+  }
+
+  /// \return the result of the instruction \p op on \p x and \p y, run
+  /// from \p builder, which holds the instruction and a Ret.
+  CBValue binop(BytecodeBuilder &builder, CBValue x, CBValue y) {
+    CBValue result = CBValue::encodeUndefinedValue();
+    EXPECT_TRUE(builder.run(*runtime, 3, {result, x, y}, result));
+    return result;
+  }
+
+  /// \return a builder holding the instruction \p op and a Ret.
+  static BytecodeBuilder makeBinop(OpCode op) {
+    BytecodeBuilder builder;
+    builder.emit(AddInst{op, 0, 1, 2});
+    builder.emit(RetInst{OpCode::Ret, 0});
+    return builder;
+  }
+
+  /// \return the opcode of the first instruction of \p builder.
+  static OpCode firstOpCode(const BytecodeBuilder &builder) {
+    return (OpCode)builder.getBytes()[0];
+  }
+
+  CBValue makeString(const char *chars) {
+    return CBValue::encodeStringValue(
+        String::create(gc, chars, (uint32_t)strlen(chars)));
+  }
+};
+
+TEST_F(InterpreterTest, MovObject) {
+  CBValue str = makeString("abc");
+  CBValue result = unop(OpCode::MovObject, str);
+  ASSERT_TRUE(result.isString());
+  EXPECT_EQ("abc", toStdString(result));
+}
+
+TEST_F(InterpreterTest, ToNumber) {
+  EXPECT_EQ(1.5, unop(OpCode::ToNumber, makeNumber(1.5)).getNumber());
+  EXPECT_EQ(1, unop(OpCode::ToNumber, CBValue::encodeBoolValue(true))
+                   .getNumber());
+  EXPECT_EQ(0, unop(OpCode::ToNumber, CBValue::encodeNullValue()).getNumber());
+  EXPECT_TRUE(std::isnan(
+      unop(OpCode::ToNumber, CBValue::encodeUndefinedValue()).getNumber()));
+}
+
+TEST_F(InterpreterTest, ToString) {
+  EXPECT_EQ("abc", toStdString(unop(OpCode::ToString, makeString("abc"))));
+  CBValue result = unop(OpCode::ToString, makeNumber(42));
+  ASSERT_TRUE(result.isString());
+  EXPECT_EQ("42", toStdString(result));
+  EXPECT_EQ(
+      "true",
+      toStdString(unop(OpCode::ToString, CBValue::encodeBoolValue(true))));
+  EXPECT_EQ(
+      "undefined",
+      toStdString(unop(OpCode::ToString, CBValue::encodeUndefinedValue())));
+}
+
+#ifdef COBRA_ENABLE_ADAPTIVE_INTERPRETER
+
+TEST_F(InterpreterTest, QuickensNumberArithmetic) {
+  static const std::pair<OpCode, OpCode> kOpCodes[] = {
+      {OpCode::Add, OpCode::AddN},
+      {OpCode::Sub, OpCode::SubN},
+      {OpCode::Mul, OpCode::MulN},
+      {OpCode::Div, OpCode::DivN},
+      {OpCode::Mod, OpCode::ModN},
+  };
+  for (auto [generic, quickened] : kOpCodes) {
+    BytecodeBuilder builder = makeBinop(generic);
+    EXPECT_TRUE(binop(builder, makeNumber(7), makeNumber(2)).isNumber());
+    EXPECT_EQ(quickened, firstOpCode(builder));
+    // The quickened instruction keeps running numbers.
+    EXPECT_TRUE(binop(builder, makeNumber(9), makeNumber(4)).isNumber());
+    EXPECT_EQ(quickened, firstOpCode(builder));
+  }
+}
+
+TEST_F(InterpreterTest, KeepsGenericArithmeticOnOtherOperands) {
+  BytecodeBuilder builder = makeBinop(OpCode::Sub);
+  CBValue result =
+      binop(builder, makeNumber(1), CBValue::encodeUndefinedValue());
+  EXPECT_TRUE(std::isnan(result.getNumber()));
+  EXPECT_EQ(OpCode::Sub, firstOpCode(builder));
+}
+
+TEST_F(InterpreterTest, DequickensArithmetic) {
+  BytecodeBuilder builder = makeBinop(OpCode::Add);
+  EXPECT_EQ(3, binop(builder, makeNumber(1), makeNumber(2)).getNumber());
+  EXPECT_EQ(OpCode::AddN, firstOpCode(builder));
+
+  CBValue result = binop(builder, makeString("a"), makeNumber(1));
+  EXPECT_EQ("a1", toStdString(result));
+  EXPECT_EQ(OpCode::Add, firstOpCode(builder));
+
+  // The generic instruction quickens again on numbers.
+  EXPECT_EQ(5, binop(builder, makeNumber(2), makeNumber(3)).getNumber());
+  EXPECT_EQ(OpCode::AddN, firstOpCode(builder));
+}
+
+TEST_F(InterpreterTest, QuickensAndDequickensEquality) {
+  BytecodeBuilder builder = makeBinop(OpCode::Eq);
+  CBValue result = binop(builder, makeString("ab"), makeString("ab"));
+  EXPECT_TRUE(result.getBool());
+  EXPECT_EQ(OpCode::EqS, firstOpCode(builder));
+
+  // EqS goes back to Eq, which quickens itself into EqN.
+  result = binop(builder, makeNumber(1), makeNumber(2));
+  EXPECT_FALSE(result.getBool());
+  EXPECT_EQ(OpCode::EqN, firstOpCode(builder));
+
+  result = binop(builder, makeNumber(1), makeString("1"));
+  EXPECT_FALSE(result.getBool());
+  EXPECT_EQ(OpCode::Eq, firstOpCode(builder));
+}
+
+#endif // COBRA_ENABLE_ADAPTIVE_INTERPRETER
+
+} // anonymous namespace
@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "TestHelpers.h"
+
+using namespace cobra;
+using namespace cobra::vm;
+using namespace cobra::inst;
+
+namespace {
+
+/// Registers past the 256 a Reg8 operand can address.
+constexpr uint16_t kIndex = 300;
+constexpr uint16_t kSum = 301;
+constexpr uint16_t kLimit = 302;
+constexpr uint16_t kOne = 303;
+constexpr uint16_t kCond = 350;
+constexpr uint16_t kResult = 351;
+constexpr uint32_t kFrameSize = 400;
+
+using InterpreterWideTest = RuntimeTestFixture;
+
+TEST_F(InterpreterWideTest, LoopOnWideRegisters) {
+  BytecodeBuilder builder;
+  builder.emit(LoadConstZeroWideInst{OpCode::LoadConstZeroWide, kIndex});
+  builder.emit(LoadConstZeroWideInst{OpCode::LoadConstZeroWide, kSum});
+  builder.emit(
+      LoadConstDoubleWideInst{OpCode::LoadConstDoubleWide, kLimit, 1000});
+  builder.emit(LoadConstUInt8WideInst{OpCode::LoadConstUInt8Wide, kOne, 1});
+  uint32_t loop = builder.emit(AddWideInst{OpCode::AddWide, kSum, kSum, kIndex});
+  builder.emit(AddI32WideInst{OpCode::AddI32Wide, kIndex, kIndex, kOne});
+  uint32_t jump = builder.getOffset();
+  builder.emit(JLessWideInst{
+      OpCode::JLessWide, (int32_t)loop - (int32_t)jump, kIndex, kLimit});
+  builder.emit(RetWideInst{OpCode::RetWide, kSum});
+
+  CBValue result = CBValue::encodeUndefinedValue();
+  ASSERT_TRUE(builder.run(*runtime, kFrameSize, {}, result));
+  ASSERT_TRUE(result.isNumber());
+  EXPECT_EQ(499500, result.getNumber());
+}
+
+TEST_F(InterpreterWideTest, WideJumpOverLongBody) {
+  // if (r0) r351 = 1, with a body too long for an 8-bit jump offset.
+  constexpr uint16_t kBodyLength = 100;
+  constexpr int32_t kOffset = sizeof(JmpFalseWideInst) +
+      kBodyLength * sizeof(LoadConstZeroWideInst) +
+      sizeof(LoadConstUInt8WideInst);
+  static_assert(kOffset > INT8_MAX, "the jump must not fit in an Addr8");
+
+  BytecodeBuilder builder;
+  builder.emit(MovLongInst{OpCode::MovLong, kCond, 0});
+  builder.emit(JmpFalseWideInst{OpCode::JmpFalseWide, kOffset, kCond});
+  for (uint16_t reg = 1; reg <= kBodyLength; ++reg)
+    builder.emit(LoadConstZeroWideInst{OpCode::LoadConstZeroWide, reg});
+  builder.emit(LoadConstUInt8WideInst{OpCode::LoadConstUInt8Wide, kResult, 1});
+  builder.emit(RetWideInst{OpCode::RetWide, kResult});
+
+  CBValue result = CBValue::encodeUndefinedValue();
+  ASSERT_TRUE(builder.run(
+      *runtime, kFrameSize, {CBValue::encodeBoolValue(true)}, result));
+  ASSERT_TRUE(result.isNumber());
+  EXPECT_EQ(1, result.getNumber());
+
+  result = CBValue::encodeNullValue();
+  ASSERT_TRUE(builder.run(
+      *runtime, kFrameSize, {CBValue::encodeBoolValue(false)}, result));
+  EXPECT_TRUE(result.isUndefined());
+}
+
+TEST_F(InterpreterWideTest, WideCompareAndMove) {
+  BytecodeBuilder builder;
+  builder.emit(MovLongInst{OpCode::MovLong, kIndex, 0});
+  builder.emit(MovLongInst{OpCode::MovLong, kLimit, 1});
+  builder.emit(EqWideInst{OpCode::EqWide, kResult, kIndex, kLimit});
+  builder.emit(RetWideInst{OpCode::RetWide, kResult});
+
+  CBValue result = CBValue::encodeUndefinedValue();
+  ASSERT_TRUE(builder.run(
+      *runtime, kFrameSize, {makeNumber(2), makeNumber(2)}, result));
+  EXPECT_EQ(CBValue::encodeBoolValue(true).getRaw(), result.getRaw());
+  ASSERT_TRUE(builder.run(
+      *runtime, kFrameSize, {makeNumber(2), makeNumber(3)}, result));
+  EXPECT_EQ(CBValue::encodeBoolValue(false).getRaw(), result.getRaw());
+}
+
+} // anonymous namespace
@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifdef COBRA_ENABLE_JIT
+
+#include "TestHelpers.h"
+
+#include "cobra/VM/JIT.h"
+#include "cobra/VM/String.h"
+#include "cobra/VM/X86_64Assembler.h"
+
+#include <cmath>
+#include <memory>
+#include <string>
+
+using namespace cobra;
+using namespace cobra::vm;
+using namespace cobra::inst;
+
+namespace {
+
+class JITTest : public RuntimeTestFixture {
+protected:
+  /// \return a linked method of \p argCount parameters, not counting 'this',
+  /// running the bytecode of \p builder in \p frameSize registers.
+  Method *createMethod(
+      const BytecodeBuilder &builder,
+      uint32_t argCount,
+      uint32_t frameSize) {
+    shorties_.push_back(
+        std::make_unique<std::string>(std::string(argCount + 1, 'L')));
+    methods_.push_back(std::make_unique<Method>(
+        nullptr, methods_.size(), shorties_.back()->c_str()));
+    Method *method = methods_.back().get();
+    method->setArgCount(argCount);
+    method->setFrameSize(frameSize);
+    std::string error;
+    EXPECT_TRUE(runtime->getClassLinker().linkMethod(
+        method,
+        builder.getBytes().data(),
+        builder.getBytes().size(),
+        0,
+        error))
+        << error;
+    return method;
+  }
+
+  /// Call \p method with the arguments \p x and \p y from a frame of its own.
+  /// \return false if the call raised an error.
+  bool call(Method *method, CBValue x, CBValue y, CBValue &result) {
+    BytecodeBuilder caller;
+    caller.emit(Call3Inst{OpCode::Call3, 0, 1, 0, 2, 3});
+    caller.emit(RetInst{OpCode::Ret, 0});
+    result = CBValue::encodeUndefinedValue();
+    return caller.run(
+        *runtime,
+        4,
+        {result, CBValue::encodeObjectValue(method), x, y},
+        result);
+  }
+
+private:
+  std::vector<std::unique_ptr<std::string>> shorties_{};
+  std::vector<std::unique_ptr<Method>> methods_{};
+};
+
+/// The bytecode of f(x, y) = x * y + (x - y) / 2, compared with 0 and
+/// returned as 1 or -1 times the result.
+BytecodeBuilder makeArithmetic() {
+  BytecodeBuilder builder;
+  builder.emit(LoadParamInst{OpCode::LoadParam, 1, 1});
+  builder.emit(LoadParamInst{OpCode::LoadParam, 2, 2});
+  builder.emit(MulInst{OpCode::Mul, 3, 1, 2});
+  builder.emit(SubInst{OpCode::Sub, 4, 1, 2});
+  builder.emit(LoadConstUInt8Inst{OpCode::LoadConstUInt8, 5, 2});
+  builder.emit(DivInst{OpCode::Div, 4, 4, 5});
+  builder.emit(AddInst{OpCode::Add, 0, 3, 4});
+  builder.emit(RetInst{OpCode::Ret, 0});
+  return builder;
+}
+
+TEST_F(JITTest, CompiledArithmeticMatchesInterpreter) {
+  BytecodeBuilder builder = makeArithmetic();
+  Method *interpreted = createMethod(builder, 2, 6);
+  Method *compiled = createMethod(builder, 2, 6);
+  ASSERT_TRUE(JIT::compile(compiled));
+  ASSERT_NE(nullptr, compiled->getCompiledCode());
+
+  const double operands[][2] = {
+      {3, 4}, {-1.5, 2}, {0, -0.0}, {1e300, 1e300}, {NAN, 1}};
+  for (auto &xy : operands) {
+    CBValue expected, actual;
+    ASSERT_TRUE(call(
+        interpreted, makeNumber(xy[0]), makeNumber(xy[1]), expected));
+    ASSERT_TRUE(call(compiled, makeNumber(xy[0]), makeNumber(xy[1]), actual));
+    ASSERT_TRUE(actual.isNumber());
+    if (std::isnan(expected.getNumber())) {
+      EXPECT_TRUE(std::isnan(actual.getNumber()));
+    } else {
+      EXPECT_EQ(expected.getNumber(), actual.getNumber());
+    }
+  }
+
+  // Non-number operands go through the helpers of the slow paths.
+  CBValue str = CBValue::encodeStringValue(String::create(gc, "a", 1));
+  CBValue result;
+  ASSERT_TRUE(call(compiled, str, makeNumber(1), result));
+  EXPECT_TRUE(std::isnan(result.getNumber()));
+}
+
+/// The bytecode of count(self, n), which returns n by calling
+/// self(self, n - 1) until n is 0.
+BytecodeBuilder makeCount() {
+  constexpr auto kDoneOffset = sizeof(JLessEqualInst) +
+      sizeof(LoadConstUInt8Inst) + sizeof(SubInst) + sizeof(Call3Inst) +
+      sizeof(AddInst) + sizeof(RetInst);
+  BytecodeBuilder builder;
+  builder.emit(LoadParamInst{OpCode::LoadParam, 1, 1});
+  builder.emit(LoadParamInst{OpCode::LoadParam, 2, 2});
+  builder.emit(LoadConstZeroInst{OpCode::LoadConstZero, 3});
+  builder.emit(JLessEqualInst{OpCode::JLessEqual, kDoneOffset, 2, 3});
+  builder.emit(LoadConstUInt8Inst{OpCode::LoadConstUInt8, 4, 1});
+  builder.emit(SubInst{OpCode::Sub, 2, 2, 4});
+  builder.emit(Call3Inst{OpCode::Call3, 0, 1, 3, 1, 2});
+  builder.emit(AddInst{OpCode::Add, 0, 0, 4});
+  builder.emit(RetInst{OpCode::Ret, 0});
+  builder.emit(RetInst{OpCode::Ret, 3});
+  return builder;
+}
+
+TEST_F(JITTest, CompiledCodeCallsItself) {
+  Method *count = createMethod(makeCount(), 2, 5);
+  ASSERT_TRUE(JIT::compile(count));
+  CBValue self = CBValue::encodeObjectValue(count);
+  CBValue result;
+  ASSERT_TRUE(call(count, self, makeNumber(100), result));
+  EXPECT_EQ(100, result.getNumber());
+}
+
+TEST_F(JITTest, DeepRecursionContinuesInTheInterpreter) {
+  // Compiled code nests on the native stack, the calls past the limit run in
+  // the interpreter.
+  Method *count = createMethod(makeCount(), 2, 5);
+  ASSERT_TRUE(JIT::compile(count));
+  CBValue self = CBValue::encodeObjectValue(count);
+  CBValue result;
+  uint32_t depth = 10 * Runtime::kMaxNativeCallDepth;
+  ASSERT_TRUE(call(count, self, makeNumber(depth), result));
+  EXPECT_EQ(depth, result.getNumber());
+}
+
+TEST_F(JITTest, DeepRecursionOverflowsTheStack) {
+  Method *count = createMethod(makeCount(), 2, 5);
+  ASSERT_TRUE(JIT::compile(count));
+  CBValue self = CBValue::encodeObjectValue(count);
+  CBValue result;
+  EXPECT_FALSE(call(count, self, makeNumber(10000000), result));
+  EXPECT_EQ("stack overflow", runtime->getPendingError());
+  runtime->clearPendingError();
+
+  // The runtime is usable again once the error is handled.
+  ASSERT_TRUE(call(count, self, makeNumber(10), result));
+  EXPECT_EQ(10, result.getNumber());
+}
+
+TEST_F(JITTest, HotMethodsAreCompiled) {
+  Method *count = createMethod(makeCount(), 2, 5);
+  CBValue self = CBValue::encodeObjectValue(count);
+  CBValue result;
+  for (uint32_t i = 0; i < JIT::kHotnessThreshold &&
+       count->getCompiledCode() == nullptr; ++i) {
+    ASSERT_TRUE(call(count, self, makeNumber(1), result));
+  }
+  EXPECT_NE(nullptr, count->getCompiledCode());
+  ASSERT_TRUE(call(count, self, makeNumber(50), result));
+  EXPECT_EQ(50, result.getNumber());
+}
+
+TEST(X86_64AssemblerTest, Encodings) {
+  using Asm = X86_64Assembler;
+  Asm a;
+  a.push(Asm::RBX);
+  a.push(Asm::R12);
+  a.mov(Asm::RAX, Asm::R12);
+  a.load(Asm::RAX, Asm::R12, 8);
+  a.store(Asm::RBX, -16, Asm::RCX);
+  a.cmp(Asm::RAX, Asm::RDX);
+  a.movq(Asm::XMM1, Asm::RAX);
+  a.sse(Asm::AddSD, Asm::XMM0, Asm::XMM1);
+  a.call(Asm::R11);
+  a.pop(Asm::R12);
+  a.ret();
+  const uint8_t expected[] = {
+      0x53,                                     // push rbx
+      0x41, 0x54,                               // push r12
+      0x4c, 0x89, 0xe0,                         // mov rax, r12
+      0x49, 0x8b, 0x84, 0x24, 8, 0, 0, 0,       // mov rax, [r12 + 8]
+      0x48, 0x89, 0x8b, 0xf0, 0xff, 0xff, 0xff, // mov [rbx - 16], rcx
+      0x48, 0x39, 0xd0,                         // cmp rax, rdx
+      0x66, 0x48, 0x0f, 0x6e, 0xc8,             // movq xmm1, rax
+      0xf2, 0x0f, 0x58, 0xc1,                   // addsd xmm0, xmm1
+      0x41, 0xff, 0xd3,                         // call r11
+      0x41, 0x5c,                               // pop r12
+      0xc3,                                     // ret
+  };
+  ASSERT_EQ(sizeof(expected), a.size());
+  EXPECT_EQ(0, memcmp(expected, a.data(), sizeof(expected)));
+}
+
+TEST(X86_64AssemblerTest, BranchesArePatched) {
+  using Asm = X86_64Assembler;
+  Asm a;
+  size_t forward = a.jcc(Asm::Equal);
+  size_t loop = a.size();
+  a.ret();
+  a.bind(forward);
+  size_t back = a.jmp();
+  a.patch(back, loop);
+  const uint8_t expected[] = {
+      0x0f, 0x84, 1, 0, 0, 0,          // je +1
+      0xc3,                            // ret
+      0xe9, 0xfa, 0xff, 0xff, 0xff,    // jmp -6
+  };
+  ASSERT_EQ(sizeof(expected), a.size());
+  EXPECT_EQ(0, memcmp(expected, a.data(), sizeof(expected)));
+}
+
+} // anonymous namespace
+
+#endif
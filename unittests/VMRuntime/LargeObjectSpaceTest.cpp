@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "TestHelpers.h"
+
+using namespace cobra;
+using namespace cobra::vm;
+
+namespace {
+
+class LargeObjectSpaceTest : public HeapTestFixture {
+protected:
+  /// Length of an array spanning two regions.
+  static constexpr uint32_t kLength = HeapRegion::maxSize() * 3 / 2 / 8;
+};
+
+TEST_F(LargeObjectSpaceTest, AllocatesLargeObjectsInPlace) {
+  CBValue *roots = allocateRoots(1);
+  Array *small = Array::create(gc, GC::kLargeObjectThreshold / 16);
+  EXPECT_TRUE(gc.getYoungSpace().contains(small));
+
+  Array *large = Array::create(gc, kLength);
+  ASSERT_NE(nullptr, large);
+  roots[0] = CBValue::encodeObjectValue(large);
+  EXPECT_TRUE(gc.getLargeObjectSpace().contains(large));
+  EXPECT_FALSE(gc.getYoungSpace().contains(large));
+  EXPECT_EQ(1u, gc.getLargeObjectSpace().getRegionCount());
+  EXPECT_TRUE(elements(large)[kLength - 1].isUndefined());
+
+  // Large objects are never copied.
+  gc.collectYoung();
+  EXPECT_EQ(large, toArray(roots[0]));
+  gc.collectOld();
+  EXPECT_EQ(large, toArray(roots[0]));
+  EXPECT_EQ(kLength, large->getLength());
+}
+
+TEST_F(LargeObjectSpaceTest, FindsYoungObjectsPastTheFirstRegion) {
+  CBValue *roots = allocateRoots(1);
+  Array *large = Array::create(gc, kLength);
+  roots[0] = CBValue::encodeObjectValue(large);
+
+  // The last element is past the region that has metadata.
+  Array *young = Array::create(gc, 1);
+  elements(young)[0] = makeNumber(42);
+  ASSERT_GT(
+      (char *)(elements(large) + kLength - 1),
+      (char *)large + HeapRegion::maxSize());
+  store(large, kLength - 1, CBValue::encodeObjectValue(young));
+  gc.collectYoung();
+
+  Array *promoted = toArray(elements(large)[kLength - 1]);
+  EXPECT_NE(young, promoted);
+  EXPECT_TRUE(gc.getOldSpace().contains(promoted));
+  EXPECT_EQ(42, elements(promoted)[0].getNumber());
+
+  // And through a collection of the old generation.
+  gc.collectOld();
+  promoted = toArray(elements(large)[kLength - 1]);
+  EXPECT_EQ(42, elements(promoted)[0].getNumber());
+}
+
+TEST_F(LargeObjectSpaceTest, FreesDeadLargeObjects) {
+  CBValue *roots = allocateRoots(2);
+  roots[0] = CBValue::encodeObjectValue(Array::create(gc, kLength));
+  roots[1] = CBValue::encodeObjectValue(Array::create(gc, kLength));
+  EXPECT_EQ(2u, gc.getLargeObjectSpace().getRegionCount());
+
+  roots[1] = CBValue::encodeUndefinedValue();
+  gc.collectOld();
+  EXPECT_EQ(1u, gc.getLargeObjectSpace().getRegionCount());
+  EXPECT_TRUE(gc.getLargeObjectSpace().contains(roots[0].getObject()));
+
+  roots[0] = CBValue::encodeUndefinedValue();
+  gc.collectOld();
+  EXPECT_EQ(0u, gc.getLargeObjectSpace().getRegionCount());
+  EXPECT_EQ(0u, gc.getLargeObjectSpace().getStorageBytes());
+}
+
+TEST_F(LargeObjectSpaceTest, LargeGarbageTriggersCollections) {
+  CBValue *roots = allocateRoots(1);
+  for (int i = 0; i < 200; ++i)
+    roots[0] = CBValue::encodeObjectValue(Array::create(gc, kLength));
+  EXPECT_GT(gc.getOldCollectionCount(), 0u);
+  // 200 arrays of two regions each would take 400 regions.
+  EXPECT_LT(gc.getLargeObjectSpace().getRegionCount(), 50u);
+  EXPECT_EQ(kLength, toArray(roots[0])->getLength());
+}
+
+} // anonymous namespace
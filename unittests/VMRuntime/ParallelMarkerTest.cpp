@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "TestHelpers.h"
+
+#include "cobra/VM/ParallelMarker.h"
+
+using namespace cobra;
+using namespace cobra::vm;
+
+namespace {
+
+/// The tests run with the number of marker threads of their parameter.
+class ParallelMarkerTest : public HeapTestFixture,
+                           public ::testing::WithParamInterface<uint32_t> {
+protected:
+  /// Depth of the tree marked.
+  static constexpr unsigned kDepth = 14;
+
+  /// \return a binary tree of \p depth levels, every node of which is an
+  /// array of its two children, and of a leaf that is dropped once old.
+  CBValue createTree(unsigned depth) {
+    if (depth == 0)
+      return CBValue::encodeUndefinedValue();
+    // The node is created first and kept in a register, the children may
+    // collect the young generation.
+    CBValue *node = allocateRoots(1);
+    *node = CBValue::encodeObjectValue(Array::create(gc, 3));
+    CBValue left = createTree(depth - 1);
+    store(toArray(*node), 0, left);
+    CBValue right = createTree(depth - 1);
+    store(toArray(*node), 1, right);
+    store(toArray(*node), 2, CBValue::encodeObjectValue(Array::create(gc, 1)));
+    return *node;
+  }
+
+  /// Build the tree in \p root, all old, and drop the leaves into \p garbage.
+  void createOldTree(CBValue *root, std::vector<GCCell *> &garbage) {
+    RegisterStack &stack = runtime->getRegisterStack();
+    CBValue *top = stack.getTop();
+    *root = createTree(kDepth);
+    stack.release(top);
+    gc.collectYoung();
+    forEachNode(*root, [&](Array *node) {
+      garbage.push_back(static_cast<GCCell *>(elements(node)[2].getObject()));
+      store(node, 2, CBValue::encodeUndefinedValue());
+    });
+    for (HeapRegion *region : gc.getOldSpace().getRegions())
+      region->markBitSet().clear();
+  }
+
+  template <typename Fn>
+  static void forEachNode(CBValue value, Fn fn) {
+    if (!value.isObject())
+      return;
+    Array *node = toArray(value);
+    fn(node);
+    forEachNode(elements(node)[0], fn);
+    forEachNode(elements(node)[1], fn);
+  }
+
+  /// \return the bytes of the nodes of the tree at \p root, checking that
+  /// every one is marked.
+  uint64_t checkMarked(CBValue root) {
+    uint64_t bytes = 0;
+    forEachNode(root, [&](Array *node) {
+      EXPECT_TRUE(HeapRegion::getCellMarkBit(node));
+      bytes += node->getSize();
+    });
+    return bytes;
+  }
+};
+
+TEST_P(ParallelMarkerTest, MarksTheReachableObjects) {
+  CBValue *root = allocateRoots(1);
+  std::vector<GCCell *> garbage;
+  createOldTree(root, garbage);
+
+  ParallelMarker marker(
+      {&gc.getOldSpace(), &gc.getLargeObjectSpace()}, GetParam());
+  marker.mark({static_cast<GCCell *>(root->getObject())});
+  EXPECT_EQ(checkMarked(*root), marker.getMarkedBytes());
+  for (GCCell *cell : garbage)
+    EXPECT_FALSE(HeapRegion::getCellMarkBit(cell));
+}
+
+TEST_P(ParallelMarkerTest, MarksWithinBudgets) {
+  CBValue *root = allocateRoots(1);
+  std::vector<GCCell *> garbage;
+  createOldTree(root, garbage);
+
+  // The roots of markFrom() are marked already.
+  auto *rootCell = static_cast<GCCell *>(root->getObject());
+  HeapRegion::setCellMarkBit(rootCell);
+  std::vector<GCCell *> grey{rootCell};
+  uint64_t markedBytes = rootCell->getSize();
+  unsigned increments = 0;
+  while (!grey.empty()) {
+    ASSERT_LT(increments, 1000u);
+    ParallelMarker marker(
+        {&gc.getOldSpace(), &gc.getLargeObjectSpace()}, GetParam());
+    std::vector<GCCell *> scan;
+    scan.swap(grey);
+    if (!marker.markFrom(scan, 16 * 1024))
+      marker.takeGrey(grey);
+    markedBytes += marker.getMarkedBytes();
+    ++increments;
+  }
+  EXPECT_GT(increments, 1u);
+  EXPECT_EQ(checkMarked(*root), markedBytes);
+  for (GCCell *cell : garbage)
+    EXPECT_FALSE(HeapRegion::getCellMarkBit(cell));
+}
+
+TEST_P(ParallelMarkerTest, CollectOldKeepsTheReachableObjects) {
+  gc.setMarkerThreadCount(GetParam());
+  CBValue *root = allocateRoots(1);
+  std::vector<GCCell *> garbage;
+  createOldTree(root, garbage);
+  gc.collectOld();
+  EXPECT_EQ(1u, gc.getOldCollectionCount());
+
+  // Reuse the freed memory, which would overwrite a node left unmarked.
+  CBValue *churn = allocateRoots(1);
+  for (int i = 0; i < 100000; ++i) {
+    Array *array = Array::create(gc, 1);
+    elements(array)[0] = makeNumber(i);
+    *churn = CBValue::encodeObjectValue(array);
+  }
+  gc.collectYoung();
+  size_t nodes = 0;
+  forEachNode(*root, [&](Array *node) {
+    EXPECT_EQ(3u, node->getLength());
+    EXPECT_TRUE(elements(node)[2].isUndefined());
+    ++nodes;
+  });
+  EXPECT_EQ((1u << kDepth) - 1, nodes);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    Threads,
+    ParallelMarkerTest,
+    ::testing::Values(1u, 2u, 4u));
+
+} // anonymous namespace
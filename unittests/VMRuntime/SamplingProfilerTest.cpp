@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifdef COBRA_SAMPLING_PROFILER
+
+#include "TestHelpers.h"
+
+#include "cobra/VM/SamplingProfiler.h"
+
+#include <atomic>
+#include <thread>
+
+#include <time.h>
+
+using namespace cobra;
+using namespace cobra::vm;
+using namespace cobra::inst;
+
+namespace {
+
+/// \return the CPU time of the calling thread in milliseconds.
+uint64_t threadCPUTimeMs() {
+  struct timespec now;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  return (uint64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+using SamplingProfilerTest = RuntimeTestFixture;
+
+TEST_F(SamplingProfilerTest, SamplesOnlyTheProfiledThread) {
+  // Count to 100000 in a loop.
+  BytecodeBuilder builder;
+  builder.emit(LoadConstZeroInst{OpCode::LoadConstZero, 0});
+  builder.emit(LoadConstUInt8Inst{OpCode::LoadConstUInt8, 1, 1});
+  builder.emit(LoadConstDoubleInst{OpCode::LoadConstDouble, 2, 100000});
+  uint32_t loop = builder.emit(AddInst{OpCode::Add, 0, 0, 1});
+  uint32_t jump = builder.getOffset();
+  builder.emit(JLessInst{OpCode::JLess, (int8_t)(loop - jump), 0, 2});
+  builder.emit(RetInst{OpCode::Ret, 0});
+
+  // Another thread burns CPU time while the runtime is profiled, none of the
+  // ticks of the profiled thread may be lost to it.
+  std::atomic<bool> done{false};
+  std::thread spinner([&done] {
+    while (!done.load(std::memory_order_relaxed)) {
+    }
+  });
+
+  SamplingProfiler profiler;
+  ASSERT_TRUE(profiler.start(runtime, 1000));
+  uint64_t start = threadCPUTimeMs();
+  while (threadCPUTimeMs() - start < 200) {
+    CBValue result = CBValue::encodeUndefinedValue();
+    ASSERT_TRUE(builder.run(*runtime, 3, {result}, result));
+  }
+  profiler.stop();
+  done = true;
+  spinner.join();
+
+  EXPECT_FALSE(profiler.getSamples().empty());
+  EXPECT_EQ(0u, profiler.getDroppedSamples());
+}
+
+} // anonymous namespace
+
+#endif
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#ifndef TestHelpers_h
+#define TestHelpers_h
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+#include "cobra/Inst/Inst.h"
+#include "cobra/VM/Array.h"
+#include "cobra/VM/Interpreter.h"
+#include "cobra/VM/Operations.h"
+#include "cobra/VM/Runtime.h"
+#include "cobra/VM/StackFrame.h"
+
+#include "gtest/gtest.h"
+
+namespace cobra {
+namespace vm {
+
+/// A test with a runtime of its own, current on the thread of the test.
+class RuntimeTestFixture : public ::testing::Test {
+protected:
+  RuntimeTestFixture()
+      : runtime(Runtime::create(RuntimeOptions())), gc(runtime->getHeap()) {}
+
+  ~RuntimeTestFixture() override {
+    Runtime::destroy();
+  }
+
+  Runtime *runtime;
+  GC &gc;
+};
+
+/// A test of the heap, whose roots are registers allocated on the register
+/// stack of the runtime.
+class HeapTestFixture : public RuntimeTestFixture {
+protected:
+  /// \return \p count registers, all undefined, scanned by every collection.
+  CBValue *allocateRoots(uint32_t count) {
+    CBValue *roots = runtime->getRegisterStack().allocate(count);
+    std::fill_n(roots, count, CBValue::encodeUndefinedValue());
+    return roots;
+  }
+
+  /// \return the elements of \p array.
+  static CBValue *elements(Array *array) {
+    return reinterpret_cast<CBValue *>(array->getData());
+  }
+
+  static Array *toArray(CBValue value) {
+    return static_cast<Array *>(value.getObject());
+  }
+
+  /// Store \p value in the element \p index of \p array, through the write
+  /// barrier.
+  void store(Array *array, uint32_t index, CBValue value) {
+    CBValue *slot = elements(array) + index;
+    gc.writeBarrier(array, slot, value);
+    *slot = value;
+  }
+};
+
+/// The bytecode of a method without a Method, written one instruction at a
+/// time and run in a frame of its own.
+class BytecodeBuilder {
+public:
+  /// Append \p inst.
+  /// \return the offset of \p inst.
+  template <typename Inst>
+  uint32_t emit(const Inst &inst) {
+    uint32_t offset = getOffset();
+    bytes_.resize(offset + sizeof(Inst));
+    std::memcpy(&bytes_[offset], &inst, sizeof(Inst));
+    return offset;
+  }
+
+  /// \return the offset of the next instruction.
+  uint32_t getOffset() const {
+    return (uint32_t)bytes_.size();
+  }
+
+  const std::vector<uint8_t> &getBytes() const {
+    return bytes_;
+  }
+
+  /// Run the bytecode in a frame of \p frameSize registers, the first ones
+  /// set to \p args and the others undefined.
+  /// \return false if the bytecode raised an error.
+  bool run(
+      Runtime &runtime,
+      uint32_t frameSize,
+      std::initializer_list<CBValue> args,
+      CBValue &result) {
+    RegisterStack &stack = runtime.getRegisterStack();
+    StackFrame *frame = StackFrame::createWithFrameSize(
+        stack,
+        runtime.getCurrentFrame(),
+        nullptr,
+        frameSize,
+        0,
+        stack.getTop(),
+        &result);
+    std::copy(args.begin(), args.end(), frame->getRegisters());
+    frame->setInstructions(bytes_.data());
+    return Interpreter::run(frame);
+  }
+
+private:
+  std::vector<uint8_t> bytes_{};
+};
+
+inline CBValue makeNumber(double number) {
+  return CBValue::encodeUntrustedNumberValue(number);
+}
+
+inline std::string toStdString(CBValue value) {
+  std::u16string str;
+  appendToString(value, str);
+  return std::string(str.begin(), str.end());
+}
+
+}
+}
+
+#endif /* TestHelpers_h */
@@ -0,0 +1,152 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "TestHelpers.h"
+
+#include "cobra/VM/Verifier.h"
+
+using namespace cobra;
+using namespace cobra::vm;
+using namespace cobra::inst;
+
+namespace {
+
+class VerifierTest : public ::testing::Test {
+protected:
+  VerifierTest() : method(nullptr, 0, "V") {
+    method.setFrameSize(4);
+    method.setArgCount(1);
+  }
+
+  /// Verify the bytecode of \p builder as the code of the method.
+  bool verify(const BytecodeBuilder &builder) {
+    const std::vector<uint8_t> &bytes = builder.getBytes();
+    method.setInstructions(bytes.data(), (uint32_t)bytes.size());
+    return Verifier::verify(&method, (uint32_t)bytes.size(), error);
+  }
+
+  /// \return true if the error reported contains \p message.
+  bool failedWith(const char *message) const {
+    return error.find(message) != std::string::npos;
+  }
+
+  Method method;
+  std::string error;
+};
+
+TEST_F(VerifierTest, AcceptsValidCode) {
+  BytecodeBuilder builder;
+  builder.emit(LoadParamInst{OpCode::LoadParam, 0, 1});
+  builder.emit(LoadConstZeroInst{OpCode::LoadConstZero, 1});
+  builder.emit(JmpTrueInst{OpCode::JmpTrue, 5, 0});
+  builder.emit(RetInst{OpCode::Ret, 1});
+  builder.emit(RetInst{OpCode::Ret, 0});
+  ASSERT_TRUE(verify(builder)) << error;
+  EXPECT_TRUE(method.isVerified());
+  // The checked instructions are rewritten.
+  EXPECT_EQ(
+      (uint8_t)OpCode::LoadParamUnchecked, method.getInstructions()[0]);
+}
+
+TEST_F(VerifierTest, AcceptsUnreachableAsTerminator) {
+  BytecodeBuilder builder;
+  builder.emit(LoadConstZeroInst{OpCode::LoadConstZero, 0});
+  builder.emit(UnreachableInst{OpCode::Unreachable});
+  EXPECT_TRUE(verify(builder)) << error;
+}
+
+TEST_F(VerifierTest, RejectsMalformedCode) {
+  BytecodeBuilder empty;
+  EXPECT_FALSE(verify(empty));
+  EXPECT_TRUE(failedWith("empty code"));
+
+  BytecodeBuilder invalid;
+  invalid.emit(OpCode::_last);
+  EXPECT_FALSE(verify(invalid));
+  EXPECT_TRUE(failedWith("invalid opcode"));
+
+  BytecodeBuilder truncated;
+  truncated.emit(OpCode::Add);
+  truncated.emit((uint8_t)0);
+  EXPECT_FALSE(verify(truncated));
+  EXPECT_TRUE(failedWith("truncated instruction"));
+
+  BytecodeBuilder fallsThrough;
+  fallsThrough.emit(LoadConstZeroInst{OpCode::LoadConstZero, 0});
+  EXPECT_FALSE(verify(fallsThrough));
+  EXPECT_TRUE(failedWith("falls through the end"));
+  EXPECT_FALSE(method.isVerified());
+}
+
+TEST_F(VerifierTest, RejectsRegistersOutOfFrame) {
+  BytecodeBuilder narrow;
+  narrow.emit(AddInst{OpCode::Add, 0, 1, 4});
+  narrow.emit(RetInst{OpCode::Ret, 0});
+  EXPECT_FALSE(verify(narrow));
+  EXPECT_TRUE(failedWith("register out of frame bounds"));
+
+  BytecodeBuilder wide;
+  wide.emit(RetWideInst{OpCode::RetWide, 300});
+  EXPECT_FALSE(verify(wide));
+  EXPECT_TRUE(failedWith("register out of frame bounds"));
+}
+
+TEST_F(VerifierTest, RejectsJumpsOutOfInstructions) {
+  BytecodeBuilder intoInstruction;
+  intoInstruction.emit(JmpInst{OpCode::Jmp, 3});
+  intoInstruction.emit(AddInst{OpCode::Add, 0, 1, 2});
+  intoInstruction.emit(RetInst{OpCode::Ret, 0});
+  EXPECT_FALSE(verify(intoInstruction));
+  EXPECT_TRUE(failedWith("jump target is not an instruction"));
+
+  BytecodeBuilder beforeCode;
+  beforeCode.emit(RetInst{OpCode::Ret, 0});
+  beforeCode.emit(JmpLongInst{OpCode::JmpLong, -3});
+  EXPECT_FALSE(verify(beforeCode));
+  EXPECT_TRUE(failedWith("jump target is not an instruction"));
+
+  BytecodeBuilder pastCode;
+  pastCode.emit(JmpTrueWideInst{OpCode::JmpTrueWide, 100, 0});
+  pastCode.emit(RetInst{OpCode::Ret, 0});
+  EXPECT_FALSE(verify(pastCode));
+  EXPECT_TRUE(failedWith("jump target is not an instruction"));
+}
+
+TEST_F(VerifierTest, RejectsOperandsOutOfRange) {
+  // The method has no file, so it has no string.
+  BytecodeBuilder string;
+  string.emit(GetFieldInst{OpCode::GetField, 0, 1, kNoInlineCacheIndex, 0});
+  string.emit(RetInst{OpCode::Ret, 0});
+  EXPECT_FALSE(verify(string));
+  EXPECT_TRUE(failedWith("string ID out of range"));
+
+  BytecodeBuilder param;
+  param.emit(LoadParamInst{OpCode::LoadParam, 0, 2});
+  param.emit(RetInst{OpCode::Ret, 0});
+  EXPECT_FALSE(verify(param));
+  EXPECT_TRUE(failedWith("parameter is not declared"));
+
+  BytecodeBuilder unchecked;
+  unchecked.emit(LoadParamUncheckedInst{OpCode::LoadParamUnchecked, 0, 1});
+  unchecked.emit(RetInst{OpCode::Ret, 0});
+  EXPECT_FALSE(verify(unchecked));
+  EXPECT_TRUE(failedWith("unchecked instruction"));
+
+  BytecodeBuilder noThis;
+  noThis.emit(CallInst{OpCode::Call, 0, 1, 0});
+  noThis.emit(RetInst{OpCode::Ret, 0});
+  EXPECT_FALSE(verify(noThis));
+  EXPECT_TRUE(failedWith("invalid argument count"));
+
+  BytecodeBuilder tooMany;
+  tooMany.emit(CallInst{OpCode::Call, 0, 1, 5});
+  tooMany.emit(RetInst{OpCode::Ret, 0});
+  EXPECT_FALSE(verify(tooMany));
+  EXPECT_TRUE(failedWith("invalid argument count"));
+}
+
+} // anonymous namespace
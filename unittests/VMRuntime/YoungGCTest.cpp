@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) the Cobra project authors.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "TestHelpers.h"
+
+#include "cobra/VM/String.h"
+
+using namespace cobra;
+using namespace cobra::vm;
+
+namespace {
+
+class YoungGCTest : public HeapTestFixture {
+protected:
+  /// \return the bytes allocated in the old generation.
+  size_t getOldBytes() {
+    size_t bytes = 0;
+    for (HeapRegion *region : gc.getOldSpace().getRegions())
+      bytes += region->top() - region->start();
+    return bytes;
+  }
+};
+
+TEST_F(YoungGCTest, PromotesSurvivors) {
+  CBValue *roots = allocateRoots(1);
+  Array *array = Array::create(gc, 3);
+  elements(array)[0] = makeNumber(42);
+  roots[0] = CBValue::encodeObjectValue(array);
+  ASSERT_TRUE(gc.getYoungSpace().contains(array));
+
+  gc.collectYoung();
+  EXPECT_EQ(1u, gc.getYoungCollectionCount());
+  Array *promoted = toArray(roots[0]);
+  EXPECT_NE(array, promoted);
+  EXPECT_TRUE(gc.getOldSpace().contains(promoted));
+  ASSERT_EQ(3u, promoted->getLength());
+  EXPECT_EQ(42, elements(promoted)[0].getNumber());
+  EXPECT_TRUE(elements(promoted)[1].isUndefined());
+}
+
+TEST_F(YoungGCTest, DoesNotPromoteGarbage) {
+  CBValue *roots = allocateRoots(1);
+  roots[0] = CBValue::encodeObjectValue(Array::create(gc, 1));
+  gc.collectYoung();
+  size_t oldBytes = getOldBytes();
+
+  for (int i = 0; i < 1000; ++i)
+    Array::create(gc, 4);
+  gc.collectYoung();
+  EXPECT_EQ(oldBytes, getOldBytes());
+}
+
+TEST_F(YoungGCTest, ScansTheCardsOfOldObjects) {
+  CBValue *roots = allocateRoots(1);
+  roots[0] = CBValue::encodeObjectValue(Array::create(gc, 64));
+  gc.collectYoung();
+  Array *old = toArray(roots[0]);
+  ASSERT_TRUE(gc.getOldSpace().contains(old));
+
+  // The only references to the young objects are in the old array.
+  Array *young = Array::create(gc, 2);
+  String *str = String::create(gc, "abc", 3);
+  elements(young)[1] = CBValue::encodeStringValue(str);
+  store(old, 63, CBValue::encodeObjectValue(young));
+  gc.collectYoung();
+
+  EXPECT_EQ(old, toArray(roots[0]));
+  Array *promoted = toArray(elements(old)[63]);
+  EXPECT_NE(young, promoted);
+  EXPECT_TRUE(gc.getOldSpace().contains(promoted));
+  auto *promotedStr = static_cast<String *>(elements(promoted)[1].getPointer());
+  EXPECT_TRUE(gc.getOldSpace().contains(promotedStr));
+  ASSERT_EQ(3u, promotedStr->getLength());
+  EXPECT_EQ(0, memcmp("abc", promotedStr->getDataCompressed(), 3));
+  EXPECT_TRUE(elements(old)[62].isUndefined());
+}
+
+TEST_F(YoungGCTest, AllocationsCollectTheYoungGeneration) {
+  // A chain outgrowing the young generation, linked from young to old.
+  CBValue *roots = allocateRoots(1);
+  int count = 0;
+  for (; gc.getYoungCollectionCount() < 3; ++count) {
+    ASSERT_LT(count, 10000000);
+    Array *link = Array::create(gc, 2);
+    ASSERT_NE(nullptr, link);
+    elements(link)[0] = roots[0];
+    elements(link)[1] = makeNumber(count);
+    roots[0] = CBValue::encodeObjectValue(link);
+  }
+  EXPECT_EQ(GC::kYoungRegionCount, gc.getYoungSpace().getRegionCount());
+
+  int length = 0;
+  for (CBValue link = roots[0]; link.isObject();
+       link = elements(toArray(link))[0]) {
+    ASSERT_EQ(count - 1 - length, elements(toArray(link))[1].getNumber());
+    ++length;
+  }
+  EXPECT_EQ(count, length);
+}
+
+} // anonymous namespace